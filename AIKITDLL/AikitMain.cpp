@@ -107,6 +107,8 @@ extern "C"
 
 		// 清理退出操作
 		AIKIT::AIKIT_UnInit();
+		AIKITDLL::ivwEngineLoaded.store(false);
+		AIKITDLL::esrEngineLoaded.store(false);
 		AIKITDLL::LogDebug("命令词识别启动成功\n");
 		AIKITDLL::lastResult = "SUCCESS: 命令词识别成功";
 		return 0;
@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "AikitSession.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <cstring>
+#include <mutex>
+
+// 一类错误的重试策略
+struct AikitRetryPolicy {
+	int maxRetries;
+	unsigned int backoffMs;
+};
+
+static std::mutex g_statsMutex;
+static AikitCallStats g_stats[AIKIT_CALL_COUNT];
+static AikitRetryPolicy g_policies[AIKIT_ERROR_CLASS_COUNT] = {
+	{ 1, 0 },   // AIKIT_ERROR_SESSION
+	{ 0, 0 }    // AIKIT_ERROR_OTHER
+};
+
+static void record_call(AikitCall call, unsigned long long beginUs, int ret)
+{
+	long long us = (long long)(audio_source_now_us() - beginUs);
+	int bucket = 0;
+	while (bucket < AIKIT_LATENCY_BUCKETS - 1 && (us >> (bucket + 1)) != 0) {
+		bucket++;
+	}
+	std::lock_guard<std::mutex> lock(g_statsMutex);
+	AikitCallStats& s = g_stats[call];
+	s.calls++;
+	if (ret != 0) {
+		s.failures++;
+	}
+	s.totalUs += us;
+	if (us > s.maxUs) {
+		s.maxUs = us;
+	}
+	s.buckets[bucket]++;
+}
+
+// 分位数取所在桶的上界，最后一个桶用最大值
+static long long bucket_percentile(const AikitCallStats& s, double q)
+{
+	if (s.calls == 0) {
+		return 0;
+	}
+	unsigned long long rank = (unsigned long long)(q * s.calls);
+	if (rank >= s.calls) {
+		rank = s.calls - 1;
+	}
+	unsigned long long seen = 0;
+	for (int i = 0; i < AIKIT_LATENCY_BUCKETS - 1; ++i) {
+		seen += s.buckets[i];
+		if (seen > rank) {
+			long long upper = 1LL << (i + 1);
+			return upper < s.maxUs ? upper : s.maxUs;
+		}
+	}
+	return s.maxUs;
+}
+
+namespace AIKITDLL {
+
+	AikitErrorClass ClassifyAikitError(int err) {
+		switch (err) {
+		case 18310:   // 会话已存在
+		case 18301:   // 授权状态错误，通常是上一个会话没有正常结束
+			return AIKIT_ERROR_SESSION;
+		default:
+			return AIKIT_ERROR_OTHER;
+		}
+	}
+
+	AikitSession::AikitSession(const char* abilityID, void* context)
+		: m_ability(abilityID), m_context(context), m_handle(nullptr)
+	{
+	}
+
+	AikitSession::~AikitSession() {
+		End();
+	}
+
+	int AikitSession::Start(AIKIT_BizParam* params, AikitRecoverFn recover, void* arg) {
+		if (m_handle != nullptr) {
+			LogError("AikitSession: %s 已在会话中，不能重复开始", m_ability ? m_ability : "");
+			return -1;
+		}
+		int retries = 0;
+		for (;;) {
+			unsigned long long begin = audio_source_now_us();
+			int ret = AIKIT::AIKIT_Start(m_ability, params, m_context, &m_handle);
+			record_call(AIKIT_CALL_START, begin, ret);
+			if (ret == 0) {
+				return 0;
+			}
+			// 失败时SDK可能留下了残留的句柄，结束它再决定是否重试
+			End();
+
+			AikitErrorClass cls = ClassifyAikitError(ret);
+			AikitRetryPolicy policy;
+			{
+				std::lock_guard<std::mutex> lock(g_statsMutex);
+				policy = g_policies[cls];
+				if (retries < policy.maxRetries) {
+					g_stats[AIKIT_CALL_START].retries++;
+				}
+			}
+			if (retries >= policy.maxRetries) {
+				return ret;
+			}
+			retries++;
+			LogWarning("AikitSession: %s 启动失败，错误码: %d，第 %d 次重试", m_ability ? m_ability : "", ret, retries);
+			if (policy.backoffMs > 0) {
+				Sleep(policy.backoffMs);
+			}
+			if (recover && recover(ret, arg) != 0) {
+				LogError("AikitSession: 恢复失败，放弃重试");
+				return ret;
+			}
+		}
+	}
+
+	int AikitSession::Write(AIKIT_InputData* input) {
+		if (m_handle == nullptr) {
+			return -1;
+		}
+		unsigned long long begin = audio_source_now_us();
+		int ret = AIKIT::AIKIT_Write(m_handle, input);
+		record_call(AIKIT_CALL_WRITE, begin, ret);
+		return ret;
+	}
+
+	int AikitSession::Read(AIKIT_OutputData** output) {
+		if (m_handle == nullptr) {
+			return -1;
+		}
+		unsigned long long begin = audio_source_now_us();
+		int ret = AIKIT::AIKIT_Read(m_handle, output);
+		record_call(AIKIT_CALL_READ, begin, ret);
+		return ret;
+	}
+
+	int AikitSession::End() {
+		if (m_handle == nullptr) {
+			return 0;
+		}
+		AIKIT_HANDLE* handle = m_handle;
+		m_handle = nullptr;
+		unsigned long long begin = audio_source_now_us();
+		int ret = AIKIT::AIKIT_End(handle);
+		record_call(AIKIT_CALL_END, begin, ret);
+		if (ret != 0) {
+			LogWarning("AikitSession: %s 结束会话失败，错误码: %d", m_ability ? m_ability : "", ret);
+		}
+		return ret;
+	}
+}
+
+int GetAikitCallStats(int call, AikitCallStats* stats)
+{
+	if (call < 0 || call >= AIKIT_CALL_COUNT || stats == nullptr) {
+		return -1;
+	}
+	std::lock_guard<std::mutex> lock(g_statsMutex);
+	*stats = g_stats[call];
+	stats->p50Us = bucket_percentile(*stats, 0.5);
+	stats->p99Us = bucket_percentile(*stats, 0.99);
+	return 0;
+}
+
+void ResetAikitCallStats()
+{
+	std::lock_guard<std::mutex> lock(g_statsMutex);
+	memset(g_stats, 0, sizeof(g_stats));
+}
+
+int SetAikitRetryPolicy(int errorClass, int maxRetries, int backoffMs)
+{
+	if (errorClass < 0 || errorClass >= AIKIT_ERROR_CLASS_COUNT || maxRetries < 0 || backoffMs < 0) {
+		return -1;
+	}
+	std::lock_guard<std::mutex> lock(g_statsMutex);
+	g_policies[errorClass].maxRetries = maxRetries;
+	g_policies[errorClass].backoffMs = (unsigned int)backoffMs;
+	AIKITDLL::LogInfo("AIKIT启动重试策略: 类别 %d 最多重试 %d 次，间隔 %d ms", errorClass, maxRetries, backoffMs);
+	return 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "aikit_biz_api.h"
+
+// 会话上的SDK调用
+enum AikitCall {
+	AIKIT_CALL_START = 0,   // AIKIT_Start，含重试中的每一次
+	AIKIT_CALL_WRITE,       // AIKIT_Write
+	AIKIT_CALL_READ,        // AIKIT_Read
+	AIKIT_CALL_END,         // AIKIT_End
+	AIKIT_CALL_COUNT
+};
+
+// 启动失败的错误类别，重试策略按类别配置
+enum AikitErrorClass {
+	AIKIT_ERROR_SESSION = 0,  // 会话已存在或授权状态错误（18310、18301）：结束残留会话、恢复引擎后可以重试
+	AIKIT_ERROR_OTHER,        // 参数、资源等其他错误，默认不重试
+	AIKIT_ERROR_CLASS_COUNT
+};
+
+// 耗时分布的桶数：第0个桶为[0, 2)微秒，第i个桶为[2^i, 2^(i+1))微秒，最后一个桶不设上限
+#define AIKIT_LATENCY_BUCKETS 24
+
+// 一种调用的统计
+struct AikitCallStats {
+	unsigned long long calls;      // 调用次数
+	unsigned long long failures;   // 返回非0的次数
+	unsigned long long retries;    // 按重试策略重新启动的次数（只有Start有）
+	long long totalUs;             // 累计耗时（微秒）
+	long long maxUs;               // 最长一次（微秒）
+	long long p50Us;               // 中位数，取所在桶的上界（微秒）
+	long long p99Us;               // 99分位，取所在桶的上界（微秒）
+	unsigned long long buckets[AIKIT_LATENCY_BUCKETS];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取调用call（AikitCall）的耗时统计，成功返回0
+	AIKITDLL_API int GetAikitCallStats(int call, AikitCallStats* stats);
+
+	// 清零所有调用的统计
+	AIKITDLL_API void ResetAikitCallStats();
+
+	// 设置一类启动错误（AikitErrorClass）的重试策略：最多重试maxRetries次，每次重试前等待backoffMs毫秒。
+	// 默认会话状态错误重试1次、不等待，其他错误不重试。成功返回0
+	AIKITDLL_API int SetAikitRetryPolicy(int errorClass, int maxRetries, int backoffMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace AIKITDLL {
+	// 按错误码区分启动失败的类别
+	AikitErrorClass ClassifyAikitError(int err);
+
+	// 重试之前的恢复动作（如卸载并重新加载引擎），返回非0表示无法恢复，不再重试
+	typedef int (*AikitRecoverFn)(int err, void* arg);
+
+	// 一个AIKIT会话：Start成功后由End或析构结束，保证只结束一次；每次SDK调用都计入耗时统计，
+	// 启动失败时按错误类别的重试策略处理。不是线程安全的，同一会话上的调用由调用方串行化
+	class AikitSession {
+	public:
+		// context作为SDK的用户上下文，回调时从handle->usrContext取回
+		explicit AikitSession(const char* abilityID, void* context = nullptr);
+		~AikitSession();
+
+		AikitSession(const AikitSession&) = delete;
+		AikitSession& operator=(const AikitSession&) = delete;
+
+		// 开始会话，失败时按重试策略重试，每次重试前调用recover（可为NULL）。已在会话中时返回-1
+		int Start(AIKIT_BizParam* params, AikitRecoverFn recover = nullptr, void* arg = nullptr);
+		int Write(AIKIT_InputData* input);
+		int Read(AIKIT_OutputData** output);
+		// 结束会话；没有进行中的会话时直接返回0，不调用SDK
+		int End();
+
+		bool Active() const { return m_handle != nullptr; }
+		AIKIT_HANDLE* Handle() const { return m_handle; }
+		const char* Ability() const { return m_ability; }
+
+	private:
+		const char* m_ability;
+		void* m_context;
+		AIKIT_HANDLE* m_handle;
+	};
+}
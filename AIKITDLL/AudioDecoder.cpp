@@ -0,0 +1,476 @@
+#include "pch.h"
+#include "AudioDecoder.h"
+#include "Common.h"
+#include "resample.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AD_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	const unsigned int ENGINE_RATE = 16000;
+
+	// WAVE格式码
+	const unsigned short WAVE_FORMAT_PCM_CODE = 0x0001;
+	const unsigned short WAVE_FORMAT_FLOAT_CODE = 0x0003;
+	const unsigned short WAVE_FORMAT_ALAW_CODE = 0x0006;
+	const unsigned short WAVE_FORMAT_MULAW_CODE = 0x0007;
+	const unsigned short WAVE_FORMAT_EXTENSIBLE_CODE = 0xFFFE;
+
+	// KSDATAFORMAT_SUBTYPE_xxx的GUID除前两个字节（格式码）以外的部分
+	const unsigned char SUBFORMAT_TAIL[14] = {
+		0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+	};
+
+	unsigned short ReadU16(const unsigned char* p) {
+		return (unsigned short)(p[0] | (p[1] << 8));
+	}
+
+	unsigned int ReadU32(const unsigned char* p) {
+		return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+	}
+
+	// G.711解码表，按ITU-T G.711的分段规则展开，查表即可还原16bit线性值
+	struct G711Tables {
+		short alaw[256];
+		short mulaw[256];
+
+		G711Tables() {
+			for (int i = 0; i < 256; ++i) {
+				int a = i ^ 0x55;
+				int t = (a & 0x0F) << 4;
+				int seg = (a & 0x70) >> 4;
+				if (seg == 0) {
+					t += 8;
+				}
+				else {
+					t += 0x108;
+					if (seg > 1) {
+						t <<= seg - 1;
+					}
+				}
+				alaw[i] = (short)((a & 0x80) ? t : -t);
+
+				int u = ~i & 0xFF;
+				int m = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+				mulaw[i] = (short)((u & 0x80) ? (0x84 - m) : (m - 0x84));
+			}
+		}
+	};
+
+	const G711Tables& GetG711Tables() {
+		static G711Tables tables;
+		return tables;
+	}
+
+	void ConvertFloat(const char* data, unsigned int samples, short* out) {
+		unsigned int i = 0;
+#ifdef AD_X86
+		// 每次8个样本：NaN置0（max/min遇到NaN会返回-1，成为满幅的爆音），限幅、缩放、取整后饱和打包成16bit
+		const __m128 lo = _mm_set1_ps(-1.0f);
+		const __m128 hi = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(32767.0f);
+		for (; i + 8 <= samples; i += 8) {
+			__m128 a = _mm_loadu_ps((const float*)(data + i * 4));
+			__m128 b = _mm_loadu_ps((const float*)(data + i * 4 + 16));
+			a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+			b = _mm_and_ps(b, _mm_cmpord_ps(b, b));
+			a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(a, lo), hi), scale);
+			b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(b, lo), hi), scale);
+			__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+			_mm_storeu_si128((__m128i*)(out + i), packed);
+		}
+#endif
+		for (; i < samples; ++i) {
+			float v;
+			memcpy(&v, data + i * 4, sizeof(v));
+			// NaN不满足任何比较，按静音处理
+			if (!(v == v)) {
+				v = 0.0f;
+			}
+			v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+			float scaled = v * 32767.0f;
+			out[i] = (short)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+		}
+	}
+
+	const char* EncodingName(int encoding) {
+		switch (encoding) {
+		case AUDIO_ENCODING_PCM16: return "PCM16";
+		case AUDIO_ENCODING_PCM24: return "PCM24";
+		case AUDIO_ENCODING_FLOAT32: return "float32";
+		case AUDIO_ENCODING_ALAW: return "A-law";
+		case AUDIO_ENCODING_MULAW: return "mu-law";
+		default: return "unknown";
+		}
+	}
+}
+
+namespace AIKITDLL {
+
+	AudioDecoder::AudioDecoder()
+		: m_passthrough(false), m_dataRemain(-1), m_outPos(0), m_headLen(0), m_headPos(0),
+		m_resampler(nullptr), m_outBegin(0) {
+		memset(&m_format, 0, sizeof(m_format));
+	}
+
+	AudioDecoder::~AudioDecoder() {
+		Close();
+	}
+
+	int AudioDecoder::Open(const char* path) {
+		Close();
+		int err = m_reader.Open(path);
+		if (err != 0) {
+			return err;
+		}
+
+		unsigned int len = 0;
+		const char* head = m_reader.Next(sizeof(m_head), &len);
+		if (head != nullptr) {
+			memcpy(m_head, head, len);
+		}
+		m_headLen = len;
+
+		int ret = 0;
+		if (len >= 4 && memcmp(m_head, "RIFF", 4) == 0) {
+			if (len < 12 || memcmp(m_head + 8, "WAVE", 4) != 0) {
+				LogError("AudioDecoder: RIFF文件不是WAVE格式: %s", path);
+				ret = E_AUDIO_FORMAT;
+			}
+			else {
+				m_headLen = 0;
+				m_format.container = AUDIO_CONTAINER_WAV;
+				ret = ParseWav();
+			}
+		}
+		else {
+			// 没有文件头：沿用原来的约定，按16k/16bit单声道PCM处理，已读出的开头几个字节随后输出
+			m_format.container = AUDIO_CONTAINER_RAW;
+			m_format.encoding = AUDIO_ENCODING_PCM16;
+			m_format.sampleRate = ENGINE_RATE;
+			m_format.channels = 1;
+			m_format.blockAlign = 2;
+			m_format.dataBytes = m_reader.Size();
+			m_dataRemain = -1;
+		}
+		if (ret != 0) {
+			Close();
+			return ret;
+		}
+
+		m_passthrough = m_format.encoding == AUDIO_ENCODING_PCM16 && m_format.sampleRate == ENGINE_RATE
+			&& m_format.channels == 1;
+		if (!m_passthrough) {
+			unsigned int maxFrames = AUDIO_DECODE_BLOCK_BYTES / m_format.blockAlign;
+			m_resampler = resampler_create(m_format.sampleRate, m_format.channels, ENGINE_RATE, maxFrames);
+			if (m_resampler == nullptr) {
+				LogError("AudioDecoder: 创建重采样器失败（%u Hz，%u 声道）", m_format.sampleRate, m_format.channels);
+				Close();
+				return E_AUDIO_FORMAT;
+			}
+			m_pcm.resize((size_t)maxFrames * m_format.channels);
+		}
+		LogInfo("AudioDecoder: %s %s，%u Hz，%u 声道，数据 %lld 字节%s",
+			m_format.container == AUDIO_CONTAINER_WAV ? "WAV" : "无文件头",
+			EncodingName(m_format.encoding), m_format.sampleRate, m_format.channels, m_format.dataBytes,
+			m_passthrough ? "，直接送入引擎" : "，转换为16k单声道");
+		return 0;
+	}
+
+	void AudioDecoder::Close() {
+		m_reader.Close();
+		if (m_resampler != nullptr) {
+			resampler_destroy(m_resampler);
+			m_resampler = nullptr;
+		}
+		memset(&m_format, 0, sizeof(m_format));
+		m_passthrough = false;
+		m_dataRemain = -1;
+		m_outPos = 0;
+		m_headLen = m_headPos = 0;
+		m_pcm.clear();
+		m_out.clear();
+		m_outBegin = 0;
+		m_stage.clear();
+	}
+
+	bool AudioDecoder::ReadExact(void* dst, unsigned int n) {
+		unsigned int len = 0;
+		const char* data = m_reader.Next(n, &len);
+		if (data == nullptr || len < n) {
+			return false;
+		}
+		memcpy(dst, data, n);
+		return true;
+	}
+
+	bool AudioDecoder::Skip(unsigned long long n) {
+		while (n > 0) {
+			unsigned int want = n < AUDIO_FILE_STREAM_BYTES ? (unsigned int)n : AUDIO_FILE_STREAM_BYTES;
+			unsigned int len = 0;
+			if (m_reader.Next(want, &len) == nullptr || len < want) {
+				return false;
+			}
+			n -= len;
+		}
+		return true;
+	}
+
+	int AudioDecoder::ParseWav() {
+		unsigned char chunk[8];
+		unsigned char fmt[40];
+		bool haveFmt = false;
+
+		// 逐个块查找fmt和data，其他块（LIST、fact、cue等）跳过；块长为奇数时后面有一个填充字节
+		for (;;) {
+			if (!ReadExact(chunk, sizeof(chunk))) {
+				LogError("AudioDecoder: WAV文件在找到%s块之前结束", haveFmt ? "data" : "fmt");
+				return E_AUDIO_FORMAT;
+			}
+			unsigned int size = ReadU32(chunk + 4);
+
+			if (memcmp(chunk, "fmt ", 4) == 0) {
+				if (size < 16) {
+					LogError("AudioDecoder: fmt块太短（%u 字节）", size);
+					return E_AUDIO_FORMAT;
+				}
+				unsigned int keep = size < sizeof(fmt) ? size : (unsigned int)sizeof(fmt);
+				if (!ReadExact(fmt, keep) || !Skip((unsigned long long)(size - keep) + (size & 1))) {
+					LogError("AudioDecoder: fmt块不完整");
+					return E_AUDIO_FORMAT;
+				}
+				int ret = ParseFmt(fmt, keep);
+				if (ret != 0) {
+					return ret;
+				}
+				haveFmt = true;
+			}
+			else if (memcmp(chunk, "data", 4) == 0) {
+				if (!haveFmt) {
+					LogError("AudioDecoder: data块出现在fmt块之前");
+					return E_AUDIO_FORMAT;
+				}
+				long long fileRemain = m_reader.Size() >= 0 ? m_reader.Size() - (long long)m_reader.Position() : -1;
+				if (size == 0 || size == 0xFFFFFFFF) {
+					// 录音时先写头、结束后才回填长度的文件，长度还是0或-1：读到文件末尾
+					m_dataRemain = -1;
+				}
+				else if (fileRemain >= 0 && (long long)size > fileRemain) {
+					LogWarning("AudioDecoder: data块长度 %u 超出文件（剩余 %lld 字节），按实际长度读取", size, fileRemain);
+					m_dataRemain = fileRemain;
+				}
+				else {
+					m_dataRemain = size;
+				}
+				m_format.dataBytes = m_dataRemain >= 0 ? m_dataRemain : fileRemain;
+				return 0;
+			}
+			else if (!Skip((unsigned long long)size + (size & 1))) {
+				LogError("AudioDecoder: WAV文件在找到data块之前结束");
+				return E_AUDIO_FORMAT;
+			}
+		}
+	}
+
+	int AudioDecoder::ParseFmt(const unsigned char* fmt, unsigned int len) {
+		unsigned short tag = ReadU16(fmt);
+		unsigned int channels = ReadU16(fmt + 2);
+		unsigned int rate = ReadU32(fmt + 4);
+		unsigned int blockAlign = ReadU16(fmt + 12);
+		unsigned int bits = ReadU16(fmt + 14);
+
+		if (tag == WAVE_FORMAT_EXTENSIBLE_CODE) {
+			if (len < 40 || memcmp(fmt + 26, SUBFORMAT_TAIL, sizeof(SUBFORMAT_TAIL)) != 0) {
+				LogError("AudioDecoder: 不支持的WAVE_FORMAT_EXTENSIBLE子格式");
+				return E_AUDIO_FORMAT;
+			}
+			tag = ReadU16(fmt + 24);
+		}
+
+		int encoding = -1;
+		if (tag == WAVE_FORMAT_PCM_CODE && bits == 16) {
+			encoding = AUDIO_ENCODING_PCM16;
+		}
+		else if (tag == WAVE_FORMAT_PCM_CODE && bits == 24) {
+			encoding = AUDIO_ENCODING_PCM24;
+		}
+		else if (tag == WAVE_FORMAT_FLOAT_CODE && bits == 32) {
+			encoding = AUDIO_ENCODING_FLOAT32;
+		}
+		else if (tag == WAVE_FORMAT_ALAW_CODE && bits == 8) {
+			encoding = AUDIO_ENCODING_ALAW;
+		}
+		else if (tag == WAVE_FORMAT_MULAW_CODE && bits == 8) {
+			encoding = AUDIO_ENCODING_MULAW;
+		}
+		if (encoding < 0) {
+			LogError("AudioDecoder: 不支持的编码（格式码 0x%04X，%u 位）", tag, bits);
+			return E_AUDIO_FORMAT;
+		}
+		if (channels < 1 || channels > 8) {
+			LogError("AudioDecoder: 不支持的声道数: %u", channels);
+			return E_AUDIO_FORMAT;
+		}
+		if (rate < 8000 || rate > 192000) {
+			LogError("AudioDecoder: 不支持的采样率: %u", rate);
+			return E_AUDIO_FORMAT;
+		}
+		if (blockAlign != channels * bits / 8) {
+			LogError("AudioDecoder: 帧长 %u 与 %u 声道 %u 位不符", blockAlign, channels, bits);
+			return E_AUDIO_FORMAT;
+		}
+
+		m_format.encoding = encoding;
+		m_format.sampleRate = rate;
+		m_format.channels = channels;
+		m_format.blockAlign = blockAlign;
+		return 0;
+	}
+
+	const char* AudioDecoder::NextInput(unsigned int maxLen, unsigned int* len) {
+		*len = 0;
+		if (m_dataRemain == 0) {
+			return nullptr;
+		}
+		if (m_dataRemain > 0 && (long long)maxLen > m_dataRemain) {
+			maxLen = (unsigned int)m_dataRemain;
+		}
+		const char* data = m_reader.Next(maxLen, len);
+		if (data != nullptr && m_dataRemain > 0) {
+			m_dataRemain -= *len;
+		}
+		return data;
+	}
+
+	void AudioDecoder::ConvertBlock(const char* data, unsigned int samples) {
+		short* out = m_pcm.data();
+		switch (m_format.encoding) {
+		case AUDIO_ENCODING_PCM16:
+			memcpy(out, data, (size_t)samples * 2);
+			break;
+		case AUDIO_ENCODING_PCM24: {
+			// 保留高16位，低8位在引擎的16bit精度以下
+			const unsigned char* p = (const unsigned char*)data;
+			for (unsigned int i = 0; i < samples; ++i, p += 3) {
+				out[i] = (short)(p[1] | (p[2] << 8));
+			}
+			break;
+		}
+		case AUDIO_ENCODING_FLOAT32:
+			ConvertFloat(data, samples, out);
+			break;
+		case AUDIO_ENCODING_ALAW:
+		case AUDIO_ENCODING_MULAW: {
+			const G711Tables& tables = GetG711Tables();
+			const short* table = m_format.encoding == AUDIO_ENCODING_ALAW ? tables.alaw : tables.mulaw;
+			const unsigned char* p = (const unsigned char*)data;
+			for (unsigned int i = 0; i < samples; ++i) {
+				out[i] = table[p[i]];
+			}
+			break;
+		}
+		}
+	}
+
+	bool AudioDecoder::DecodeBlock() {
+		unsigned int blockAlign = m_format.blockAlign;
+		unsigned int want = AUDIO_DECODE_BLOCK_BYTES - AUDIO_DECODE_BLOCK_BYTES % blockAlign;
+		unsigned int len = 0;
+		const char* data = NextInput(want, &len);
+		if (data == nullptr) {
+			return false;
+		}
+		// 只有最后一块可能不足整帧，截断的半帧丢弃
+		unsigned int frames = len / blockAlign;
+		if (frames * blockAlign != len) {
+			LogWarning("AudioDecoder: 数据末尾有 %u 字节不足一帧，已丢弃", len - frames * blockAlign);
+		}
+		if (frames == 0) {
+			return false;
+		}
+		ConvertBlock(data, frames * m_format.channels);
+
+		if (m_outBegin > 0) {
+			m_out.erase(m_out.begin(), m_out.begin() + m_outBegin);
+			m_outBegin = 0;
+		}
+		size_t used = m_out.size();
+		unsigned int cap = resampler_max_output(m_resampler, frames);
+		m_out.resize(used + cap);
+		unsigned int produced = resampler_process(m_resampler, m_pcm.data(), frames, m_out.data() + used, cap);
+		m_out.resize(used + produced);
+		return true;
+	}
+
+	const char* AudioDecoder::Next(unsigned int maxLen, unsigned int* len) {
+		*len = 0;
+		if (!m_reader.IsOpen()) {
+			return nullptr;
+		}
+		if (maxLen > AUDIO_FILE_STREAM_BYTES) {
+			maxLen = AUDIO_FILE_STREAM_BYTES;
+		}
+		maxLen &= ~1u;
+		if (maxLen == 0) {
+			return nullptr;
+		}
+
+		const char* data = nullptr;
+		if (m_passthrough) {
+			if (m_headPos < m_headLen) {
+				// 无文件头时开头的几个字节已经读出，与后面的数据拼成一段，保证只有末尾才不足maxLen
+				unsigned int head = m_headLen - m_headPos;
+				if (head > maxLen) {
+					head = maxLen;
+				}
+				m_stage.assign(m_head + m_headPos, m_head + m_headPos + head);
+				m_headPos += head;
+				unsigned int restLen = 0;
+				const char* rest = head < maxLen ? NextInput(maxLen - head, &restLen) : nullptr;
+				if (rest != nullptr) {
+					m_stage.insert(m_stage.end(), rest, rest + restLen);
+				}
+				*len = (unsigned int)m_stage.size();
+				data = m_stage.data();
+			}
+			else {
+				data = NextInput(maxLen, len);
+			}
+		}
+		else {
+			while ((m_out.size() - m_outBegin) * 2 < maxLen && DecodeBlock()) {
+			}
+			size_t avail = (m_out.size() - m_outBegin) * 2;
+			if (avail > 0) {
+				*len = avail < maxLen ? (unsigned int)avail : maxLen;
+				data = (const char*)(m_out.data() + m_outBegin);
+				m_outBegin += *len / 2;
+			}
+		}
+		if (data != nullptr) {
+			m_outPos += *len;
+		}
+		return data;
+	}
+}
+
+// 导出函数实现
+int GetAudioFileFormat(const char* path, AudioFileFormat* format)
+{
+	if (path == nullptr || format == nullptr) {
+		return -1;
+	}
+	AIKITDLL::AudioDecoder decoder;
+	int ret = decoder.Open(path);
+	if (ret == E_AUDIO_FORMAT) {
+		return ret;
+	}
+	if (ret != 0) {
+		return -1;
+	}
+	*format = decoder.Format();
+	return 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "AudioFile.h"
+#include <vector>
+
+struct resampler;
+
+// 文件格式不支持或头部损坏时的返回码
+#define E_AUDIO_FORMAT -1200
+
+// 音频文件的容器
+enum AudioContainer {
+	AUDIO_CONTAINER_RAW = 0,   // 没有文件头，按16k/16bit单声道PCM处理
+	AUDIO_CONTAINER_WAV        // RIFF/WAVE
+};
+
+// 采样编码
+enum AudioEncoding {
+	AUDIO_ENCODING_PCM16 = 0,
+	AUDIO_ENCODING_PCM24,
+	AUDIO_ENCODING_FLOAT32,
+	AUDIO_ENCODING_ALAW,
+	AUDIO_ENCODING_MULAW
+};
+
+// 音频文件的格式
+struct AudioFileFormat {
+	int container;                 // AudioContainer
+	int encoding;                  // AudioEncoding
+	unsigned int sampleRate;
+	unsigned int channels;
+	unsigned int blockAlign;       // 每帧字节数
+	long long dataBytes;           // 音频数据的字节数，未知（流式写入的WAV、管道）时为-1
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 读取音频文件的格式，成功返回0，格式不支持返回E_AUDIO_FORMAT，打不开返回-1
+	AIKITDLL_API int GetAudioFileFormat(const char* path, AudioFileFormat* format);
+
+#ifdef __cplusplus
+}
+#endif
+
+// 转换时每次从文件取出的输入数据量
+#define AUDIO_DECODE_BLOCK_BYTES (64u * 1024)
+
+namespace AIKITDLL {
+	// 按块解码音频文件，输出引擎需要的16k/16bit单声道PCM，不把整个文件读进内存。
+	// 支持RIFF/WAVE（PCM16、PCM24、float32、A律、μ律，含WAVE_FORMAT_EXTENSIBLE），
+	// 没有RIFF头的文件按原来的方式当作16k/16bit单声道PCM。
+	// 已经是16k单声道PCM16的数据直接返回映射区的片段；其他格式先转换成16bit，
+	// 再经过与采集相同的降混/重采样（SIMD）转换。不是线程安全的，每个会话一个。
+	class AudioDecoder {
+	public:
+		AudioDecoder();
+		~AudioDecoder();
+
+		AudioDecoder(const AudioDecoder&) = delete;
+		AudioDecoder& operator=(const AudioDecoder&) = delete;
+
+		// 打开文件并解析格式，成功返回0；格式不支持或头部损坏返回E_AUDIO_FORMAT，打不开返回GetLastError的错误码
+		int Open(const char* path);
+		void Close();
+
+		// 取出下一段16k单声道PCM，最多maxLen字节（偶数，不超过AUDIO_FILE_STREAM_BYTES），只在末尾才会不足maxLen。
+		// 返回的指针在下一次Next或Close之前有效，读完或出错时返回nullptr
+		const char* Next(unsigned int maxLen, unsigned int* len);
+
+		const AudioFileFormat& Format() const { return m_format; }
+		// 输入数据是否不经转换直接交给引擎
+		bool Passthrough() const { return m_passthrough; }
+		bool Mapped() const { return m_reader.Mapped(); }
+		// 已输出的数据量
+		unsigned long long Position() const { return m_outPos; }
+
+	private:
+		int ParseWav();
+		int ParseFmt(const unsigned char* fmt, unsigned int len);
+		// 从文件读取恰好n字节到dst（n不超过AUDIO_FILE_STREAM_BYTES），不足时返回false
+		bool ReadExact(void* dst, unsigned int n);
+		bool Skip(unsigned long long n);
+		// 在数据块范围内取一段输入
+		const char* NextInput(unsigned int maxLen, unsigned int* len);
+		// 解码一块输入追加到m_out，没有输入时返回false
+		bool DecodeBlock();
+		// 把输入的一块转换成16bit交错数据放到m_pcm
+		void ConvertBlock(const char* data, unsigned int samples);
+
+		AudioFileReader m_reader;
+		AudioFileFormat m_format;
+		bool m_passthrough;
+		long long m_dataRemain;        // 数据块还剩的字节数，-1表示读到文件末尾
+		unsigned long long m_outPos;
+
+		// 不是RIFF文件时已经读出的开头几个字节，先于文件后面的数据输出
+		char m_head[12];
+		unsigned int m_headLen;
+		unsigned int m_headPos;
+
+		struct resampler* m_resampler;
+		std::vector<short> m_pcm;      // 转换成16bit的交错输入
+		std::vector<short> m_out;      // 待输出的16k单声道数据
+		size_t m_outBegin;
+		std::vector<char> m_stage;     // 开头几个字节和后面的数据拼成一段
+	};
+}
@@ -0,0 +1,233 @@
+#include "pch.h"
+#include "AudioFile.h"
+#include "Common.h"
+#include <atomic>
+#include <cstring>
+
+namespace {
+	std::atomic<unsigned long long> g_files(0);
+	std::atomic<unsigned long long> g_mappedFiles(0);
+	std::atomic<unsigned long long> g_streamedFiles(0);
+	std::atomic<unsigned long long> g_bytes(0);
+	std::atomic<unsigned long long> g_readCalls(0);
+	std::atomic<unsigned long long> g_mapCalls(0);
+	std::atomic<unsigned long long> g_prefetchCalls(0);
+	std::atomic<bool> g_mappingEnabled(true);
+
+	// PrefetchVirtualMemory只在Windows 8及以后提供，按名字取，没有时不做预读
+	struct PrefetchRange {
+		PVOID address;
+		SIZE_T bytes;
+	};
+	typedef BOOL(WINAPI* PrefetchVirtualMemoryFn)(HANDLE process, ULONG_PTR count, PrefetchRange* ranges, ULONG flags);
+
+	PrefetchVirtualMemoryFn GetPrefetchFn() {
+		static PrefetchVirtualMemoryFn fn = (PrefetchVirtualMemoryFn)GetProcAddress(
+			GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+		return fn;
+	}
+}
+
+namespace AIKITDLL {
+
+	AudioFileReader::AudioFileReader()
+		: m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_size(-1), m_pos(0),
+		m_view(nullptr), m_viewBegin(0), m_viewEnd(0), m_granularity(65536),
+		m_buffer(nullptr), m_bufBegin(0), m_bufEnd(0), m_eof(false) {
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		if (si.dwAllocationGranularity > 0) {
+			m_granularity = si.dwAllocationGranularity;
+		}
+	}
+
+	AudioFileReader::~AudioFileReader() {
+		Close();
+	}
+
+	int AudioFileReader::Open(const char* path) {
+		Close();
+		if (path == nullptr) {
+			return ERROR_INVALID_PARAMETER;
+		}
+
+		// 顺序读取提示对映射和流方式都有效：系统会加大预读、尽早回收读过的页
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (m_file == INVALID_HANDLE_VALUE) {
+			return (int)GetLastError();
+		}
+		g_files++;
+
+		LARGE_INTEGER size;
+		if (GetFileType(m_file) == FILE_TYPE_DISK && GetFileSizeEx(m_file, &size)) {
+			m_size = size.QuadPart;
+		}
+
+		// 空文件不能映射，按流方式处理（直接读到末尾）
+		if (g_mappingEnabled.load() && m_size > 0) {
+			m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (m_mapping == NULL) {
+				LogWarning("AudioFileReader: 映射文件失败（错误码 %lu），改为流方式读取: %s", GetLastError(), path);
+			}
+		}
+		if (m_mapping != NULL) {
+			g_mappedFiles++;
+			return 0;
+		}
+
+		m_buffer = new char[AUDIO_FILE_STREAM_BYTES];
+		g_streamedFiles++;
+		return 0;
+	}
+
+	void AudioFileReader::Close() {
+		if (m_view != nullptr) {
+			UnmapViewOfFile(m_view);
+			m_view = nullptr;
+		}
+		if (m_mapping != NULL) {
+			CloseHandle(m_mapping);
+			m_mapping = NULL;
+		}
+		if (m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+		delete[] m_buffer;
+		m_buffer = nullptr;
+		m_size = -1;
+		m_pos = 0;
+		m_viewBegin = m_viewEnd = 0;
+		m_bufBegin = m_bufEnd = 0;
+		m_eof = false;
+	}
+
+	const char* AudioFileReader::Next(unsigned int maxLen, unsigned int* len) {
+		*len = 0;
+		if (!IsOpen() || maxLen == 0) {
+			return nullptr;
+		}
+		if (maxLen > AUDIO_FILE_STREAM_BYTES) {
+			maxLen = AUDIO_FILE_STREAM_BYTES;
+		}
+		const char* data = Mapped() ? NextMapped(maxLen, len) : NextStreamed(maxLen, len);
+		if (data != nullptr) {
+			m_pos += *len;
+			g_bytes += *len;
+		}
+		return data;
+	}
+
+	bool AudioFileReader::MapView(unsigned long long pos) {
+		if (m_view != nullptr) {
+			UnmapViewOfFile(m_view);
+			m_view = nullptr;
+		}
+		unsigned long long begin = pos / m_granularity * m_granularity;
+		unsigned long long end = begin + AUDIO_FILE_VIEW_BYTES;
+		if (end > (unsigned long long)m_size) {
+			end = (unsigned long long)m_size;
+		}
+		m_view = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, (DWORD)(begin >> 32), (DWORD)(begin & 0xFFFFFFFF),
+			(SIZE_T)(end - begin));
+		g_mapCalls++;
+		if (m_view == nullptr) {
+			LogError("AudioFileReader: 映射视图失败，错误码: %lu", GetLastError());
+			return false;
+		}
+		m_viewBegin = begin;
+		m_viewEnd = end;
+
+		// 相当于madvise(MADV_WILLNEED)：让系统在后台把整个视图按顺序读进来，送数时不再逐页缺页等待
+		PrefetchVirtualMemoryFn prefetch = GetPrefetchFn();
+		if (prefetch != nullptr) {
+			PrefetchRange range = { (PVOID)m_view, (SIZE_T)(end - begin) };
+			prefetch(GetCurrentProcess(), 1, &range, 0);
+			g_prefetchCalls++;
+		}
+		return true;
+	}
+
+	const char* AudioFileReader::NextMapped(unsigned int maxLen, unsigned int* len) {
+		unsigned long long remain = (unsigned long long)m_size - m_pos;
+		if (remain == 0) {
+			return nullptr;
+		}
+		unsigned int want = remain < maxLen ? (unsigned int)remain : maxLen;
+		// 片段不跨视图：放不下时从当前位置重新映射，视图远大于一帧，每段只映射一次
+		if (m_view == nullptr || m_pos < m_viewBegin || m_pos + want > m_viewEnd) {
+			if (!MapView(m_pos)) {
+				return nullptr;
+			}
+		}
+		*len = want;
+		return m_view + (m_pos - m_viewBegin);
+	}
+
+	const char* AudioFileReader::NextStreamed(unsigned int maxLen, unsigned int* len) {
+		// 缓冲区里不够一帧时把剩余数据移到开头再读，保证只有文件末尾才返回不足一帧的数据
+		while (m_bufEnd - m_bufBegin < maxLen && !m_eof) {
+			if (m_bufBegin > 0) {
+				memmove(m_buffer, m_buffer + m_bufBegin, m_bufEnd - m_bufBegin);
+				m_bufEnd -= m_bufBegin;
+				m_bufBegin = 0;
+			}
+			DWORD got = 0;
+			BOOL ok = ReadFile(m_file, m_buffer + m_bufEnd, AUDIO_FILE_STREAM_BYTES - m_bufEnd, &got, NULL);
+			g_readCalls++;
+			if (!ok) {
+				DWORD err = GetLastError();
+				// 管道的写入端关闭即为文件结束
+				if (err != ERROR_BROKEN_PIPE && err != ERROR_HANDLE_EOF) {
+					LogError("AudioFileReader: 读取失败，错误码: %lu", err);
+				}
+				m_eof = true;
+			}
+			else if (got == 0) {
+				m_eof = true;
+			}
+			m_bufEnd += got;
+		}
+		unsigned int avail = m_bufEnd - m_bufBegin;
+		if (avail == 0) {
+			return nullptr;
+		}
+		*len = avail < maxLen ? avail : maxLen;
+		const char* data = m_buffer + m_bufBegin;
+		m_bufBegin += *len;
+		return data;
+	}
+}
+
+// 导出函数实现
+int GetAudioFileStats(AudioFileStats* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+	stats->files = g_files.load();
+	stats->mappedFiles = g_mappedFiles.load();
+	stats->streamedFiles = g_streamedFiles.load();
+	stats->bytes = g_bytes.load();
+	stats->readCalls = g_readCalls.load();
+	stats->mapCalls = g_mapCalls.load();
+	stats->prefetchCalls = g_prefetchCalls.load();
+	return 0;
+}
+
+void ResetAudioFileStats()
+{
+	g_files.store(0);
+	g_mappedFiles.store(0);
+	g_streamedFiles.store(0);
+	g_bytes.store(0);
+	g_readCalls.store(0);
+	g_mapCalls.store(0);
+	g_prefetchCalls.store(0);
+}
+
+void SetAudioFileMapping(int enabled)
+{
+	g_mappingEnabled.store(enabled != 0);
+}
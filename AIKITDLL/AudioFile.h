@@ -0,0 +1,99 @@
+#pragma once
+#include <Windows.h>
+
+// 音频文件读取的统计，自进程启动（或上次清零）累计
+struct AudioFileStats {
+	unsigned long long files;          // 打开的文件数
+	unsigned long long mappedFiles;    // 以内存映射方式读取的文件数
+	unsigned long long streamedFiles;  // 以流方式读取的文件数（管道、映射失败或关闭映射时）
+	unsigned long long bytes;          // 交给调用方的数据量
+	unsigned long long readCalls;      // ReadFile调用次数
+	unsigned long long mapCalls;       // MapViewOfFile调用次数
+	unsigned long long prefetchCalls;  // 预读提示调用次数
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取音频文件读取的统计，成功返回0
+	AIKITDLL_API int GetAudioFileStats(AudioFileStats* stats);
+
+	// 清零音频文件读取的统计
+	AIKITDLL_API void ResetAudioFileStats();
+
+	// 是否对磁盘文件使用内存映射（默认启用），关闭时一律按流方式读取，用于对比测试
+	AIKITDLL_API void SetAudioFileMapping(int enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+// 内存映射时每个视图的大小：超过这个大小的文件分段映射，32位进程里也不会占满地址空间
+#define AUDIO_FILE_VIEW_BYTES (32u * 1024 * 1024)
+// 流方式读取时每次ReadFile的数据量
+#define AUDIO_FILE_STREAM_BYTES (256u * 1024)
+
+namespace AIKITDLL {
+	// 顺序读取音频文件，按调用方的帧长取出连续的数据片段交给引擎。
+	// 磁盘文件映射到内存，片段直接指向映射区，不经过拷贝，也没有逐帧的读调用；
+	// 每映射一段就提示系统顺序预读。管道等不能映射的文件按大块ReadFile读到内部缓冲区。
+	// 不是线程安全的，每个会话一个。
+	class AudioFileReader {
+	public:
+		AudioFileReader();
+		~AudioFileReader();
+
+		AudioFileReader(const AudioFileReader&) = delete;
+		AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+		// 打开文件，成功返回0，失败返回GetLastError的错误码
+		int Open(const char* path);
+		void Close();
+
+		// 取出下一段数据，最多maxLen字节（maxLen不能超过AUDIO_FILE_STREAM_BYTES），只在文件末尾才会不足maxLen。
+		// 返回的指针在下一次Next或Close之前有效，读完或出错时返回nullptr
+		const char* Next(unsigned int maxLen, unsigned int* len);
+
+		bool IsOpen() const { return m_file != INVALID_HANDLE_VALUE; }
+		bool Mapped() const { return m_mapping != NULL; }
+		// 文件大小，流方式下未知时为-1
+		long long Size() const { return m_size; }
+		// 已取出的数据量
+		unsigned long long Position() const { return m_pos; }
+
+	private:
+		const char* NextMapped(unsigned int maxLen, unsigned int* len);
+		const char* NextStreamed(unsigned int maxLen, unsigned int* len);
+		// 映射从pos所在的分配粒度边界开始的一段视图
+		bool MapView(unsigned long long pos);
+
+		HANDLE m_file;
+		HANDLE m_mapping;
+		long long m_size;
+		unsigned long long m_pos;
+
+		// 内存映射
+		const char* m_view;
+		unsigned long long m_viewBegin;   // 视图在文件中的起始位置
+		unsigned long long m_viewEnd;
+		unsigned int m_granularity;
+
+		// 流方式
+		char* m_buffer;
+		unsigned int m_bufBegin;
+		unsigned int m_bufEnd;
+		bool m_eof;
+	};
+}
@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "BatchCommon.h"
+#include "CancelToken.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace AIKITDLL {
+
+	bool LoadManifestLines(const char* path, std::vector<ManifestLine>& lines) {
+		FILE* fp = nullptr;
+		if (fopen_s(&fp, path, "rb") != 0 || fp == nullptr) {
+			return false;
+		}
+		char line[4096];
+		unsigned int lineNo = 0;
+		while (fgets(line, sizeof(line), fp) != nullptr) {
+			++lineNo;
+			char* begin = line;
+			while (*begin == ' ' || *begin == '\t') {
+				++begin;
+			}
+			char* end = begin + strlen(begin);
+			while (end > begin && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ' || end[-1] == '\t')) {
+				--end;
+			}
+			if (end == begin || *begin == '#') {
+				continue;
+			}
+			ManifestLine item;
+			item.lineNo = lineNo;
+			item.text.assign(begin, end);
+			lines.push_back(item);
+		}
+		fclose(fp);
+		return true;
+	}
+
+	void AppendJsonString(std::string& out, const std::string& value) {
+		out += '"';
+		for (unsigned char c : value) {
+			switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (c < 0x20) {
+					char esc[8];
+					sprintf_s(esc, sizeof(esc), "\\u%04x", c);
+					out += esc;
+				}
+				else {
+					out += (char)c;
+				}
+				break;
+			}
+		}
+		out += '"';
+	}
+
+	BatchQueue::BatchQueue(size_t count, CancelToken* cancel)
+		: m_count(count), m_cancel(cancel), m_next(0) {
+	}
+
+	bool BatchQueue::Claim(size_t* index) {
+		if (IsCancelled(m_cancel)) {
+			return false;
+		}
+		size_t next = m_next.fetch_add(1);
+		if (next >= m_count) {
+			return false;
+		}
+		*index = next;
+		return true;
+	}
+
+	int ClampBatchWorkers(int workers, int maxWorkers, size_t count) {
+		if (workers < 1) {
+			workers = 1;
+		}
+		if (workers > maxWorkers) {
+			workers = maxWorkers;
+		}
+		if ((size_t)workers > count && count > 0) {
+			workers = (int)count;
+		}
+		return workers;
+	}
+
+	void RunBatchWorkers(int workers, BatchWorkerFn fn, void* ctx) {
+		std::vector<std::thread> threads;
+		for (int i = 0; i < workers; ++i) {
+			threads.push_back(std::thread(fn, ctx, (unsigned int)i));
+		}
+		for (std::thread& t : threads) {
+			t.join();
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace AIKITDLL {
+	class CancelToken;
+
+	// 清单中的一行：已去掉首尾空白，不含空行和#开头的注释行
+	struct ManifestLine {
+		unsigned int lineNo;   // 在文件中的行号（从1开始）
+		std::string text;
+	};
+
+	// 读取批量处理的清单文件，打不开时返回false
+	bool LoadManifestLines(const char* path, std::vector<ManifestLine>& lines);
+
+	// 按JSON字符串的规则转义并加上引号追加到out，非ASCII字节原样输出
+	void AppendJsonString(std::string& out, const std::string& value);
+
+	// 批量处理的任务分发：各线程按序号动态领取，先做完的线程多领，长短不一的文件也能均衡
+	class BatchQueue {
+	public:
+		BatchQueue(size_t count, CancelToken* cancel);
+
+		// 领取下一个序号；全部领完或已取消时返回false
+		bool Claim(size_t* index);
+
+		size_t Count() const { return m_count; }
+
+	private:
+		size_t m_count;
+		CancelToken* m_cancel;
+		std::atomic<size_t> m_next;
+	};
+
+	// 工作线程的入口，worker为线程号（从0开始）
+	typedef void (*BatchWorkerFn)(void* ctx, unsigned int worker);
+
+	// 把请求的线程数限制在[1, maxWorkers]内，有任务时不超过任务数
+	int ClampBatchWorkers(int workers, int maxWorkers, size_t count);
+
+	// 启动workers个线程运行fn，全部结束后返回
+	void RunBatchWorkers(int workers, BatchWorkerFn fn, void* ctx);
+}
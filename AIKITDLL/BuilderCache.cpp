@@ -0,0 +1,201 @@
+#include "pch.h"
+#include "BuilderCache.h"
+#include "Common.h"
+#include "IvwWrapper.h"
+#include <cstring>
+#include <string>
+
+// 池中最多保留的空闲数据构建器：唤醒、命令词和文件识别各一个，再留一些余量
+#define BUILDER_POOL_MAX 8
+
+namespace AIKITDLL {
+
+	BuilderCache& BuilderCache::Instance() {
+		static BuilderCache instance;
+		return instance;
+	}
+
+	BuilderCache::BuilderCache()
+		: m_createdBuilders(0), m_paramHits(0), m_paramBuilds(0), m_frameReuses(0), m_frameRebuilds(0) {
+		// 预留容量，归还构建器时不再分配内存
+		m_pool.reserve(BUILDER_POOL_MAX);
+	}
+
+	AIKIT_BizParam* BuilderCache::GetParams(const char* ability, const char* profile, int arg, ParamFiller fill) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_params.size(); ++i) {
+			const ParamSet& set = m_params[i];
+			if (set.arg == arg && set.ability == ability && set.profile == profile) {
+				m_paramHits++;
+				return set.built;
+			}
+		}
+
+		ParamSet set;
+		set.ability = ability;
+		set.profile = profile;
+		set.arg = arg;
+		set.builder = AIKIT::AIKIT_ParamBuilder::create();
+		if (!set.builder) {
+			LogError("BuilderCache: 创建参数构建器失败 (%s/%s)", ability, profile);
+			return nullptr;
+		}
+		set.builder->clear();
+		fill(set.builder, arg);
+		set.built = AIKIT::AIKIT_Builder::build(set.builder);
+		if (!set.built) {
+			LogError("BuilderCache: 参数构建失败 (%s/%s)", ability, profile);
+			delete set.builder;
+			return nullptr;
+		}
+		m_params.push_back(set);
+		m_paramBuilds++;
+		LogInfo("BuilderCache: 已缓存参数集 %s/%s (%d)", ability, profile, arg);
+		return set.built;
+	}
+
+	AIKIT::AIKIT_DataBuilder* BuilderCache::AcquireDataBuilder() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_pool.empty()) {
+				AIKIT::AIKIT_DataBuilder* builder = m_pool.back();
+				m_pool.pop_back();
+				return builder;
+			}
+		}
+		AIKIT::AIKIT_DataBuilder* builder = AIKIT::AIKIT_DataBuilder::create();
+		if (builder) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_createdBuilders++;
+		}
+		return builder;
+	}
+
+	void BuilderCache::ReleaseDataBuilder(AIKIT::AIKIT_DataBuilder* builder) {
+		if (!builder) {
+			return;
+		}
+		builder->clear();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_pool.size() < BUILDER_POOL_MAX) {
+				m_pool.push_back(builder);
+				return;
+			}
+		}
+		delete builder;
+	}
+
+	void BuilderCache::CountFrame(bool rebuilt) {
+		if (rebuilt) {
+			m_frameRebuilds.fetch_add(1, std::memory_order_relaxed);
+		}
+		else {
+			m_frameReuses.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void BuilderCache::GetStats(BuilderCacheStats* stats) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stats->paramSets = (unsigned int)m_params.size();
+		stats->paramHits = m_paramHits;
+		stats->paramBuilds = m_paramBuilds;
+		stats->pooledBuilders = (unsigned int)m_pool.size();
+		stats->createdBuilders = m_createdBuilders;
+		stats->frameReuses = m_frameReuses.load();
+		stats->frameRebuilds = m_frameRebuilds.load();
+	}
+
+	static void FillIvwParams(AIKIT::AIKIT_ParamBuilder* builder, int threshold) {
+		char value[32];
+		int len = snprintf(value, sizeof(value), "0 0:%d", threshold);
+		builder->param("wdec_param_nCmThreshold", value, len);
+		builder->param("gramLoad", true);
+	}
+
+	// 麦克风识别开启后处理，句尾静音稍长，避免说话停顿时过早结束
+	static void FillEsrMicParams(AIKIT::AIKIT_ParamBuilder* builder, int) {
+		builder->param("languageType", 0);    // 0-中文 1-英文
+		builder->param("vadEndGap", 75);
+		builder->param("vadOn", true);
+		builder->param("beamThreshold", 20);
+		builder->param("hisGramThreshold", 3000);
+		builder->param("postprocOn", true);
+		builder->param("vadResponsetime", 1000);
+		builder->param("vadLinkOn", true);
+		builder->param("vadSpeechEnd", 80);
+	}
+
+	static void FillEsrFileParams(AIKIT::AIKIT_ParamBuilder* builder, int) {
+		builder->param("languageType", 0);    // 0-中文 1-英文
+		builder->param("vadEndGap", 60);
+		builder->param("vadOn", true);
+		builder->param("beamThreshold", 20);
+		builder->param("hisGramThreshold", 3000);
+		builder->param("postprocOn", false);
+		builder->param("vadResponsetime", 1000);
+		builder->param("vadLinkOn", true);
+		builder->param("vadSpeechEnd", 80);
+	}
+
+	AIKIT_BizParam* IvwSessionParams(int threshold) {
+		return BuilderCache::Instance().GetParams(IVW_ABILITY, "session", threshold, FillIvwParams);
+	}
+
+	AIKIT_BizParam* EsrSessionParams(EsrParamProfile profile) {
+		if (profile == ESR_PARAMS_FILE) {
+			return BuilderCache::Instance().GetParams(ESR_ABILITY, "file", 0, FillEsrFileParams);
+		}
+		return BuilderCache::Instance().GetParams(ESR_ABILITY, "mic", 0, FillEsrMicParams);
+	}
+
+	AudioFrame::AudioFrame(const char* key, bool withStatus)
+		: m_key(key), m_withStatus(withStatus), m_built(nullptr), m_len(0), m_status(AIKIT_DataBegin) {
+		m_builder = BuilderCache::Instance().AcquireDataBuilder();
+	}
+
+	AudioFrame::~AudioFrame() {
+		BuilderCache::Instance().ReleaseDataBuilder(m_builder);
+	}
+
+	void AudioFrame::Reset() {
+		m_built = nullptr;
+		if (m_builder) {
+			m_builder->clear();
+		}
+	}
+
+	AIKIT_InputData* AudioFrame::Build(const char* data, unsigned int len, AIKIT_DataStatus status) {
+		if (!m_builder) {
+			return nullptr;
+		}
+		// 同一会话内帧长和状态通常不变，只替换数据指针
+		if (m_built && m_built->node && len == m_len && len > 0 && (!m_withStatus || status == m_status)) {
+			m_built->node->value = (void*)data;
+			BuilderCache::Instance().CountFrame(false);
+			return m_built;
+		}
+
+		m_builder->clear();
+		if (m_withStatus) {
+			m_builder->payload(AIKIT::AiAudio::get(m_key)->data(data, (int)len)->status(status)->valid());
+		}
+		else {
+			m_builder->payload(AIKIT::AiAudio::get(m_key)->data(data, (int)len)->valid());
+		}
+		m_built = AIKIT::AIKIT_Builder::build(m_builder);
+		m_len = len;
+		m_status = status;
+		BuilderCache::Instance().CountFrame(true);
+		return m_built;
+	}
+}
+
+int GetBuilderCacheStats(BuilderCacheStats* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+	AIKITDLL::BuilderCache::Instance().GetStats(stats);
+	return 0;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "aikit_biz_api.h"
+#include "aikit_biz_config.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 构建器缓存的统计
+struct BuilderCacheStats {
+	unsigned int paramSets;            // 已缓存的参数集数量
+	unsigned long long paramHits;      // 直接复用参数集的次数
+	unsigned long long paramBuilds;    // 构建参数集的次数
+	unsigned int pooledBuilders;       // 池中空闲的数据构建器
+	unsigned int createdBuilders;      // 创建过的数据构建器总数
+	unsigned long long frameReuses;    // 只替换数据指针、没有重新构建的音频帧
+	unsigned long long frameRebuilds;  // 长度或状态变化后重新构建的音频帧
+};
+
+// ESR会话参数配置
+enum EsrParamProfile {
+	ESR_PARAMS_MIC = 0,    // 麦克风实时识别
+	ESR_PARAMS_FILE        // 文件识别
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取参数集缓存和数据构建器池的统计，成功返回0
+	AIKITDLL_API int GetBuilderCacheStats(BuilderCacheStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace AIKITDLL {
+	// 填写一个参数集
+	typedef void (*ParamFiller)(AIKIT::AIKIT_ParamBuilder* builder, int arg);
+
+	// 会话参数和数据构建器的进程级缓存：
+	// 参数集按能力、配置名和整型参数（如唤醒阈值）缓存，第一次使用时构建，之后直接复用构建结果；
+	// 数据构建器放在池里跨会话复用。缓存的参数集在进程退出前不释放。
+	class BuilderCache {
+	public:
+		static BuilderCache& Instance();
+
+		// 取已构建的参数集，没有时用fill填写并构建，失败返回nullptr
+		AIKIT_BizParam* GetParams(const char* ability, const char* profile, int arg, ParamFiller fill);
+
+		// 从池中取一个清空的数据构建器，池空时新建，失败返回nullptr
+		AIKIT::AIKIT_DataBuilder* AcquireDataBuilder();
+		// 归还数据构建器，nullptr忽略
+		void ReleaseDataBuilder(AIKIT::AIKIT_DataBuilder* builder);
+
+		void CountFrame(bool rebuilt);
+		void GetStats(BuilderCacheStats* stats);
+
+	private:
+		BuilderCache();
+		BuilderCache(const BuilderCache&) = delete;
+		BuilderCache& operator=(const BuilderCache&) = delete;
+
+		struct ParamSet {
+			std::string ability;
+			std::string profile;
+			int arg;
+			AIKIT::AIKIT_ParamBuilder* builder;
+			AIKIT_BizParam* built;
+		};
+
+		std::mutex m_mutex;
+		std::vector<ParamSet> m_params;
+		std::vector<AIKIT::AIKIT_DataBuilder*> m_pool;
+		unsigned int m_createdBuilders;
+		unsigned long long m_paramHits;
+		unsigned long long m_paramBuilds;
+		std::atomic<unsigned long long> m_frameReuses;
+		std::atomic<unsigned long long> m_frameRebuilds;
+	};
+
+	// 唤醒会话参数（阈值threshold，加载唤醒词），按阈值缓存
+	AIKIT_BizParam* IvwSessionParams(int threshold);
+
+	// 命令词识别会话参数
+	AIKIT_BizParam* EsrSessionParams(EsrParamProfile profile);
+
+	// 一个会话内反复写入的音频帧：绑定池中的数据构建器，长度和状态与上一帧相同时
+	// 只把已构建结果中的数据指针换成新数据，不再clear/payload/build，送数循环不分配内存。
+	// 不是线程安全的，每个会话一个。
+	class AudioFrame {
+	public:
+		// key为音频数据名（唤醒为"wav"，命令词为"audio"）；withStatus为false时不设置数据状态
+		AudioFrame(const char* key, bool withStatus);
+		~AudioFrame();
+
+		AudioFrame(const AudioFrame&) = delete;
+		AudioFrame& operator=(const AudioFrame&) = delete;
+
+		// 构建器是否可用
+		bool Valid() const { return m_builder != nullptr; }
+
+		// 返回可直接交给AIKIT_Write的输入，失败返回nullptr。
+		// 返回值在下一次调用Build前有效，data在AIKIT_Write返回前必须保持不变
+		AIKIT_InputData* Build(const char* data, unsigned int len, AIKIT_DataStatus status = AIKIT_DataContinue);
+
+		// 丢弃已构建结果，下一帧重新构建
+		void Reset();
+
+	private:
+		const char* m_key;
+		bool m_withStatus;
+		AIKIT::AIKIT_DataBuilder* m_builder;
+		AIKIT_InputData* m_built;
+		unsigned int m_len;
+		AIKIT_DataStatus m_status;
+	};
+}
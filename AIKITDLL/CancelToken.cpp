@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "CancelToken.h"
+#include "Common.h"
+#include <algorithm>
+
+namespace AIKITDLL {
+
+	CancelToken::CancelToken()
+		: m_cancelled(false)
+	{
+		m_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (m_event == NULL) {
+			LogError("CancelToken: 创建取消事件失败，等待只能靠轮询发现取消");
+		}
+	}
+
+	CancelToken::~CancelToken() {
+		if (m_event != NULL) {
+			CloseHandle(m_event);
+		}
+	}
+
+	void CancelToken::Cancel() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_cancelled.exchange(true, std::memory_order_acq_rel)) {
+			return;
+		}
+		if (m_event != NULL) {
+			SetEvent(m_event);
+		}
+		for (CancelListener* listener : m_listeners) {
+			listener->m_fn(listener->m_arg);
+		}
+	}
+
+	void CancelToken::Reset() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_event != NULL) {
+			ResetEvent(m_event);
+		}
+		m_cancelled.store(false, std::memory_order_release);
+	}
+
+	CancelListener::CancelListener(CancelToken* token, Callback fn, void* arg)
+		: m_token(token), m_fn(fn), m_arg(arg)
+	{
+		if (m_token == nullptr) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(m_token->m_mutex);
+		m_token->m_listeners.push_back(this);
+	}
+
+	CancelListener::~CancelListener() {
+		if (m_token == nullptr) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(m_token->m_mutex);
+		std::vector<CancelListener*>& listeners = m_token->m_listeners;
+		listeners.erase(std::remove(listeners.begin(), listeners.end(), this), listeners.end());
+	}
+}
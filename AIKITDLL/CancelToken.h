@@ -0,0 +1,63 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// 会话被取消令牌中止时的返回码
+#define E_SESSION_CANCELLED -1100
+
+namespace AIKITDLL {
+	class CancelListener;
+
+	// 协作式取消令牌：Cancel之后所有持有它的送数循环和等待尽快返回。
+	// 送数循环每处理一帧检查一次IsCancelled()，内核对象等待把Event()放进等待列表，
+	// 条件变量等待用CancelListener在取消时唤醒。线程安全，可以Reset后重复使用
+	class CancelToken {
+	public:
+		CancelToken();
+		~CancelToken();
+
+		CancelToken(const CancelToken&) = delete;
+		CancelToken& operator=(const CancelToken&) = delete;
+
+		void Cancel();
+		void Reset();
+		bool IsCancelled() const { return m_cancelled.load(std::memory_order_acquire); }
+		// 手动重置事件，取消后一直处于触发状态直到Reset
+		HANDLE Event() const { return m_event; }
+
+	private:
+		friend class CancelListener;
+
+		std::atomic<bool> m_cancelled;
+		HANDLE m_event;
+		std::mutex m_mutex;
+		std::vector<CancelListener*> m_listeners;
+	};
+
+	// 作用域内登记一个取消通知：令牌被取消时在Cancel的线程上调用fn(arg)，token为nullptr时什么也不做。
+	// 登记之前就已取消的不会再通知，等待条件里要自己检查IsCancelled()。
+	// fn一般是在条件变量的互斥量下notify_all，所以要在持有该互斥量之前构造
+	class CancelListener {
+	public:
+		typedef void (*Callback)(void* arg);
+
+		CancelListener(CancelToken* token, Callback fn, void* arg);
+		~CancelListener();
+
+		CancelListener(const CancelListener&) = delete;
+		CancelListener& operator=(const CancelListener&) = delete;
+
+	private:
+		friend class CancelToken;
+
+		CancelToken* m_token;
+		Callback m_fn;
+		void* m_arg;
+	};
+
+	inline bool IsCancelled(const CancelToken* token) {
+		return token != nullptr && token->IsCancelled();
+	}
+}
@@ -0,0 +1,666 @@
+#include "pch.h"
+#include "CaptureHub.h"
+#include "Common.h"
+#include "resample.h"
+#include "vad.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// 共享采集缓冲区容量：约4秒的16k/16bit单声道音频
+#define CAPTURE_HUB_CAPACITY (128 * 1024)
+// 16k/16bit单声道每毫秒的字节数
+#define CAPTURE_BYTES_PER_MS 32
+// 默认预录长度，以及为读者留出的余量后允许的最大预录长度
+#define CAPTURE_DEFAULT_PREROLL_MS 2000
+#define CAPTURE_MAX_PREROLL_MS     3000
+
+// 引擎需要的采集格式
+#define CAPTURE_SAMPLE_RATE 16000
+
+// 读者没有租借时的m_leasePos
+#define CAPTURE_NO_LEASE (~0ULL)
+
+// 依次尝试的设备格式：优先16k单声道，部分USB阵列麦克风只支持48k/44.1k，
+// 这时按设备格式录音，再降混、重采样为16k单声道
+static const struct {
+	unsigned int rate;
+	unsigned short channels;
+} g_captureFormats[] = {
+	{ 16000, 1 },
+	{ 48000, 2 }, { 48000, 1 },
+	{ 44100, 2 }, { 44100, 1 },
+	{ 32000, 2 }, { 32000, 1 },
+};
+
+namespace AIKITDLL {
+	static unsigned int RoundUpPow2(unsigned int v) {
+		unsigned int n = 1;
+		while (n < v && n < 0x80000000u) {
+			n <<= 1;
+		}
+		return n;
+	}
+
+	// ---------------- CaptureConsumer ----------------
+
+	CaptureConsumer::CaptureConsumer(CaptureBuffer* owner, HANDLE notifyEvent, unsigned long long cursor)
+		: m_owner(owner),
+		m_notifyEvent(notifyEvent),
+		m_cursor(cursor),
+		m_leasePos(CAPTURE_NO_LEASE),
+		m_readBytes(0),
+		m_laps(0),
+		m_lostBytes(0),
+		m_leasedBytes(0),
+		m_blockedBytes(0),
+		m_highWater(0) {
+	}
+
+	unsigned int CaptureConsumer::Read(char* out, unsigned int maxLen) {
+		if (!out || maxLen == 0) {
+			return 0;
+		}
+
+		for (;;) {
+			unsigned long long cursor = m_cursor.load(std::memory_order_relaxed);
+			unsigned long long writePos = m_owner->m_writePos.load(std::memory_order_acquire);
+			unsigned long long avail = writePos - cursor;
+			if (avail == 0) {
+				return 0;
+			}
+			if (avail > m_owner->m_capacity) {
+				// 被写入方追上：跳到仍然有效的最旧数据
+				unsigned long long oldest = writePos - m_owner->m_capacity;
+				m_laps.fetch_add(1, std::memory_order_relaxed);
+				m_lostBytes.fetch_add(oldest - cursor, std::memory_order_relaxed);
+				m_cursor.store(oldest, std::memory_order_release);
+				continue;
+			}
+			if (avail > m_highWater.load(std::memory_order_relaxed)) {
+				m_highWater.store((unsigned int)avail, std::memory_order_relaxed);
+			}
+
+			unsigned int len = avail < maxLen ? (unsigned int)avail : maxLen;
+			if (!m_owner->ReadAt(cursor, out, len)) {
+				// 拷贝过程中数据被覆盖，重新定位后再读
+				continue;
+			}
+			m_cursor.store(cursor + len, std::memory_order_release);
+			m_readBytes.fetch_add(len, std::memory_order_relaxed);
+			m_owner->m_copiedBytes.fetch_add(len, std::memory_order_relaxed);
+			return len;
+		}
+	}
+
+	const char* CaptureConsumer::BeginLease(unsigned int maxLen, unsigned int* len) {
+		if (!len) {
+			return nullptr;
+		}
+		*len = 0;
+		if (maxLen == 0) {
+			return nullptr;
+		}
+
+		unsigned long long cursor;
+		unsigned long long avail;
+		for (;;) {
+			cursor = m_cursor.load(std::memory_order_relaxed);
+			unsigned long long writePos = m_owner->m_writePos.load(std::memory_order_acquire);
+			avail = writePos - cursor;
+			if (avail == 0) {
+				return nullptr;
+			}
+			if (avail > m_owner->m_capacity) {
+				// 被写入方追上：跳到仍然有效的最旧数据
+				unsigned long long oldest = writePos - m_owner->m_capacity;
+				m_laps.fetch_add(1, std::memory_order_relaxed);
+				m_lostBytes.fetch_add(oldest - cursor, std::memory_order_relaxed);
+				m_cursor.store(oldest, std::memory_order_release);
+				continue;
+			}
+
+			// 先公布租借起点再检查写入方：写入方公布写入区域后也会检查租借，两边至少有一方看到对方
+			m_leasePos.store(cursor, std::memory_order_seq_cst);
+			unsigned long long reservePos = m_owner->m_reservePos.load(std::memory_order_seq_cst);
+			if (reservePos - cursor <= m_owner->m_capacity) {
+				break;
+			}
+			// 正在进行的写入已经开始覆盖读位置，跳过将被覆盖的部分
+			m_leasePos.store(CAPTURE_NO_LEASE, std::memory_order_release);
+			unsigned long long oldest = reservePos - m_owner->m_capacity;
+			m_laps.fetch_add(1, std::memory_order_relaxed);
+			m_lostBytes.fetch_add(oldest - cursor, std::memory_order_relaxed);
+			m_cursor.store(oldest, std::memory_order_release);
+		}
+		if (avail > m_highWater.load(std::memory_order_relaxed)) {
+			m_highWater.store((unsigned int)avail, std::memory_order_relaxed);
+		}
+
+		// 只交出到环尾为止的连续部分，剩余部分在下一次租借中取得
+		unsigned int offset = (unsigned int)(cursor & m_owner->m_mask);
+		unsigned int contiguous = m_owner->m_capacity - offset;
+		unsigned int n = avail < maxLen ? (unsigned int)avail : maxLen;
+		if (n > contiguous) {
+			n = contiguous;
+		}
+		*len = n;
+		return m_owner->m_buffer + offset;
+	}
+
+	void CaptureConsumer::EndLease(unsigned int len) {
+		unsigned long long cursor = m_cursor.load(std::memory_order_relaxed) + len;
+		m_readBytes.fetch_add(len, std::memory_order_relaxed);
+		m_leasedBytes.fetch_add(len, std::memory_order_relaxed);
+		m_owner->m_leasedBytes.fetch_add(len, std::memory_order_relaxed);
+		m_cursor.store(cursor, std::memory_order_release);
+		// 对租借数据的使用都在归还之前完成，写入方看到归还后才会覆盖这段数据
+		m_leasePos.store(CAPTURE_NO_LEASE, std::memory_order_release);
+	}
+
+	unsigned int CaptureConsumer::Available() const {
+		unsigned long long avail = m_owner->m_writePos.load(std::memory_order_acquire) - m_cursor.load(std::memory_order_acquire);
+		return avail > m_owner->m_capacity ? m_owner->m_capacity : (unsigned int)avail;
+	}
+
+	void CaptureConsumer::SeekToLive() {
+		m_cursor.store(m_owner->m_writePos.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	unsigned long long CaptureConsumer::Seek(unsigned long long pos) {
+		unsigned long long writePos = m_owner->m_writePos.load(std::memory_order_acquire);
+		unsigned long long oldest = writePos > m_owner->m_capacity ? writePos - m_owner->m_capacity : 0;
+		if (pos > writePos) {
+			pos = writePos;
+		}
+		if (pos < oldest) {
+			pos = oldest;
+		}
+		m_cursor.store(pos, std::memory_order_release);
+		return pos;
+	}
+
+	void CaptureConsumer::GetStats(CaptureConsumerStats* stats) const {
+		if (!stats) {
+			return;
+		}
+		stats->capacity = m_owner->m_capacity;
+		stats->depth = Available();
+		stats->highWater = m_highWater.load(std::memory_order_relaxed);
+		stats->position = m_cursor.load(std::memory_order_acquire);
+		stats->readBytes = m_readBytes.load(std::memory_order_relaxed);
+		stats->laps = m_laps.load(std::memory_order_relaxed);
+		stats->lostBytes = m_lostBytes.load(std::memory_order_relaxed);
+		stats->leasedBytes = m_leasedBytes.load(std::memory_order_relaxed);
+		stats->blockedBytes = m_blockedBytes.load(std::memory_order_relaxed);
+	}
+
+	// ---------------- CaptureBuffer ----------------
+
+	CaptureBuffer::CaptureBuffer(unsigned int capacity)
+		: m_buffer(nullptr),
+		m_capacity(RoundUpPow2(capacity)),
+		m_mask(0),
+		m_writePos(0),
+		m_reservePos(0),
+		m_copiedBytes(0),
+		m_leasedBytes(0) {
+		m_mask = m_capacity - 1;
+		// 一次性预分配，运行期间不再申请内存
+		m_buffer = (char*)malloc(m_capacity);
+		if (m_buffer) {
+			memset(m_buffer, 0, m_capacity);
+		}
+		else {
+			m_capacity = 0;
+			m_mask = 0;
+		}
+	}
+
+	CaptureBuffer::~CaptureBuffer() {
+		for (CaptureConsumer* consumer : m_consumers) {
+			delete consumer;
+		}
+		m_consumers.clear();
+		if (m_buffer) {
+			free(m_buffer);
+			m_buffer = nullptr;
+		}
+	}
+
+	bool CaptureBuffer::Write(const char* data, unsigned int len) {
+		if (!data || len == 0 || m_capacity == 0) {
+			return false;
+		}
+		if (len > m_capacity) {
+			// 只保留最新的一个缓冲区容量
+			data += len - m_capacity;
+			len = m_capacity;
+		}
+
+		// 持有读者列表的锁：检查租借和通知读者期间读者不会被释放
+		std::lock_guard<std::mutex> lock(m_consumerMutex);
+		unsigned long long writePos = m_writePos.load(std::memory_order_relaxed);
+		unsigned long long end = writePos + len;
+		// 先公布将要覆盖的区域，再检查租借、写数据；读者拷贝后据此判断是否读到了被覆盖的数据
+		m_reservePos.store(end, std::memory_order_seq_cst);
+		for (CaptureConsumer* consumer : m_consumers) {
+			unsigned long long lease = consumer->m_leasePos.load(std::memory_order_seq_cst);
+			if (lease != CAPTURE_NO_LEASE && end - lease > m_capacity) {
+				// 会覆盖正在交给引擎的数据：丢弃这一块录音，读者归还租借后恢复写入
+				m_reservePos.store(writePos, std::memory_order_release);
+				consumer->m_blockedBytes.fetch_add(len, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		unsigned int offset = (unsigned int)(writePos & m_mask);
+		unsigned int first = m_capacity - offset;
+		if (first > len) {
+			first = len;
+		}
+		memcpy(m_buffer + offset, data, first);
+		if (len > first) {
+			memcpy(m_buffer, data + first, len - first);
+		}
+		m_writePos.store(end, std::memory_order_release);
+		m_copiedBytes.fetch_add(len, std::memory_order_relaxed);
+
+		for (CaptureConsumer* consumer : m_consumers) {
+			if (consumer->m_notifyEvent) {
+				SetEvent(consumer->m_notifyEvent);
+			}
+		}
+		return true;
+	}
+
+	bool CaptureBuffer::ReadAt(unsigned long long pos, char* out, unsigned int len) const {
+		unsigned int offset = (unsigned int)(pos & m_mask);
+		unsigned int first = m_capacity - offset;
+		if (first > len) {
+			first = len;
+		}
+		memcpy(out, m_buffer + offset, first);
+		if (len > first) {
+			memcpy(out + first, m_buffer, len - first);
+		}
+
+		// 拷贝完成后检查写入方是否已经覆盖了[pos, pos+len)
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long reservePos = m_reservePos.load(std::memory_order_relaxed);
+		return reservePos - pos <= m_capacity;
+	}
+
+	CaptureConsumer* CaptureBuffer::Subscribe(HANDLE notifyEvent) {
+		CaptureConsumer* consumer = new (std::nothrow) CaptureConsumer(this, notifyEvent, WritePos());
+		if (!consumer) {
+			return nullptr;
+		}
+		std::lock_guard<std::mutex> lock(m_consumerMutex);
+		m_consumers.push_back(consumer);
+		return consumer;
+	}
+
+	void CaptureBuffer::Unsubscribe(CaptureConsumer* consumer) {
+		if (!consumer) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_consumerMutex);
+			auto it = std::find(m_consumers.begin(), m_consumers.end(), consumer);
+			if (it == m_consumers.end()) {
+				return;
+			}
+			m_consumers.erase(it);
+		}
+		delete consumer;
+	}
+
+	// ---------------- PumpCapture ----------------
+
+	int PumpCapture(CaptureConsumer* consumer, unsigned int chunkLen, struct vad_gate* gate,
+		CaptureChunkWriter writer, void* ctx, unsigned int* written) {
+		const char* data;
+		unsigned int len;
+		unsigned int total = 0;
+		unsigned int bypass = 0;  // 回放的预录音频和触发它的那一块，已经判断过，直接写入
+		int ret = 0;
+
+		// 只写入已经录制好的数据，不足一块时也立即送出，避免积压。
+		// 直接把共享缓冲区中的数据交给引擎，写入返回后才归还，中间不再拷贝
+		while ((data = consumer->BeginLease(bypass > 0 && bypass < chunkLen ? bypass : chunkLen, &len)) != nullptr) {
+			if (gate && bypass == 0) {
+				unsigned int replay = 0;
+				if (!vad_gate_process(gate, (const short*)data, len / 2, &replay)) {
+					consumer->EndLease(len);  // 静音，不写入引擎
+					continue;
+				}
+				if (replay > 0) {
+					// 语音开始：归还这次租借，退回到之前跳过的静音末尾，先写入这段预录音频
+					consumer->EndLease(0);
+					unsigned long long pos = consumer->Position();
+					unsigned long long back = (unsigned long long)replay * 2;
+					unsigned long long start = consumer->Seek(pos > back ? pos - back : 0);
+					bypass = (unsigned int)(pos - start) + len;
+					continue;
+				}
+			}
+
+			ret = writer(data, len, ctx);
+			consumer->EndLease(len);
+			if (bypass > 0) {
+				bypass -= len;
+			}
+			if (ret != 0) {
+				break;
+			}
+			total += len;
+		}
+		if (written) {
+			*written = total;
+		}
+		return ret;
+	}
+
+	// ---------------- CaptureHub ----------------
+
+	static void AccumulateRecordStats(struct record_stats* total, const struct record_stats* stats) {
+		total->periods += stats->periods;
+		total->bytes += stats->bytes;
+		total->gaps += stats->gaps;
+		total->lost_bytes += stats->lost_bytes;
+		total->overruns += stats->overruns;
+		total->stall_us += stats->stall_us;
+		if (stats->max_stall_us > total->max_stall_us) {
+			total->max_stall_us = stats->max_stall_us;
+		}
+		total->grows += stats->grows;
+	}
+
+	CaptureHub& CaptureHub::Instance() {
+		static CaptureHub hub;
+		return hub;
+	}
+
+	CaptureHub::CaptureHub()
+		: m_refCount(0),
+		m_recorder(nullptr),
+		m_buffer(CAPTURE_HUB_CAPACITY),
+		m_periodBytes(0),
+		m_running(false),
+		m_openCount(0),
+		m_prerollMs(CAPTURE_DEFAULT_PREROLL_MS),
+		m_wakeEndPos(0),
+		m_wakeMarked(false),
+		m_vadEnabled(true),
+		m_lastCopied(0),
+		m_lastLeased(0),
+		m_lastStatsMs(GetTickCount64()),
+		m_resampler(nullptr),
+		m_convBuf(nullptr),
+		m_convCap(0),
+		m_blockAlign(2),
+		m_periodFrames(0) {
+		memset(&m_recordTotals, 0, sizeof(m_recordTotals));
+	}
+
+	CaptureHub::~CaptureHub() {
+		CloseDevice();
+	}
+
+	// 录音回调：运行在录音线程上，只追加到共享缓冲区
+	void CaptureHub::OnData(char* data, unsigned long len, void* para) {
+		CaptureHub* hub = (CaptureHub*)para;
+		if (hub == nullptr || data == nullptr || len == 0) {
+			return;
+		}
+		if (hub->m_resampler == nullptr) {
+			hub->m_buffer.Write(data, (unsigned int)len);
+			return;
+		}
+
+		// 设备不是16k单声道：按周期分块转换后写入，转换缓冲区在打开设备时已分配
+		const short* in = (const short*)data;
+		unsigned int frames = (unsigned int)(len / hub->m_blockAlign);
+		while (frames > 0) {
+			unsigned int n = frames < hub->m_periodFrames ? frames : hub->m_periodFrames;
+			unsigned int out = resampler_process(hub->m_resampler, in, n, hub->m_convBuf, hub->m_convCap);
+			hub->m_buffer.Write((const char*)hub->m_convBuf, out * 2);
+			in += n * (hub->m_blockAlign / 2);
+			frames -= n;
+		}
+	}
+
+	int CaptureHub::OpenDevice() {
+		WAVEFORMATEX waveform;
+		int ret;
+
+		if (m_buffer.Capacity() == 0) {
+			LogError("CaptureHub: 共享缓冲区分配失败");
+			return -1;
+		}
+		if (get_input_dev_num() == 0) {
+			LogError("CaptureHub: 没有可用的录音设备");
+			return -1;
+		}
+
+		ret = create_recorder(&m_recorder, OnData, this);
+		if (ret != 0 || m_recorder == nullptr) {
+			LogError("CaptureHub: 创建录音对象失败: %d", ret);
+			m_recorder = nullptr;
+			return -1;
+		}
+
+		ret = -1;
+		for (size_t i = 0; i < sizeof(g_captureFormats) / sizeof(g_captureFormats[0]); ++i) {
+			waveform.wFormatTag = WAVE_FORMAT_PCM;
+			waveform.nSamplesPerSec = g_captureFormats[i].rate;
+			waveform.wBitsPerSample = 16;
+			waveform.nChannels = g_captureFormats[i].channels;
+			waveform.nBlockAlign = waveform.nChannels * 2;
+			waveform.nAvgBytesPerSec = waveform.nSamplesPerSec * waveform.nBlockAlign;
+			waveform.cbSize = 0;
+
+			ret = open_recorder(m_recorder, get_default_input_dev(), &waveform);
+			if (ret == 0) {
+				break;
+			}
+			LogInfo("CaptureHub: 设备不支持 %u Hz %u 声道: %d", waveform.nSamplesPerSec, waveform.nChannels, ret);
+		}
+		if (ret == 0 && (waveform.nSamplesPerSec != CAPTURE_SAMPLE_RATE || waveform.nChannels != 1)) {
+			ret = OpenConverter(waveform.nSamplesPerSec, waveform.nChannels, m_recorder->period_ms);
+		}
+		if (ret == 0) {
+			ret = start_record(m_recorder);
+		}
+		if (ret != 0) {
+			LogError("CaptureHub: 打开录音设备失败: %d", ret);
+			close_recorder(m_recorder);
+			destroy_recorder(m_recorder);
+			m_recorder = nullptr;
+			CloseConverter();
+			return -1;
+		}
+
+		// 读者看到的始终是16k单声道，每个周期的数据量按转换后的格式计算
+		m_periodBytes = CAPTURE_SAMPLE_RATE / 1000 * 2 * m_recorder->period_ms;
+		m_running.store(true);
+		m_openCount++;
+		LogInfo("CaptureHub: 录音设备已打开，%u Hz %u 声道，周期 %u ms，队列深度 %u",
+			waveform.nSamplesPerSec, waveform.nChannels, m_recorder->period_ms, m_recorder->depth);
+		return 0;
+	}
+
+	int CaptureHub::OpenConverter(unsigned int rate, unsigned int channels, unsigned int periodMs) {
+		m_periodFrames = rate * periodMs / 1000;
+		m_blockAlign = channels * 2;
+		m_resampler = resampler_create(rate, channels, CAPTURE_SAMPLE_RATE, m_periodFrames);
+		if (m_resampler == nullptr) {
+			LogError("CaptureHub: 创建重采样器失败");
+			return -1;
+		}
+		m_convCap = resampler_max_output(m_resampler, m_periodFrames);
+		m_convBuf = (short*)malloc(m_convCap * sizeof(short));
+		if (m_convBuf == nullptr) {
+			LogError("CaptureHub: 转换缓冲区分配失败");
+			CloseConverter();
+			return -1;
+		}
+		LogInfo("CaptureHub: 采集格式 %u Hz %u 声道，转换为16k单声道（%s）",
+			rate, channels, resampler_simd_name(resampler_detect_simd()));
+		return 0;
+	}
+
+	void CaptureHub::CloseConverter() {
+		if (m_resampler) {
+			resampler_destroy(m_resampler);
+			m_resampler = nullptr;
+		}
+		if (m_convBuf) {
+			free(m_convBuf);
+			m_convBuf = nullptr;
+		}
+		m_convCap = 0;
+		m_blockAlign = 2;
+	}
+
+	void CaptureHub::CloseDevice() {
+		if (!m_recorder) {
+			return;
+		}
+		m_running.store(false);
+		stop_record(m_recorder);
+		for (int i = 0; i < 1000 && !is_record_stopped(m_recorder); ++i) {
+			Sleep(1);
+		}
+
+		struct record_stats stats;
+		get_recorder_stats(m_recorder, &stats);
+		if (stats.gaps > 0 || stats.overruns > 0) {
+			LogWarning("CaptureHub: 本次录音丢帧 %u 次共 %llu 字节，溢出 %u 次，最长停顿 %llu ms，队列扩容 %u 次",
+				stats.gaps, stats.lost_bytes, stats.overruns, stats.max_stall_us / 1000, stats.grows);
+		}
+		AccumulateRecordStats(&m_recordTotals, &stats);
+		close_recorder(m_recorder);
+		destroy_recorder(m_recorder);
+		m_recorder = nullptr;
+		m_periodBytes = 0;
+		CloseConverter();
+		LogInfo("CaptureHub: 录音设备已关闭");
+	}
+
+	int CaptureHub::Acquire() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_refCount == 0 && OpenDevice() != 0) {
+			return -1;
+		}
+		m_refCount++;
+		return 0;
+	}
+
+	void CaptureHub::Release() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_refCount <= 0) {
+			return;
+		}
+		if (--m_refCount == 0) {
+			CloseDevice();
+		}
+	}
+
+	CaptureConsumer* CaptureHub::Subscribe(HANDLE notifyEvent) {
+		if (Acquire() != 0) {
+			return nullptr;
+		}
+		CaptureConsumer* consumer = m_buffer.Subscribe(notifyEvent);
+		if (!consumer) {
+			Release();
+		}
+		return consumer;
+	}
+
+	void CaptureHub::Unsubscribe(CaptureConsumer* consumer) {
+		if (!consumer) {
+			return;
+		}
+		m_buffer.Unsubscribe(consumer);
+		Release();
+	}
+
+	void CaptureHub::SetPrerollMs(unsigned int ms) {
+		if (ms > CAPTURE_MAX_PREROLL_MS) {
+			LogWarning("CaptureHub: 预录长度 %u ms 超出上限，按 %u ms 处理", ms, CAPTURE_MAX_PREROLL_MS);
+			ms = CAPTURE_MAX_PREROLL_MS;
+		}
+		m_prerollMs.store(ms);
+	}
+
+	void CaptureHub::MarkWakeEnd(unsigned long long pos) {
+		m_wakeEndPos.store(pos);
+		m_wakeMarked.store(true);
+	}
+
+	unsigned long long CaptureHub::TakeCommandStart() {
+		unsigned long long live = m_buffer.WritePos();
+		bool marked = m_wakeMarked.exchange(false);
+		unsigned long long prerollBytes = (unsigned long long)m_prerollMs.load() * CAPTURE_BYTES_PER_MS;
+		if (!marked || prerollBytes == 0) {
+			return live;
+		}
+
+		unsigned long long wakeEnd = m_wakeEndPos.load();
+		unsigned long long floor = live > prerollBytes ? live - prerollBytes : 0;
+		if (wakeEnd > live) {
+			wakeEnd = live;
+		}
+		return wakeEnd > floor ? wakeEnd : floor;
+	}
+
+	void CaptureHub::GetCopyStats(CaptureCopyStats* stats) {
+		std::lock_guard<std::mutex> lock(m_copyStatsMutex);
+		unsigned long long copied = m_buffer.CopiedBytes();
+		unsigned long long leased = m_buffer.LeasedBytes();
+		unsigned long long now = GetTickCount64();
+		double seconds = (now - m_lastStatsMs) / 1000.0;
+
+		stats->copiedBytes = copied;
+		stats->leasedBytes = leased;
+		stats->copiedPerSec = seconds > 0 ? (copied - m_lastCopied) / seconds : 0.0;
+		stats->leasedPerSec = seconds > 0 ? (leased - m_lastLeased) / seconds : 0.0;
+
+		m_lastCopied = copied;
+		m_lastLeased = leased;
+		m_lastStatsMs = now;
+	}
+
+	void CaptureHub::GetRecordStats(struct record_stats* stats) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		*stats = m_recordTotals;
+		stats->depth = 0;
+		if (m_recorder) {
+			struct record_stats current;
+			get_recorder_stats(m_recorder, &current);
+			AccumulateRecordStats(stats, &current);
+			stats->depth = current.depth;
+		}
+	}
+}
+
+int GetCaptureRecordStats(struct record_stats* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+	AIKITDLL::CaptureHub::Instance().GetRecordStats(stats);
+	return 0;
+}
+
+int GetCaptureCopyStats(CaptureCopyStats* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+	AIKITDLL::CaptureHub::Instance().GetCopyStats(stats);
+	return 0;
+}
@@ -0,0 +1,248 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "winrec.h"
+
+struct resampler;
+struct vad_gate;
+
+// 单个采集消费者的统计信息（单位：字节）
+struct CaptureConsumerStats {
+	unsigned int capacity;            // 共享缓冲区容量
+	unsigned int depth;               // 当前未读数据量
+	unsigned int highWater;           // 未读数据峰值
+	unsigned long long position;      // 当前读位置（自采集开始的字节偏移）
+	unsigned long long readBytes;     // 累计读出
+	unsigned long long laps;          // 被写入方追上的次数
+	unsigned long long lostBytes;     // 被追上而跳过的数据量
+	unsigned long long leasedBytes;   // 通过租借直接交给引擎、没有经过拷贝的数据量
+	unsigned long long blockedBytes;  // 租借尚未归还、写入方为了不覆盖租借的数据而丢弃的录音数据量
+};
+
+// 采集链路上的拷贝统计（单位：字节）
+struct CaptureCopyStats {
+	unsigned long long copiedBytes;   // 累计拷贝：录音回调写入共享缓冲区 + 读者拷贝读出
+	unsigned long long leasedBytes;   // 累计以租借方式零拷贝读出
+	double copiedPerSec;              // 距上次查询以来每秒拷贝的字节数
+	double leasedPerSec;              // 距上次查询以来每秒零拷贝读出的字节数
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取共享采集的拷贝统计，成功返回0
+	AIKITDLL_API int GetCaptureCopyStats(CaptureCopyStats* stats);
+
+	// 获取共享采集录音设备的健康计数（丢帧、溢出、停顿时长、队列扩容），
+	// 自进程启动累计，包含已关闭的设备，成功返回0
+	AIKITDLL_API int GetCaptureRecordStats(struct record_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace AIKITDLL {
+	class CaptureBuffer;
+
+	// 采集流的一个读者，拥有独立的读位置
+	// 只能由一个线程读取；写入方永远不会等待读者，读者落后超过缓冲区容量时跳到最旧的有效数据并记入丢失。
+	// 租借中的数据不会被覆盖：写入会覆盖某个读者的租借时，写入方丢弃这一块录音，记入该读者的blockedBytes。
+	class CaptureConsumer {
+	public:
+		// 读出最多maxLen字节，返回实际读出的字节数
+		unsigned int Read(char* out, unsigned int maxLen);
+
+		// 零拷贝读取：返回共享缓冲区内从读位置开始的一段连续数据（不跨越环尾），
+		// len返回长度，没有数据时返回nullptr。租借期间读位置不动，这段数据不会被写入方覆盖，
+		// 用完后必须调用EndLease。
+		const char* BeginLease(unsigned int maxLen, unsigned int* len);
+
+		// 归还租借，读位置前进len字节（为0时只归还）
+		void EndLease(unsigned int len);
+
+		// 未读数据量
+		unsigned int Available() const;
+
+		// 跳到最新位置，之前的数据不再读取
+		void SeekToLive();
+
+		// 跳到指定位置，超出有效范围时取最近的有效位置，返回实际位置
+		unsigned long long Seek(unsigned long long pos);
+
+		// 当前读位置
+		unsigned long long Position() const { return m_cursor.load(std::memory_order_acquire); }
+
+		void GetStats(CaptureConsumerStats* stats) const;
+
+	private:
+		friend class CaptureBuffer;
+		CaptureConsumer(CaptureBuffer* owner, HANDLE notifyEvent, unsigned long long cursor);
+
+		CaptureBuffer* m_owner;
+		HANDLE m_notifyEvent;
+		std::atomic<unsigned long long> m_cursor;
+		std::atomic<unsigned long long> m_leasePos;      // 租借的起点，没有租借时为CAPTURE_NO_LEASE
+		// 统计只由读者线程（m_blockedBytes由写入方）更新，GetStats可在其他线程调用，用relaxed原子变量
+		std::atomic<unsigned long long> m_readBytes;
+		std::atomic<unsigned long long> m_laps;
+		std::atomic<unsigned long long> m_lostBytes;
+		std::atomic<unsigned long long> m_leasedBytes;
+		std::atomic<unsigned long long> m_blockedBytes;
+		std::atomic<unsigned int> m_highWater;
+	};
+
+	// 单写多读的广播环形缓冲区：写入方只推进写位置，每个读者各自维护读位置
+	class CaptureBuffer {
+	public:
+		// capacity会向上取整为2的幂
+		explicit CaptureBuffer(unsigned int capacity);
+		~CaptureBuffer();
+
+		CaptureBuffer(const CaptureBuffer&) = delete;
+		CaptureBuffer& operator=(const CaptureBuffer&) = delete;
+
+		// 写入方调用：追加一块数据并通知所有读者，不会阻塞在读者上。
+		// 这块数据会覆盖某个读者正在租借的数据时整块丢弃，返回false
+		bool Write(const char* data, unsigned int len);
+
+		// 已写入的总字节数，即最新数据的位置
+		unsigned long long WritePos() const { return m_writePos.load(std::memory_order_acquire); }
+
+		unsigned int Capacity() const { return m_capacity; }
+
+		// 累计拷贝和零拷贝读出的字节数
+		unsigned long long CopiedBytes() const { return m_copiedBytes.load(std::memory_order_relaxed); }
+		unsigned long long LeasedBytes() const { return m_leasedBytes.load(std::memory_order_relaxed); }
+
+		// 新读者从最新位置开始读；notifyEvent可为NULL，有新数据时会被SetEvent
+		CaptureConsumer* Subscribe(HANDLE notifyEvent);
+		void Unsubscribe(CaptureConsumer* consumer);
+
+	private:
+		friend class CaptureConsumer;
+
+		// 从pos处读取len字节；数据已被覆盖时返回false
+		bool ReadAt(unsigned long long pos, char* out, unsigned int len) const;
+
+		char* m_buffer;
+		unsigned int m_capacity;
+		unsigned int m_mask;
+
+		alignas(64) std::atomic<unsigned long long> m_writePos;   // 已完成写入的位置
+		std::atomic<unsigned long long> m_reservePos;              // 正在写入的区域末尾，读者据此判断数据是否被覆盖；
+		                                                           // 与读者的m_leasePos配对，双方先公布自己的位置再检查对方
+
+		std::atomic<unsigned long long> m_copiedBytes;
+		std::atomic<unsigned long long> m_leasedBytes;
+
+		std::mutex m_consumerMutex;
+		std::vector<CaptureConsumer*> m_consumers;
+	};
+
+	// 把一块音频写入引擎的函数，返回0表示成功
+	typedef int (*CaptureChunkWriter)(const char* data, unsigned int len, void* ctx);
+
+	// 把读者尚未读取的数据按不超过chunkLen的块直接交给writer（零拷贝），written返回写入的总字节数。
+	// gate不为NULL时静音块不写入；门限打开时先回放之前跳过的一小段音频，保证语音开头完整。
+	// 每块数据在writer返回后才归还，写入期间不会被录音覆盖
+	int PumpCapture(CaptureConsumer* consumer, unsigned int chunkLen, struct vad_gate* gate,
+		CaptureChunkWriter writer, void* ctx, unsigned int* written);
+
+	// 进程内共享的麦克风采集：只打开一次录音设备，唤醒和命令词识别作为读者挂在同一路采集流上，
+	// 切换时只需更换读者，不再关闭和重新打开设备。
+	class CaptureHub {
+	public:
+		static CaptureHub& Instance();
+
+		// 引用计数方式持有录音设备：第一次Acquire打开并开始录音，最后一次Release关闭设备
+		int Acquire();
+		void Release();
+
+		// 订阅采集流（隐含一次Acquire），失败返回nullptr
+		CaptureConsumer* Subscribe(HANDLE notifyEvent);
+		// 取消订阅（隐含一次Release）
+		void Unsubscribe(CaptureConsumer* consumer);
+
+		// 设备是否处于录音状态
+		bool IsRunning() const { return m_running.load(); }
+
+		// 录音设备每次回调的数据量，未打开时为0
+		unsigned int PeriodBytes() const { return m_periodBytes; }
+
+		// 设备打开的次数，用于验证唤醒与命令词识别之间没有重开设备
+		unsigned long long OpenCount() const { return m_openCount.load(); }
+
+		// 命令词识别的预录长度（毫秒），0表示只识别开始监听之后的音频
+		void SetPrerollMs(unsigned int ms);
+		unsigned int PrerollMs() const { return m_prerollMs.load(); }
+
+		// 记录唤醒词结束时在采集流中的位置
+		void MarkWakeEnd(unsigned long long pos);
+
+		// 命令词识别的起始位置：从唤醒词结束处开始，但不早于预录长度；
+		// 没有未使用的唤醒位置或预录关闭时返回最新位置。唤醒位置只使用一次。
+		unsigned long long TakeCommandStart();
+
+		// 是否在引擎前启用静音门限（默认启用），下次开始唤醒或命令词识别时生效
+		void SetVadEnabled(bool enabled) { m_vadEnabled.store(enabled); }
+		bool VadEnabled() const { return m_vadEnabled.load(); }
+
+		// 拷贝统计，每秒速率按距上次调用的间隔计算
+		void GetCopyStats(CaptureCopyStats* stats);
+
+		// 录音设备健康计数，depth为当前设备的队列深度（未打开时为0）
+		void GetRecordStats(struct record_stats* stats);
+
+	private:
+		CaptureHub();
+		~CaptureHub();
+		CaptureHub(const CaptureHub&) = delete;
+		CaptureHub& operator=(const CaptureHub&) = delete;
+
+		static void OnData(char* data, unsigned long len, void* para);
+		int OpenDevice();
+		void CloseDevice();
+		// 设备格式不是16k单声道时创建降混/重采样转换
+		int OpenConverter(unsigned int rate, unsigned int channels, unsigned int periodMs);
+		void CloseConverter();
+
+		std::mutex m_mutex;
+		int m_refCount;
+		struct recorder* m_recorder;
+		CaptureBuffer m_buffer;
+		unsigned int m_periodBytes;
+		std::atomic<bool> m_running;
+		std::atomic<unsigned long long> m_openCount;
+		std::atomic<unsigned int> m_prerollMs;
+		std::atomic<unsigned long long> m_wakeEndPos;
+		std::atomic<bool> m_wakeMarked;
+		std::atomic<bool> m_vadEnabled;
+
+		std::mutex m_copyStatsMutex;
+		unsigned long long m_lastCopied;
+		unsigned long long m_lastLeased;
+		unsigned long long m_lastStatsMs;
+
+		struct record_stats m_recordTotals;  // 已关闭设备的累计计数，受m_mutex保护
+
+		// 采集格式转换，只在录音线程上使用
+		struct resampler* m_resampler;
+		short* m_convBuf;
+		unsigned int m_convCap;       // 转换缓冲区容量（采样数）
+		unsigned int m_blockAlign;    // 设备格式每帧字节数
+		unsigned int m_periodFrames;  // 设备格式每周期帧数
+	};
+}
@@ -1,7 +1,14 @@
 #include "pch.h"
 #include "CnenEsrWrapper.h"
 #include "EsrHelper.h"
+#include "audiosrc.h"
+#include "TimerService.h"
+#include "CancelToken.h"
+#include "EsrStandby.h"
+#include "Teardown.h"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <process.h>
 #include <conio.h>
 #include <errno.h>
@@ -20,6 +27,7 @@ enum {
 	EVT_START = 0,
 	EVT_STOP,
 	EVT_QUIT,
+	EVT_TIMEOUT,    // 识别期限到期，由会话定时器触发
 	EVT_TOTAL
 };
 
@@ -32,7 +40,7 @@ enum ESR_STATUS {
 };
 
 // 事件句柄
-static HANDLE events[EVT_TOTAL] = { NULL, NULL, NULL };
+static HANDLE events[EVT_TOTAL] = { NULL, NULL, NULL, NULL };
 
 // ESR能力结果标识
 namespace AIKITDLL {
@@ -42,11 +50,69 @@ namespace AIKITDLL {
 	std::string lastEsrKeywordResult;            // 识别到的命令词结果
 	std::string lastEsrErrorInfo;                // 错误信息
 	std::mutex esrResultMutex;                   // 结果保护互斥锁
+
+	std::atomic<bool> esrEngineLoaded(false);
+	static std::mutex esrEngineMutex;            // 保护引擎加载/卸载和会话引用计数
+	static std::condition_variable esrEngineIdle; // 引用计数归零时通知
+	static int esrEngineRefs = 0;
+
+	// 以下在持有esrEngineMutex时调用
+	static int EsrEngineLoadLocked();
+	static void EsrEngineUnloadLocked();
+
+	static std::mutex esrPhaseMutex;
+	static EsrPhaseTimes lastEsrPhaseTimes;
+	static bool hasEsrPhaseTimes = false;
+
+	int EsrEngineAcquire(bool* loaded)
+	{
+		std::lock_guard<std::mutex> lock(esrEngineMutex);
+		if (loaded) *loaded = false;
+		if (!esrEngineLoaded.load()) {
+			int ret = EsrEngineLoadLocked();
+			if (ret != 0) {
+				return ret;
+			}
+			if (loaded) *loaded = true;
+		}
+		esrEngineRefs++;
+		return 0;
+	}
+
+	void EsrEngineRelease()
+	{
+		std::lock_guard<std::mutex> lock(esrEngineMutex);
+		if (esrEngineRefs > 0) {
+			esrEngineRefs--;
+			if (esrEngineRefs == 0) {
+				esrEngineIdle.notify_all();
+			}
+		}
+	}
+
+	int EsrEngineUnload(unsigned int timeoutMs)
+	{
+		unsigned long long begin = audio_source_now_us();
+		std::unique_lock<std::mutex> lock(esrEngineMutex);
+		bool idle = true;
+		if (esrEngineRefs > 0) {
+			idle = esrEngineIdle.wait_for(lock, std::chrono::milliseconds(timeoutMs), [] { return esrEngineRefs == 0; });
+			Teardown::Instance().Record(TEARDOWN_ESR_REFS, begin, idle);
+		}
+		if (!idle) {
+			LogError("EsrEngineUnload: 等待 %u ms 后仍有 %d 个识别会话在使用ESR引擎，放弃卸载", timeoutMs, esrEngineRefs);
+			return -1;
+		}
+		if (esrEngineLoaded.load()) {
+			EsrEngineUnloadLocked();
+		}
+		return 0;
+	}
 }
 
 // 从麦克风获取ESR结果的实现
 namespace AIKITDLL {
-	int esr_microphone(const char* abilityID)
+	int esr_microphone(const char* abilityID, EsrPhaseTimes* times, CancelToken* cancel)
 	{
 		AIKITDLL::LogInfo("正在初始化麦克风语音识别...");
 
@@ -54,33 +120,57 @@ namespace AIKITDLL {
 		HANDLE helper_thread = NULL;
 		DWORD waitres;
 		char isquit = 0;
-		struct EsrRecognizer esr;
-		DWORD startTime = GetTickCount();
+		struct EsrRecognizer* esr = nullptr;
 		const DWORD MAX_WAIT_TIME = 10000; // 10秒超时
-
-		// 初始化语音识别器
-		errcode = EsrInit(&esr, ESR_MIC, -1);
-		if (errcode) {
-			AIKITDLL::LogError("语音识别器初始化失败，错误码: %d", errcode);
-			return errcode;
+		Deadline deadline;
+		unsigned long long t0 = audio_source_now_us();
+		unsigned long long t1;
+
+		// 唤醒期间预开了会话时直接接过来，否则初始化新的语音识别器
+		esr = EsrStandby::Instance().Take();
+		if (esr == nullptr) {
+			esr = new EsrRecognizer();
+			errcode = EsrInit(esr, ESR_MIC, get_default_input_dev());
+			if (errcode) {
+				AIKITDLL::LogError("语音识别器初始化失败，错误码: %d", errcode);
+				delete esr;
+				return errcode;
+			}
 		}
+		t1 = audio_source_now_us();
 
 		// 创建事件句柄
 		for (int i = 0; i < EVT_TOTAL; ++i) {
 			events[i] = CreateEvent(NULL, FALSE, FALSE, NULL);
 			if (events[i] == NULL) {
 				AIKITDLL::LogError("创建事件失败，错误码: %d", GetLastError());
-				EsrUninit(&esr);
+				EsrUninit(esr);
+				delete esr;
 				return -1;
 			}
 		}
 
+		// 识别期限由会话定时器管理，到期时触发EVT_TIMEOUT
+		deadline.Start(MAX_WAIT_TIME, events[EVT_TIMEOUT]);
+
+		// 取消令牌的事件接在会话事件后面，取消时立即结束等待
+		HANDLE waitSet[EVT_TOTAL + 1];
+		DWORD waitCount = EVT_TOTAL;
+		memcpy(waitSet, events, sizeof(events));
+		if (cancel && cancel->Event()) {
+			waitSet[waitCount++] = cancel->Event();
+		}
+
 		AIKITDLL::LogInfo("开始监听语音...");
-		errcode = EsrStartListening(&esr);
+		errcode = EsrStartListening(esr);
 		if (errcode) {
 			AIKITDLL::LogError("开始监听失败，错误码: %d", errcode);
 			isquit = 1; // 标记退出
 		}
+		if (times) {
+			times->recognizerUs = (long long)(t1 - t0);
+			times->startUs = esr->started_us > t1 ? (long long)(esr->started_us - t1) : 0;
+		}
 		
 		char plainResultBuffer[8192]; // 用于接收 plain 结果的缓冲区
 		bool hasNewResult = false;
@@ -109,7 +199,7 @@ namespace AIKITDLL {
 				AIKITDLL::esrStatus = ESR_STATUS_SUCCESS;
 				AIKITDLL::LogInfo("已识别到命令词: %s，准备退出监听", actualJson);
 				
-				errcode = EsrStopListening(&esr);
+				errcode = EsrStopListening(esr);
 				if (errcode) {
 					AIKITDLL::LogError("停止监听失败，错误码: %d", errcode);
 				}
@@ -122,7 +212,7 @@ namespace AIKITDLL {
 			// 检查是否已经失败 (例如由其他逻辑设置)
 			if (esrStatus.load() == ESR_STATUS_FAILED) {
 				AIKITDLL::LogInfo("命令词识别已失败（由其他部分标记），准备退出监听");
-				errcode = EsrStopListening(&esr);
+				errcode = EsrStopListening(esr);
 				if (errcode) {
 					AIKITDLL::LogError("停止监听失败，错误码: %d", errcode);
 				}
@@ -131,9 +221,9 @@ namespace AIKITDLL {
 			}
 
 			// 检查是否超时
-			if (GetTickCount() - startTime > MAX_WAIT_TIME) {
+			if (deadline.Expired()) {
 				AIKITDLL::LogInfo("命令词识别超时，准备退出监听");
-				errcode = EsrStopListening(&esr);
+				errcode = EsrStopListening(esr);
 				if (errcode) {
 					AIKITDLL::LogError("停止监听失败，错误码: %d", errcode);
 				}
@@ -144,8 +234,20 @@ namespace AIKITDLL {
 				break;
 			}
 
+			// 检查是否被取消
+			if (IsCancelled(cancel)) {
+				AIKITDLL::LogInfo("命令词识别已取消，停止监听");
+				EsrStopListening(esr);
+				std::lock_guard<std::mutex> lock(AIKITDLL::esrResultMutex);
+				AIKITDLL::esrStatus = ESR_STATUS_FAILED;
+				AIKITDLL::lastEsrErrorInfo = "识别已取消";
+				errcode = E_SESSION_CANCELLED;
+				isquit = 1;
+				break;
+			}
+
 			// 等待事件，设置较短的超时时间以便定期检查识别结果
-			waitres = WaitForMultipleObjects(EVT_TOTAL, events, FALSE, 200); // 缩短等待时间，更频繁检查
+			waitres = WaitForMultipleObjects(waitCount, waitSet, FALSE, 200); // 缩短等待时间，更频繁检查
 			switch (waitres) {
 			case WAIT_FAILED:
 				AIKITDLL::LogError("等待事件失败，错误码: %d", GetLastError());
@@ -156,7 +258,7 @@ namespace AIKITDLL {
 				break;
 			case WAIT_OBJECT_0 + EVT_STOP:
 				AIKITDLL::LogInfo("接收到停止事件，停止监听语音...");
-				errcode = EsrStopListening(&esr);
+				errcode = EsrStopListening(esr);
 				if (errcode) {
 					AIKITDLL::LogError("停止监听失败，错误码: %d", errcode);
 				}
@@ -164,7 +266,7 @@ namespace AIKITDLL {
 				break;
 			case WAIT_OBJECT_0 + EVT_QUIT:
 				AIKITDLL::LogInfo("接收到退出事件，正在退出...");
-				EsrStopListening(&esr); // 尝试停止
+				EsrStopListening(esr); // 尝试停止
 				isquit = 1;
 				break;
 			default:
@@ -173,8 +275,8 @@ namespace AIKITDLL {
 			}
 		}
 
-		// 清理资源
-		// ... (保持原有清理逻辑)
+		// 清理资源；先取消期限，之后不会再触发即将关闭的事件
+		deadline.Cancel();
 		if (helper_thread != NULL) {
 			WaitForSingleObject(helper_thread, INFINITE);
 			CloseHandle(helper_thread);
@@ -187,7 +289,11 @@ namespace AIKITDLL {
 			}
 		}
 
-		EsrUninit(&esr);
+		if (times) {
+			times->firstWriteUs = esr->first_write_us > esr->started_us ? (long long)(esr->first_write_us - esr->started_us) : -1;
+		}
+		EsrUninit(esr);
+		delete esr;
 		AIKITDLL::LogInfo("麦克风语音识别已结束");
 		return errcode; // 返回最后的错误码
 	}
@@ -195,6 +301,17 @@ namespace AIKITDLL {
 
 // ESR初始化函数
 int CnenEsrInit()
+{
+	std::lock_guard<std::mutex> lock(AIKITDLL::esrEngineMutex);
+	if (AIKITDLL::esrEngineLoaded.load()) {
+		AIKITDLL::LogInfo("ESR引擎和FSA语法已加载，跳过初始化");
+		return 0;
+	}
+	return AIKITDLL::EsrEngineLoadLocked();
+}
+
+// 加载ESR引擎和FSA语法
+int AIKITDLL::EsrEngineLoadLocked()
 {
 	AIKITDLL::LogInfo("正在初始化ESR能力...");
 
@@ -252,15 +369,41 @@ int CnenEsrInit()
 	}
 	AIKITDLL::LogInfo("FSA数据加载成功");
 
+	// 语法只有一套，加载时指定一次，之后每次识别只需开始会话
+	{
+		int index[] = { 0 };
+		ret = AIKIT::AIKIT_SpecifyDataSet(ESR_ABILITY, "FSA", index, 1);
+		if (ret != 0) {
+			AIKITDLL::LogError("AIKIT_SpecifyDataSet 失败，错误码: %d", ret);
+			AIKIT::AIKIT_UnLoadData(ESR_ABILITY, "FSA", 0);
+			delete engine_paramBuilder;
+			delete customBuilder;
+			return ret;
+		}
+	}
+
 	// 清理资源
 	delete engine_paramBuilder;
 	delete customBuilder;
 
+	AIKITDLL::esrEngineLoaded.store(true);
 	return 0;
 }
 
 // ESR资源释放
 int CnenEsrUninit()
+{
+	std::lock_guard<std::mutex> lock(AIKITDLL::esrEngineMutex);
+	if (AIKITDLL::esrEngineRefs > 0) {
+		AIKITDLL::LogWarning("仍有 %d 个识别会话在使用ESR引擎，暂不释放", AIKITDLL::esrEngineRefs);
+		return -1;
+	}
+	AIKITDLL::EsrEngineUnloadLocked();
+	return 0;
+}
+
+// 卸载FSA语法和ESR引擎
+void AIKITDLL::EsrEngineUnloadLocked()
 {
 	AIKITDLL::LogInfo("正在释放ESR资源...");
 
@@ -270,7 +413,26 @@ int CnenEsrUninit()
 		AIKITDLL::LogWarning("卸载FSA数据时出现警告，错误码: %d", ret);
 	}
 
+	ret = AIKIT::AIKIT_EngineUnInit(ESR_ABILITY);
+	if (ret != 0) {
+		AIKITDLL::LogWarning("ESR引擎反初始化异常，错误码: %d", ret);
+	}
+	AIKITDLL::esrEngineLoaded.store(false);
+
 	AIKITDLL::LogInfo("ESR资源释放完成");
+}
+
+// 获取最近一次麦克风命令词识别的各阶段耗时
+int GetEsrPhaseTimes(EsrPhaseTimes* times)
+{
+	if (!times) {
+		return -1;
+	}
+	std::lock_guard<std::mutex> lock(AIKITDLL::esrPhaseMutex);
+	if (!AIKITDLL::hasEsrPhaseTimes) {
+		return -1;
+	}
+	*times = AIKITDLL::lastEsrPhaseTimes;
 	return 0;
 }
 
@@ -306,6 +468,8 @@ void TestEsr(const AIKIT_Callbacks& cbs)
 {
 	AIKITDLL::LogInfo("======================= ESR 测试开始 ===========================");
 
+	bool engineHeld = false;
+
 	try {
 		int ret = 0;
 
@@ -321,13 +485,14 @@ void TestEsr(const AIKIT_Callbacks& cbs)
 		}
 		AIKITDLL::LogInfo("注册能力回调成功");
 
-		// 初始化ESR
-		ret = CnenEsrInit();
+		// 初始化ESR（已常驻时直接复用）
+		ret = AIKITDLL::EsrEngineAcquire(nullptr);
 		if (ret != 0) {
 			AIKITDLL::LogError("ESR初始化失败，错误码: %d", ret);
 			AIKITDLL::esrStatus = ESR_STATUS_FAILED;
 			goto exit;
 		}
+		engineHeld = true;
 
 		// 直接从音频文件读取数据
 		const char* audioFilePath = ".\\resource\\cnenesr\\testAudio\\cn_test.pcm";
@@ -353,20 +518,33 @@ void TestEsr(const AIKIT_Callbacks& cbs)
 	}
 
 exit:
-	// 释放资源
-	CnenEsrUninit();
+	// 归还会话引用，引擎保持加载
+	if (engineHeld) {
+		AIKITDLL::EsrEngineRelease();
+	}
 
 	AIKITDLL::LogInfo("======================= ESR 测试结束 ===========================");
 }
 
 // 麦克风输入的ESR测试函数
 int EsrMicrophone(const AIKIT_Callbacks& cbs)
+{
+	return AIKITDLL::EsrMicrophoneSession(cbs, nullptr);
+}
+
+int AIKITDLL::EsrMicrophoneSession(const AIKIT_Callbacks& cbs, CancelToken* cancel)
 {
 	AIKITDLL::LogInfo("======================= ESR 麦克风测试开始 ===========================");
 
+	EsrPhaseTimes times = {};
+	bool engineHeld = false;
+	unsigned long long t0 = audio_source_now_us();
+	unsigned long long t1;
+
 	try {
 		// 注册回调
 		int ret = 0;
+		bool loaded = false;
 
 		// 设置状态为处理中
 		AIKITDLL::esrStatus = ESR_STATUS_PROCESSING;
@@ -379,18 +557,41 @@ int EsrMicrophone(const AIKIT_Callbacks& cbs)
 			return -1;
 		}
 		AIKITDLL::LogInfo("注册能力回调成功");
+		t1 = audio_source_now_us();
+		times.registerUs = (long long)(t1 - t0);
 
-		// 初始化ESR
-		ret = CnenEsrInit();
+		// 引擎和语法常驻，只有第一次（或被卸载后）才真正加载
+		ret = AIKITDLL::EsrEngineAcquire(&loaded);
 		if (ret != 0) {
 			AIKITDLL::LogError("ESR初始化失败，错误码: %d", ret);
 			AIKITDLL::esrStatus = ESR_STATUS_FAILED;
 			goto exit;
 		}
+		engineHeld = true;
+		times.engineLoaded = loaded ? 1 : 0;
+		times.engineUs = (long long)(audio_source_now_us() - t1);
+
 		// 从麦克风获取音频数据
 		AIKITDLL::LogInfo("开始从麦克风获取音频数据");
-		ret = AIKITDLL::esr_microphone(ESR_ABILITY);
-		if (ret != 0) {
+		times.readyUs = -1;
+		times.firstWriteUs = -1;
+		ret = AIKITDLL::esr_microphone(ESR_ABILITY, &times, cancel);
+		times.readyUs = times.registerUs + times.engineUs + times.recognizerUs + times.startUs;
+		AIKITDLL::LogInfo("ESR各阶段耗时(us): 注册=%lld 引擎%s=%lld 识别器=%lld 开始会话=%lld 就绪=%lld 首次写入=%lld",
+			times.registerUs, loaded ? "加载" : "复用", times.engineUs, times.recognizerUs,
+			times.startUs, times.readyUs, times.firstWriteUs);
+		{
+			std::lock_guard<std::mutex> lock(AIKITDLL::esrPhaseMutex);
+			AIKITDLL::lastEsrPhaseTimes = times;
+			AIKITDLL::hasEsrPhaseTimes = true;
+		}
+		AIKITDLL::EsrEngineRelease();
+		engineHeld = false;
+
+		if (ret == E_SESSION_CANCELLED) {
+			AIKITDLL::LogInfo("麦克风识别已取消");
+		}
+		else if (ret != 0) {
 			AIKITDLL::LogError("麦克风处理失败，错误码: %d", ret);
 			AIKITDLL::esrStatus = ESR_STATUS_FAILED;
 		}
@@ -420,11 +621,12 @@ int EsrMicrophone(const AIKIT_Callbacks& cbs)
 	}
 
 exit:
-	// 释放资源
-	CnenEsrUninit();
-	return -1;
-
+	// 只归还会话引用，引擎保持加载供下一次识别使用
+	if (engineHeld) {
+		AIKITDLL::EsrEngineRelease();
+	}
 	AIKITDLL::LogInfo("======================= ESR 麦克风测试结束 ===========================");
+	return -1;
 }
 
 // 获取ESR状态
@@ -2,6 +2,7 @@
 
 #include "Common.h"
 #include <Windows.h>
+#include <atomic>
 #include <mmsystem.h>
 #pragma comment(lib, "winmm.lib")
 
@@ -27,12 +28,26 @@ extern "C" {
 // ESR结果回调相关错误码
 #define ESR_HAS_RESULT 6001
 
-	// ESR能力初始化
+	// 一次麦克风命令词识别各阶段的耗时（微秒）
+	struct EsrPhaseTimes {
+		long long registerUs;    // 注册能力回调
+		long long engineUs;      // 引擎和FSA语法就绪，引擎常驻时接近0
+		long long recognizerUs;  // 创建识别器：构建器、订阅共享采集流、送数线程
+		long long startUs;       // 开始会话（AIKIT_Start）
+		long long readyUs;       // 进入EsrMicrophone到会话可以接收音频
+		long long firstWriteUs;  // 会话开始到第一次写入引擎完成，含等待音频（静音门限开启时等待语音）
+		int engineLoaded;        // 本次是否加载了引擎和语法
+	};
+
+	// ESR能力初始化：初始化引擎、加载并指定FSA语法。引擎已加载时直接返回0
 	AIKITDLL_API int CnenEsrInit();
 
-	// ESR资源释放
+	// ESR资源释放：卸载FSA语法并反初始化引擎。仍有识别会话在使用时不释放，返回-1
 	AIKITDLL_API int CnenEsrUninit();
 
+	// 获取最近一次麦克风命令词识别的各阶段耗时，成功返回0，还没有识别过时返回-1
+	AIKITDLL_API int GetEsrPhaseTimes(EsrPhaseTimes* times);
+
 	// ESR测试函数 - 从麦克风输入
 	AIKITDLL_API int EsrFromMicrophone();
 
@@ -52,8 +67,27 @@ extern "C" {
 
 // 内部使用的函数
 namespace AIKITDLL {
-	// 麦克风输入的ESR处理函数
-	int esr_microphone(const char* abilityID);
+	// 命令词识别引擎和FSA语法是否已加载（CnenEsrInit成功后置位，CnenEsrUninit或SDK反初始化后清除）
+	extern std::atomic<bool> esrEngineLoaded;
+
+	// 识别会话开始前调用：引擎未加载时加载引擎和语法（loaded返回true），并增加会话引用计数
+	int EsrEngineAcquire(bool* loaded);
+
+	// 识别会话结束后调用：减少引用计数，引擎和语法保持加载
+	void EsrEngineRelease();
+
+	// 拆除时调用：等待所有识别会话归还引用（最多timeoutMs）后卸载引擎和语法。
+	// 到时仍有引用返回-1，引擎保持加载，调用方不能再反初始化SDK
+	int EsrEngineUnload(unsigned int timeoutMs);
+
+	class CancelToken;
+
+	// 麦克风输入的ESR处理函数，times不为空时填入识别器创建和会话开始各阶段的耗时。
+	// cancel被取消时在一帧之内停止监听，返回E_SESSION_CANCELLED
+	int esr_microphone(const char* abilityID, EsrPhaseTimes* times = nullptr, CancelToken* cancel = nullptr);
+
+	// EsrMicrophone的可取消版本
+	int EsrMicrophoneSession(const AIKIT_Callbacks& cbs, CancelToken* cancel);
 
 	// 从文件进行ESR处理的内部实现
 	int esr_file(const char* abilityID, const char* audioFilePath, int fsa_count, long* readLen);
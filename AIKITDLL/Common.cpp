@@ -2,6 +2,9 @@
 #include "Common.h"
 #include "IvwWrapper.h"
 #include "VoiceStateManager.h"
+#include "EngineLoader.h"
+#include "Teardown.h"
+#include "IvwEval.h"
 #include <string.h>
 #include <aikit_constant.h>
 #include <Windows.h>
@@ -36,10 +39,16 @@ namespace AIKITDLL {
 	}
 	
 	void OnOutput(AIKIT_HANDLE* handle, const AIKIT_OutputData* output) {
+		// 拆除时等待回调返回
+		CallbackScope scope;
 		if (!handle || !output || !output->node) {
 			LogError("OnOutput received invalid parameters");
 			return;
 		}
+		// 评测会话的唤醒只记到它自己的上下文，不改变全局唤醒状态
+		if (IvwEvalOnOutput(handle, output)) {
+			return;
+		}
 
 		// Log the output
 		LogInfo("OnOutput abilityID: %s", handle->abilityID);
@@ -100,6 +109,10 @@ namespace AIKITDLL {
 	}
 
 	void OnEvent(AIKIT_HANDLE* handle, AIKIT_EVENT eventType, const AIKIT_OutputEvent* eventValue) {
+		CallbackScope scope;
+		if (IvwEvalOwns(handle)) {
+			return;
+		}
 		// 记录事件信息
 		LogInfo("OnEvent abilityID: %s, eventType: %d", handle ? handle->abilityID : "NULL", eventType);
 
@@ -202,6 +215,11 @@ namespace AIKITDLL {
 	}
 
 	void OnError(AIKIT_HANDLE* handle, int32_t err, const char* desc) {
+		CallbackScope scope;
+		if (IvwEvalOnError(handle, err)) {
+			LogError("IvwEval: 会话出错: %d - %s", err, desc ? desc : "无描述");
+			return;
+		}
 		std::string errorMsg = "错误: " + std::to_string(err) + " - " + std::string(desc ? desc : "无描述");
 		lastResult = errorMsg;
 
@@ -209,9 +227,8 @@ namespace AIKITDLL {
 		LogError("AIKIT错误: %d - %s", err, desc ? desc : "无描述");
 	}
 
-	// 将日志写入文件
-	void WriteToLogFile(const std::string& level, const std::string& message) {
-		std::lock_guard<std::mutex> lock(logMutex);
+	// 将日志写入文件，调用方持有logMutex
+	static void WriteToLogFile(const std::string& level, const std::string& message) {
 		std::ofstream logFile("D:\\AIKITDLL\\aikit_wpf_demo.log", std::ios::app);
 		if (logFile.is_open()) {
 			logFile << GetCurrentTimeString() << " [" << level << "] " << message << std::endl;
@@ -227,10 +244,10 @@ namespace AIKITDLL {
 		// 在控制台输出
 		printf("[%s] %s\n", level, buffer);
 
-		// 同时写入日志文件
+		// 写入日志文件并更新最后结果：批量识别、评测和预热的工作线程会同时记录日志，
+		// lastResult的赋值也要在logMutex内完成
+		std::lock_guard<std::mutex> lock(logMutex);
 		WriteToLogFile(level, buffer);
-
-		// 更新最后结果
 		lastResult = std::string(level) + ": " + buffer;
 	}
 
@@ -266,62 +283,9 @@ namespace AIKITDLL {
 		va_end(args);
 	}
 
-	// 加载引擎所需的动态库
+	// 加载引擎所需的动态库：只在第一次调用时真正加载，之后直接返回缓存的结果
 	bool EnsureEngineDllsLoaded() {
-		// 获取当前程序架构
-#ifdef _WIN64
-		const char* libsDir = "D:\\AIKITDLL\\libs\\64";
-#else
-		const char* libsDir = ".\\libs\\32";
-#endif
-
-		LogInfo("正在加载引擎动态库，目录: %s", libsDir);
-
-		// 添加DLL搜索路径
-		if (!SetDllDirectoryA(libsDir)) {
-			LogError("设置DLL搜索路径失败，错误码: %d", GetLastError());
-			return false;
-		}
-
-		// 获取当前环境变量PATH
-		char pathBuffer[32768] = { 0 }; // 大小足够存储PATH
-		if (GetEnvironmentVariableA("PATH", pathBuffer, sizeof(pathBuffer)) > 0) {
-			// 添加库路径到PATH
-			std::string newPath = std::string(libsDir) + ";" + pathBuffer;
-			if (!SetEnvironmentVariableA("PATH", newPath.c_str())) {
-				LogWarning("更新PATH环境变量失败，错误码: %d", GetLastError());
-				// 继续执行，因为SetDllDirectory可能已经足够
-			}
-		}
-
-		// 预加载关键DLL文件
-		std::string aeeLibPath = std::string(libsDir) + "\\AEE_lib.dll";
-		HMODULE hAeeLib = LoadLibraryExA(aeeLibPath.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
-		if (!hAeeLib) {
-			LogError("加载AEE_lib.dll失败，错误码: %d", GetLastError());
-			return false;
-		}
-		LogInfo("成功加载AEE_lib.dll");
-
-		// 尝试加载语音唤醒相关的DLL
-		const char* ivwDllNames[] = {
-			"eabb2f029_v10092_aee.dll",
-			"ef7d69542_v1014_aee.dll"
-		};
-
-		for (const char* dllName : ivwDllNames) {
-			std::string dllPath = std::string(libsDir) + "\\" + dllName;
-			HMODULE hDll = LoadLibraryExA(dllPath.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
-			if (!hDll) {
-				LogWarning("加载%s失败，错误码: %d", dllName, GetLastError());
-				// 继续尝试加载其他DLL
-			}
-			else {
-				LogInfo("成功加载%s", dllName);
-			}
-		}
-
-		return true;
+		return EngineLoader::Instance().Load();
 	}
 }
 
@@ -25,7 +25,8 @@ extern "C" {
 	// 初始化SDK并配置回调函数
 	AIKITDLL_API int InitializeAIKitSDK();
 
-	// 清理SDK资源
+	// 清理SDK资源：停止语音助手，结束预开会话，卸载引擎并反初始化SDK，停止所有后台线程。
+	// 卸载DLL（FreeLibrary）或退出进程前调用：静态对象在加载器锁内析构，那时不再等待线程退出
 	AIKITDLL_API void CleanupSDK();
 
 #ifdef __cplusplus
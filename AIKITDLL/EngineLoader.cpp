@@ -0,0 +1,209 @@
+#include "pch.h"
+#include "EngineLoader.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <cstring>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#include <errno.h>
+#endif
+
+// 引擎动态库目录和文件名，AEE_lib是其余引擎库的依赖，必须先加载
+#ifdef _WIN32
+#ifdef _WIN64
+#define ENGINE_LIBS_DIR "D:\\AIKITDLL\\libs\\64"
+#else
+#define ENGINE_LIBS_DIR ".\\libs\\32"
+#endif
+#define ENGINE_PATH_SEP "\\"
+static const struct { const char* name; bool required; } g_engineLibraries[] = {
+	{ "AEE_lib.dll", true },
+	{ "eabb2f029_v10092_aee.dll", false },   // 语音唤醒
+	{ "ef7d69542_v1014_aee.dll", false },
+};
+#else
+#define ENGINE_LIBS_DIR "./libs/64"
+#define ENGINE_PATH_SEP "/"
+static const struct { const char* name; bool required; } g_engineLibraries[] = {
+	{ "libAEE_lib.so", true },
+	{ "libeabb2f029_v10092_aee.so", false },
+	{ "libef7d69542_v1014_aee.so", false },
+};
+#endif
+
+namespace AIKITDLL {
+
+	EngineLoader& EngineLoader::Instance() {
+		static EngineLoader instance;
+		return instance;
+	}
+
+	EngineLoader::EngineLoader()
+		: m_libsDir(ENGINE_LIBS_DIR), m_searchPathSet(false), m_loaded(false),
+		m_attempts(0), m_calls(0), m_totalUs(0) {
+		for (const auto& lib : g_engineLibraries) {
+			Library entry;
+			entry.name = lib.name;
+			entry.required = lib.required;
+			entry.handle = nullptr;
+			entry.error = 0;
+			entry.loadUs = 0;
+			m_libraries.push_back(entry);
+		}
+	}
+
+	bool EngineLoader::Load() {
+		m_calls.fetch_add(1, std::memory_order_relaxed);
+		if (m_loaded.load(std::memory_order_acquire)) {
+			return true;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_loaded.load(std::memory_order_relaxed)) {
+			return true;
+		}
+		return LoadLocked();
+	}
+
+	bool EngineLoader::IsLoaded() const {
+		return m_loaded.load(std::memory_order_acquire);
+	}
+
+	// 设置一次搜索路径，使引擎库之间的依赖能在库目录中找到
+	bool EngineLoader::SetSearchPathLocked() {
+		if (m_searchPathSet) {
+			return true;
+		}
+#ifdef _WIN32
+		if (!SetDllDirectoryA(m_libsDir.c_str())) {
+			LogError("设置DLL搜索路径失败，错误码: %d", GetLastError());
+			return false;
+		}
+
+		// PATH中还没有库目录时才添加，避免重复加载时PATH不断变长
+		char pathBuffer[32768] = { 0 };
+		DWORD len = GetEnvironmentVariableA("PATH", pathBuffer, sizeof(pathBuffer));
+		if (len > 0 && len < sizeof(pathBuffer)) {
+			bool found = false;
+			const char* p = pathBuffer;
+			while (*p && !found) {
+				const char* end = strchr(p, ';');
+				size_t n = end ? (size_t)(end - p) : strlen(p);
+				found = n == m_libsDir.size() && _strnicmp(p, m_libsDir.c_str(), n) == 0;
+				p += n;
+				if (*p == ';') {
+					p++;
+				}
+			}
+			if (!found) {
+				std::string newPath = m_libsDir + ";" + pathBuffer;
+				if (!SetEnvironmentVariableA("PATH", newPath.c_str())) {
+					LogWarning("更新PATH环境变量失败，错误码: %d", GetLastError());
+					// 继续执行，因为SetDllDirectory可能已经足够
+				}
+			}
+		}
+#endif
+		// Linux下用完整路径加载，并以RTLD_GLOBAL导出符号，后加载的库可以解析前面库的符号
+		m_searchPathSet = true;
+		return true;
+	}
+
+	bool EngineLoader::LoadLocked() {
+		unsigned long long begin = audio_source_now_us();
+		m_attempts++;
+		LogInfo("正在加载引擎动态库，目录: %s（第 %u 次）", m_libsDir.c_str(), m_attempts);
+
+		if (!SetSearchPathLocked()) {
+			return false;
+		}
+
+		bool ok = true;
+		for (auto& lib : m_libraries) {
+			if (lib.handle) {
+				continue;
+			}
+			std::string path = m_libsDir + ENGINE_PATH_SEP + lib.name;
+			unsigned long long t0 = audio_source_now_us();
+#ifdef _WIN32
+			lib.handle = (void*)LoadLibraryExA(path.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+			lib.error = lib.handle ? 0 : (int)GetLastError();
+#else
+			lib.handle = dlopen(path.c_str(), RTLD_NOW | RTLD_GLOBAL);
+			lib.error = lib.handle ? 0 : ENOENT;
+#endif
+			lib.loadUs = (long long)(audio_source_now_us() - t0);
+			if (lib.handle) {
+				LogInfo("成功加载%s，耗时 %.1f ms", lib.name.c_str(), lib.loadUs / 1000.0);
+				continue;
+			}
+			if (!lib.required) {
+				LogWarning("加载%s失败，错误码: %d", lib.name.c_str(), lib.error);
+				// 继续尝试加载其他库
+				continue;
+			}
+			LogError("加载%s失败，错误码: %d", lib.name.c_str(), lib.error);
+#ifndef _WIN32
+			LogError("dlopen: %s", dlerror());
+#endif
+			// 依赖库加载失败，其余库也无法加载
+			ok = false;
+			break;
+		}
+
+		m_totalUs = (long long)(audio_source_now_us() - begin);
+		if (ok) {
+			m_loaded.store(true, std::memory_order_release);
+			LogInfo("引擎动态库加载完成，耗时 %.1f ms", m_totalUs / 1000.0);
+		}
+		return ok;
+	}
+
+	void EngineLoader::GetStatus(EngineLoaderStatus* status) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		status->loaded = m_loaded.load() ? 1 : 0;
+		status->libraries = (unsigned int)m_libraries.size();
+		status->failed = 0;
+		for (const auto& lib : m_libraries) {
+			if (!lib.handle) {
+				status->failed++;
+			}
+		}
+		status->attempts = m_attempts;
+		status->calls = m_calls.load();
+		status->totalUs = m_totalUs;
+	}
+
+	bool EngineLoader::GetLibraryInfo(unsigned int index, EngineLibraryInfo* info) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (index >= m_libraries.size()) {
+			return false;
+		}
+		const Library& lib = m_libraries[index];
+		memset(info, 0, sizeof(*info));
+		memcpy(info->name, lib.name.c_str(), lib.name.size() < sizeof(info->name) ? lib.name.size() : sizeof(info->name) - 1);
+		info->loaded = lib.handle ? 1 : 0;
+		info->required = lib.required ? 1 : 0;
+		info->error = lib.error;
+		info->loadUs = lib.loadUs;
+		return true;
+	}
+}
+
+int GetEngineLoaderStatus(EngineLoaderStatus* status)
+{
+	if (!status) {
+		return -1;
+	}
+	AIKITDLL::EngineLoader::Instance().GetStatus(status);
+	return 0;
+}
+
+int GetEngineLibraryInfo(unsigned int index, EngineLibraryInfo* info)
+{
+	if (!info) {
+		return -1;
+	}
+	return AIKITDLL::EngineLoader::Instance().GetLibraryInfo(index, info) ? 0 : -1;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 单个引擎动态库的加载结果
+struct EngineLibraryInfo {
+	char name[64];            // 文件名
+	int loaded;               // 1表示已加载
+	int required;             // 1表示加载失败时引擎不可用
+	int error;                // 加载失败时的系统错误码（Windows为GetLastError）
+	long long loadUs;         // 加载耗时（微秒）
+};
+
+// 引擎动态库加载器的状态
+struct EngineLoaderStatus {
+	int loaded;               // 1表示必需的库均已加载
+	unsigned int libraries;   // 库的数量
+	unsigned int failed;      // 加载失败的库数量（含可选库）
+	unsigned int attempts;    // 实际执行加载的次数（成功后不再重复加载）
+	unsigned long long calls; // EnsureEngineDllsLoaded被调用的次数
+	long long totalUs;        // 最近一次加载的总耗时（微秒）
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取引擎动态库加载器的状态，成功返回0
+	AIKITDLL_API int GetEngineLoaderStatus(EngineLoaderStatus* status);
+
+	// 获取第index个引擎动态库的加载结果，index越界返回-1
+	AIKITDLL_API int GetEngineLibraryInfo(unsigned int index, EngineLibraryInfo* info);
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace AIKITDLL {
+	// 引擎动态库加载器：进程内只加载一次，缓存模块句柄，之后的调用直接返回结果。
+	// 加载失败时保留已加载的库，下次调用再重试失败的部分。线程安全。
+	// 句柄在进程退出前不释放：SDK内部会持有其中的函数指针。
+	class EngineLoader {
+	public:
+		static EngineLoader& Instance();
+
+		// 加载所有引擎动态库，必需的库都已加载时返回true
+		bool Load();
+
+		bool IsLoaded() const;
+
+		void GetStatus(EngineLoaderStatus* status) const;
+		bool GetLibraryInfo(unsigned int index, EngineLibraryInfo* info) const;
+
+	private:
+		EngineLoader();
+		EngineLoader(const EngineLoader&) = delete;
+		EngineLoader& operator=(const EngineLoader&) = delete;
+
+		struct Library {
+			std::string name;
+			bool required;
+			void* handle;         // Windows为HMODULE，Linux为dlopen的返回值
+			int error;
+			long long loadUs;
+		};
+
+		bool LoadLocked();
+		bool SetSearchPathLocked();
+
+		mutable std::mutex m_mutex;
+		std::string m_libsDir;
+		std::vector<Library> m_libraries;
+		bool m_searchPathSet;
+		std::atomic<bool> m_loaded;           // 已加载后不再加锁，直接返回
+		unsigned int m_attempts;
+		std::atomic<unsigned long long> m_calls;
+		long long m_totalUs;
+	};
+}
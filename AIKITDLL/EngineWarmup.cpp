@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "EngineWarmup.h"
+#include "Common.h"
+#include "IvwWrapper.h"
+#include "CnenEsrWrapper.h"
+#include "SdkHelper.h"
+#include "CancelToken.h"
+#include "audiosrc.h"
+#include <chrono>
+
+// 默认同时加载唤醒和命令词引擎
+#define WARMUP_DEFAULT_WORKERS 2
+
+static const char* const g_stepNames[] = {
+	"SDK初始化", "唤醒引擎", "命令词引擎", "首次唤醒监听"
+};
+static_assert(sizeof(g_stepNames) / sizeof(g_stepNames[0]) == STARTUP_STEP_COUNT, "每个启动步骤都要有名称");
+
+namespace AIKITDLL {
+
+	EngineWarmup& EngineWarmup::Instance() {
+		static EngineWarmup instance;
+		return instance;
+	}
+
+	EngineWarmup::EngineWarmup()
+		: m_startUs(0), m_wakeMarked(false), m_workerCount(WARMUP_DEFAULT_WORKERS) {
+		for (int i = 0; i < WARMUP_ABILITY_COUNT; ++i) {
+			m_state[i] = WARMUP_IDLE;
+		}
+		for (int i = 0; i < STARTUP_STEP_COUNT; ++i) {
+			m_timeline.steps[i].beginUs = -1;
+			m_timeline.steps[i].durationUs = 0;
+			m_timeline.steps[i].result = 0;
+		}
+		m_timeline.workers = 0;
+	}
+
+	EngineWarmup::~EngineWarmup() {
+		// 静态对象在DLL卸载时持有加载器锁析构，这里等待线程退出会死锁，加载线程应已由CleanupSDK等待结束
+		for (size_t i = 0; i < m_workers.size(); ++i) {
+			if (m_workers[i].joinable()) {
+				m_workers[i].detach();
+			}
+		}
+	}
+
+	bool EngineWarmup::Start() {
+		Join();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (int i = 0; i < STARTUP_STEP_COUNT; ++i) {
+				m_timeline.steps[i].beginUs = -1;
+				m_timeline.steps[i].durationUs = 0;
+				m_timeline.steps[i].result = 0;
+			}
+			m_startUs = audio_source_now_us();
+			m_wakeMarked = false;
+		}
+
+		// 其他能力的加载都依赖SDK，这一步只能同步执行
+		unsigned long long begin = audio_source_now_us();
+		bool ok = SafeInitSDK();
+		RecordStep(STARTUP_SDK, begin, ok ? 0 : -1);
+		if (!ok) {
+			LogError("EngineWarmup: SDK初始化失败，不加载引擎");
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.clear();
+		// 唤醒引擎排在前面：线程数为1时也先加载唤醒，尽早开始唤醒监听
+		m_queue.push_back(WARMUP_IVW);
+		m_queue.push_back(WARMUP_ESR);
+		for (size_t i = 0; i < m_queue.size(); ++i) {
+			m_state[m_queue[i]] = WARMUP_RUNNING;
+		}
+
+		unsigned int workers = m_workerCount.load();
+		if (workers > m_queue.size()) {
+			workers = (unsigned int)m_queue.size();
+		}
+		m_timeline.workers = workers;
+		for (unsigned int i = 0; i < workers; ++i) {
+			m_workers.emplace_back(&EngineWarmup::WorkerProc, this);
+		}
+		LogInfo("EngineWarmup: SDK已就绪，%u 个线程在后台加载 %u 个引擎", workers, (unsigned int)m_queue.size());
+		return true;
+	}
+
+	void EngineWarmup::WorkerProc() {
+		for (;;) {
+			WarmupAbility ability;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_queue.empty()) {
+					return;
+				}
+				ability = m_queue.front();
+				m_queue.erase(m_queue.begin());
+			}
+
+			unsigned long long begin = audio_source_now_us();
+			int ret;
+			StartupStep step;
+			if (ability == WARMUP_IVW) {
+				step = STARTUP_IVW_ENGINE;
+				ret = Ivw70Init();
+			}
+			else {
+				// 取一次引用再归还，引擎和语法常驻
+				step = STARTUP_ESR_ENGINE;
+				ret = EsrEngineAcquire(nullptr);
+				if (ret == 0) {
+					EsrEngineRelease();
+				}
+			}
+			RecordStep(step, begin, ret);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_state[ability] = ret == 0 ? WARMUP_READY : WARMUP_FAILED;
+			}
+			m_cond.notify_all();
+			if (ret != 0) {
+				LogWarning("EngineWarmup: %s加载失败，错误码: %d，使用时将重新加载", g_stepNames[step], ret);
+			}
+		}
+	}
+
+	void EngineWarmup::Join() {
+		std::vector<std::thread> workers;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			workers.swap(m_workers);
+		}
+		for (size_t i = 0; i < workers.size(); ++i) {
+			if (workers[i].joinable()) {
+				workers[i].join();
+			}
+		}
+	}
+
+	void EngineWarmup::Invalidate() {
+		Join();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int i = 0; i < WARMUP_ABILITY_COUNT; ++i) {
+			m_state[i] = WARMUP_IDLE;
+		}
+	}
+
+	WarmupState EngineWarmup::GetState(WarmupAbility ability) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_state[ability];
+	}
+
+	WarmupState EngineWarmup::WaitReady(WarmupAbility ability, unsigned int timeoutMs, CancelToken* cancel) {
+		CancelListener listener(cancel, [](void* arg) {
+			EngineWarmup* self = (EngineWarmup*)arg;
+			std::lock_guard<std::mutex> lock(self->m_mutex);
+			self->m_cond.notify_all();
+		}, this);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+			[this, ability, cancel]() { return m_state[ability] != WARMUP_RUNNING || IsCancelled(cancel); });
+		return m_state[ability];
+	}
+
+	void EngineWarmup::RecordStep(StartupStep step, unsigned long long begin, int result) {
+		unsigned long long end = audio_source_now_us();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_timeline.steps[step].beginUs = begin > m_startUs ? (long long)(begin - m_startUs) : 0;
+		m_timeline.steps[step].durationUs = (long long)(end - begin);
+		m_timeline.steps[step].result = result;
+		LogInfo("启动时间线: %s +%.1f ms 开始, 耗时 %.1f ms%s", g_stepNames[step],
+			m_timeline.steps[step].beginUs / 1000.0, m_timeline.steps[step].durationUs / 1000.0,
+			result == 0 ? "" : " (失败)");
+	}
+
+	void EngineWarmup::MarkWakeListening() {
+		unsigned long long begin;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_wakeMarked || m_startUs == 0) {
+				return;
+			}
+			m_wakeMarked = true;
+			begin = m_startUs;
+		}
+		// 从启动开始计时，耗时即首次可唤醒时间
+		RecordStep(STARTUP_WAKE_LISTENING, begin, 0);
+		LogTimeline();
+	}
+
+	void EngineWarmup::GetTimeline(StartupTimeline* timeline) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		*timeline = m_timeline;
+	}
+
+	void EngineWarmup::LogTimeline() const {
+		StartupTimeline timeline;
+		GetTimeline(&timeline);
+		LogInfo("启动时间线汇总（%u 个加载线程）:", timeline.workers);
+		for (int i = 0; i < STARTUP_STEP_COUNT; ++i) {
+			const StartupStepTime& s = timeline.steps[i];
+			if (s.beginUs < 0) {
+				LogInfo("  %s: 未完成", g_stepNames[i]);
+				continue;
+			}
+			LogInfo("  %s: +%.1f ms -> +%.1f ms (%.1f ms)%s", g_stepNames[i], s.beginUs / 1000.0,
+				(s.beginUs + s.durationUs) / 1000.0, s.durationUs / 1000.0, s.result == 0 ? "" : " 失败");
+		}
+	}
+}
+
+int StartEngineWarmup()
+{
+	return AIKITDLL::EngineWarmup::Instance().Start() ? 0 : -1;
+}
+
+int GetEngineReadiness(int ability)
+{
+	if (ability < 0 || ability >= WARMUP_ABILITY_COUNT) {
+		return -1;
+	}
+	return AIKITDLL::EngineWarmup::Instance().GetState((WarmupAbility)ability);
+}
+
+int GetStartupTimeline(StartupTimeline* timeline)
+{
+	if (!timeline) {
+		return -1;
+	}
+	AIKITDLL::EngineWarmup::Instance().GetTimeline(timeline);
+	return 0;
+}
+
+void SetEngineWarmupWorkers(int workers)
+{
+	AIKITDLL::EngineWarmup::Instance().SetWorkers(workers > 0 ? (unsigned int)workers : 1);
+}
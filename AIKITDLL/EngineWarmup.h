@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 后台加载的能力
+enum WarmupAbility {
+	WARMUP_IVW = 0,     // 语音唤醒
+	WARMUP_ESR,         // 命令词识别
+	WARMUP_ABILITY_COUNT
+};
+
+// 能力的就绪状态
+enum WarmupState {
+	WARMUP_IDLE = 0,    // 未加载（或SDK重置后需要重新加载）
+	WARMUP_RUNNING,     // 正在后台加载
+	WARMUP_READY,       // 引擎和资源已加载
+	WARMUP_FAILED       // 加载失败，使用时会按原流程再试一次
+};
+
+// 启动时间线上的步骤
+enum StartupStep {
+	STARTUP_SDK = 0,          // AIKIT_Init
+	STARTUP_IVW_ENGINE,       // 唤醒引擎和唤醒词资源
+	STARTUP_ESR_ENGINE,       // 命令词引擎和FSA语法
+	STARTUP_WAKE_LISTENING,   // 第一次开始唤醒监听（从启动开始计时，即首次可唤醒耗时）
+	STARTUP_STEP_COUNT
+};
+
+// 一个启动步骤的时间（微秒，相对启动开始），没有执行过时begin为-1
+struct StartupStepTime {
+	long long beginUs;
+	long long durationUs;
+	int result;               // 0表示成功
+};
+
+struct StartupTimeline {
+	StartupStepTime steps[STARTUP_STEP_COUNT];
+	unsigned int workers;     // 加载引擎使用的线程数
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 初始化SDK并在后台加载唤醒和命令词引擎，SDK初始化失败返回-1
+	AIKITDLL_API int StartEngineWarmup();
+
+	// 查询能力的就绪状态（WarmupState），ability为WarmupAbility
+	AIKITDLL_API int GetEngineReadiness(int ability);
+
+	// 获取最近一次启动的时间线，成功返回0
+	AIKITDLL_API int GetStartupTimeline(StartupTimeline* timeline);
+
+	// 设置加载引擎的线程数：1为依次加载，默认2（唤醒和命令词同时加载），下次启动时生效
+	AIKITDLL_API void SetEngineWarmupWorkers(int workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace AIKITDLL {
+	class CancelToken;
+
+	// 启动编排：先同步初始化SDK，再把各能力的引擎加载交给一个小线程池并行执行。
+	// 唤醒引擎排在最前，就绪后即可开始唤醒监听，命令词引擎继续在后台加载。
+	class EngineWarmup {
+	public:
+		static EngineWarmup& Instance();
+
+		// 开始一次启动：初始化SDK，成功后提交后台加载任务并立即返回。
+		// 上一次的加载还没结束时先等待它结束。SDK初始化失败返回false
+		bool Start();
+
+		// 等待后台加载结束；卸载引擎、反初始化SDK或卸载DLL（CleanupSDK）前必须调用
+		void Join();
+
+		// 等待后台加载结束并把所有能力标记为未加载（SDK被重置后调用）
+		void Invalidate();
+
+		WarmupState GetState(WarmupAbility ability) const;
+
+		// 能力正在加载时等待其结束，最多timeoutMs毫秒，返回此时的状态；
+		// cancel被取消时立即返回（此时可能仍是WARMUP_RUNNING）
+		WarmupState WaitReady(WarmupAbility ability, unsigned int timeoutMs, CancelToken* cancel = nullptr);
+
+		// 记录第一次开始唤醒监听，每次启动只记录一次，并输出启动时间线
+		void MarkWakeListening();
+
+		void GetTimeline(StartupTimeline* timeline) const;
+
+		void SetWorkers(unsigned int workers) { m_workerCount.store(workers < 1 ? 1 : workers); }
+
+	private:
+		EngineWarmup();
+		~EngineWarmup();
+		EngineWarmup(const EngineWarmup&) = delete;
+		EngineWarmup& operator=(const EngineWarmup&) = delete;
+
+		void WorkerProc();
+		void RecordStep(StartupStep step, unsigned long long begin, int result);
+		void LogTimeline() const;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::vector<std::thread> m_workers;
+		std::vector<WarmupAbility> m_queue;    // 待加载的能力，按提交顺序取出
+		WarmupState m_state[WARMUP_ABILITY_COUNT];
+		StartupTimeline m_timeline;
+		unsigned long long m_startUs;          // 本次启动开始的时刻
+		bool m_wakeMarked;
+		std::atomic<unsigned int> m_workerCount;
+	};
+}
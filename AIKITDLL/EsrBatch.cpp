@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "EsrBatch.h"
+#include "BatchCommon.h"
+#include "EsrHelper.h"
+#include "CnenEsrWrapper.h"
+#include "CancelToken.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+	// 一次批量识别的共享状态
+	struct BatchContext {
+		const std::vector<AIKITDLL::ManifestLine>* files;
+		int fsaCount;
+		AIKITDLL::CancelToken* cancel;
+		AIKITDLL::BatchQueue* queue;
+
+		std::mutex outputMutex;      // 保护输出文件和下面的计数
+		FILE* output;
+		unsigned long long succeeded;
+		unsigned long long failed;
+		unsigned long long recognized;
+		long long audioUs;
+	};
+
+	void BatchWorker(void* arg, unsigned int worker) {
+		BatchContext* ctx = (BatchContext*)arg;
+		std::string plain;
+		std::string line;
+		AIKITDLL::EsrFileOptions options = { ESR_PACING_FAST, 1.0, 0, &plain };
+		size_t index;
+
+		while (ctx->queue->Claim(&index)) {
+			const std::string& path = (*ctx->files)[index].text;
+			EsrFileStats fileStats = {};
+			long readLen = 0;
+			plain.clear();
+			unsigned long long t0 = audio_source_now_us();
+			int ret = AIKITDLL::EsrFileSession(ESR_ABILITY, path.c_str(), ctx->fsaCount, &readLen, ctx->cancel, &fileStats, &options);
+			long long wallUs = (long long)(audio_source_now_us() - t0);
+			bool ok = (ret == 0 || ret == ESR_HAS_RESULT);
+
+			line.clear();
+			line += "{\"index\":";
+			line += std::to_string(index);
+			line += ",\"path\":";
+			AIKITDLL::AppendJsonString(line, path);
+			line += ",\"status\":";
+			line += std::to_string(ok ? 0 : ret);
+			line += ",\"result\":";
+			AIKITDLL::AppendJsonString(line, plain);
+			line += ",\"audio_ms\":";
+			line += std::to_string(fileStats.audioUs / 1000);
+			line += ",\"wall_ms\":";
+			line += std::to_string(wallUs / 1000);
+			line += ",\"rtf\":";
+			char rtf[32];
+			sprintf_s(rtf, sizeof(rtf), "%.4f", fileStats.rtf);
+			line += rtf;
+			line += ",\"worker\":";
+			line += std::to_string(worker);
+			line += "}\n";
+
+			std::lock_guard<std::mutex> lock(ctx->outputMutex);
+			fputs(line.c_str(), ctx->output);
+			fflush(ctx->output);
+			if (ok) {
+				ctx->succeeded++;
+				ctx->audioUs += fileStats.audioUs;
+				if (!plain.empty()) {
+					ctx->recognized++;
+				}
+			}
+			else {
+				ctx->failed++;
+			}
+		}
+	}
+}
+
+namespace AIKITDLL {
+
+	int EsrBatchRun(const char* manifestPath, const char* outputPath, int workers, int fsaCount,
+		EsrBatchStats* stats, CancelToken* cancel)
+	{
+		if (manifestPath == nullptr || outputPath == nullptr) {
+			return -1;
+		}
+		if (fsaCount < 1) {
+			fsaCount = 1;
+		}
+
+		std::vector<ManifestLine> files;
+		if (!LoadManifestLines(manifestPath, files)) {
+			LogError("EsrBatch: 打开清单失败: %s", manifestPath);
+			return -1;
+		}
+
+		FILE* output = nullptr;
+		if (fopen_s(&output, outputPath, "wb") != 0 || output == nullptr) {
+			LogError("EsrBatch: 打开输出文件失败: %s", outputPath);
+			return -1;
+		}
+
+		// 引擎和语法在整批期间保持加载，各线程只开始和结束自己的会话
+		int ret = EsrEngineAcquire(nullptr);
+		if (ret != 0) {
+			LogError("EsrBatch: 命令词引擎不可用，错误码: %d", ret);
+			fclose(output);
+			return -1;
+		}
+
+		workers = ClampBatchWorkers(workers, ESR_BATCH_MAX_WORKERS, files.size());
+		LogInfo("EsrBatch: 开始批量识别 %zu 个文件，%d 个线程", files.size(), workers);
+
+		BatchQueue queue(files.size(), cancel);
+		BatchContext ctx;
+		ctx.files = &files;
+		ctx.fsaCount = fsaCount;
+		ctx.cancel = cancel;
+		ctx.queue = &queue;
+		ctx.output = output;
+		ctx.succeeded = 0;
+		ctx.failed = 0;
+		ctx.recognized = 0;
+		ctx.audioUs = 0;
+
+		unsigned long long t0 = audio_source_now_us();
+		RunBatchWorkers(workers, BatchWorker, &ctx);
+		long long wallUs = (long long)(audio_source_now_us() - t0);
+
+		EsrEngineRelease();
+		fclose(output);
+
+		double wallSec = wallUs > 0 ? wallUs / 1000000.0 : 0;
+		EsrBatchStats result = {};
+		result.workers = (unsigned int)workers;
+		result.files = files.size();
+		result.succeeded = ctx.succeeded;
+		result.failed = ctx.failed;
+		result.recognized = ctx.recognized;
+		result.audioUs = ctx.audioUs;
+		result.wallUs = wallUs;
+		result.filesPerSec = wallSec > 0 ? (ctx.succeeded + ctx.failed) / wallSec : 0;
+		result.audioPerSec = wallSec > 0 ? ctx.audioUs / 1000000.0 / wallSec : 0;
+		LogInfo("EsrBatch: 完成 %llu/%zu 个文件（失败 %llu，有结果 %llu），用时 %.2f 秒，%.1f 文件/秒，%.1f 倍实时",
+			result.succeeded, files.size(), result.failed, result.recognized, wallSec, result.filesPerSec, result.audioPerSec);
+		if (stats != nullptr) {
+			*stats = result;
+		}
+		return (int)result.failed;
+	}
+}
+
+// 导出函数实现
+int RunEsrBatch(const char* manifestPath, const char* outputPath, int workers, int fsaCount, EsrBatchStats* stats)
+{
+	return AIKITDLL::EsrBatchRun(manifestPath, outputPath, workers, fsaCount, stats, nullptr);
+}
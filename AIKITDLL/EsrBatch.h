@@ -0,0 +1,51 @@
+#pragma once
+
+// 一次批量识别的统计
+struct EsrBatchStats {
+	unsigned int workers;           // 工作线程数
+	unsigned long long files;       // 清单中的文件数
+	unsigned long long succeeded;   // 识别完成的文件数（包括没有识别出命令词的）
+	unsigned long long failed;      // 识别失败的文件数
+	unsigned long long recognized;  // 有plain结果的文件数
+	long long audioUs;              // 识别完成的音频总时长（微秒）
+	long long wallUs;               // 整批耗时（微秒）
+	double filesPerSec;             // 每秒处理的文件数
+	double audioPerSec;             // 每秒处理的音频秒数（整批的实时倍数）
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 批量识别：manifestPath每行一个音频文件路径（WAV，或没有文件头的16k/16bit单声道PCM）（空行和#开头的行忽略），
+	// 用workers个线程并行识别，每个线程各自开始识别会话，按快速模式送数。
+	// 每个文件完成后立即向outputPath追加一行JSON（按完成顺序）：
+	// {"index":清单中的序号,"path":路径,"status":错误码,"result":plain结果,"audio_ms":..,"wall_ms":..,"rtf":..,"worker":线程号}。
+	// stats可为NULL。清单或输出文件无法打开、引擎不可用时返回-1，否则返回失败的文件数
+	AIKITDLL_API int RunEsrBatch(const char* manifestPath, const char* outputPath, int workers, int fsaCount, EsrBatchStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+// 批量识别的最大线程数
+#define ESR_BATCH_MAX_WORKERS 64
+
+namespace AIKITDLL {
+	class CancelToken;
+
+	// RunEsrBatch的可取消版本：取消后各线程结束手上的文件，不再领取新文件
+	int EsrBatchRun(const char* manifestPath, const char* outputPath, int workers, int fsaCount,
+		EsrBatchStats* stats, CancelToken* cancel);
+}
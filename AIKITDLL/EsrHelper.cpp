@@ -1,5 +1,10 @@
 #include "pch.h"
 #include "EsrHelper.h"
+#include "vad.h"
+#include "audiosrc.h"
+#include "CnenEsrWrapper.h"
+#include "CancelToken.h"
+#include "AudioDecoder.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <windows.h>
@@ -16,21 +21,16 @@ using namespace AIKIT;
 #define esr_dbg
 #endif
 
-#define DEFAULT_FORMAT        \
-{                             \
-    WAVE_FORMAT_PCM,          \
-    1,                        \
-    16000,                    \
-    32000,                    \
-    2,                        \
-    16,                       \
-    sizeof(WAVEFORMATEX)      \
-}
-
 #define ESR_MALLOC malloc
 #define ESR_MFREE  free
 #define ESR_MEMSET memset
 
+// 送数线程每次取出的最大数据量：200ms音频，即最大录音周期
+#define ESR_FEED_CHUNK    6400
+
+// 16k/16bit单声道音频每秒的字节数
+#define ESR_BYTES_PER_SEC 32000
+
 // 添加全局变量存储识别结果
 extern "C" {
 	// 不同类型结果的缓冲区
@@ -53,6 +53,19 @@ extern "C" {
 
 // 使用全局变量跟踪初始化状态
 static bool g_resultLockInitialized = false;
+
+// 当前麦克风识别器的采集读者，以及上一次会话结束时的读者统计快照
+static std::mutex g_esrCaptureMutex;
+static AIKITDLL::CaptureConsumer* g_activeEsrCapture = nullptr;
+static CaptureConsumerStats g_lastEsrCaptureStats = { 0 };
+
+// 文件识别的送数节奏，以及最近一次文件识别的耗时
+static std::mutex g_filePacingMutex;
+static int g_filePacing = ESR_PACING_SPEED;
+static double g_fileSpeed = ESR_FILE_DEFAULT_SPEED;
+static unsigned int g_fileFastFrame = ESR_FEED_CHUNK;
+static EsrFileStats g_lastFileStats = { 0 };
+static bool g_hasFileStats = false;
 std::string UTF8ToLocalString(const char* utf8Str) {
 	if (!utf8Str) return "";
 
@@ -207,28 +220,42 @@ void ProcessRecognitionResult(const char* key, const char* value) {
 }
 
 bool is_result = false;
-int ESRGetRlt(AIKIT_HANDLE* handle, AIKIT_DataBuilder* dataBuilder)
+// plain不为空时识别结果只写到这里（批量识别），不写结果文件，也不更新全局结果缓冲区
+int ESRGetRlt(AIKITDLL::AikitSession* session, AIKIT_InputData* input_data, std::string* plain = nullptr)
 {
 	int ret = 0;
 	AIKIT_OutputData* output = nullptr;
-	AIKIT_InputData* input_data = AIKIT_Builder::build(dataBuilder);
 	bool has_plain_result = false;  // 添加标志位判断plain结果
 
+	if (input_data == nullptr) {
+		AIKITDLL::LogError("构建音频数据失败");
+		return E_SR_INVAL;
+	}
+
 	// 确保互斥锁已初始化
 	InitResultLock();
 
-	ret = AIKIT_Write(handle, input_data);
+	ret = session->Write(input_data);
 	if (ret != 0) {
 		AIKITDLL::LogError("AIKIT_Write 失败，错误码: %d", ret);
 		return ret;
 	}
-	ret = AIKIT_Read(handle, &output);
+	ret = session->Read(&output);
 	if (ret != 0) {
 		AIKITDLL::LogError("AIKIT_Read 失败，错误码: %d", ret);
 		return ret;
 	}
 
-	if (output != nullptr) {
+	if (plain != nullptr) {
+		for (AIKIT_BaseData* node = output != nullptr ? output->node : nullptr; node != nullptr && node->value != nullptr; node = node->next) {
+			if (strcmp(node->key, "plain") == 0 && node->len > 0) {
+				plain->assign((const char*)node->value, node->len);
+				has_plain_result = true;
+			}
+		}
+	}
+	// 没有结果时不打开结果文件，送数循环里大多数帧都没有结果
+	else if (output != nullptr && output->node != nullptr && output->node->value != nullptr) {
 		FILE* fsaFile = nullptr;
 		errno_t err = fopen_s(&fsaFile, "esr_result.txt", "ab");
 		if (err != 0 || fsaFile == nullptr) {
@@ -265,42 +292,134 @@ int ESRGetRlt(AIKIT_HANDLE* handle, AIKIT_DataBuilder* dataBuilder)
 
 static void end_esr(struct EsrRecognizer* esr)
 {
-	if (esr->aud_src == ESR_MIC)
-		stop_record(esr->recorder);
-
-	if (esr->handle) {
-		AIKIT_End(esr->handle);
-		esr->handle = NULL;
-	}
+	// 麦克风模式下设备由CaptureHub持有，会话结束后送数线程自动丢弃后续数据
+	esr->session->End();
 	esr->state = ESR_STATE_INIT;
 }
 
-static void esr_cb(char* data, unsigned long len, void* user_para)
+// 把一块音频写入识别引擎
+static int esr_write_chunk(const char* data, unsigned int len, void* ctx)
 {
-	int errcode;
-	struct EsrRecognizer* esr;
+	return EsrWriteAudioData((struct EsrRecognizer*)ctx, data, len);
+}
+
+// 从采集流取出未读数据写入引擎，调用方需持有feed_lock
+static void drain_capture(struct EsrRecognizer* esr)
+{
+	const char* data;
+	unsigned int len;
 
-	if (len == 0 || data == NULL)
+	if (esr->state < ESR_STATE_STARTED || esr->audio_status >= AIKIT_DataEnd || !esr->session->Active()) {
+		// 未在监听或会话已结束，丢弃数据
+		while ((data = esr->capture->BeginLease(esr->feed_chunk, &len)) != NULL)
+			esr->capture->EndLease(len);
 		return;
+	}
+
+	if (AIKITDLL::PumpCapture(esr->capture, esr->feed_chunk, esr->vad, esr_write_chunk, esr, NULL)) {
+		// EsrWriteAudioData 内部已调用 end_esr
+		esr->capture->SeekToLive();
+	}
+}
 
-	esr = (struct EsrRecognizer*)user_para;
+// 送数线程：把录音数据从共享采集流送入AIKIT
+static unsigned int __stdcall esr_feeder_proc(void* para)
+{
+	struct EsrRecognizer* esr = (struct EsrRecognizer*)para;
 
-	if (esr == NULL || esr->audio_status >= AIKIT_DataEnd)
-		return;
+	while (!esr->feeder_quit) {
+		WaitForSingleObject(esr->feeder_event, 100);
+		if (esr->feeder_quit)
+			break;
 
-	errcode = EsrWriteAudioData(esr, data, len);
-	if (errcode) {
-		end_esr(esr);
-		return;
+		EnterCriticalSection(&esr->feed_lock);
+		drain_capture(esr);
+		LeaveCriticalSection(&esr->feed_lock);
+	}
+	return 0;
+}
+
+static void destroy_feeder(struct EsrRecognizer* esr)
+{
+	if (esr->feeder_thread) {
+		esr->feeder_quit = 1;
+		SetEvent(esr->feeder_event);
+		WaitForSingleObject(esr->feeder_thread, INFINITE);
+		CloseHandle(esr->feeder_thread);
+		esr->feeder_thread = NULL;
+		DeleteCriticalSection(&esr->feed_lock);
+	}
+	if (esr->capture) {
+		std::lock_guard<std::mutex> lock(g_esrCaptureMutex);
+		esr->capture->GetStats(&g_lastEsrCaptureStats);
+		if (g_activeEsrCapture == esr->capture)
+			g_activeEsrCapture = nullptr;
+		AIKITDLL::LogInfo("ESR采集流统计: 积压峰值 %u/%u 字节, 被追上 %llu 次, 丢弃 %llu 字节",
+			g_lastEsrCaptureStats.highWater, g_lastEsrCaptureStats.capacity,
+			g_lastEsrCaptureStats.laps, g_lastEsrCaptureStats.lostBytes);
+		// 只取消订阅，设备是否关闭由CaptureHub按引用计数决定
+		AIKITDLL::CaptureHub::Instance().Unsubscribe(esr->capture);
+		esr->capture = NULL;
+	}
+	if (esr->vad) {
+		struct vad_gate_stats vs;
+		vad_gate_get_stats(esr->vad, &vs);
+		AIKITDLL::LogInfo("ESR静音门限: 跳过 %llu/%llu 采样", vs.withheld - vs.replayed, vs.samples);
+		vad_gate_destroy(esr->vad);
+		esr->vad = NULL;
+	}
+	if (esr->feeder_event) {
+		CloseHandle(esr->feeder_event);
+		esr->feeder_event = NULL;
+	}
+}
+
+static int create_feeder(struct EsrRecognizer* esr)
+{
+	unsigned int thread_id;
+
+	esr->feeder_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (esr->feeder_event == NULL) {
+		destroy_feeder(esr);
+		return -1;
+	}
+
+	// 订阅共享采集流：唤醒阶段已打开的设备直接复用，不再重新打开
+	esr->capture = AIKITDLL::CaptureHub::Instance().Subscribe(esr->feeder_event);
+	if (esr->capture == NULL) {
+		destroy_feeder(esr);
+		return -1;
+	}
+
+	// 命令开始前的静音不送入引擎；一旦检测到语音就保持打开，引擎需要句尾静音判断结束
+	if (AIKITDLL::CaptureHub::Instance().VadEnabled())
+		esr->vad = vad_gate_create(16000, VAD_DEFAULT_PREROLL_MS, 0);
+
+	// 每个录音周期送一次数据，送数粒度跟随录音周期
+	esr->feed_chunk = AIKITDLL::CaptureHub::Instance().PeriodBytes();
+	if (esr->feed_chunk == 0 || esr->feed_chunk > ESR_FEED_CHUNK)
+		esr->feed_chunk = ESR_FEED_CHUNK;
+
+	InitializeCriticalSection(&esr->feed_lock);
+	esr->feeder_quit = 0;
+	esr->feeder_thread = (HANDLE)_beginthreadex(NULL, 0, esr_feeder_proc, esr, 0, &thread_id);
+	if (esr->feeder_thread == NULL) {
+		DeleteCriticalSection(&esr->feed_lock);
+		destroy_feeder(esr);
+		return -1;
 	}
+
+	std::lock_guard<std::mutex> lock(g_esrCaptureMutex);
+	g_activeEsrCapture = esr->capture;
+	return 0;
 }
 
 int EsrInit(struct EsrRecognizer* esr, enum EsrAudioSource aud_src, int devid)
 {
 	int errcode;
 	int index[] = { 0 };
-	WAVEFORMATEX wavfmt = DEFAULT_FORMAT;
 
+	(void)devid;  // 麦克风由CaptureHub统一打开默认设备
 	if (aud_src == ESR_MIC && get_input_dev_num() == 0) {
 		return E_SR_NOACTIVEDEVICE;
 	}
@@ -313,74 +432,102 @@ int EsrInit(struct EsrRecognizer* esr, enum EsrAudioSource aud_src, int devid)
 	esr->aud_src = aud_src;
 	esr->audio_status = AIKIT_DataBegin;
 	esr->ABILITY = ESR_ABILITY;
-	esr->dataBuilder = nullptr;
-	esr->dataBuilder = AIKIT_DataBuilder::create();
-	esr->paramBuilder = AIKIT_ParamBuilder::create();
-
-	esr->paramBuilder->clear();
-	esr->paramBuilder->param("languageType", 0);
-	esr->paramBuilder->param("vadEndGap", 75);
-	esr->paramBuilder->param("vadOn", true);
-	esr->paramBuilder->param("beamThreshold", 20);
-	esr->paramBuilder->param("hisGramThreshold", 3000);
-	esr->paramBuilder->param("postprocOn", true);
-	esr->paramBuilder->param("vadResponsetime", 1000);
-	esr->paramBuilder->param("vadLinkOn", true);
-	esr->paramBuilder->param("vadSpeechEnd", 80);
+	// 会话参数只构建一次，数据构建器从池里取
+	esr->params = AIKITDLL::EsrSessionParams(ESR_PARAMS_MIC);
+	esr->frame = new AIKITDLL::AudioFrame("audio", true);
+	esr->session = new AIKITDLL::AikitSession(esr->ABILITY);
+	if (esr->params == nullptr || !esr->frame->Valid()) {
+		delete esr->frame;
+		esr->frame = nullptr;
+		delete esr->session;
+		esr->session = nullptr;
+		return E_SR_INVAL;
+	}
 
 	if (aud_src == ESR_MIC) {
-		errcode = create_recorder(&esr->recorder, esr_cb, (void*)esr);
-		if (esr->recorder == NULL || errcode != 0) {
-			esr_dbg("创建录音设备失败: %d", errcode);
+		if (create_feeder(esr) != 0) {
+			esr_dbg("创建送数线程或订阅采集流失败");
 			errcode = E_SR_RECORDFAIL;
 			goto fail;
 		}
+	}
 
-		// 音频参数设置
-		wavfmt.nSamplesPerSec = 16000;
-		wavfmt.nAvgBytesPerSec = wavfmt.nBlockAlign * wavfmt.nSamplesPerSec;
+	return 0;
 
-		errcode = open_recorder(esr->recorder, devid, &wavfmt);
+fail:
+	destroy_feeder(esr);
+	delete esr->session;
+	esr->session = nullptr;
+	delete esr->frame;
+	esr->frame = nullptr;
+
+	return errcode;
+}
+
+// 开始引擎会话，还不送数
+static int start_session(struct EsrRecognizer* esr)
+{
+	int errcode = 0;
+	int index[] = { 0 };
+
+	// 常驻引擎在加载语法时已经指定过数据集，这里只需开始会话
+	if (!AIKITDLL::esrEngineLoaded.load()) {
+		AIKITDLL::LogDebug("开始指定数据集...");
+		index[0] = 0;
+		errcode = AIKIT_SpecifyDataSet(esr->ABILITY, "FSA", index, sizeof(index) / sizeof(int));
 		if (errcode != 0) {
-			esr_dbg("打开录音设备失败: %d", errcode);
-			errcode = E_SR_RECORDFAIL;
-			goto fail;
+			AIKITDLL::LogDebug("指定数据集失败,错误码: %d", errcode);
+			return errcode;
 		}
+		AIKITDLL::LogDebug("数据集指定成功");
 	}
 
+	AIKITDLL::LogDebug("正在启动AIKIT服务...");
+	errcode = esr->session->Start(esr->params);
+	if (0 != errcode)
+	{
+		AIKITDLL::LogDebug("AIKIT_Start 启动失败,错误码: %d", errcode);
+		esr_dbg("AIKIT_Start 失败! 错误码:%d", errcode);
+		return errcode;
+	}
+	AIKITDLL::LogDebug("AIKIT服务启动成功");
+	esr->started_us = audio_source_now_us();
+	esr->first_write_us = 0;
+	esr->frame->Reset();
+
+	esr->audio_status = AIKIT_DataBegin;
 	return 0;
+}
 
-fail:
-	if (esr->recorder) {
-		destroy_recorder(esr->recorder);
-		esr->recorder = NULL;
+int AIKITDLL::EsrPrestart(struct EsrRecognizer* esr)
+{
+	if (esr->state >= ESR_STATE_STARTED || esr->session->Active()) {
+		return E_SR_ALREADY;
 	}
-
-	return errcode;
+	return start_session(esr);
 }
 
 int EsrStartListening(struct EsrRecognizer* esr)
 {
-	int ret;
 	int errcode = 0;
-	int index[] = { 0 };
 
 	AIKITDLL::LogInfo("状态(state): %d", esr->state);
 	AIKITDLL::LogInfo("音频来源(aud_src): %d", esr->aud_src);
 	AIKITDLL::LogInfo("音频状态(audio_status): %d", esr->audio_status);
 	AIKITDLL::LogInfo("能力ID(ABILITY): %s", esr->ABILITY);
-	AIKITDLL::LogInfo("句柄(handle): %p", esr->handle);
-	AIKITDLL::LogInfo("数据构建器(dataBuilder): %p", esr->dataBuilder);
-	AIKITDLL::LogInfo("参数构建器(paramBuilder): %p", esr->paramBuilder);
-	AIKITDLL::LogInfo("录音设备句柄(recorder): %p", esr->recorder);
+	AIKITDLL::LogInfo("句柄(handle): %p", esr->session->Handle());
+	AIKITDLL::LogInfo("音频帧(frame): %p", esr->frame);
+	AIKITDLL::LogInfo("会话参数(params): %p", esr->params);
+	AIKITDLL::LogInfo("采集流读者(capture): %p", esr->capture);
 	AIKITDLL::LogInfo("当前状态: %d", esr->state);
 
 	// 如果已经有handle，输出其详细信息
-	if (esr->handle) {
+	AIKIT_HANDLE* handle = esr->session->Handle();
+	if (handle) {
 		AIKITDLL::LogInfo("句柄详细信息:");
-		AIKITDLL::LogInfo("  用户上下文: %p", esr->handle->usrContext);
-		AIKITDLL::LogInfo("  能力ID: %s", esr->handle->abilityID ? esr->handle->abilityID : "空");
-		AIKITDLL::LogInfo("  句柄ID: %zu", esr->handle->handleID);
+		AIKITDLL::LogInfo("  用户上下文: %p", handle->usrContext);
+		AIKITDLL::LogInfo("  能力ID: %s", handle->abilityID ? handle->abilityID : "空");
+		AIKITDLL::LogInfo("  句柄ID: %zu", handle->handleID);
 	}
 
 	if (esr->state >= ESR_STATE_STARTED) {
@@ -389,38 +536,29 @@ int EsrStartListening(struct EsrRecognizer* esr)
 		return E_SR_ALREADY;
 	}
 
-	AIKITDLL::LogDebug("开始指定数据集...");
-	index[0] = 0;
-	errcode = AIKIT_SpecifyDataSet(esr->ABILITY, "FSA", index, sizeof(index) / sizeof(int));
-	if (errcode != 0) {
-		AIKITDLL::LogDebug("指定数据集失败,错误码: %d", errcode);
-		return errcode;
+	if (esr->session->Active()) {
+		// 预开的会话：引擎会话已经开始，只需开始送数；会话开始时间从这里算起
+		AIKITDLL::LogDebug("使用预开的AIKIT会话");
+		esr->started_us = audio_source_now_us();
 	}
-	AIKITDLL::LogDebug("数据集指定成功");
-
-	AIKITDLL::LogDebug("正在启动AIKIT服务...");
-	errcode = AIKIT_Start(esr->ABILITY, AIKIT_Builder::build(esr->paramBuilder), nullptr, &esr->handle);
-	if (0 != errcode)
-	{
-		AIKITDLL::LogDebug("AIKIT_Start 启动失败,错误码: %d", errcode);
-		esr_dbg("AIKIT_Start 失败! 错误码:%d", errcode);
-		return errcode;
+	else {
+		errcode = start_session(esr);
+		if (errcode != 0) {
+			return errcode;
+		}
 	}
-	AIKITDLL::LogDebug("AIKIT服务启动成功");
-
-	esr->audio_status = AIKIT_DataBegin;
 
 	if (esr->aud_src == ESR_MIC) {
-		AIKITDLL::LogDebug("正在启动麦克风录音...");
-		ret = start_record(esr->recorder);
-		if (ret != 0) {
-			AIKITDLL::LogDebug("启动录音失败,错误码: %d", ret);
-			esr_dbg("开始录音失败: %d", ret);
-			ret = AIKIT_End(esr->handle);
-			esr->handle = NULL;
-			return E_SR_RECORDFAIL;
-		}
-		AIKITDLL::LogDebug("麦克风录音启动成功");
+		// 设备一直在录音：从唤醒词结束处回放预录音频，追上后继续实时送数
+		AIKITDLL::CaptureHub& hub = AIKITDLL::CaptureHub::Instance();
+		EnterCriticalSection(&esr->feed_lock);
+		esr->capture->Seek(hub.TakeCommandStart());
+		if (esr->vad)
+			vad_gate_reset(esr->vad);
+		unsigned int replay = esr->capture->Available();
+		esr->state = ESR_STATE_STARTED;
+		LeaveCriticalSection(&esr->feed_lock);
+		AIKITDLL::LogDebug("开始从共享采集流送数，回放预录音频 %u 字节", replay);
 	}
 
 	esr->state = ESR_STATE_STARTED;
@@ -430,20 +568,9 @@ int EsrStartListening(struct EsrRecognizer* esr)
 	return 0;
 }
 
-static void wait_for_rec_stop(struct recorder* rec, unsigned int timeout_ms)
-{
-	while (!is_record_stopped(rec)) {
-		Sleep(1);
-		if (timeout_ms != (unsigned int)-1)
-			if (0 == timeout_ms--)
-				break;
-	}
-}
-
 int EsrStopListening(struct EsrRecognizer* esr)
 {
 	int ret = 0;
-	AiAudio* aiAudio_raw = NULL;
 
 	if (esr->state < ESR_STATE_STARTED) {
 		esr_dbg("未开始或已停止.");
@@ -451,45 +578,39 @@ int EsrStopListening(struct EsrRecognizer* esr)
 	}
 
 	if (esr->aud_src == ESR_MIC) {
-		ret = stop_record(esr->recorder);
-		if (ret != 0) {
-			esr_dbg("停止失败!");
-			return E_SR_RECORDFAIL;
-		}
-		wait_for_rec_stop(esr->recorder, (unsigned int)-1);
+		// 把到目前为止已采集的数据送完，再发送结束标记；设备继续为其他读者录音
+		EnterCriticalSection(&esr->feed_lock);
+		drain_capture(esr);
+	}
+	if (esr->session->Active()) {
+		esr->state = ESR_STATE_INIT;
+		AIKITDLL::LogInfo("停止监听");
+		ret = ESRGetRlt(esr->session, esr->frame->Build(NULL, 0, AIKIT_DataEnd));
+		esr->session->End();
 	}
 	esr->state = ESR_STATE_INIT;
-	esr->dataBuilder->clear();
-	aiAudio_raw = AiAudio::get("audio")->data(NULL, 0)->status(AIKIT_DataEnd)->valid();
-	esr->dataBuilder->payload(aiAudio_raw);
-	AIKITDLL::LogInfo("停止监听");
-	ret = ESRGetRlt(esr->handle, esr->dataBuilder);
-
-	AIKIT_End(esr->handle);
-	esr->handle = NULL;
+	if (esr->aud_src == ESR_MIC)
+		LeaveCriticalSection(&esr->feed_lock);
 	return 0;
 }
 
-int EsrWriteAudioData(struct EsrRecognizer* esr, char* data, unsigned int len)
+int EsrWriteAudioData(struct EsrRecognizer* esr, const char* data, unsigned int len)
 {
-	AiAudio* aiAudio_raw = NULL;
 	int ret = 0;
 	if (!esr)
 		return E_SR_INVAL;
 	if (!data || !len)
 		return 0;
 
-	esr->dataBuilder->clear();
-	aiAudio_raw = AiAudio::get("audio")->data(data, len)->status(esr->audio_status)->valid();
-	esr->dataBuilder->payload(aiAudio_raw);
-
-	AIKITDLL::LogDebug("写入音频数据");
-	ret = ESRGetRlt(esr->handle, esr->dataBuilder);
+	// 送数循环的热路径：不记日志，长度和状态不变的帧只替换数据指针
+	ret = ESRGetRlt(esr->session, esr->frame->Build(data, len, esr->audio_status));
 	if (ret) {
 		esr->audio_status = AIKIT_DataEnd;
 		end_esr(esr);
 		return ret;
 	}
+	if (esr->first_write_us == 0)
+		esr->first_write_us = audio_source_now_us();
 	esr->audio_status = AIKIT_DataContinue;
 
 	return 0;
@@ -497,46 +618,117 @@ int EsrWriteAudioData(struct EsrRecognizer* esr, char* data, unsigned int len)
 
 void EsrUninit(struct EsrRecognizer* esr)
 {
-	if (esr->recorder) {
-		if (!is_record_stopped(esr->recorder))
-			stop_record(esr->recorder);
-		close_recorder(esr->recorder);
-		destroy_recorder(esr->recorder);
-		esr->recorder = NULL;
+	destroy_feeder(esr);
+
+	// 会话还没结束时在这里结束（只结束一次）
+	delete esr->session;
+	esr->session = nullptr;
+
+	// 数据构建器归还到池中，参数集由BuilderCache持有
+	if (esr->frame != nullptr) {
+		delete esr->frame;
+		esr->frame = nullptr;
 	}
+	esr->params = nullptr;
+}
+
+int EsrFromFile(const char* abilityID, const char* audio_path, int fsa_count, long* readLen)
+{
+	return AIKITDLL::EsrFileSession(abilityID, audio_path, fsa_count, readLen, nullptr);
+}
 
-	if (esr->dataBuilder != nullptr) {
-		delete esr->dataBuilder;
-		esr->dataBuilder = nullptr;
+int SetEsrFilePacing(int pacing, double speed, int frameBytes)
+{
+	if (pacing < ESR_PACING_REALTIME || pacing > ESR_PACING_SPEED) {
+		return E_SR_INVAL;
 	}
-	if (esr->paramBuilder != nullptr)
-	{
-		delete esr->paramBuilder;
-		esr->paramBuilder = nullptr;
+	if (pacing == ESR_PACING_SPEED && !(speed > 0)) {
+		return E_SR_INVAL;
 	}
+	// 快速模式按整帧写入，最多一次写入录音送数路径上的最大块
+	unsigned int fastFrame = ESR_FEED_CHUNK;
+	if (frameBytes > 0) {
+		fastFrame = (unsigned int)frameBytes / FRAME_LEN_ESR * FRAME_LEN_ESR;
+		if (fastFrame < FRAME_LEN_ESR) {
+			fastFrame = FRAME_LEN_ESR;
+		}
+		if (fastFrame > ESR_FEED_CHUNK) {
+			fastFrame = ESR_FEED_CHUNK;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(g_filePacingMutex);
+	g_filePacing = pacing;
+	g_fileSpeed = pacing == ESR_PACING_SPEED ? speed : 1.0;
+	g_fileFastFrame = fastFrame;
+	return 0;
 }
 
-int EsrFromFile(const char* abilityID, const char* audio_path, int fsa_count, long* readLen)
+int GetEsrFileStats(EsrFileStats* stats)
+{
+	if (stats == nullptr)
+		return E_SR_INVAL;
+
+	std::lock_guard<std::mutex> lock(g_filePacingMutex);
+	if (!g_hasFileStats) {
+		return -1;
+	}
+	*stats = g_lastFileStats;
+	return 0;
+}
+
+int AIKITDLL::EsrFileSession(const char* abilityID, const char* audio_path, int fsa_count, long* readLen, CancelToken* cancel,
+	EsrFileStats* stats, const EsrFileOptions* options)
 {
 	AIKITDLL::LogInfo("开始处理音频文件识别...");
 
 	int ret = 0;
-	FILE* file = nullptr;
-	long fileSize = 0;
-	long curLen = 0;
-	char data[FRAME_LEN_ESR] = { 0 };
+	AudioDecoder reader;      // 解析WAV头并转换成16k单声道，16k单声道PCM直接取映射区的片段
+	long long fileSize = 0;
+	unsigned int curLen = 0;
+	long totalLen = 0;
+	const char* data = nullptr;
 	int* index = nullptr;
 
+	// 送数节奏：实时和倍速按音频时长排定每一帧的送出时刻，快速模式不等待并使用更大的写入块
+	int pacing = ESR_PACING_REALTIME;
+	double speed = 1.0;
+	unsigned int frameBytes = FRAME_LEN_ESR;
+	unsigned long long sendStartUs = 0;
+	unsigned long long dueUs = 0;
+	unsigned long long nowUs = 0;
+	EsrFileStats fileStats = { 0 };
+
 	AIKIT_DataStatus status = AIKIT_DataBegin;
-	AIKIT::AIKIT_DataBuilder* dataBuilder = nullptr;
-	AIKIT_HANDLE* handle = nullptr;
-	AIKIT::AiAudio* aiAudio_raw = nullptr;
+	AIKITDLL::AudioFrame* frame = nullptr;
+	AIKIT_BizParam* params = nullptr;
+	AikitSession session(abilityID);   // 任何出口都只结束一次
+
+	if (options != nullptr) {
+		pacing = options->pacing;
+		speed = options->speed > 0 ? options->speed : 1.0;
+		if (pacing == ESR_PACING_FAST) {
+			frameBytes = options->frameBytes > 0 ? options->frameBytes : ESR_FEED_CHUNK;
+		}
+	}
+	else {
+		std::lock_guard<std::mutex> lock(g_filePacingMutex);
+		pacing = g_filePacing;
+		speed = g_fileSpeed;
+		if (pacing == ESR_PACING_FAST) {
+			frameBytes = g_fileFastFrame;
+		}
+	}
+	if (pacing == ESR_PACING_REALTIME) {
+		speed = 1.0;
+	}
 
 	// 防止内存分配失败
 	index = (int*)malloc(fsa_count * sizeof(int));
 	if (index == nullptr) {
 		AIKITDLL::LogError("内存分配失败");
-		return -1;
+		ret = -1;
+		goto exit;
 	}
 
 	for (int i = 0; i < fsa_count; ++i)
@@ -549,35 +741,25 @@ int EsrFromFile(const char* abilityID, const char* audio_path, int fsa_count, lo
 	if (ret != 0)
 	{
 		AIKITDLL::LogError("AIKIT_SpecifyDataSet 失败，错误码: %d", ret);
+		goto exit;
 	}
 	AIKITDLL::LogInfo("数据集指定成功");
 
-	// 创建参数构建器
-	AIKIT::AIKIT_ParamBuilder* paramBuilder = AIKIT::AIKIT_ParamBuilder::create();
-	if (paramBuilder == nullptr) {
-		AIKITDLL::LogError("创建 ParamBuilder 失败");
+	// 文件识别的会话参数只构建一次
+	params = AIKITDLL::EsrSessionParams(ESR_PARAMS_FILE);
+	if (params == nullptr) {
+		AIKITDLL::LogError("构建会话参数失败");
 		ret = -1;
+		goto exit;
 	}
 
-	// 设置参数
-	paramBuilder->clear();
-	paramBuilder->param("languageType", 0);    // 0-中文 1-英文
-	paramBuilder->param("vadEndGap", 60);
-	paramBuilder->param("vadOn", true);
-	paramBuilder->param("beamThreshold", 20);
-	paramBuilder->param("hisGramThreshold", 3000);
-	paramBuilder->param("postprocOn", false);
-	paramBuilder->param("vadResponsetime", 1000);
-	paramBuilder->param("vadLinkOn", true);
-	paramBuilder->param("vadSpeechEnd", 80);
-
 	// 启动能力
 	AIKITDLL::LogInfo("正在启动语音识别能力...");
-	ret = AIKIT::AIKIT_Start(abilityID, AIKIT::AIKIT_Builder::build(paramBuilder), nullptr, &handle);
+	ret = session.Start(params);
 	if (ret != 0)
 	{
 		AIKITDLL::LogError("AIKIT_Start 失败，错误码: %d", ret);
-		if (paramBuilder) delete paramBuilder;
+		goto exit;
 	}
 	AIKITDLL::LogInfo("语音识别能力启动成功");
 
@@ -585,107 +767,116 @@ int EsrFromFile(const char* abilityID, const char* audio_path, int fsa_count, lo
 	if (audio_path == nullptr) {
 		AIKITDLL::LogError("音频文件路径为空");
 		ret = -1;
-		if (paramBuilder) delete paramBuilder;
+		goto exit;
 	}
 
 	// 打开音频文件
 	AIKITDLL::LogInfo("正在打开音频文件: %s", audio_path);
-	errno_t err = fopen_s(&file, audio_path, "rb");
-	if (err != 0 || file == nullptr)
+	ret = reader.Open(audio_path);
+	if (ret != 0)
 	{
-		AIKITDLL::LogError("打开音频文件失败: %s，错误码: %d", audio_path, err);
-		ret = -1;
-		if (paramBuilder) delete paramBuilder;
+		AIKITDLL::LogError("打开音频文件失败: %s，错误码: %d", audio_path, ret);
+		// 格式不支持时把原因交给调用方，其他错误保持原来的返回值
+		if (ret != E_AUDIO_FORMAT) {
+			ret = -1;
+		}
 		goto exit;
 	}
 	AIKITDLL::LogInfo("音频文件打开成功");
 
-	// 获取文件大小
-	fseek(file, 0, SEEK_END);
-	fileSize = ftell(file);
-	fseek(file, 0, SEEK_SET);
-	AIKITDLL::LogInfo("音频文件大小: %ld 字节", fileSize);
+	fileSize = reader.Format().dataBytes;
+	AIKITDLL::LogInfo("音频数据大小: %lld 字节（%s）", fileSize, reader.Mapped() ? "内存映射" : "流方式读取");
 
-	// 创建数据构建器
-	dataBuilder = AIKIT::AIKIT_DataBuilder::create();
-	if (dataBuilder == nullptr) {
+	// 从池里取数据构建器
+	frame = new AIKITDLL::AudioFrame("audio", true);
+	if (!frame->Valid()) {
 		AIKITDLL::LogError("创建 DataBuilder 失败");
 		ret = -1;
-		if (paramBuilder) delete paramBuilder;
 		goto exit;
 	}
 
-	// 处理音频数据
-	while (fileSize > *readLen) {
-		curLen = fread(data, 1, sizeof(data), file);
-		*readLen += curLen;
-		dataBuilder->clear();
-
-		if (*readLen == FRAME_LEN_ESR) {
-			status = AIKIT_DataBegin;
+	// 处理音频数据（送数循环的热路径，不逐帧记日志）
+	sendStartUs = audio_source_now_us();
+	for (;;) {
+		if (IsCancelled(cancel)) {
+			AIKITDLL::LogInfo("文件识别已取消，已处理 %ld/%lld 字节", *readLen, fileSize);
+			ret = E_SESSION_CANCELLED;
+			goto exit;
 		}
-		else {
-			status = AIKIT_DataContinue;
+		data = reader.Next(frameBytes, &curLen);
+		if (data == nullptr) {
+			break;
 		}
+		*readLen += curLen;
+		totalLen += curLen;
 
-		// 构建音频数据
-		aiAudio_raw = AIKIT::AiAudio::get("audio")->data(data, curLen)->status(status)->valid();
-		dataBuilder->payload(aiAudio_raw);
+		status = totalLen == (long)curLen ? AIKIT_DataBegin : AIKIT_DataContinue;
 
 		// 获取识别结果
-		AIKITDLL::LogDebug("正在处理音频数据片段，当前位置: %ld 字节", *readLen);
-		ret = ESRGetRlt(handle, dataBuilder);
+		ret = ESRGetRlt(&session, frame->Build(data, curLen, status), options != nullptr ? options->plain : nullptr);
 		if (ret != 0 && ret != ESR_HAS_RESULT) {
 			AIKITDLL::LogError("处理音频数据失败，错误码: %d", ret);
 			goto exit;
 		}
-
-		// 等待一小段时间，避免CPU占用过高
-		Sleep(10);
+		fileStats.writes++;
+
+		// 按已送出的音频时长计算下一帧的送出时刻，处理耗时不会累积成额外的延迟
+		if (pacing != ESR_PACING_FAST) {
+			dueUs = sendStartUs + (unsigned long long)((double)totalLen * 1000000.0 / ESR_BYTES_PER_SEC / speed);
+			nowUs = audio_source_now_us();
+			if (dueUs > nowUs + 1000) {
+				Sleep((DWORD)((dueUs - nowUs) / 1000));
+			}
+		}
 	}
 
 	// 发送结束标记
 	*readLen = -1;
-	dataBuilder->clear();
 	status = AIKIT_DataEnd;
-	aiAudio_raw = AIKIT::AiAudio::get("audio")->data(data, 0)->status(status)->valid();
-	dataBuilder->payload(aiAudio_raw);
 
 	AIKITDLL::LogInfo("发送音频数据结束标记");
-	ret = ESRGetRlt(handle, dataBuilder);
+	ret = ESRGetRlt(&session, frame->Build(nullptr, 0, status), options != nullptr ? options->plain : nullptr);
 	if (ret != 0 && ret != ESR_HAS_RESULT) {
 		AIKITDLL::LogError("发送结束标记失败，错误码: %d", ret);
 		goto exit;
 	}
 
+	// 结束标记的结果返回时整个文件才算识别完
+	fileStats.pacing = pacing;
+	fileStats.speed = speed;
+	fileStats.frameBytes = frameBytes;
+	fileStats.audioUs = (long long)totalLen * 1000000 / ESR_BYTES_PER_SEC;
+	fileStats.wallUs = (long long)(audio_source_now_us() - sendStartUs);
+	fileStats.rtf = fileStats.audioUs > 0 ? (double)fileStats.wallUs / fileStats.audioUs : 0;
+	AIKITDLL::LogInfo("文件识别耗时: 音频 %.2f 秒, 用时 %.2f 秒, 实时率 %.3f (节奏 %d, 每次写入 %u 字节, 共 %llu 次)",
+		fileStats.audioUs / 1000000.0, fileStats.wallUs / 1000000.0, fileStats.rtf, pacing, frameBytes, fileStats.writes);
+	if (stats != nullptr) {
+		*stats = fileStats;
+	}
+	{
+		std::lock_guard<std::mutex> lock(g_filePacingMutex);
+		g_lastFileStats = fileStats;
+		g_hasFileStats = true;
+	}
+
 	AIKITDLL::LogInfo("正在结束语音识别能力...");
-	ret = AIKIT::AIKIT_End(handle);
+	ret = session.End();
 	if (ret != 0)
 	{
 		AIKITDLL::LogError("AIKIT_End 失败，错误码: %d", ret);
 	}
 
 exit:
-	// 确保所有资源正确释放
-	if (handle != nullptr) {
-		AIKIT::AIKIT_End(handle);
-		handle = nullptr;
-	}
+	// 确保所有资源正确释放；出错退出时在这里结束会话
+	session.End();
 
-	if (dataBuilder != nullptr) {
-		delete dataBuilder;
-		dataBuilder = nullptr;
+	// 数据构建器归还到池中，参数集由BuilderCache持有
+	if (frame != nullptr) {
+		delete frame;
+		frame = nullptr;
 	}
 
-	if (paramBuilder != nullptr) {
-		delete paramBuilder;
-		paramBuilder = nullptr;
-	}
-
-	if (file != nullptr) {
-		fclose(file);
-		file = nullptr;
-	}
+	reader.Close();
 
 	if (index != nullptr) {
 		free(index);
@@ -695,6 +886,22 @@ exit:
 	return ret;
 }
 
+// 获取麦克风识别的采集读者统计：有活动会话时返回实时数据，否则返回上一次会话结束时的快照
+int GetEsrCaptureStats(CaptureConsumerStats* stats)
+{
+	if (stats == nullptr)
+		return E_SR_INVAL;
+
+	std::lock_guard<std::mutex> lock(g_esrCaptureMutex);
+	if (g_activeEsrCapture != nullptr) {
+		g_activeEsrCapture->GetStats(stats);
+	}
+	else {
+		*stats = g_lastEsrCaptureStats;
+	}
+	return 0;
+}
+
 // 为WPF应用提供的接口函数 - 获取各种格式的结果
 // 返回值增加长度信息,便于WPF判断
 extern "C" __declspec(dllexport) int GetPgsResult(char* buffer, int bufferSize, bool* isNewResult)
@@ -4,6 +4,10 @@
 #include "aikit_biz_config.h"
 #include "Common.h"
 #include "winrec.h"
+#include "CaptureHub.h"
+#include "BuilderCache.h"
+#include "AikitSession.h"
+#include <string>
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,16 +36,45 @@ extern "C" {
 #define E_SR_RECORDFAIL     -1003
 #define E_SR_ALREADY        -1004
 
+	// 文件识别的送数节奏
+	enum EsrFilePacing {
+		ESR_PACING_REALTIME = 0,  // 按音频时长实时送数，用于回放测试
+		ESR_PACING_FAST,          // 不等待，按引擎单次写入的最大数据量尽快送完
+		ESR_PACING_SPEED          // 按固定倍速送数
+	};
+
+	// 文件识别默认的送数倍速：原来每送一帧（640字节，20ms）等待10ms，约为2倍速
+#define ESR_FILE_DEFAULT_SPEED 2.0
+
+	// 一次文件识别的耗时
+	struct EsrFileStats {
+		int pacing;                 // 使用的送数节奏（EsrFilePacing）
+		double speed;               // 倍速（只对ESR_PACING_SPEED有意义）
+		unsigned int frameBytes;    // 每次写入的数据量
+		unsigned long long writes;  // 写入次数
+		long long audioUs;          // 音频时长（微秒，按16k/16bit单声道计算）
+		long long wallUs;           // 从开始送数到收到结束标记结果的耗时（微秒）
+		double rtf;                 // 实时率：wallUs / audioUs，小于1表示快于实时
+	};
+
 // 语音识别器结构体
 	struct EsrRecognizer {
-		struct recorder* recorder;   // 录音设备句柄
+		AIKITDLL::CaptureConsumer* capture; // 共享采集流上的读者（麦克风模式）
 		EsrAudioSource aud_src;      // 音频来源
 		AIKIT_DataStatus audio_status; // 音频数据状态
 		const char* ABILITY;         // 能力ID
-		AIKIT::AIKIT_DataBuilder* dataBuilder;    // 数据构建器
-		AIKIT::AIKIT_ParamBuilder* paramBuilder;  // 参数构建器
-		AIKIT_HANDLE* handle;        // AIKIT句柄
+		AIKITDLL::AudioFrame* frame;  // 复用的音频帧，构建器来自BuilderCache的池
+		AIKIT_BizParam* params;       // 缓存的会话参数，不需要释放
+		AIKITDLL::AikitSession* session; // AIKIT会话，EsrInit创建、EsrUninit销毁，保证只结束一次
 		int state;                   // 状态
+		HANDLE feeder_thread;        // 送数线程句柄
+		HANDLE feeder_event;         // 数据到达通知事件
+		volatile int feeder_quit;    // 送数线程退出标志
+		CRITICAL_SECTION feed_lock;  // 保证同一时刻只有一个线程从采集流取数
+		unsigned int feed_chunk;     // 每次写入引擎的数据量，跟随录音周期
+		struct vad_gate* vad;        // 静音门限，未启用时为NULL
+		unsigned long long started_us;     // AIKIT_Start 返回的时刻
+		unsigned long long first_write_us; // 第一次成功写入音频的时刻，0 表示还没有写入
 	};
 
 	// 初始化语音识别器
@@ -54,13 +87,25 @@ extern "C" {
 	AIKITDLL_API int EsrStopListening(struct EsrRecognizer* esr);
 
 	// 写入音频数据
-	AIKITDLL_API int EsrWriteAudioData(struct EsrRecognizer* esr, char* data, unsigned int len);
+	AIKITDLL_API int EsrWriteAudioData(struct EsrRecognizer* esr, const char* data, unsigned int len);
 
 	// 释放语音识别器资源
 	AIKITDLL_API void EsrUninit(struct EsrRecognizer* esr);
 
+	// 获取麦克风识别读取共享采集流的统计（积压、峰值、被追上丢弃的数据），成功返回0。
+	// 有活动会话时返回实时数据，否则返回上一次会话结束时的快照
+	AIKITDLL_API int GetEsrCaptureStats(CaptureConsumerStats* stats);
+
 	// 从文件获取ESR结果
 	AIKITDLL_API int EsrFromFile(const char* abilityID, const char* audio_path, int fsa_count, long* readLen);
+
+	// 设置文件识别的送数节奏（EsrFilePacing）：speed为ESR_PACING_SPEED的倍速，
+	// frameBytes为ESR_PACING_FAST每次写入的数据量（0表示默认200ms，按帧长对齐，不超过200ms）。
+	// 默认按ESR_FILE_DEFAULT_SPEED倍速每次送一帧，与原来每帧之后等待10ms的节奏相当。成功返回0
+	AIKITDLL_API int SetEsrFilePacing(int pacing, double speed, int frameBytes);
+
+	// 获取最近一次文件识别的耗时和实时率，没有识别过时返回-1
+	AIKITDLL_API int GetEsrFileStats(EsrFileStats* stats);
 #ifdef __cplusplus
 }
 #endif
@@ -72,4 +117,26 @@ enum {
 };
 
 // 帧长度定义
-#define FRAME_LEN_ESR 640 // 16k采样率的16bit音频，一帧的大小为640B, 时长20ms
\ No newline at end of file
+#define FRAME_LEN_ESR 640 // 16k采样率的16bit音频，一帧的大小为640B, 时长20ms
+
+namespace AIKITDLL {
+	class CancelToken;
+
+	// 单次文件识别的选项，覆盖SetEsrFilePacing的全局设置
+	struct EsrFileOptions {
+		int pacing;                 // EsrFilePacing
+		double speed;               // ESR_PACING_SPEED的倍速
+		unsigned int frameBytes;    // ESR_PACING_FAST每次写入的数据量，0表示默认
+		std::string* plain;         // 不为空时plain结果写到这里，不写结果文件、不更新全局结果缓冲区
+	};
+
+	// 预开识别会话：EsrInit之后开始引擎会话但不送数，送数线程继续丢弃采集到的数据；
+	// 之后的EsrStartListening直接使用这个会话，只从唤醒词结束处开始送数
+	int EsrPrestart(struct EsrRecognizer* esr);
+
+	// EsrFromFile的可取消版本：每写入一帧之前检查cancel，取消时不再发送结束标记，
+	// 直接结束会话并返回E_SESSION_CANCELLED
+	// stats不为空时填入本次识别的耗时和实时率；options为空时使用全局的送数节奏
+	int EsrFileSession(const char* abilityID, const char* audio_path, int fsa_count, long* readLen, CancelToken* cancel,
+		EsrFileStats* stats = nullptr, const EsrFileOptions* options = nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "pch.h"
+#include "EsrStandby.h"
+#include "EsrHelper.h"
+#include "CnenEsrWrapper.h"
+#include "CaptureHub.h"
+#include "BuilderCache.h"
+#include "EngineWarmup.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <chrono>
+#include <cstring>
+
+// 预开失败后重试的间隔（毫秒）
+#define ESR_STANDBY_RETRY_MS 2000
+// 命令词引擎还在后台加载时，每次等待的时长（毫秒）
+#define ESR_STANDBY_WARMUP_WAIT_MS 200
+
+namespace AIKITDLL {
+
+	EsrStandby& EsrStandby::Instance() {
+		static EsrStandby instance;
+		return instance;
+	}
+
+	EsrStandby::EsrStandby()
+		: m_quit(false), m_enabled(false), m_armed(false), m_preparing(false), m_recycleMs(ESR_STANDBY_RECYCLE_MS),
+		m_standby(nullptr), m_signature(0), m_preparedUs(0), m_retryUs(0), m_totalPrepareUs(0) {
+		memset(&m_cbs, 0, sizeof(m_cbs));
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	EsrStandby::~EsrStandby() {
+		// 静态对象在DLL卸载时持有加载器锁析构，这里等待线程退出会死锁，线程应已由Shutdown停止。
+		// 进程退出时SDK可能已经反初始化，不再结束预开会话
+		if (m_worker.joinable()) {
+			m_worker.detach();
+		}
+	}
+
+	void EsrStandby::Shutdown() {
+		std::thread worker;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+			m_armed = false;
+			ReleaseLocked();
+			worker.swap(m_worker);
+		}
+		m_cond.notify_all();
+		if (worker.joinable()) {
+			worker.join();
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = false;
+	}
+
+	void EsrStandby::Configure(bool enabled, unsigned int recycleMs) {
+		recycleMs = recycleMs > 0 ? recycleMs : ESR_STANDBY_RECYCLE_MS;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_enabled = enabled;
+			m_recycleMs = recycleMs;
+			if (!enabled) {
+				m_armed = false;
+				ReleaseLocked();
+			}
+		}
+		m_cond.notify_all();
+		LogInfo("EsrStandby: 预开命令词会话已%s，最长空闲 %u ms", enabled ? "启用" : "关闭", recycleMs);
+	}
+
+	bool EsrStandby::Enabled() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_enabled;
+	}
+
+	void EsrStandby::Arm(const AIKIT_Callbacks& cbs) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_enabled) {
+				return;
+			}
+			m_cbs = cbs;
+			m_armed = true;
+			m_retryUs = 0;
+			if (!m_worker.joinable() && !m_quit) {
+				m_worker = std::thread(&EsrStandby::WorkerProc, this);
+			}
+		}
+		m_cond.notify_all();
+	}
+
+	struct EsrRecognizer* EsrStandby::Take() {
+		struct EsrRecognizer* esr = nullptr;
+		bool preparing = m_preparing.load();
+		unsigned long long t0 = audio_source_now_us();
+		{
+			// 后台正在预开时持有锁，这里等它完成
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_enabled) {
+				return nullptr;
+			}
+			m_armed = false;
+			if (preparing) {
+				// 等待的时间算在交接耗时里，预开没有省下这一段
+				m_stats.waited++;
+				m_stats.lastTakeWaitUs = (long long)(audio_source_now_us() - t0);
+				LogDebug("EsrStandby: 等待预开完成 %lld us", m_stats.lastTakeWaitUs);
+			}
+			if (m_standby != nullptr && m_signature != SignatureLocked()) {
+				LogInfo("EsrStandby: 会话参数已变化，丢弃预开会话");
+				ReleaseLocked();
+				m_stats.recycled++;
+			}
+			if (m_standby == nullptr) {
+				m_stats.missed++;
+				return nullptr;
+			}
+			esr = m_standby;
+			m_standby = nullptr;
+			m_stats.taken++;
+			m_stats.standbyUs += (long long)(audio_source_now_us() - m_preparedUs);
+			// 识别会话自己持有引擎引用，归还预开时持有的那一个
+			EsrEngineRelease();
+		}
+		m_cond.notify_all();
+		LogDebug("EsrStandby: 命令词识别使用预开会话");
+		return esr;
+	}
+
+	void EsrStandby::Discard() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_armed = false;
+		ReleaseLocked();
+	}
+
+	void EsrStandby::GetStats(EsrStandbyStats* stats) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		*stats = m_stats;
+		stats->avgPrepareUs = m_stats.prepared > 0 ? m_totalPrepareUs / (long long)m_stats.prepared : 0;
+		stats->active = m_standby != nullptr ? 1 : 0;
+		if (m_standby != nullptr) {
+			stats->standbyUs += (long long)(audio_source_now_us() - m_preparedUs);
+		}
+	}
+
+	unsigned long long EsrStandby::SignatureLocked() const {
+		// 会话参数、静音门限和录音周期决定了识别器的构造，任何一个变化都要重开
+		CaptureHub& hub = CaptureHub::Instance();
+		unsigned long long sig = (unsigned long long)(uintptr_t)EsrSessionParams(ESR_PARAMS_MIC);
+		sig = sig * 31 + (hub.VadEnabled() ? 1 : 0);
+		sig = sig * 31 + hub.PeriodBytes();
+		return sig;
+	}
+
+	int EsrStandby::PrepareLocked() {
+		struct EsrRecognizer* esr = nullptr;
+		unsigned long long t0 = audio_source_now_us();
+		bool engineHeld = false;
+		int ret = AIKIT::AIKIT_RegisterAbilityCallback(ESR_ABILITY, m_cbs);
+		if (ret != 0) {
+			LogError("EsrStandby: 注册能力回调失败，错误码: %d", ret);
+			goto fail;
+		}
+
+		ret = EsrEngineAcquire(nullptr);
+		if (ret != 0) {
+			LogError("EsrStandby: 获取命令词引擎失败，错误码: %d", ret);
+			goto fail;
+		}
+		engineHeld = true;
+
+		esr = new EsrRecognizer();
+		ret = EsrInit(esr, ESR_MIC, get_default_input_dev());
+		if (ret != 0) {
+			LogError("EsrStandby: 识别器初始化失败，错误码: %d", ret);
+			delete esr;
+			esr = nullptr;
+			goto fail;
+		}
+
+		ret = EsrPrestart(esr);
+		if (ret != 0) {
+			LogError("EsrStandby: 预开会话失败，错误码: %d", ret);
+			goto fail;
+		}
+
+		m_standby = esr;
+		m_signature = SignatureLocked();
+		m_preparedUs = audio_source_now_us();
+		m_stats.prepared++;
+		m_stats.lastPrepareUs = (long long)(m_preparedUs - t0);
+		m_totalPrepareUs += m_stats.lastPrepareUs;
+		LogDebug("EsrStandby: 预开会话就绪，耗时 %lld us", m_stats.lastPrepareUs);
+		return 0;
+
+	fail:
+		if (esr != nullptr) {
+			EsrUninit(esr);
+			delete esr;
+		}
+		if (engineHeld) {
+			EsrEngineRelease();
+		}
+		m_stats.failed++;
+		return ret != 0 ? ret : -1;
+	}
+
+	void EsrStandby::ReleaseLocked() {
+		if (m_standby == nullptr) {
+			return;
+		}
+		m_stats.standbyUs += (long long)(audio_source_now_us() - m_preparedUs);
+		EsrUninit(m_standby);
+		delete m_standby;
+		m_standby = nullptr;
+		EsrEngineRelease();
+	}
+
+	void EsrStandby::WorkerProc() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		int ret = 0;
+		while (!m_quit) {
+			if (!m_enabled || !m_armed) {
+				m_cond.wait(lock);
+				continue;
+			}
+
+			unsigned long long now = audio_source_now_us();
+			if (m_standby != nullptr) {
+				// 空闲到期或参数变化时回收，下一轮重新预开
+				unsigned long long expireUs = m_preparedUs + (unsigned long long)m_recycleMs * 1000;
+				if (now >= expireUs || m_signature != SignatureLocked()) {
+					LogDebug("EsrStandby: 回收预开会话");
+					ReleaseLocked();
+					m_stats.recycled++;
+					continue;
+				}
+				// 录音周期和门限设置没有通知，最多1秒检查一次
+				unsigned long long waitUs = expireUs - now;
+				m_cond.wait_for(lock, std::chrono::microseconds(waitUs < 1000000ULL ? waitUs : 1000000ULL));
+				continue;
+			}
+
+			if (now < m_retryUs) {
+				m_cond.wait_for(lock, std::chrono::microseconds(m_retryUs - now));
+				continue;
+			}
+
+			// 命令词引擎还在后台加载时不持锁等待，避免和加载争抢引擎
+			if (EngineWarmup::Instance().GetState(WARMUP_ESR) == WARMUP_RUNNING) {
+				lock.unlock();
+				EngineWarmup::Instance().WaitReady(WARMUP_ESR, ESR_STANDBY_WARMUP_WAIT_MS);
+				lock.lock();
+				continue;
+			}
+
+			m_preparing = true;
+			ret = PrepareLocked();
+			m_preparing = false;
+			if (ret != 0) {
+				m_retryUs = audio_source_now_us() + (unsigned long long)ESR_STANDBY_RETRY_MS * 1000;
+			}
+		}
+	}
+}
+
+// 导出函数实现
+void SetEsrSpeculativeStart(int enabled, int recycleMs)
+{
+	AIKITDLL::EsrStandby::Instance().Configure(enabled != 0, recycleMs > 0 ? (unsigned int)recycleMs : 0);
+}
+
+int GetEsrStandbyStats(EsrStandbyStats* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+	AIKITDLL::EsrStandby::Instance().GetStats(stats);
+	return 0;
+}
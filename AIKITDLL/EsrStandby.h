@@ -0,0 +1,110 @@
+#pragma once
+#include "aikit_biz_api.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct EsrRecognizer;
+
+// 预开命令词会话的统计
+struct EsrStandbyStats {
+	unsigned long long prepared;   // 预开的次数
+	unsigned long long taken;      // 命令词识别直接使用预开会话的次数
+	unsigned long long missed;     // 开始识别时没有可用预开会话、按原流程冷启动的次数
+	unsigned long long recycled;   // 空闲到期或参数变化后回收重开的次数
+	unsigned long long failed;     // 预开失败的次数
+	unsigned long long waited;     // 开始识别时预开还没完成、等它完成的次数（唤醒来得太早）
+	long long lastPrepareUs;       // 最近一次预开耗时（微秒）。使用预开会话时省下的交接耗时
+	                               // 约为这个值减去lastTakeWaitUs，只有预开在唤醒前完成时才全部省下
+	long long lastTakeWaitUs;      // 最近一次等待预开完成的耗时（微秒），这段时间计入交接耗时
+	long long avgPrepareUs;        // 预开的平均耗时（微秒）
+	long long standbyUs;           // 预开会话累计空闲时长（微秒），即备用会话占用引擎的时间
+	int active;                    // 当前是否有预开会话
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 开关唤醒监听期间预开命令词会话（默认关闭）。recycleMs为预开会话最长空闲时间，
+	// 到期后结束并重新开始，0表示使用默认值。关闭时立即结束已预开的会话
+	AIKITDLL_API void SetEsrSpeculativeStart(int enabled, int recycleMs);
+
+	// 获取预开命令词会话的统计，成功返回0
+	AIKITDLL_API int GetEsrStandbyStats(EsrStandbyStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+// 预开会话的默认最长空闲时间（毫秒）
+#define ESR_STANDBY_RECYCLE_MS 30000
+
+namespace AIKITDLL {
+	// 唤醒监听期间在后台保持一个已经开始的命令词会话（识别器、采集读者、送数线程和引擎会话都已就绪，
+	// 送数线程丢弃采集数据），唤醒后命令词识别直接接过这个会话，只从唤醒词结束处开始送数。
+	// 预开会话空闲超过回收时间，或会话参数、静音门限、录音周期变化后结束并重新开始。
+	// 预开会话持有一个命令词引擎引用，重置SDK、卸载引擎之前必须调用Discard。
+	class EsrStandby {
+	public:
+		static EsrStandby& Instance();
+
+		void Configure(bool enabled, unsigned int recycleMs);
+		bool Enabled() const;
+
+		// 唤醒会话开始送数时调用（见IvwListeningFn）：未启用时什么也不做，否则在后台线程上准备预开会话
+		void Arm(const AIKIT_Callbacks& cbs);
+
+		// 取走预开会话，之后由调用方EsrStopListening、EsrUninit并delete；没有可用会话时返回nullptr。
+		// 后台正在预开时等它完成。取走后不再预开，直到下一次Arm
+		struct EsrRecognizer* Take();
+
+		// 结束预开会话并停止预开，直到下一次Arm
+		void Discard();
+
+		// 结束预开会话并停止后台线程（CleanupSDK调用），之后的Arm会重新启动线程
+		void Shutdown();
+
+		void GetStats(EsrStandbyStats* stats);
+
+	private:
+		EsrStandby();
+		~EsrStandby();
+		EsrStandby(const EsrStandby&) = delete;
+		EsrStandby& operator=(const EsrStandby&) = delete;
+
+		void WorkerProc();
+		// 以下都在持有m_mutex时调用
+		int PrepareLocked();
+		void ReleaseLocked();
+		unsigned long long SignatureLocked() const;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::thread m_worker;
+		bool m_quit;
+		bool m_enabled;
+		bool m_armed;
+		std::atomic<bool> m_preparing;       // 后台线程正在PrepareLocked中，Take会等它完成
+		unsigned int m_recycleMs;
+		AIKIT_Callbacks m_cbs;
+		struct EsrRecognizer* m_standby;
+		unsigned long long m_signature;      // 预开时的参数签名
+		unsigned long long m_preparedUs;     // 预开完成的时刻
+		unsigned long long m_retryUs;        // 预开失败后下一次重试的时刻
+		EsrStandbyStats m_stats;
+		long long m_totalPrepareUs;
+	};
+}
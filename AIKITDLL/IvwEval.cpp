@@ -0,0 +1,494 @@
+#include "pch.h"
+#include "IvwEval.h"
+#include "BatchCommon.h"
+#include "IvwWrapper.h"
+#include "IvwResourceManager.h"
+#include "VoiceStateManager.h"
+#include "BuilderCache.h"
+#include "AikitSession.h"
+#include "AudioDecoder.h"
+#include "CancelToken.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 每次写入引擎的数据量：40ms，唤醒时刻按写入块记录，这也是时刻的精度
+#define IVW_EVAL_CHUNK_LEN (4 * FRAME_LEN)
+// 16k/16bit单声道每毫秒的字节数
+#define IVW_EVAL_BYTES_PER_MS 32
+
+namespace {
+	// 评测会话上下文的标记，回调据此确认usrContext是评测会话
+	const unsigned int IVW_EVAL_MAGIC = 0x45565749;  // "IWVE"
+
+	// 正在评测：语音助手据此拒绝启动，同一时刻也只允许一次评测
+	std::atomic<bool> g_evalActive(false);
+
+	struct WakeEvent {
+		long long audioMs;   // 唤醒时已送入引擎的音频时长
+		long long wallMs;    // 距会话开始的时间
+	};
+
+	// 一个文件的唤醒会话，作为SDK的用户上下文交给回调
+	struct EvalSession {
+		unsigned int magic;
+		std::atomic<unsigned long long> fedBytes;   // 已送入（含正在写入的一块）的字节数
+		unsigned long long startUs;
+		std::atomic<int> error;
+		std::mutex mutex;                           // 保护events
+		std::vector<WakeEvent> events;
+
+		EvalSession() : magic(IVW_EVAL_MAGIC), fedBytes(0), startUs(0), error(0) {}
+		~EvalSession() { magic = 0; }
+	};
+
+	// 清单中的一个样本
+	struct EvalItem {
+		bool positive;
+		std::string path;
+		long long keywordEndMs;   // 唤醒词结束时刻，未标注时为-1
+	};
+
+	struct EvalResult {
+		bool done;
+		int status;
+		unsigned int worker;
+		long long audioUs;
+		long long wallUs;
+		std::vector<WakeEvent> events;
+	};
+
+	// 解析清单：每行“标注 路径 [唤醒词结束毫秒]”，路径可以含空格
+	void ParseManifest(const std::vector<AIKITDLL::ManifestLine>& lines, std::vector<EvalItem>& items) {
+		for (const AIKITDLL::ManifestLine& line : lines) {
+			const char* begin = line.text.c_str();
+			const char* end = begin + line.text.size();
+			const char* rest = begin;
+			while (*rest != '\0' && *rest != ' ' && *rest != '\t') {
+				++rest;
+			}
+			if (*rest == '\0') {
+				AIKITDLL::LogWarning("IvwEval: 清单第 %u 行缺少路径，已跳过", line.lineNo);
+				continue;
+			}
+			std::string label(begin, rest);
+			while (*rest == ' ' || *rest == '\t') {
+				++rest;
+			}
+
+			EvalItem item;
+			if (label == "pos" || label == "1") {
+				item.positive = true;
+			}
+			else if (label == "neg" || label == "0") {
+				item.positive = false;
+			}
+			else {
+				AIKITDLL::LogWarning("IvwEval: 清单第 %u 行的标注无效: %s，已跳过", line.lineNo, label.c_str());
+				continue;
+			}
+
+			// 最后一个字段全是数字时作为唤醒词结束时刻
+			item.keywordEndMs = -1;
+			const char* last = end;
+			while (last > rest && last[-1] >= '0' && last[-1] <= '9') {
+				--last;
+			}
+			if (last < end && last > rest && (last[-1] == ' ' || last[-1] == '\t')) {
+				item.keywordEndMs = atoll(last);
+				end = last;
+				while (end > rest && (end[-1] == ' ' || end[-1] == '\t')) {
+					--end;
+				}
+			}
+			item.path.assign(rest, end);
+			items.push_back(item);
+		}
+	}
+
+	// 一次评测的共享状态：结果按序号写回，报告按清单顺序输出
+	struct EvalContext {
+		const std::vector<EvalItem>* items;
+		std::vector<EvalResult>* results;
+		AIKIT_BizParam* params;
+		AIKITDLL::CancelToken* cancel;
+		AIKITDLL::BatchQueue* queue;
+	};
+
+	// 送完一个文件，返回0或错误码；唤醒事件由回调记到session
+	int EvalFile(EvalContext* ctx, const EvalItem& item, AIKITDLL::AudioFrame* frame, EvalSession* evalSession) {
+		AIKITDLL::AudioDecoder reader;
+		int ret = reader.Open(item.path.c_str());
+		if (ret != 0) {
+			AIKITDLL::LogError("IvwEval: 打开音频文件失败: %s，错误码: %d", item.path.c_str(), ret);
+			return ret == E_AUDIO_FORMAT ? ret : -1;
+		}
+
+		// 不传恢复动作：其他线程的会话仍在进行，不能重新加载引擎
+		AIKITDLL::AikitSession session(IVW_ABILITY, evalSession);
+		evalSession->startUs = audio_source_now_us();
+		ret = session.Start(ctx->params);
+		if (ret != 0) {
+			AIKITDLL::LogError("IvwEval: 启动唤醒会话失败，错误码: %d，文件: %s", ret, item.path.c_str());
+			return ret;
+		}
+
+		unsigned long long fed = 0;
+		unsigned int len = 0;
+		const char* data;
+		while ((data = reader.Next(IVW_EVAL_CHUNK_LEN, &len)) != nullptr) {
+			if (AIKITDLL::IsCancelled(ctx->cancel)) {
+				ret = E_SESSION_CANCELLED;
+				break;
+			}
+			// 先更新位置再写入：写入过程中回调的唤醒记在这一块的末尾
+			fed += len;
+			evalSession->fedBytes.store(fed);
+			ret = session.Write(frame->Build(data, len));
+			if (ret != 0) {
+				AIKITDLL::LogError("IvwEval: 写入数据失败，错误码: %d，文件: %s", ret, item.path.c_str());
+				break;
+			}
+			ret = evalSession->error.load();
+			if (ret != 0) {
+				break;
+			}
+		}
+		int endRet = session.End();
+		if (ret == 0) {
+			ret = endRet;
+		}
+		return ret;
+	}
+
+	void EvalWorker(void* arg, unsigned int worker) {
+		EvalContext* ctx = (EvalContext*)arg;
+		AIKITDLL::AudioFrame frame("wav", false);
+		if (!frame.Valid()) {
+			AIKITDLL::LogError("IvwEval: 创建数据构建器失败");
+			return;
+		}
+
+		size_t index;
+		while (ctx->queue->Claim(&index)) {
+			const EvalItem& item = (*ctx->items)[index];
+			EvalSession evalSession;
+			unsigned long long t0 = audio_source_now_us();
+			int ret = EvalFile(ctx, item, &frame, &evalSession);
+			if (ret == E_SESSION_CANCELLED) {
+				break;
+			}
+
+			EvalResult& result = (*ctx->results)[index];
+			result.done = true;
+			result.status = ret;
+			result.worker = worker;
+			result.wallUs = (long long)(audio_source_now_us() - t0);
+			result.audioUs = (long long)(evalSession.fedBytes.load() * 1000 / IVW_EVAL_BYTES_PER_MS);
+			std::lock_guard<std::mutex> lock(evalSession.mutex);
+			result.events = evalSession.events;
+		}
+	}
+
+	EvalSession* OwnedSession(const AIKIT_HANDLE* handle) {
+		if (handle == nullptr || handle->usrContext == nullptr || handle->abilityID == nullptr ||
+			strcmp(handle->abilityID, IVW_ABILITY) != 0) {
+			return nullptr;
+		}
+		EvalSession* session = (EvalSession*)handle->usrContext;
+		return session->magic == IVW_EVAL_MAGIC ? session : nullptr;
+	}
+
+	// 最近秩法取分位数，sorted已升序
+	double Percentile(const std::vector<double>& sorted, int percent) {
+		if (sorted.empty()) {
+			return 0;
+		}
+		size_t rank = (sorted.size() * percent + 99) / 100;
+		return sorted[rank > 0 ? rank - 1 : 0];
+	}
+
+	void WriteReport(FILE* output, int threshold, const IvwEvalStats& stats, const std::vector<EvalItem>& items,
+		const std::vector<EvalResult>& results) {
+		fprintf(output, "{\"threshold\":%d,\"workers\":%u,\n\"summary\":{", threshold, stats.workers);
+		fprintf(output, "\"positives\":%llu,\"negatives\":%llu,\"failed\":%llu,\"detected\":%llu,"
+			"\"false_rejects\":%llu,\"frr\":%.6f,\"false_accepts\":%llu,\"negative_hours\":%.6f,\"far_per_hour\":%.4f,",
+			stats.positives, stats.negatives, stats.failed, stats.detected, stats.positives - stats.detected,
+			stats.frr, stats.falseAccepts, stats.negativeHours, stats.farPerHour);
+		fprintf(output, "\"latency_count\":%llu,\"latency_avg_ms\":%.1f,\"latency_p50_ms\":%.1f,"
+			"\"latency_p95_ms\":%.1f,\"latency_max_ms\":%.1f,",
+			stats.latencyCount, stats.latencyAvgMs, stats.latencyP50Ms, stats.latencyP95Ms, stats.latencyMaxMs);
+		fprintf(output, "\"audio_ms\":%lld,\"wall_ms\":%lld,\"rtf\":%.6f,\"audio_per_sec\":%.2f},\n\"files\":[",
+			stats.audioUs / 1000, stats.wallUs / 1000, stats.rtf, stats.audioPerSec);
+
+		std::string line;
+		bool first = true;
+		for (size_t i = 0; i < items.size(); ++i) {
+			const EvalResult& r = results[i];
+			if (!r.done) {
+				continue;
+			}
+			const EvalItem& item = items[i];
+			line = first ? "\n" : ",\n";
+			first = false;
+			line += "{\"index\":";
+			line += std::to_string(i);
+			line += ",\"label\":";
+			line += item.positive ? "\"pos\"" : "\"neg\"";
+			line += ",\"path\":";
+			AIKITDLL::AppendJsonString(line, item.path);
+			line += ",\"status\":";
+			line += std::to_string(r.status);
+			line += ",\"audio_ms\":";
+			line += std::to_string(r.audioUs / 1000);
+			line += ",\"wall_ms\":";
+			line += std::to_string(r.wallUs / 1000);
+			line += ",\"rtf\":";
+			char rtf[32];
+			sprintf_s(rtf, sizeof(rtf), "%.4f", r.audioUs > 0 ? (double)r.wallUs / r.audioUs : 0.0);
+			line += rtf;
+			line += ",\"keyword_end_ms\":";
+			line += item.keywordEndMs >= 0 ? std::to_string(item.keywordEndMs) : "null";
+			line += ",\"latency_ms\":";
+			line += (item.positive && item.keywordEndMs >= 0 && !r.events.empty() && r.status == 0)
+				? std::to_string(r.events[0].audioMs - item.keywordEndMs) : "null";
+			line += ",\"wakes\":[";
+			for (size_t e = 0; e < r.events.size(); ++e) {
+				if (e > 0) {
+					line += ",";
+				}
+				line += "{\"audio_ms\":";
+				line += std::to_string(r.events[e].audioMs);
+				line += ",\"wall_ms\":";
+				line += std::to_string(r.events[e].wallMs);
+				line += "}";
+			}
+			line += "],\"worker\":";
+			line += std::to_string(r.worker);
+			line += "}";
+			fputs(line.c_str(), output);
+		}
+		fputs("\n]}\n", output);
+	}
+}
+
+namespace AIKITDLL {
+
+	bool IvwEvalOwns(const AIKIT_HANDLE* handle) {
+		return OwnedSession(handle) != nullptr;
+	}
+
+	bool IvwEvalOnOutput(AIKIT_HANDLE* handle, const AIKIT_OutputData* output) {
+		EvalSession* session = OwnedSession(handle);
+		if (session == nullptr) {
+			return false;
+		}
+		for (const AIKIT_BaseData* node = output != nullptr ? output->node : nullptr; node != nullptr; node = node->next) {
+			if (node->value != nullptr && strstr((const char*)node->value, "keyword") != nullptr) {
+				WakeEvent event;
+				event.audioMs = (long long)(session->fedBytes.load() / IVW_EVAL_BYTES_PER_MS);
+				event.wallMs = (long long)(audio_source_now_us() - session->startUs) / 1000;
+				std::lock_guard<std::mutex> lock(session->mutex);
+				session->events.push_back(event);
+				break;
+			}
+		}
+		return true;
+	}
+
+	bool IvwEvalOnError(AIKIT_HANDLE* handle, int err) {
+		EvalSession* session = OwnedSession(handle);
+		if (session == nullptr) {
+			return false;
+		}
+		session->error.store(err != 0 ? err : -1);
+		return true;
+	}
+
+	bool IvwEvalActive() {
+		return g_evalActive.load();
+	}
+
+	// 已经独占唤醒会话、加载好唤醒引擎之后的评测过程
+	static int EvalRunExclusive(const char* manifestPath, const char* reportPath, int workers, int threshold,
+		IvwEvalStats* stats, CancelToken* cancel)
+	{
+		std::vector<ManifestLine> lines;
+		if (!LoadManifestLines(manifestPath, lines)) {
+			LogError("IvwEval: 打开清单失败: %s", manifestPath);
+			return -1;
+		}
+		std::vector<EvalItem> items;
+		ParseManifest(lines, items);
+
+		FILE* output = nullptr;
+		if (fopen_s(&output, reportPath, "wb") != 0 || output == nullptr) {
+			LogError("IvwEval: 打开报告文件失败: %s", reportPath);
+			return -1;
+		}
+
+		AIKIT_Callbacks cbs = { OnOutput, OnEvent, OnError };
+		AIKIT::AIKIT_RegisterAbilityCallback(IVW_ABILITY, cbs);
+		AIKIT_BizParam* params = IvwSessionParams(threshold);
+		if (params == nullptr) {
+			LogError("IvwEval: 构建会话参数失败");
+			fclose(output);
+			return -1;
+		}
+
+		workers = ClampBatchWorkers(workers, IVW_EVAL_MAX_WORKERS, items.size());
+		LogInfo("IvwEval: 开始评测 %zu 个文件，阈值 %d，%d 个线程", items.size(), threshold, workers);
+
+		std::vector<EvalResult> results(items.size());
+		for (EvalResult& r : results) {
+			r.done = false;
+			r.status = 0;
+			r.worker = 0;
+			r.audioUs = 0;
+			r.wallUs = 0;
+		}
+		BatchQueue queue(items.size(), cancel);
+		EvalContext ctx;
+		ctx.items = &items;
+		ctx.results = &results;
+		ctx.params = params;
+		ctx.cancel = cancel;
+		ctx.queue = &queue;
+
+		unsigned long long t0 = audio_source_now_us();
+		RunBatchWorkers(workers, EvalWorker, &ctx);
+		long long wallUs = (long long)(audio_source_now_us() - t0);
+
+		// 汇总：失败的文件不计入误拒和误唤醒
+		IvwEvalStats result = {};
+		result.workers = (unsigned int)workers;
+		result.threshold = threshold;
+		result.wallUs = wallUs;
+		long long negativeUs = 0;
+		long long fileWallUs = 0;
+		std::vector<double> latencies;
+		for (size_t i = 0; i < items.size(); ++i) {
+			const EvalResult& r = results[i];
+			if (!r.done) {
+				continue;
+			}
+			if (r.status != 0) {
+				result.failed++;
+				continue;
+			}
+			result.audioUs += r.audioUs;
+			fileWallUs += r.wallUs;
+			if (items[i].positive) {
+				result.positives++;
+				if (!r.events.empty()) {
+					result.detected++;
+					if (items[i].keywordEndMs >= 0) {
+						latencies.push_back((double)(r.events[0].audioMs - items[i].keywordEndMs));
+					}
+				}
+			}
+			else {
+				result.negatives++;
+				result.falseAccepts += r.events.size();
+				negativeUs += r.audioUs;
+			}
+		}
+		result.negativeHours = negativeUs / 3600000000.0;
+		result.frr = result.positives > 0 ? (double)(result.positives - result.detected) / result.positives : 0;
+		result.farPerHour = result.negativeHours > 0 ? result.falseAccepts / result.negativeHours : 0;
+		std::sort(latencies.begin(), latencies.end());
+		result.latencyCount = latencies.size();
+		if (!latencies.empty()) {
+			double sum = 0;
+			for (double v : latencies) {
+				sum += v;
+			}
+			result.latencyAvgMs = sum / latencies.size();
+			result.latencyP50Ms = Percentile(latencies, 50);
+			result.latencyP95Ms = Percentile(latencies, 95);
+			result.latencyMaxMs = latencies.back();
+		}
+		result.rtf = result.audioUs > 0 ? (double)fileWallUs / result.audioUs : 0;
+		result.audioPerSec = wallUs > 0 ? (double)result.audioUs / wallUs : 0;
+
+		WriteReport(output, threshold, result, items, results);
+		fclose(output);
+
+		LogInfo("IvwEval: 阈值 %d: 正样本 %llu（唤醒 %llu，误拒率 %.2f%%），负样本 %.2f 小时（误唤醒 %llu 次，%.2f 次/小时），"
+			"延迟 平均 %.0f ms / P95 %.0f ms，失败 %llu，单路实时率 %.3f，%.1f 倍实时",
+			threshold, result.positives, result.detected, result.frr * 100, result.negativeHours, result.falseAccepts,
+			result.farPerHour, result.latencyAvgMs, result.latencyP95Ms, result.failed, result.rtf, result.audioPerSec);
+		if (stats != nullptr) {
+			*stats = result;
+		}
+		return (int)result.failed;
+	}
+
+	int IvwEvalRun(const char* manifestPath, const char* reportPath, int workers, int threshold,
+		IvwEvalStats* stats, CancelToken* cancel)
+	{
+		if (manifestPath == nullptr || reportPath == nullptr) {
+			return -1;
+		}
+
+		// 语音助手会在启动和退出时重置SDK、卸载唤醒引擎，运行时不评测。
+		// 先标记再检查，与StartVoiceAssistant的顺序相反，两边不会同时错过对方
+		if (g_evalActive.exchange(true)) {
+			LogError("IvwEval: 已有一次评测在运行");
+			return -1;
+		}
+		if (VoiceStateManager::GetInstance()->IsActive()) {
+			g_evalActive.store(false);
+			LogError("IvwEval: 语音助手正在运行，请先停止再评测");
+			return -1;
+		}
+
+		// 占用唤醒会话，评测期间ivw_microphone、ivw_file不会开始新会话。
+		// 先加载引擎再占用：加载在g_ivwMutex内完成，期间也不会有别的会话开始。
+		// 引擎在评测期间保持加载；原来没有加载的，评测结束后按常驻模式的设置释放
+		bool busy;
+		bool wasLoaded = false;
+		int ret = 0;
+		{
+			std::lock_guard<std::mutex> lock(g_ivwMutex);
+			busy = g_ivwSessionActive.load();
+			if (!busy) {
+				wasLoaded = ivwEngineLoaded.load();
+				ret = IvwEngineAcquire();
+				if (ret == 0) {
+					g_ivwSessionActive.store(true);
+				}
+			}
+		}
+		if (busy) {
+			g_evalActive.store(false);
+			LogError("IvwEval: 已有一个活动的唤醒会话，无法评测");
+			return -1;
+		}
+		if (ret != 0) {
+			g_evalActive.store(false);
+			LogError("IvwEval: 唤醒引擎不可用，错误码: %d", ret);
+			return -1;
+		}
+
+		ret = EvalRunExclusive(manifestPath, reportPath, workers, threshold, stats, cancel);
+
+		if (!wasLoaded) {
+			IvwEngineRelease();
+		}
+		// 先清除评测标记再结束会话：看到会话已结束的线程不会再看到评测仍在运行
+		g_evalActive.store(false);
+		EndIvwSession();
+		return ret;
+	}
+}
+
+// 导出函数实现
+int RunIvwEval(const char* manifestPath, const char* reportPath, int workers, int threshold, IvwEvalStats* stats)
+{
+	return AIKITDLL::IvwEvalRun(manifestPath, reportPath, workers, threshold, stats, nullptr);
+}
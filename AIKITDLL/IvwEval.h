@@ -0,0 +1,74 @@
+#pragma once
+#include "aikit_biz_api.h"
+
+// 一次唤醒词评测的统计
+struct IvwEvalStats {
+	unsigned int workers;            // 工作线程数
+	int threshold;                   // 唤醒阈值（wdec_param_nCmThreshold）
+	unsigned long long positives;    // 评测完成的正样本数
+	unsigned long long negatives;    // 评测完成的负样本数
+	unsigned long long failed;       // 打不开或会话失败的文件数（不计入下面的指标）
+	unsigned long long detected;     // 至少唤醒一次的正样本数
+	unsigned long long falseAccepts; // 负样本中的唤醒次数
+	double negativeHours;            // 负样本的总时长（小时）
+	double frr;                      // 误拒率：没有唤醒的正样本所占比例
+	double farPerHour;               // 每小时误唤醒次数
+	unsigned long long latencyCount; // 标注了唤醒词结束时间、并且唤醒了的正样本数
+	double latencyAvgMs;             // 唤醒时刻相对唤醒词结束的平均延迟（音频时间，毫秒）
+	double latencyP50Ms;
+	double latencyP95Ms;
+	double latencyMaxMs;
+	long long audioUs;               // 评测完成的音频总时长（微秒）
+	long long wallUs;                // 整次评测耗时（微秒）
+	double rtf;                      // 单路实时率：各文件处理耗时之和 / 音频时长之和
+	double audioPerSec;              // 每秒处理的音频秒数（整次评测的实时倍数）
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 唤醒词评测：manifestPath每行一个样本，格式为“标注 路径 [唤醒词结束毫秒]”，
+	// 标注为pos/1（包含唤醒词）或neg/0（不包含），空行和#开头的行忽略；音频可以是WAV或16k/16bit单声道PCM。
+	// 用workers个线程并行评测，每个文件各自开始唤醒会话，不等待地送完整个文件，记录每次唤醒的音频时刻。
+	// 结束后把报告写到reportPath（JSON）：{"threshold":..,"workers":..,"summary":{..},"files":[..]}，
+	// 指标含义见IvwEvalStats，files按清单顺序，每个文件列出所有唤醒事件。
+	// 评测期间唤醒引擎保持加载，不要调用Ivw70Uninit；语音助手运行时或已有唤醒会话时不评测，
+	// 评测期间语音助手也无法启动。stats可为NULL。
+	// 清单或报告文件无法打开、引擎不可用、语音助手在运行时返回-1，否则返回失败的文件数
+	AIKITDLL_API int RunIvwEval(const char* manifestPath, const char* reportPath, int workers, int threshold, IvwEvalStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+// 评测的最大线程数
+#define IVW_EVAL_MAX_WORKERS 64
+
+namespace AIKITDLL {
+	class CancelToken;
+
+	// RunIvwEval的可取消版本：取消后各线程结束手上的文件，不再领取新文件，报告只包含已完成的文件
+	int IvwEvalRun(const char* manifestPath, const char* reportPath, int workers, int threshold,
+		IvwEvalStats* stats, CancelToken* cancel);
+
+	// 由AIKIT回调调用：句柄属于评测会话时把结果记到该会话并返回true，不改变全局唤醒状态；
+	// 不属于评测会话时返回false，由调用方照常处理
+	bool IvwEvalOnOutput(AIKIT_HANDLE* handle, const AIKIT_OutputData* output);
+	bool IvwEvalOnError(AIKIT_HANDLE* handle, int err);
+	bool IvwEvalOwns(const AIKIT_HANDLE* handle);
+
+	// 是否有唤醒词评测在运行，语音助手据此拒绝启动
+	bool IvwEvalActive();
+}
@@ -2,6 +2,9 @@
 #include "IvwResourceManager.h"
 #include "Common.h"
 #include "IvwWrapper.h"
+#include "Teardown.h"
+#include "CancelToken.h"
+#include "audiosrc.h"
 
 namespace AIKITDLL {
     // 全局互斥量实现
@@ -14,6 +17,21 @@ namespace AIKITDLL {
     std::condition_variable g_wakeupCond;
     std::mutex g_wakeupMutex;
     
+    // 唤醒会话结束的通知
+    static std::condition_variable g_ivwSessionCond;
+    static std::mutex g_ivwSessionMutex;
+    
+    // 取消令牌的通知：在条件变量的互斥量下唤醒，不会漏掉正在进入等待的线程
+    static void WakeSessionWaiters(void*) {
+        std::lock_guard<std::mutex> lock(g_ivwSessionMutex);
+        g_ivwSessionCond.notify_all();
+    }
+    
+    static void WakeWakeupWaiters(void*) {
+        std::lock_guard<std::mutex> lock(g_wakeupMutex);
+        g_wakeupCond.notify_all();
+    }
+    
     // 初始化IVW互斥资源
     void InitIvwResources() {
         // 标记会话为非活动状态
@@ -23,7 +41,39 @@ namespace AIKITDLL {
     // 释放IVW互斥资源
     void CleanupIvwResources() {
         // 标记会话为非活动状态
-        g_ivwSessionActive.store(false);
+        EndIvwSession();
+    }
+    
+    void EndIvwSession() {
+        {
+            std::lock_guard<std::mutex> lock(g_ivwSessionMutex);
+            g_ivwSessionActive.store(false);
+        }
+        g_ivwSessionCond.notify_all();
+    }
+    
+    bool WaitIvwSessionEnded(int timeoutMs, CancelToken* cancel) {
+        if (!g_ivwSessionActive.load()) {
+            return true;
+        }
+        unsigned long long begin = audio_source_now_us();
+        bool ended;
+        {
+            CancelListener listener(cancel, WakeSessionWaiters, nullptr);
+            std::unique_lock<std::mutex> lock(g_ivwSessionMutex);
+            g_ivwSessionCond.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                [cancel] { return !g_ivwSessionActive.load() || IsCancelled(cancel); });
+            ended = !g_ivwSessionActive.load();
+        }
+        if (!ended && IsCancelled(cancel)) {
+            LogInfo("WaitIvwSessionEnded: 等待已取消");
+            return false;
+        }
+        Teardown::Instance().Record(TEARDOWN_IVW_SESSION, begin, ended);
+        if (!ended) {
+            LogWarning("WaitIvwSessionEnded: 等待 %d ms 后唤醒会话仍未结束", timeoutMs);
+        }
+        return ended;
     }
     
     // 通知唤醒事件发生
@@ -43,7 +93,7 @@ namespace AIKITDLL {
         wakeupFlag = 0;
         wakeupDetected = false;
         lastEventType = EVENT_NONE;
-        g_ivwSessionActive.store(false);
+        EndIvwSession();
         
         // 重置外部数据
         lastResult = "";
@@ -54,7 +104,9 @@ namespace AIKITDLL {
     }
     
     // 等待唤醒事件，带超时
-    bool WaitForWakeup(int timeoutMs) {
+    bool WaitForWakeup(int timeoutMs, CancelToken* cancel) {
+        // 监听者要在持有g_wakeupMutex之前登记，析构时已经释放
+        CancelListener listener(cancel, WakeWakeupWaiters, nullptr);
         std::unique_lock<std::mutex> lock(g_wakeupMutex);
         LogInfo("WaitForWakeup: 开始等待唤醒事件，超时时间: %d ms", timeoutMs);
         
@@ -82,22 +134,23 @@ namespace AIKITDLL {
         bool result = false;
         if (timeoutMs > 0) {
             result = g_wakeupCond.wait_for(lock, std::chrono::milliseconds(timeoutMs), 
-                []{ 
+                [cancel]{ 
                     // 条件变量等待期间再次检查状态
                     if (wakeupFlag.load() == 1 || GetWakeupStatus() == 1 || lastEventType == EVENT_WAKEUP_SUCCESS) {
                         wakeupFlag.store(1);
                         return true;
                     }
-                    return false;
+                    return IsCancelled(cancel);
                 });
+            result = (wakeupFlag.load() == 1);
         } else {
-            g_wakeupCond.wait(lock, []{ 
+            g_wakeupCond.wait(lock, [cancel]{ 
                 // 条件变量等待期间再次检查状态
                 if (wakeupFlag == 1 || GetWakeupStatus() == 1 || lastEventType == EVENT_WAKEUP_SUCCESS) {
                     wakeupFlag = 1;
                     return true;
                 }
-                return false;
+                return IsCancelled(cancel);
             });
             result = (wakeupFlag == 1);
         }
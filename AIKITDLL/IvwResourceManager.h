@@ -4,6 +4,8 @@
 #include <condition_variable>
 
 namespace AIKITDLL {
+    class CancelToken;
+    
     // 全局互斥量，用于保护IVW会话创建和资源管理
     extern std::mutex g_ivwMutex;
     
@@ -20,9 +22,16 @@ namespace AIKITDLL {
     // 释放IVW互斥资源
     void CleanupIvwResources();
     
+    // 标记唤醒会话结束并通知等待者，代替直接清除g_ivwSessionActive
+    void EndIvwSession();
+    
+    // 等待当前唤醒会话结束，带超时；没有活动会话时立即返回true。
+    // cancel被取消时立即返回false
+    bool WaitIvwSessionEnded(int timeoutMs, CancelToken* cancel = nullptr);
+    
     // 通知唤醒事件发生
     void NotifyWakeupDetected();
     
-    // 等待唤醒事件，带超时
-    bool WaitForWakeup(int timeoutMs);
+    // 等待唤醒事件，带超时；cancel被取消时立即返回false
+    bool WaitForWakeup(int timeoutMs, CancelToken* cancel = nullptr);
 }
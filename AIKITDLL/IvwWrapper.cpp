@@ -2,16 +2,82 @@
 #include "IvwWrapper.h"
 #include "IvwResourceManager.h"
 #include "SdkHelper.h"
+#include "vad.h"
+#include "BuilderCache.h"
+#include "Teardown.h"
+#include "TimerService.h"
+#include "CancelToken.h"
+#include "AikitSession.h"
+#include "AudioDecoder.h"
 #include <atomic>
 #include <aikit_constant.h>
+
+// 每次写入引擎的最大数据量：20帧（200ms），与最大录音周期一致
+#define IVW_CHUNK_LEN     (20 * FRAME_LEN)
 namespace AIKITDLL {
 	std::atomic<int> wakeupFlag(0);
+	std::atomic<bool> ivwStopRequested(false);
+	std::atomic<int> ivwListenTimeoutMs(10000);
+	std::atomic<bool> ivwResidentEngine(true);
+	std::atomic<bool> ivwEngineLoaded(false);
+
+	// 写入唤醒引擎所需的上下文
+	struct IvwWriteContext {
+		AikitSession* session;
+		AudioFrame* frame;           // 复用的音频帧
+		CaptureConsumer* consumer;   // 用于记录唤醒词结束位置，可为NULL
+		bool wakeMarked;             // 本次会话是否已记录唤醒位置
+	};
+
+	// 唤醒后把已送入引擎的音频末尾作为唤醒词结束位置交给CaptureHub，命令词识别从这里开始回放
+	static void ivw_mark_wake_end(IvwWriteContext* ctx, unsigned int pendingLen)
+	{
+		if (ctx->consumer == nullptr || ctx->wakeMarked || wakeupFlag.load() != 1) {
+			return;
+		}
+		ctx->wakeMarked = true;
+		CaptureHub::Instance().MarkWakeEnd(ctx->consumer->Position() + pendingLen);
+	}
 
-	int ivw_microphone(const char* abilityID, int threshold, int timeoutMs)
+	// 把一块音频写入唤醒引擎
+	static int ivw_write_chunk(const char* data, unsigned int len, void* user_para)
+	{
+		IvwWriteContext* ctx = (IvwWriteContext*)user_para;
+		if (ctx == nullptr || ctx->session == nullptr || !ctx->session->Active()) {
+			return -1;
+		}
+		AIKIT_InputData* input = ctx->frame->Build(data, len);
+		if (input == nullptr) {
+			return -1;
+		}
+		int ret = ctx->session->Write(input);
+		// 唤醒结果在写入过程中回调；这块音频仍处于租借中，读位置还停在它的开头
+		ivw_mark_wake_end(ctx, len);
+		return ret;
+	}
+
+	// 会话状态错误后重试之前的恢复：调用方已持有g_ivwMutex，不能调用Ivw70Uninit；
+	// 卸载后等正在执行的回调返回再重新加载。会话仍在进行，只重新加载引擎，不能用Ivw70Init重置会话状态
+	static int ivw_recover_session(int err, void* arg)
+	{
+		(void)arg;
+		AIKITDLL::LogWarning("检测到会话状态错误(%d)，重新加载唤醒引擎后重试", err);
+		IvwEngineUnload();
+		Teardown::Instance().WaitCallbacksIdle(TEARDOWN_CALLBACK_TIMEOUT_MS);
+		return IvwEngineLoad();
+	}
+
+	int ivw_microphone(const char* abilityID, int threshold, int timeoutMs, CancelToken* cancel,
+		IvwListeningFn onListening, void* arg)
 	{
 		// 使用互斥锁保护，确保同一时刻只有一个线程能运行此函数
 		std::lock_guard<std::mutex> lock(g_ivwMutex);
 		
+		if (IsCancelled(cancel)) {
+			lastResult = "唤醒监听已取消";
+			return E_SESSION_CANCELLED;
+		}
+
 		// 检查是否已有活动会话
 		if (g_ivwSessionActive.load()) {
 			AIKITDLL::LogError("ivw_microphone: 已有一个活动的唤醒会话，无法启动新会话");
@@ -21,260 +87,228 @@ namespace AIKITDLL {
 		
 		// 标记会话为活动状态
 		g_ivwSessionActive.store(true);
+		ivwStopRequested.store(false);
 
 		int ret = 0;
-		AIKIT::AIKIT_DataBuilder* dataBuilder = nullptr;
-		AIKIT_HANDLE* handle = nullptr;
-		AIKIT::AiAudio* aiAudio_raw = nullptr;
-		DWORD bufsize;
-
-		HWAVEIN hWaveIn = nullptr;  // 输入设备
-		WAVEFORMATEX waveform;      // 采集音频的格式，结构体
-		BYTE* pBuffer = nullptr;    // 采集音频时的数据缓存
-		WAVEHDR wHdr;               // 采集音频时包含数据缓存的结构体
-		HANDLE wait = nullptr;
+		AIKIT_BizParam* builtParam = nullptr;  // 按阈值缓存的会话参数
+		AudioFrame* frame = nullptr;
+		AikitSession session(abilityID);      // 退出时保证结束一次会话
+
+		CaptureHub& hub = CaptureHub::Instance();
+		CaptureConsumer* consumer = nullptr;  // 共享采集流上的读者，设备由CaptureHub统一持有
+		HANDLE dataEvent = NULL;              // 有新数据时由采集线程置位
+		unsigned int chunkLen = IVW_CHUNK_LEN;  // 每次写入引擎的数据量，跟随录音周期
+		IvwWriteContext writer = { nullptr, nullptr, nullptr, false };
+		struct vad_gate* gate = nullptr;      // 静音门限，关闭时为NULL
+		unsigned long long audio_count = 0;
+		int count = 0;
+		Deadline listenDeadline;              // 监听超时，到期时唤醒送数循环
+		HANDLE waits[2] = { NULL, NULL };     // 新数据事件和取消事件
+		DWORD waitCount = 1;
 
 		AIKITDLL::LogInfo("ivw_microphone: 开始麦克风唤醒流程");
 
-		// 设置音频格式
-		waveform.wFormatTag = WAVE_FORMAT_PCM;      // 声音格式为PCM
-		waveform.nSamplesPerSec = 16000;            // 音频采样率
-		waveform.wBitsPerSample = 16;               // 采样比特
-		waveform.nChannels = 1;                     // 采样声道数
-		waveform.nAvgBytesPerSec = 16000 * 2;       // 每秒的数据率
-		waveform.nBlockAlign = 2;                   // 一个块的大小，采样bit的字节数乘以声道数
-		waveform.cbSize = 0;                        // 一般为0
-
-		AIKITDLL::LogInfo("ivw_microphone: 设置音频格式完成");
+		dataEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (!dataEvent) {
+			AIKITDLL::LogError("ivw_microphone: 创建事件失败");
+			lastResult = "创建事件失败";
+			ret = -1;
+			goto exit;
+		}
 
-		// 创建事件并打开音频设备
-		wait = CreateEvent(NULL, 0, 0, NULL);
-		if (waveInOpen(&hWaveIn, WAVE_MAPPER, &waveform, (DWORD_PTR)wait, 0L, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+		// 订阅共享采集流：设备已打开时直接复用，不再重新打开
+		consumer = hub.Subscribe(dataEvent);
+		if (!consumer) {
 			AIKITDLL::LogError("ivw_microphone: 打开音频设备失败");
 			lastResult = "打开音频设备失败";
-			return -1;
+			ret = -1;
+			goto exit;
 		}
-		AIKITDLL::LogInfo("ivw_microphone: 打开音频设备成功");
 
-		// 创建参数构建器
-		AIKIT::AIKIT_ParamBuilder* paramBuilder = AIKIT::AIKIT_ParamBuilder::create();
-		if (!paramBuilder) {
-			AIKITDLL::LogError("ivw_microphone: 创建参数构建器失败");
-			lastResult = "创建参数构建器失败";
-			return -1;
+		// 每个录音周期写一次引擎，周期越短唤醒响应越快
+		chunkLen = hub.PeriodBytes();
+		if (chunkLen == 0 || chunkLen > IVW_CHUNK_LEN) {
+			chunkLen = IVW_CHUNK_LEN;
 		}
-		AIKITDLL::LogInfo("ivw_microphone: 参数构建器创建成功");
+		AIKITDLL::LogInfo("ivw_microphone: 已订阅共享采集流，每次写入 %u 字节", chunkLen);
 
-		// 设置参数
-		std::string thresholdParam = "0 0:" + std::to_string(threshold);
-		paramBuilder->param("wdec_param_nCmThreshold", thresholdParam.c_str(), thresholdParam.length());
-		paramBuilder->param("gramLoad", true);
-		AIKITDLL::LogInfo("ivw_microphone: 已设置唤醒阈值: %s", thresholdParam.c_str());
+		// 安静时不把静音送入引擎，语音开始时补上之前的一小段音频
+		if (hub.VadEnabled()) {
+			gate = vad_gate_create(16000, VAD_DEFAULT_PREROLL_MS, VAD_DEFAULT_HANGOVER_MS);
+			if (!gate) {
+				AIKITDLL::LogWarning("ivw_microphone: 创建静音门限失败，全部音频送入引擎");
+			}
+		}
+
+		// 取缓存的会话参数，同一阈值只构建一次
+		builtParam = IvwSessionParams(threshold);
+		if (!builtParam) {
+			AIKITDLL::LogError("ivw_microphone: 参数构建结果无效");
+			lastResult = "参数构建结果无效";
+			ret = -1;
+			goto exit;
+		}
+		AIKITDLL::LogInfo("ivw_microphone: 唤醒阈值: %d", threshold);
 
 		// 确保引擎 DLL 已加载
 		if (!AIKITDLL::EnsureEngineDllsLoaded()) {
 			AIKITDLL::LogError("ivw_microphone: 引擎动态库加载失败");
 			lastResult = "引擎动态库加载失败";
-			delete paramBuilder;
-			if (hWaveIn) waveInClose(hWaveIn);
-			if (wait) CloseHandle(wait);
-			return -1;
+			ret = -1;
+			goto exit;
 		}
 		AIKITDLL::LogInfo("ivw_microphone: 引擎动态库加载检查通过");
 
+		// 检查参数和SDK状态
+		if (!abilityID) {
+			AIKITDLL::LogError("ivw_microphone: abilityID参数无效");
+			lastResult = "abilityID参数无效";
+			ret = -1;
+			goto exit;
+		}
+
+		if (!AIKITDLL::isInitialized) {
+			AIKITDLL::LogError("ivw_microphone: SDK尚未初始化，先尝试初始化");
+			if (!SafeInitSDK()) {
+				AIKITDLL::LogError("ivw_microphone: SDK初始化失败");
+				lastResult = "SDK初始化失败";
+				ret = -1;
+				goto exit;
+			}
+		}
+
 		// 启动能力
 		AIKITDLL::LogInfo("ivw_microphone: 正在启动能力...");
-		
-		// 检查构建结果
-		auto builtParam = AIKIT::AIKIT_Builder::build(paramBuilder);
-		if (!builtParam) {
-			AIKITDLL::LogError("ivw_microphone: 参数构建结果无效");
-			lastResult = "参数构建结果无效";
-			delete paramBuilder;
-			if (hWaveIn) waveInClose(hWaveIn);
-			if (wait) CloseHandle(wait);
-			return -1;
-		}		
-		
-	// 尝试启动能力
-	AIKITDLL::LogInfo("ivw_microphone: 正在启动能力...");
-	
-	// 检查参数和SDK状态
-	if (!abilityID) {
-		AIKITDLL::LogError("ivw_microphone: abilityID参数无效");
-		lastResult = "abilityID参数无效";
-		delete paramBuilder;
-		if (hWaveIn) waveInClose(hWaveIn);
-		if (wait) CloseHandle(wait);
-		return -1;
-	}
-	
-	// 先检查SDK状态
-	if (!AIKITDLL::isInitialized) {
-		AIKITDLL::LogError("ivw_microphone: SDK尚未初始化，先尝试初始化");
-		if (!SafeInitSDK()) {
-			AIKITDLL::LogError("ivw_microphone: SDK初始化失败");
-			lastResult = "SDK初始化失败";
-			delete paramBuilder;
-			if (hWaveIn) waveInClose(hWaveIn);
-			if (wait) CloseHandle(wait);
-			return -1;
+		// 会话状态错误时按重试策略重新加载引擎后再启动
+		ret = session.Start(builtParam, ivw_recover_session, nullptr);
+		if (ret != 0) {
+			AIKITDLL::LogError("ivw_microphone: 启动能力失败，错误码: %d", ret);
+			lastResult = "启动能力失败: " + std::to_string(ret);
+			goto exit;
 		}
-	}
 
-	// 尝试启动，如果失败且是由于会话问题，则尝试清理后重新启动
-	ret = AIKIT::AIKIT_Start(abilityID, builtParam, nullptr, &handle);
-	if (ret == 18310 || ret == 18301) { // 会话已存在或授权状态错误
-		AIKITDLL::LogWarning("ivw_microphone: 检测到会话状态错误，尝试清理并重启...");
-		// 强制清理所有相关资源
-		if (AIKIT::AIKIT_End(handle) == 0) {
-			AIKITDLL::LogInfo("ivw_microphone: 成功终止现有会话");
-		}
-		Ivw70Uninit(); // 完全清理
-		Sleep(100);    // 等待资源释放
-		Ivw70Init();   // 重新初始化
-		
-		// 重新尝试启动
-		AIKITDLL::LogInfo("ivw_microphone: 重新尝试启动能力...");
-		ret = AIKIT::AIKIT_Start(abilityID, builtParam, nullptr, &handle);
-	}
-	
-	if (ret != 0) {
-		AIKITDLL::LogError("ivw_microphone: 启动能力失败，错误码: %d", ret);
-		lastResult = "启动能力失败: " + std::to_string(ret);
-		delete paramBuilder;
-		if (hWaveIn) waveInClose(hWaveIn);
-		if (wait) CloseHandle(wait);
-		return ret;
-	}
-		
 		// 检查handle是否有效再记录日志
-		if (handle) {
-			AIKITDLL::LogInfo("ivw_microphone: 能力启动成功，句柄: %p", handle);
+		if (session.Handle()) {
+			AIKITDLL::LogInfo("ivw_microphone: 能力启动成功，句柄: %p", session.Handle());
 		} else {
 			AIKITDLL::LogWarning("ivw_microphone: 能力启动成功，但句柄为空");
 		}
 
-		// 分配音频缓冲区
-		bufsize = 1024 * 500; // 开辟适当大小的内存存储音频数据
-		pBuffer = (BYTE*)malloc(bufsize);
-		if (!pBuffer) {
-			AIKITDLL::LogError("ivw_microphone: 内存分配失败");
-			lastResult = "内存分配失败";
-			delete paramBuilder;
-			if (handle) AIKIT::AIKIT_End(handle);
-			if (hWaveIn) waveInClose(hWaveIn);
-			if (wait) CloseHandle(wait);
-			return -1;
+		// 从池里取数据构建器，送数循环里复用同一帧
+		frame = new AudioFrame("wav", false);
+		if (!frame->Valid()) {
+			AIKITDLL::LogError("ivw_microphone: 创建数据构建器失败");
+			ret = -1;
+			goto exit;
 		}
-		AIKITDLL::LogInfo("ivw_microphone: 分配音频缓冲区成功，大小: %lu", bufsize);
-
-		// 设置录音缓冲区
-		wHdr.lpData = (LPSTR)pBuffer;
-		wHdr.dwBufferLength = bufsize;
-		wHdr.dwBytesRecorded = 0;
-		wHdr.dwUser = 0;
-		wHdr.dwFlags = 0;
-		wHdr.dwLoops = 1;
-		waveInPrepareHeader(hWaveIn, &wHdr, sizeof(WAVEHDR));
-		waveInAddBuffer(hWaveIn, &wHdr, sizeof(WAVEHDR));
-		waveInStart(hWaveIn); // 开始录音
-				AIKITDLL::LogInfo("ivw_microphone: 开始录音");
+		writer.session = &session;
+		writer.frame = frame;
+		writer.consumer = consumer;
 
 		// 重置唤醒标志
 		wakeupFlag.store(0);
 		AIKITDLL::LogInfo("ivw_microphone: 已重置唤醒标志");
 
-		// 创建数据构建器
-		dataBuilder = AIKIT::AIKIT_DataBuilder::create();
-		if (!dataBuilder) {
-			AIKITDLL::LogError("ivw_microphone: 创建数据构建器失败");
-			free(pBuffer);
-			delete paramBuilder;
-			if (handle) AIKIT::AIKIT_End(handle);
-			if (hWaveIn) {
-				waveInStop(hWaveIn);
-				waveInClose(hWaveIn);
-			}
-			if (wait) CloseHandle(wait);
-			return -1;
+		// 从最新的音频开始送数，订阅期间积压的数据不再送入引擎
+		consumer->SeekToLive();
+		AIKITDLL::LogInfo("ivw_microphone: 开始送数");
+		// 从这里开始可以被唤醒
+		if (onListening) {
+			onListening(arg);
 		}
-		AIKITDLL::LogInfo("ivw_microphone: 数据构建器创建成功");
 
-		int len = 0;
-		int audio_count = 0;
-		int count = 0;		DWORD startTime = GetTickCount();
-		AIKIT_DataStatus status = AIKIT_DataBegin;
-		AIKITDLL::LogInfo("ivw_microphone: 进入音频数据处理循环，超时时间: %d ms", timeoutMs);
-		// 循环处理音频数据直到唤醒或超时
-		while (audio_count < bufsize && wakeupFlag.load() != 1)
+		if (timeoutMs > 0) {
+			listenDeadline.Start((unsigned int)timeoutMs, dataEvent);
+		}
+		AIKITDLL::LogInfo("ivw_microphone: 进入音频数据处理循环，超时时间: %d ms%s",
+			timeoutMs, timeoutMs > 0 ? "" : "（持续监听）");
+		// 循环处理音频数据直到唤醒、超时、被要求停止或被取消
+		waits[0] = dataEvent;
+		if (cancel && cancel->Event()) {
+			waits[waitCount++] = cancel->Event();
+		}
+		while (wakeupFlag.load() != 1 && !ivwStopRequested.load() && !IsCancelled(cancel))
 		{
 			// 检查是否超时
-			if (timeoutMs > 0 && (GetTickCount() - startTime) > (DWORD)timeoutMs) {
+			if (listenDeadline.Expired()) {
 				AIKITDLL::LogError("ivw_microphone: 等待唤醒超时");
 				lastResult = "等待唤醒超时";
 				break;
 			}
 
-			// 方法1：使用条件变量等待唤醒事件
-			if (WaitForWakeup(100)) {
-				AIKITDLL::LogInfo("ivw_microphone: 收到唤醒通知，退出录音循环");
+			// 等待录音线程送来新数据，取消时立即返回
+			if (WaitForMultipleObjects(waitCount, waits, FALSE, 100) == WAIT_OBJECT_0 + 1) {
 				break;
 			}
-			
-			// 方法2：主动检查唤醒状态
+
+			// 主动检查唤醒状态
 			if (GetWakeupStatus() == 1) {
 				AIKITDLL::LogInfo("ivw_microphone: 主动检测到唤醒状态，退出录音循环");
 				break;
 			}
-			
-			len = 10 * FRAME_LEN; // 16k音频，10帧 （时长200ms）
-
-			if (audio_count >= wHdr.dwBytesRecorded) {
-				len = 0;
-				status = AIKIT_DataEnd;
-			}			dataBuilder->clear();
-			aiAudio_raw = AIKIT::AiAudio::get("wav")->data((const char*)&pBuffer[audio_count], len)->valid();
-			dataBuilder->payload(aiAudio_raw);
-			
-			// 检查handle是否有效
-			if (!handle) {
+
+			// 检查会话是否有效
+			if (!session.Active()) {
 				AIKITDLL::LogError("ivw_microphone: 写入数据失败：句柄无效");
 				lastResult = "写入数据失败: 句柄无效";
 				break;
 			}
-			
-			ret = AIKIT::AIKIT_Write(handle, AIKIT::AIKIT_Builder::build(dataBuilder));
+
+			unsigned int written = 0;
+			ret = PumpCapture(consumer, chunkLen, gate, ivw_write_chunk, &writer, &written);
 			if (ret != 0) {
 				AIKITDLL::LogError("ivw_microphone: 写入数据失败，错误码: %d", ret);
 				lastResult = "写入数据失败: " + std::to_string(ret);
 				break;
 			}
+			if (written == 0) {
+				continue;
+			}
 
-			status = AIKIT_DataContinue;
-			audio_count += len;
+			audio_count += written;
 			count++;
 
-			if (count % 10 == 0) {
-				AIKITDLL::LogInfo("ivw_microphone: 已处理 %d 个音频块, 当前累计字节: %d", count, audio_count);
+			if (count % 50 == 0) {
+				AIKITDLL::LogInfo("ivw_microphone: 已处理 %d 批音频, 当前累计字节: %llu, 缓冲区积压: %u",
+					count, audio_count, consumer->Available());
 			}
 		}
 
 		AIKITDLL::LogInfo("ivw_microphone: 音频处理循环结束，开始清理资源");
+		// 唤醒回调晚于写入返回时，在这里补记唤醒位置
+		ivw_mark_wake_end(&writer, 0);
+
+	exit:
+		// 清理资源；先取消期限，之后不会再触发即将关闭的dataEvent
+		listenDeadline.Cancel();
+		if (consumer) {
+			CaptureConsumerStats stats;
+			consumer->GetStats(&stats);
+			if (stats.laps > 0) {
+				AIKITDLL::LogWarning("ivw_microphone: 送数落后于采集 %llu 次，丢弃 %llu 字节", stats.laps, stats.lostBytes);
+			}
+			if (stats.blockedBytes > 0) {
+				AIKITDLL::LogWarning("ivw_microphone: 写入引擎太慢，录音端为保护租借中的数据丢弃 %llu 字节", stats.blockedBytes);
+			}
+			if (gate) {
+				struct vad_gate_stats vs;
+				vad_gate_get_stats(gate, &vs);
+				AIKITDLL::LogInfo("ivw_microphone: 静音门限跳过 %.1f%% 的音频（%llu/%llu 采样），开启 %u 次",
+					vs.samples ? 100.0 * (vs.withheld - vs.replayed) / vs.samples : 0.0,
+					vs.withheld - vs.replayed, vs.samples, vs.opens);
+			}
+			// 只取消订阅，设备是否关闭由CaptureHub按引用计数决定
+			hub.Unsubscribe(consumer);
+			consumer = nullptr;
+		}
+		session.End();
+		if (frame) delete frame;
+		if (dataEvent) CloseHandle(dataEvent);
+		if (gate) vad_gate_destroy(gate);
 
-		// 清理资源
-		if (handle) AIKIT::AIKIT_End(handle);
-		if (hWaveIn) {
-			waveInStop(hWaveIn);
-			waveInReset(hWaveIn);
-			waveInClose(hWaveIn);
-		}
-		if (wait) CloseHandle(wait);
-		if (pBuffer) free(pBuffer);
-		if (dataBuilder) delete dataBuilder;
-		if (paramBuilder) delete paramBuilder;		// 标记会话为非活动状态，无论成功或失败
-		g_ivwSessionActive.store(false);
-				// 最后一次检查唤醒状态
+		// 标记会话为非活动状态，无论成功或失败
+		EndIvwSession();
+		// 最后一次检查唤醒状态
 		if (wakeupFlag.load() != 1) {
 			// 此时可能已经收到唤醒回调，但我们错过了，再次通过GetWakeupStatus主动检查
 			if (GetWakeupStatus() == 1) {
@@ -288,14 +322,55 @@ namespace AIKITDLL {
 			lastResult = "唤醒成功";
 			return 0;
 		}
+		else if (ret == 0 && IsCancelled(cancel)) {
+			AIKITDLL::LogInfo("ivw_microphone: 唤醒监听已取消");
+			lastResult = "唤醒监听已取消";
+			return E_SESSION_CANCELLED;
+		}
 		else {
-			if (ret == 0) lastResult = "未检测到唤醒";
+			if (ret == 0) lastResult = ivwStopRequested.load() ? "唤醒监听已停止" : "未检测到唤醒";
 			AIKITDLL::LogError("ivw_microphone: 唤醒失败，未检测到唤醒词，错误码: %d", ret);
-			return -1;
+			return ret != 0 ? ret : -1;
+		}
+	}
+
+	int IvwEngineAcquire()
+	{
+		if (ivwEngineLoaded.load()) {
+			return 0;
+		}
+		// 调用方可能已经占用了唤醒会话（如评测），只加载引擎，不重置会话状态
+		return IvwEngineLoad();
+	}
+
+	void IvwEngineUnload()
+	{
+		// 尝试卸载资源，忽略潜在错误
+		int ret = AIKIT::AIKIT_UnLoadData(IVW_ABILITY, "key_word", 0);
+		if (ret != 0) {
+			LogWarning("IvwEngineUnload: 卸载资源异常，错误码: %d，继续清理", ret);
+		}
+
+		// 反初始化引擎，忽略潜在错误
+		ret = AIKIT::AIKIT_EngineUnInit(IVW_ABILITY);
+		if (ret != 0) {
+			LogWarning("IvwEngineUnload: 引擎反初始化异常，错误码: %d", ret);
 		}
+		ivwEngineLoaded.store(false);
 	}
 
-	int ivw_file(const char* abilityID, const char* audioFilePath, int threshold)
+	void IvwEngineRelease()
+	{
+		if (!ivwResidentEngine.load()) {
+			Ivw70Uninit();
+			return;
+		}
+		// 引擎和唤醒词资源保持加载，会话已在ivw_microphone退出时结束
+		ResetWakeupStatus();
+		LogInfo("IvwEngineRelease: 常驻模式，保留唤醒引擎和资源");
+	}
+
+	int ivw_file(const char* abilityID, const char* audioFilePath, int threshold, CancelToken* cancel)
 	{
 		// 使用互斥锁保护，确保同一时刻只有一个线程能运行此函数
 		std::lock_guard<std::mutex> lock(g_ivwMutex);
@@ -311,13 +386,12 @@ namespace AIKITDLL {
 		g_ivwSessionActive.store(true);
 
 		int ret = 0;
-		AIKIT::AIKIT_DataBuilder* dataBuilder = nullptr;
-		AIKIT_HANDLE* handle = nullptr;
-		AIKIT::AiAudio* aiAudio_raw = nullptr;
-		FILE* file = nullptr;
-		char data[320] = { 0 };
-		long fileSize = 0;
-		long readLen = 0;
+		AudioFrame* frame = nullptr;
+		AikitSession session(abilityID);  // 提前返回时由析构结束会话
+		AudioDecoder reader;  // 解析WAV头并转换成16k单声道，16k单声道PCM直接取映射区的片段
+		const char* data = nullptr;
+		long long fileSize = 0;
+		unsigned int readLen = 0;
 		// 记录并规范化工作目录
 		char currentDir[MAX_PATH];
 		GetCurrentDirectoryA(MAX_PATH, currentDir);
@@ -327,25 +401,21 @@ namespace AIKITDLL {
 		if (!EnsureEngineDllsLoaded()) {
 			LogError("引擎动态库加载失败");
 			lastResult = "引擎动态库加载失败";
+			EndIvwSession();
 			return -1;
 		}
 		LogInfo("引擎动态库加载检查通过");
 
-		// 创建参数构建器
-		AIKIT::AIKIT_ParamBuilder* paramBuilder = AIKIT::AIKIT_ParamBuilder::create();
-		if (!paramBuilder) {
-			LogError("创建参数构建器失败");
-			lastResult = "创建参数构建器失败";
+		// 取缓存的会话参数，同一阈值只构建一次
+		AIKIT_BizParam* builtParam = IvwSessionParams(threshold);
+		if (!builtParam) {
+			LogError("构建会话参数失败");
+			lastResult = "构建会话参数失败";
+			EndIvwSession();
 			return -1;
 		}
-		LogInfo("参数构建器创建成功");
 
-		// 设置参数
-		std::string thresholdParam = "0 0:" + std::to_string(threshold);
-		paramBuilder->param("wdec_param_nCmThreshold", thresholdParam.c_str(), thresholdParam.length());
-		paramBuilder->param("gramLoad", true);
-
-		LogInfo("已设置唤醒阈值: %s", thresholdParam.c_str());
+		LogInfo("唤醒阈值: %d", threshold);
 		// 重置唤醒标志
 		wakeupFlag.store(0);
 		LogInfo("已重置唤醒标志");
@@ -355,74 +425,74 @@ namespace AIKITDLL {
 		if (!abilityID) {
 			LogError("abilityID参数无效");
 			lastResult = "abilityID参数无效";
-			delete paramBuilder;
+			EndIvwSession();
 			return -1;
 		}
 		
-		ret = AIKIT::AIKIT_Start(abilityID, AIKIT::AIKIT_Builder::build(paramBuilder), nullptr, &handle);
+		ret = session.Start(builtParam, ivw_recover_session, nullptr);
 		if (ret != 0) {
 			LogError("启动能力失败，错误码: %d", ret);
 			lastResult = "启动能力失败: " + std::to_string(ret);
-			delete paramBuilder;
+			EndIvwSession();
 			return ret;
 		}
 		
 		// 检查handle是否有效再记录日志
-		if (handle) {
-			LogInfo("能力启动成功，句柄: %p", handle);
+		if (session.Handle()) {
+			LogInfo("能力启动成功，句柄: %p", session.Handle());
 		} else {
 			LogWarning("能力启动成功，但句柄为空");
 		}
 
 		// 打开音频文件
 		LogInfo("正在打开音频文件: %s", audioFilePath);
-		errno_t err = fopen_s(&file, audioFilePath, "rb");
-		if (err != 0 || file == nullptr) {
+		int err = reader.Open(audioFilePath);
+		if (err != 0) {
 			LogError("打开音频文件失败: %s，错误码: %d", audioFilePath, err);
 			lastResult = "打开音频文件失败: " + std::to_string(err);
-			if (paramBuilder) delete paramBuilder;
-			if (handle) AIKIT::AIKIT_End(handle);
+			session.End();
+			EndIvwSession();
 			return -1;
 		}
+		fileSize = reader.Format().dataBytes;
+		LogInfo("音频数据大小: %lld 字节（%s）", fileSize, reader.Mapped() ? "内存映射" : "流方式读取");
 
-		// 获取文件大小
-		fseek(file, 0, SEEK_END);
-		fileSize = ftell(file);
-		fseek(file, 0, SEEK_SET);
-		LogInfo("音频文件大小: %ld 字节", fileSize);
-
-		// 创建数据构建器
-		dataBuilder = AIKIT::AIKIT_DataBuilder::create();
-		if (!dataBuilder) {
+		// 从池里取数据构建器
+		frame = new AudioFrame("wav", false);
+		if (!frame->Valid()) {
 			LogError("创建数据构建器失败");
 			lastResult = "创建数据构建器失败";
-			if (file) fclose(file);
-			if (paramBuilder) delete paramBuilder;
-			if (handle) AIKIT::AIKIT_End(handle);
+			delete frame;
+			session.End();
+			EndIvwSession();
 			return -1;
 		}
 
 		// 逐块读取并处理文件数据
 		LogInfo("开始处理音频数据...");
-		int processCount = 0;		while (fileSize > 0 && wakeupFlag.load() != 1) {
-			readLen = fread(data, 1, sizeof(data), file);
-			dataBuilder->clear();			aiAudio_raw = AIKIT::AiAudio::get("wav")->data(data, (int)readLen)->valid();
-			dataBuilder->payload(aiAudio_raw);
+		int processCount = 0;		while (wakeupFlag.load() != 1) {
+			if (IsCancelled(cancel)) {
+				LogInfo("文件唤醒已取消，已处理 %llu 字节", reader.Position());
+				break;
+			}
+			data = reader.Next(FRAME_LEN, &readLen);
+			if (data == nullptr) {
+				break;
+			}
 			
-			// 检查handle是否有效
-			if (!handle) {
+			// 检查会话是否有效
+			if (!session.Active()) {
 				LogError("写入数据失败：句柄无效");
 				lastResult = "写入数据失败: 句柄无效";
 				break;
 			}
 			
-			ret = AIKIT::AIKIT_Write(handle, AIKIT::AIKIT_Builder::build(dataBuilder));
+			ret = session.Write(frame->Build(data, readLen));
 			if (ret != 0) {
 				LogError("写入数据失败，错误码: %d", ret);
 				lastResult = "写入数据失败: " + std::to_string(ret);
 				break;
 			}
-			fileSize -= readLen;
 			processCount++;
 
 			if (processCount % 50 == 0) {
@@ -431,8 +501,8 @@ namespace AIKITDLL {
 		}
 		// 结束处理
 		LogInfo("音频处理完成，结束处理...");
-		if (handle) {
-			ret = AIKIT::AIKIT_End(handle);
+		if (session.Active()) {
+			ret = session.End();
 			if (ret != 0) {
 				LogError("结束处理失败，错误码: %d", ret);
 			}
@@ -443,17 +513,20 @@ namespace AIKITDLL {
 			LogWarning("结束处理：句柄为空");
 		}
 		// 清理资源
-		if (file) fclose(file);
-		if (dataBuilder) delete dataBuilder;
-		if (paramBuilder) delete paramBuilder;
+		reader.Close();
+		if (frame) delete frame;
 
 		// 标记会话为非活动状态，无论成功或失败
-		g_ivwSessionActive.store(false);
+		EndIvwSession();
 		if (wakeupFlag.load() == 1) {
 			LogInfo("唤醒成功");
 			lastResult = "唤醒成功";
 			return 0;
 		}
+		else if (IsCancelled(cancel)) {
+			lastResult = "文件唤醒已取消";
+			return E_SESSION_CANCELLED;
+		}
 		else {
 			LogError("唤醒测试失败，未检测到唤醒词，错误码: %d", ret);
 			lastResult = "未检测到唤醒词";
@@ -465,9 +538,21 @@ namespace AIKITDLL {
 // 语音唤醒能力初始化，接受资源文件路径作为参数
 int Ivw70Init()
 {
+	// 引擎和资源已加载（常驻模式）时不重复初始化
+	if (AIKITDLL::ivwEngineLoaded.load()) {
+		AIKITDLL::LogInfo("语音唤醒引擎已加载，跳过初始化");
+		return 0;
+	}
+
 	// 初始化IVW互斥资源
 	AIKITDLL::InitIvwResources();
 
+	return AIKITDLL::IvwEngineLoad();
+}
+
+// 加载唤醒引擎和唤醒词资源
+int AIKITDLL::IvwEngineLoad()
+{
 	// 初始化阶段 - 检查参数并记录日志
 	AIKITDLL::LogInfo("开始语音唤醒引擎初始化...");
 
@@ -524,6 +609,7 @@ int Ivw70Init()
 	AIKITDLL::LogInfo("数据集指定成功");
 
 	// 初始化完成
+	AIKITDLL::ivwEngineLoaded.store(true);
 	AIKITDLL::LogInfo("语音唤醒初始化完成");
 	AIKITDLL::lastResult = "成功：语音唤醒初始化已完成。";
 	return 0;
@@ -535,39 +621,29 @@ int Ivw70Uninit()
 	if (!AIKITDLL::isInitialized) {
 		AIKITDLL::LogWarning("Ivw70Uninit: SDK未初始化，跳过清理");
 		// 即使SDK未初始化，也要重置标志位确保一致性
-		AIKITDLL::g_ivwSessionActive.store(false);
+		AIKITDLL::EndIvwSession();
+		AIKITDLL::ivwEngineLoaded.store(false);
 		AIKITDLL::lastResult = "SDK未初始化";
 		return 0;
 	}
 
-	// 尝试获取互斥锁，确保安全释放资源
-	std::lock_guard<std::mutex> lock(AIKITDLL::g_ivwMutex);
-	AIKITDLL::LogInfo("Ivw70Uninit: 开始释放唤醒资源...");
+	{
+		// 尝试获取互斥锁，确保安全释放资源
+		std::lock_guard<std::mutex> lock(AIKITDLL::g_ivwMutex);
+		AIKITDLL::LogInfo("Ivw70Uninit: 开始释放唤醒资源...");
 
-	// 强制重置所有内部唤醒标志位
-	ResetWakeupStatus();
-	AIKITDLL::LogInfo("Ivw70Uninit: 已重置唤醒状态标志");
+		// 强制重置所有内部唤醒标志位
+		ResetWakeupStatus();
+		AIKITDLL::LogInfo("Ivw70Uninit: 已重置唤醒状态标志");
 
-	// 尝试卸载资源，忽略潜在错误
-	int ret = AIKIT::AIKIT_UnLoadData(IVW_ABILITY, "key_word", 0);
-	if (ret != 0) {
-		AIKITDLL::LogWarning("Ivw70Uninit: 卸载资源异常，错误码: %d，继续清理", ret);
-	}
+		AIKITDLL::IvwEngineUnload();
 
-	// 反初始化引擎，忽略潜在错误
-	ret = AIKIT::AIKIT_EngineUnInit(IVW_ABILITY);
-	if (ret != 0) {
-		AIKITDLL::LogWarning("Ivw70Uninit: 引擎反初始化异常，错误码: %d", ret);
+		// 释放IVW互斥资源，同时重置会话状态标志位
+		AIKITDLL::CleanupIvwResources();
 	}
 
-	// 释放IVW互斥资源
-	AIKITDLL::CleanupIvwResources();
-	
-	// 确保重置会话状态标志位
-	AIKITDLL::g_ivwSessionActive.store(false);
-
-	// 强制等待一小段时间，确保资源完全释放
-	Sleep(100);
+	// 唤醒回调会获取g_ivwMutex，释放锁之后再等正在执行的回调返回
+	AIKITDLL::Teardown::Instance().WaitCallbacksIdle(TEARDOWN_CALLBACK_TIMEOUT_MS);
 
 	AIKITDLL::LogInfo("Ivw70Uninit: 唤醒资源释放完成");
 	AIKITDLL::lastResult = "语音唤醒资源已释放";
@@ -576,7 +652,6 @@ int Ivw70Uninit()
 
 int TestIvw70(const AIKIT_Callbacks& cbs)
 {
-	AIKIT::AIKIT_ParamBuilder* paramBuilder = nullptr;
 	int ret = 0;
 
 	AIKITDLL::LogInfo("======================= IVW70 测试开始 ===========================");
@@ -595,18 +670,6 @@ int TestIvw70(const AIKIT_Callbacks& cbs)
 	}
 	AIKITDLL::LogInfo("注册能力回调成功");
 
-	// 创建参数构建器
-	paramBuilder = AIKIT::AIKIT_ParamBuilder::create();
-	if (!paramBuilder) {
-		AIKITDLL::LogError("创建参数构建器失败");
-		return -1;
-	}
-
-	// 设置参数
-	paramBuilder->param("wdec_param_nCmThreshold", "0 0:900", strlen("0 0:900"));
-	paramBuilder->param("gramLoad", true);
-	AIKITDLL::LogInfo("参数已设置：唤醒阈值=900");
-
 	// 默认使用音频文件进行测试
 	const char* testAudioPath = ".\\resource\\ivw70\\testAudio\\xbxb.pcm";
 	AIKITDLL::LogInfo("开始从文件测试唤醒功能：%s", testAudioPath);
@@ -620,30 +683,34 @@ int TestIvw70(const AIKIT_Callbacks& cbs)
 		AIKITDLL::LogError("唤醒测试失败，未检测到唤醒词，错误码: %d", ret);
 	}
 
-	// 清理资源
-	if (paramBuilder != nullptr) {
-		delete paramBuilder;
-		paramBuilder = nullptr;
-	}
-
 	AIKITDLL::LogInfo("======================= IVW70 测试结束 ===========================");
 	return ret;
 }
 
 int Ivw70Microphone(const AIKIT_Callbacks& cbs)
 {
-	AIKIT::AIKIT_ParamBuilder* paramBuilder = nullptr;
+	return AIKITDLL::IvwMicrophoneSession(cbs, nullptr);
+}
+
+int AIKITDLL::IvwMicrophoneSession(const AIKIT_Callbacks& cbs, CancelToken* cancel,
+	IvwListeningFn onListening, void* arg)
+{
 	int ret = 0;
 
 	AIKITDLL::LogInfo("======================= IVW70 麦克风输入开启 ===========================");
 
-	// 检查是否已有活动会话，并尝试清理相关资源
+	// 检查是否已有活动会话：先请求它退出，按时结束时直接复用引擎
 	if (AIKITDLL::g_ivwSessionActive.load()) {
-		AIKITDLL::LogWarning("发现已有活动的唤醒会话，尝试先清理现有会话");
-		// 强制重置SDK状态，确保没有残留会话
+		AIKITDLL::LogWarning("发现已有活动的唤醒会话，等待其结束");
+		StopIvwMicrophone();
+	}
+	if (!AIKITDLL::WaitIvwSessionEnded(TEARDOWN_SESSION_TIMEOUT_MS, cancel)) {
+		if (IsCancelled(cancel)) {
+			return E_SESSION_CANCELLED;
+		}
+		AIKITDLL::LogWarning("现有会话没有按时结束，尝试完整清理");
+		// 强制重置SDK状态，确保没有残留会话（Ivw70Uninit返回前已等待回调结束）
 		Ivw70Uninit();
-		// 等待资源释放
-		Sleep(100);
 		// 重新初始化
 		int initRet = Ivw70Init();
 		if (initRet != 0) {
@@ -661,35 +728,46 @@ int Ivw70Microphone(const AIKIT_Callbacks& cbs)
 	}
 	AIKITDLL::LogInfo("注册能力回调成功");
 
-	// 创建参数构建器
-	paramBuilder = AIKIT::AIKIT_ParamBuilder::create();
-	if (!paramBuilder) {
-		AIKITDLL::LogError("创建参数构建器失败");
-		return -1;
-	}
-
-	// 设置参数
-	paramBuilder->param("wdec_param_nCmThreshold", "0 0:900", strlen("0 0:900"));
-	paramBuilder->param("gramLoad", true);
-
-	// 使用麦克风进行测试
+	// 使用麦克风进行测试（会话参数由ivw_microphone从缓存中取）
 	AIKITDLL::LogInfo("开始从麦克风测试唤醒功能");
 
-	ret = AIKITDLL::ivw_microphone(IVW_ABILITY, 900, 10000); // 10秒超时
+	ret = AIKITDLL::ivw_microphone(IVW_ABILITY, 900, AIKITDLL::ivwListenTimeoutMs.load(), cancel, onListening, arg); // 默认10秒超时，0为持续监听
 
 	if (ret == 0) {
 		AIKITDLL::LogInfo("麦克风唤醒测试成功，检测到唤醒词");
 	}
+	else if (ret == E_SESSION_CANCELLED) {
+		AIKITDLL::LogInfo("麦克风唤醒已取消");
+	}
 	else {
 		AIKITDLL::LogError("麦克风唤醒测试失败，未检测到唤醒词，错误码: %d", ret);
 	}
 
-	// 清理资源
-	if (paramBuilder != nullptr) {
-		delete paramBuilder;
-		paramBuilder = nullptr;
-	}
-
 	AIKITDLL::LogInfo("======================= IVW70 麦克风输出结束 ===========================");
 	return ret;
-}
\ No newline at end of file
+}
+
+// 设置麦克风唤醒的监听超时，0或负数表示持续流式监听直到唤醒或被停止
+void SetIvwListenTimeout(int timeoutMs)
+{
+	AIKITDLL::ivwListenTimeoutMs.store(timeoutMs > 0 ? timeoutMs : 0);
+	AIKITDLL::LogInfo("唤醒监听超时已设置为: %d ms%s", timeoutMs, timeoutMs > 0 ? "" : "（持续监听）");
+}
+
+// 请求正在进行的麦克风唤醒监听尽快退出
+void StopIvwMicrophone()
+{
+	AIKITDLL::ivwStopRequested.store(true);
+}
+
+// 切换常驻引擎模式，下次离开唤醒监听时生效
+void SetIvwResidentEngine(int enabled)
+{
+	AIKITDLL::ivwResidentEngine.store(enabled != 0);
+	AIKITDLL::LogInfo("唤醒常驻引擎模式已%s", enabled ? "开启" : "关闭");
+}
+
+int IsIvwEngineLoaded()
+{
+	return AIKITDLL::ivwEngineLoaded.load() ? 1 : 0;
+}
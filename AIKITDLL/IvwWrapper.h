@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common.h"
+#include "CaptureHub.h"
 #include <Windows.h>
 #include <mmsystem.h>
 #pragma comment(lib, "winmm.lib")
@@ -38,6 +39,19 @@ extern "C" {
 	AIKITDLL_API int TestIvw70(const AIKIT_Callbacks& cbs);
 
 	AIKITDLL_API int Ivw70Microphone(const AIKIT_Callbacks& cbs);
+
+	// 设置麦克风唤醒的监听超时（毫秒），0表示持续流式监听
+	AIKITDLL_API void SetIvwListenTimeout(int timeoutMs);
+
+	// 停止正在进行的麦克风唤醒监听
+	AIKITDLL_API void StopIvwMicrophone();
+
+	// 常驻引擎模式（默认开启）：唤醒引擎和唤醒词资源只加载一次，离开唤醒监听时不再卸载，
+	// 每次监听只开始和结束一个会话。关闭后恢复每次离开唤醒监听都完整卸载、再次进入时重新加载
+	AIKITDLL_API void SetIvwResidentEngine(int enabled);
+
+	// 唤醒引擎和资源当前是否已加载
+	AIKITDLL_API int IsIvwEngineLoaded();
 	
 	// 测试唤醒检测功能
 	AIKITDLL_API int TestWakeupDetection();
@@ -51,9 +65,46 @@ namespace AIKITDLL {
 	// 当前的唤醒标志
 	extern std::atomic<int> wakeupFlag;
 
-	// 从麦克风进行语音唤醒的内部实现
-	int ivw_microphone(const char* abilityID, int threshold, int timeoutMs);
+	// 麦克风唤醒监听的停止请求标志
+	extern std::atomic<bool> ivwStopRequested;
+
+	// 麦克风唤醒监听超时（毫秒），0表示持续监听
+	extern std::atomic<int> ivwListenTimeoutMs;
+
+	// 是否使用常驻引擎模式
+	extern std::atomic<bool> ivwResidentEngine;
+
+	// 唤醒引擎和资源是否已加载（Ivw70Init成功后置位，Ivw70Uninit或SDK反初始化后清除）
+	extern std::atomic<bool> ivwEngineLoaded;
+
+	// 进入唤醒监听前调用：引擎未加载时加载引擎和唤醒词资源（不改变会话状态），已加载时直接返回0
+	int IvwEngineAcquire();
+
+	// 加载唤醒引擎和唤醒词资源，不改变唤醒会话状态，可以在会话中途（持有g_ivwMutex时）调用。
+	// 调用方先确认引擎未加载
+	int IvwEngineLoad();
+
+	// 卸载唤醒词资源并反初始化引擎，调用方持有g_ivwMutex
+	void IvwEngineUnload();
+
+	// 离开唤醒监听时调用：常驻模式下只重置唤醒标志，否则完整卸载引擎和资源
+	void IvwEngineRelease();
+
+	class CancelToken;
+
+	// 唤醒会话已经开始、开始送数时的通知，在监听线程上调用（持有g_ivwMutex），应尽快返回，不能再进入唤醒会话
+	typedef void (*IvwListeningFn)(void* arg);
+
+	// 从麦克风进行语音唤醒的内部实现，timeoutMs<=0时持续监听。
+	// cancel被取消时在一帧之内退出，返回E_SESSION_CANCELLED；onListening（可为NULL）在开始送数前调用一次
+	int ivw_microphone(const char* abilityID, int threshold, int timeoutMs, CancelToken* cancel = nullptr,
+		IvwListeningFn onListening = nullptr, void* arg = nullptr);
+
+	// 从文件进行语音唤醒的内部实现，cancel在每个音频块之前检查
+	int ivw_file(const char* abilityID, const char* audioFilePath, int threshold, CancelToken* cancel = nullptr);
 
-	// 从文件进行语音唤醒的内部实现
-	int ivw_file(const char* abilityID, const char* audioFilePath, int threshold);
+	// Ivw70Microphone的可取消版本：等待上一个会话结束和监听过程都会被cancel中止。
+	// 唤醒会话开始送数时调用onListening（见ivw_microphone），函数本身直到唤醒、超时或取消才返回
+	int IvwMicrophoneSession(const AIKIT_Callbacks& cbs, CancelToken* cancel,
+		IvwListeningFn onListening = nullptr, void* arg = nullptr);
 }
\ No newline at end of file
@@ -0,0 +1,2658 @@
+#include "pch.h"
+#include "Common.h"
+#include "IvwWrapper.h"
+#include "winrec.h"
+#include "CaptureHub.h"
+#include "VoiceStateManager.h"
+#include "audiosrc.h"
+#include "resample.h"
+#include "vad.h"
+#include "SdkHelper.h"
+#include "EsrHelper.h"
+#include "EngineWarmup.h"
+#include "BuilderCache.h"
+#include "Teardown.h"
+#include "IvwResourceManager.h"
+#include "TimerService.h"
+#include "timer_wheel.h"
+#include "CancelToken.h"
+#include "AikitSession.h"
+#include "EsrStandby.h"
+#include "EsrBatch.h"
+#include "IvwEval.h"
+#include "AudioFile.h"
+#include "AudioDecoder.h"
+#include <psapi.h>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+#pragma comment(lib, "psapi.lib")
+
+// 音频管线相关的自测与性能测试函数
+namespace {
+	// 高精度计时（微秒）
+	long long NowUs() {
+		LARGE_INTEGER freq, counter;
+		QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&counter);
+		return (long long)(counter.QuadPart * 1000000 / freq.QuadPart);
+	}
+
+	// 当前进程的私有内存占用（字节）
+	size_t CurrentPrivateBytes() {
+		PROCESS_MEMORY_COUNTERS_EX pmc;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+			return pmc.PrivateUsage;
+		}
+		return 0;
+	}
+
+	// 以2的幂为桶的延迟直方图（微秒）
+	struct LatencyHistogram {
+		unsigned long long buckets[32];
+		unsigned long long count;
+		long long maxUs;
+		long long totalUs;
+
+		LatencyHistogram() : count(0), maxUs(0), totalUs(0) {
+			memset(buckets, 0, sizeof(buckets));
+		}
+
+		void Add(long long us) {
+			int b = 0;
+			while (b < 31 && (1LL << b) <= us) {
+				++b;
+			}
+			buckets[b]++;
+			count++;
+			totalUs += us;
+			if (us > maxUs) {
+				maxUs = us;
+			}
+		}
+
+		// 返回百分位所在桶的上界
+		long long Percentile(double p) const {
+			unsigned long long target = (unsigned long long)(count * p);
+			unsigned long long acc = 0;
+			for (int b = 0; b < 32; ++b) {
+				acc += buckets[b];
+				if (acc > target) {
+					return 1LL << b;
+				}
+			}
+			return maxUs;
+		}
+	};
+
+	// 流式唤醒压测中替代引擎的写入函数：只记录每块数据从录音到写入的延迟
+	struct StreamBenchWriter {
+		const long long* pushTimes;   // 每帧的录音时间戳，按帧序号取模存放
+		unsigned int slotCount;
+		unsigned int frameBytes;
+		unsigned long long consumed;  // 已写入的累计字节
+		LatencyHistogram latency;
+	};
+
+	int StreamBenchWrite(const char* data, unsigned int len, void* ctx) {
+		StreamBenchWriter* w = (StreamBenchWriter*)ctx;
+		volatile char sink = data[len - 1];
+		(void)sink;
+		w->consumed += len;
+		unsigned long long frame = (w->consumed - 1) / w->frameBytes;
+		w->latency.Add(NowUs() - w->pushTimes[frame % w->slotCount]);
+		return 0;
+	}
+
+	// 录音延迟压测的录音回调上下文
+	struct CaptureBenchContext {
+		AIKITDLL::CaptureBuffer* buffer;
+		long long* pushTimes;
+		unsigned int slotCount;
+		unsigned int frameBytes;
+		unsigned long long frames;     // 已收到的回调次数
+		unsigned long long bytes;      // 已收到的字节数
+		long long lastUs;              // 上一次回调的时间
+		long long maxGapUs;            // 相邻两次回调的最大间隔
+	};
+
+	void CaptureBenchCallback(char* data, unsigned long len, void* para) {
+		CaptureBenchContext* ctx = (CaptureBenchContext*)para;
+		long long now = NowUs();
+		if (ctx->lastUs != 0 && now - ctx->lastUs > ctx->maxGapUs) {
+			ctx->maxGapUs = now - ctx->lastUs;
+		}
+		ctx->lastUs = now;
+		ctx->pushTimes[ctx->frames % ctx->slotCount] = now;
+		ctx->frames++;
+		ctx->bytes += len;
+		ctx->buffer->Write(data, (unsigned int)len);
+	}
+
+	// 切换压测中单个录音对象的回调上下文：记录最后一次回调时间
+	struct HandoverRecorder {
+		HANDLE dataEvent;
+		long long lastUs;
+	};
+
+	void HandoverCallback(char* data, unsigned long len, void* para) {
+		HandoverRecorder* ctx = (HandoverRecorder*)para;
+		(void)data;
+		(void)len;
+		ctx->lastUs = NowUs();
+		SetEvent(ctx->dataEvent);
+	}
+
+	// 按旧流程打开一个独立的录音对象并等到第一块数据
+	struct recorder* OpenHandoverRecorder(HandoverRecorder* ctx, long long* openUs) {
+		WAVEFORMATEX waveform;
+		waveform.wFormatTag = WAVE_FORMAT_PCM;
+		waveform.nSamplesPerSec = 16000;
+		waveform.wBitsPerSample = 16;
+		waveform.nChannels = 1;
+		waveform.nAvgBytesPerSec = 16000 * 2;
+		waveform.nBlockAlign = 2;
+		waveform.cbSize = 0;
+
+		struct recorder* rec = nullptr;
+		long long t0 = NowUs();
+		if (create_recorder(&rec, HandoverCallback, ctx) != 0 || rec == nullptr) {
+			return nullptr;
+		}
+		if (open_recorder(rec, get_default_input_dev(), &waveform) != 0 || start_record(rec) != 0) {
+			close_recorder(rec);
+			destroy_recorder(rec);
+			return nullptr;
+		}
+		if (openUs) {
+			*openUs = NowUs() - t0;
+		}
+		return rec;
+	}
+
+	void CloseHandoverRecorder(struct recorder* rec) {
+		stop_record(rec);
+		while (!is_record_stopped(rec)) {
+			Sleep(1);
+		}
+		close_recorder(rec);
+		destroy_recorder(rec);
+	}
+
+	// 用文件源实时回放一段录音，跑完整个唤醒->命令词循环，统计唤醒次数和命令词识别成功次数
+	bool RunPrerollPass(const char* wavPath, DWORD durationMs, int prerollMs, int* wakeups, int* commands) {
+		*wakeups = 0;
+		*commands = 0;
+		SetCommandPrerollMs(prerollMs);
+		// 每次切换音频源都会让文件从头开始回放
+		if (SetVoiceAudioSource(AUDIO_SOURCE_FILE, wavPath, 1.0, 0) != 0) {
+			return false;
+		}
+		if (StartVoiceAssistantLoop() != 0) {
+			return false;
+		}
+		// 录音放完后留出最后一条命令的识别时间
+		Sleep(durationMs + 3000);
+		VoiceStateManager::GetInstance()->GetEventCounts(wakeups, commands);
+		StopVoiceAssistantLoop();
+		return true;
+	}
+
+	// 用最小二乘拟合出输出中频率为freq的正弦分量，返回信噪比（dB），amplitude返回拟合幅度。
+	// 输入是理想正弦时，这就是与理想重采样结果的差距
+	double ToneSnr(const short* pcm, unsigned int count, double freq, double rate, double* amplitude) {
+		const double pi = 3.14159265358979323846;
+		double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+		for (unsigned int i = 0; i < count; ++i) {
+			double sv = sin(2 * pi * freq * i / rate);
+			double cv = cos(2 * pi * freq * i / rate);
+			ss += sv * sv;
+			cc += cv * cv;
+			sc += sv * cv;
+			ys += pcm[i] * sv;
+			yc += pcm[i] * cv;
+		}
+		double det = ss * cc - sc * sc;
+		double a = (ys * cc - yc * sc) / det;
+		double b = (yc * ss - ys * sc) / det;
+		double signal = 0, noise = 0;
+		for (unsigned int i = 0; i < count; ++i) {
+			double fit = a * sin(2 * pi * freq * i / rate) + b * cos(2 * pi * freq * i / rate);
+			signal += fit * fit;
+			noise += (pcm[i] - fit) * (pcm[i] - fit);
+		}
+		if (amplitude) {
+			*amplitude = sqrt(a * a + b * b);
+		}
+		return noise > 0 ? 10 * log10(signal / noise) : 200.0;
+	}
+
+	// 生成frames帧、每帧channels个声道的正弦信号
+	void MakeTone(std::vector<short>& pcm, unsigned int frames, unsigned int channels,
+		double freq, double rate, double amplitude) {
+		const double pi = 3.14159265358979323846;
+		pcm.resize((size_t)frames * channels);
+		for (unsigned int i = 0; i < frames; ++i) {
+			short v = (short)lrint(amplitude * sin(2 * pi * freq * i / rate));
+			for (unsigned int c = 0; c < channels; ++c) {
+				pcm[(size_t)i * channels + c] = v;
+			}
+		}
+	}
+
+	// 按录音周期（20ms）分块送入重采样器，模拟录音回调
+	unsigned int ResampleStream(struct resampler* rs, const std::vector<short>& in, unsigned int channels,
+		unsigned int rate, std::vector<short>& out) {
+		unsigned int frames = (unsigned int)(in.size() / channels);
+		unsigned int period = rate / 50;
+		unsigned int produced = 0;
+		out.resize(resampler_max_output(rs, frames) + period);
+		for (unsigned int i = 0; i < frames; i += period) {
+			unsigned int n = frames - i < period ? frames - i : period;
+			produced += resampler_process(rs, in.data() + (size_t)i * channels, n,
+				out.data() + produced, (unsigned int)out.size() - produced);
+		}
+		out.resize(produced);
+		return produced;
+	}
+
+	// 进程累计CPU时间（用户态 + 内核态，微秒）
+	long long ProcessCpuUs() {
+		FILETIME createTime, exitTime, kernelTime, userTime;
+		if (!GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &kernelTime, &userTime)) {
+			return 0;
+		}
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernelTime.dwLowDateTime;
+		k.HighPart = kernelTime.dwHighDateTime;
+		u.LowPart = userTime.dwLowDateTime;
+		u.HighPart = userTime.dwHighDateTime;
+		return (long long)((k.QuadPart + u.QuadPart) / 10);
+	}
+
+	// 读取16k/16bit单声道录音：WAV文件取data块，其他文件按裸PCM处理
+	bool LoadPcm16k(const char* path, std::vector<short>& pcm) {
+		FILE* fp = nullptr;
+		if (fopen_s(&fp, path, "rb") != 0 || !fp) {
+			return false;
+		}
+		std::vector<char> bytes;
+		char block[4096];
+		size_t n;
+		while ((n = fread(block, 1, sizeof(block), fp)) > 0) {
+			bytes.insert(bytes.end(), block, block + n);
+		}
+		fclose(fp);
+
+		size_t offset = 0;
+		size_t length = bytes.size();
+		if (bytes.size() >= 12 && memcmp(bytes.data(), "RIFF", 4) == 0 && memcmp(bytes.data() + 8, "WAVE", 4) == 0) {
+			size_t pos = 12;
+			length = 0;
+			while (pos + 8 <= bytes.size()) {
+				unsigned int chunkLen = *(const unsigned int*)(bytes.data() + pos + 4);
+				if (memcmp(bytes.data() + pos, "data", 4) == 0) {
+					offset = pos + 8;
+					length = chunkLen < bytes.size() - offset ? chunkLen : bytes.size() - offset;
+					break;
+				}
+				pos += 8 + chunkLen + (chunkLen & 1);
+			}
+		}
+		pcm.assign((const short*)(bytes.data() + offset), (const short*)(bytes.data() + offset) + length / 2);
+		return !pcm.empty();
+	}
+
+	// 合成一段大部分时间安静的录音：底噪上每30秒出现1.5秒类似语音的谐波音节
+	void MakeQuietCorpus(std::vector<short>& pcm, unsigned int seconds) {
+		const double pi = 3.14159265358979323846;
+		unsigned int seed = 1;
+		pcm.resize((size_t)16000 * seconds);
+		for (size_t i = 0; i < pcm.size(); ++i) {
+			seed = seed * 1103515245 + 12345;
+			double v = (double)((seed >> 16) % 61) - 30.0;
+			double t = i / 16000.0;
+			double phase = fmod(t, 30.0);
+			if (phase >= 20.0 && phase < 21.5) {
+				double envelope = 0.5 + 0.5 * sin(2 * pi * 4 * t);
+				v += 3000 * envelope * (sin(2 * pi * 180 * t) + 0.5 * sin(2 * pi * 360 * t) + 0.3 * sin(2 * pi * 900 * t));
+			}
+			pcm[i] = (short)v;
+		}
+	}
+
+	// 静音门限测试的写入统计；handle不为空时写入真实的唤醒引擎
+	struct GateBenchWriter {
+		AIKIT_HANDLE* handle;
+		AIKITDLL::AudioFrame* frame;
+		unsigned long long writes;
+		unsigned long long bytes;
+	};
+
+	int GateBenchWrite(const char* data, unsigned int len, void* ctx) {
+		GateBenchWriter* w = (GateBenchWriter*)ctx;
+		w->writes++;
+		w->bytes += len;
+		if (!w->handle) {
+			volatile char sink = data[len - 1];
+			(void)sink;
+			return 0;
+		}
+		AIKIT::AIKIT_Write(w->handle, w->frame->Build(data, len));
+		return 0;
+	}
+
+	// 按20ms录音周期回放一遍语料：录音回调写入共享缓冲区，送数循环与ivw_microphone相同
+	void RunGatePass(const std::vector<short>& pcm, struct vad_gate* gate, GateBenchWriter* writer, long long* cpuUs) {
+		const unsigned int periodSamples = 320;
+		AIKITDLL::CaptureBuffer buffer(128 * 1024);
+		AIKITDLL::CaptureConsumer* consumer = buffer.Subscribe(NULL);
+		long long cpuStart = ProcessCpuUs();
+		for (size_t i = 0; i < pcm.size(); i += periodSamples) {
+			size_t n = pcm.size() - i < periodSamples ? pcm.size() - i : periodSamples;
+			buffer.Write((const char*)(pcm.data() + i), (unsigned int)(n * 2));
+			AIKITDLL::PumpCapture(consumer, periodSamples * 2, gate, GateBenchWrite, writer, nullptr);
+		}
+		*cpuUs = ProcessCpuUs() - cpuStart;
+		buffer.Unsubscribe(consumer);
+	}
+
+	// 丢帧检测测试的录音回调：在指定的回调次数上模拟一次处理卡顿
+	struct GapTestContext {
+		unsigned int calls;
+		unsigned int stallAt;
+		unsigned int stallMs;
+	};
+
+	void GapTestCallback(char* data, unsigned long len, void* para) {
+		GapTestContext* ctx = (GapTestContext*)para;
+		if (++ctx->calls == ctx->stallAt) {
+			Sleep(ctx->stallMs);
+		}
+	}
+
+	// 开始一个唤醒会话并写入10ms静音，返回0表示引擎已在接收音频
+	int StartIvwSession(AIKIT_HANDLE** handle) {
+		static const char silence[FRAME_LEN] = { 0 };
+		AIKIT_BizParam* params = AIKITDLL::IvwSessionParams(900);
+		AIKITDLL::AudioFrame frame("wav", false);
+		int ret = -1;
+		if (params && frame.Valid()) {
+			ret = AIKIT::AIKIT_Start(IVW_ABILITY, params, nullptr, handle);
+			if (ret == 0) {
+				ret = AIKIT::AIKIT_Write(*handle, frame.Build(silence, FRAME_LEN));
+			}
+		}
+		return ret;
+	}
+
+	// 走一遍命令词识别的启动流程直到第一次写入成功，返回0表示成功；times记录各阶段耗时
+	int StartEsrRound(const AIKIT_Callbacks& cbs, EsrPhaseTimes* times) {
+		static const char silence[FRAME_LEN_ESR] = { 0 };
+		struct EsrRecognizer esr;
+		bool loaded = false;
+		long long t0 = NowUs();
+		int ret = AIKIT::AIKIT_RegisterAbilityCallback(ESR_ABILITY, cbs);
+		if (ret != 0) {
+			return ret;
+		}
+		long long t1 = NowUs();
+		ret = AIKITDLL::EsrEngineAcquire(&loaded);
+		if (ret != 0) {
+			return ret;
+		}
+		long long t2 = NowUs();
+		ret = EsrInit(&esr, ESR_FILE, -1);
+		long long t3 = NowUs();
+		if (ret == 0) {
+			ret = EsrStartListening(&esr);
+		}
+		long long t4 = NowUs();
+		if (ret == 0) {
+			ret = EsrWriteAudioData(&esr, silence, sizeof(silence));
+		}
+		long long t5 = NowUs();
+		times->registerUs = t1 - t0;
+		times->engineUs = t2 - t1;
+		times->recognizerUs = t3 - t2;
+		times->startUs = t4 - t3;
+		times->readyUs = t4 - t0;
+		times->firstWriteUs = t5 - t4;
+		times->engineLoaded = loaded ? 1 : 0;
+		EsrStopListening(&esr);
+		EsrUninit(&esr);
+		AIKITDLL::EsrEngineRelease();
+		return ret;
+	}
+
+#ifdef _DEBUG
+	// 送数循环的内存分配计数：只统计指定线程上经CRT堆的分配
+	volatile long g_feedAllocs = 0;
+	volatile DWORD g_feedAllocThread = 0;
+
+	int __cdecl FeedAllocHook(int allocType, void*, size_t, int blockType, long, const unsigned char*, int) {
+		if ((allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) && blockType != _CRT_BLOCK &&
+			GetCurrentThreadId() == g_feedAllocThread) {
+			g_feedAllocs++;
+		}
+		return TRUE;
+	}
+#endif
+
+	// 分配计数测试的写入端：区分重新构建的帧和只替换数据指针的帧中发生的分配
+	struct AllocFeedWriter {
+		AIKITDLL::AudioFrame* frame;
+		AIKIT_HANDLE* handle;
+		unsigned long long writes;
+		unsigned long long rebuiltFrames;
+		long rebuildAllocs;
+	};
+
+	int AllocFeedWrite(const char* data, unsigned int len, void* ctx) {
+		AllocFeedWriter* w = (AllocFeedWriter*)ctx;
+		BuilderCacheStats before;
+		BuilderCacheStats after;
+		GetBuilderCacheStats(&before);
+		long allocs = 0;
+#ifdef _DEBUG
+		allocs = g_feedAllocs;
+#endif
+		AIKIT_InputData* input = w->frame->Build(data, len);
+		if (w->handle && input) {
+			AIKIT::AIKIT_Write(w->handle, input);
+		}
+		GetBuilderCacheStats(&after);
+		if (after.frameRebuilds != before.frameRebuilds) {
+			w->rebuiltFrames++;
+#ifdef _DEBUG
+			w->rebuildAllocs += g_feedAllocs - allocs;
+#endif
+		}
+		w->writes++;
+		return 0;
+	}
+
+	// 定时器测试中的一个会话期限
+	struct BenchSessionTimer {
+		struct tw_timer timer;
+		unsigned long long deadlineUs;
+		unsigned long long firedUs;
+		int fired;
+	};
+
+	unsigned long long g_benchClockUs = 0;
+
+	void BenchTimerFired(struct tw_timer* t, void* arg) {
+		BenchSessionTimer* s = (BenchSessionTimer*)arg;
+		s->fired++;
+		s->firedUs = g_benchClockUs;
+	}
+
+	// 定时器线程上的回调：记录到期时间
+	void BenchServiceFired(struct tw_timer* t, void* arg) {
+		BenchSessionTimer* s = (BenchSessionTimer*)arg;
+		s->fired++;
+		s->firedUs = (unsigned long long)NowUs();
+	}
+
+	// 在另一个线程上delayMs毫秒后取消token，返回wait从取消到返回用了多少毫秒；
+	// wait没等到取消就返回时结果为负数
+	template <typename Wait>
+	double MeasureCancel(AIKITDLL::CancelToken& token, DWORD delayMs, Wait wait) {
+		std::atomic<long long> cancelUs(0);
+		token.Reset();
+		std::thread canceller([&token, &cancelUs, delayMs]() {
+			Sleep(delayMs);
+			cancelUs.store(NowUs());
+			token.Cancel();
+		});
+		wait();
+		long long endUs = NowUs();
+		canceller.join();
+		return (endUs - cancelUs.load()) / 1000.0;
+	}
+
+	// 等待条件成立，最多timeoutMs毫秒
+	template <typename Cond>
+	bool WaitUntil(Cond cond, DWORD timeoutMs) {
+		long long deadline = NowUs() + (long long)timeoutMs * 1000;
+		while (!cond()) {
+			if (NowUs() > deadline) {
+				return false;
+			}
+			Sleep(5);
+		}
+		return true;
+	}
+
+	// 启动语音助手并停在state状态（唤醒监听或命令词监听）的会话中途，然后停止，返回停止耗时
+	bool StopInState(VOICE_ASSISTANT_STATE state, VoiceStopTimes* times) {
+		VoiceStateManager* manager = VoiceStateManager::GetInstance();
+		if (StartVoiceAssistantLoop() != 0) {
+			return false;
+		}
+		// 等唤醒会话真正开始送数（首次启动含SDK初始化和引擎加载）
+		bool reached = WaitUntil([]() { return AIKITDLL::g_ivwSessionActive.load(); }, 30000);
+		if (reached && state == STATE_COMMAND_LISTENING) {
+			// 模拟唤醒：送数循环看到唤醒标志后结束会话，再像唤醒回调一样通知状态机
+			AIKITDLL::wakeupFlag.store(1);
+			reached = WaitUntil([]() { return !AIKITDLL::g_ivwSessionActive.load(); }, 1000);
+			if (reached) {
+				manager->HandleEvent(EVENT_WAKEUP_SUCCESS, "TestStopLatency");
+				reached = WaitUntil([manager]() { return manager->GetCurrentState() == STATE_COMMAND_LISTENING; }, 5000);
+			}
+		}
+		if (reached) {
+			// 让会话进入稳定的送数阶段（命令词引擎已在唤醒期间加载）
+			Sleep(500);
+		}
+		StopVoiceAssistantLoop();
+		return reached && GetVoiceStopTimes(times) == 0 && times->state == (int)state;
+	}
+
+	// 重试测试用的恢复动作：只计数
+	int CountRecover(int err, void* arg) {
+		(void)err;
+		(*(int*)arg)++;
+		return 0;
+	}
+
+	// 按麦克风命令词识别的流程开始监听：有预开会话时接过来，否则新建识别器；
+	// handoverUs返回从开始到可以送数的耗时，失败返回nullptr
+	struct EsrRecognizer* StartMicCommand(long long* handoverUs) {
+		long long t0 = NowUs();
+		struct EsrRecognizer* esr = AIKITDLL::EsrStandby::Instance().Take();
+		if (esr == nullptr) {
+			esr = new EsrRecognizer();
+			if (EsrInit(esr, ESR_MIC, get_default_input_dev()) != 0) {
+				delete esr;
+				return nullptr;
+			}
+		}
+		if (EsrStartListening(esr) != 0) {
+			EsrUninit(esr);
+			delete esr;
+			return nullptr;
+		}
+		*handoverUs = NowUs() - t0;
+		return esr;
+	}
+
+	// 读一遍文件的开销：mode 0为原来的fread逐帧读取，1为内存映射，2为流方式；
+	// 每帧数据都累加进checksum，模拟引擎读取数据
+	struct FileReadCost {
+		long long wallUs;
+		unsigned long long readOps;     // 进程的读I/O操作数（系统调用）
+		unsigned long long pageFaults;
+		unsigned long long bytes;
+		unsigned long long checksum;
+	};
+
+	bool ReadFileOnce(const char* path, int mode, unsigned int frameLen, FileReadCost* cost) {
+		IO_COUNTERS io0, io1;
+		PROCESS_MEMORY_COUNTERS pm0, pm1;
+		GetProcessIoCounters(GetCurrentProcess(), &io0);
+		GetProcessMemoryInfo(GetCurrentProcess(), &pm0, sizeof(pm0));
+		long long t0 = NowUs();
+		unsigned long long sum = 0;
+		unsigned long long bytes = 0;
+
+		if (mode == 0) {
+			FILE* fp = nullptr;
+			if (fopen_s(&fp, path, "rb") != 0 || fp == nullptr) {
+				return false;
+			}
+			// 与原来的做法一致：先定位到末尾取文件大小，再逐帧读取
+			fseek(fp, 0, SEEK_END);
+			long size = ftell(fp);
+			fseek(fp, 0, SEEK_SET);
+			std::vector<char> frame(frameLen);
+			while ((long)bytes < size) {
+				size_t got = fread(frame.data(), 1, frameLen, fp);
+				if (got == 0) {
+					break;
+				}
+				for (size_t i = 0; i < got; ++i) {
+					sum += (unsigned char)frame[i];
+				}
+				bytes += got;
+			}
+			fclose(fp);
+		}
+		else {
+			SetAudioFileMapping(mode == 1 ? 1 : 0);
+			AIKITDLL::AudioFileReader reader;
+			int ret = reader.Open(path);
+			SetAudioFileMapping(1);
+			if (ret != 0) {
+				return false;
+			}
+			unsigned int len = 0;
+			const char* data;
+			while ((data = reader.Next(frameLen, &len)) != nullptr) {
+				for (unsigned int i = 0; i < len; ++i) {
+					sum += (unsigned char)data[i];
+				}
+				bytes += len;
+			}
+		}
+
+		cost->wallUs = NowUs() - t0;
+		GetProcessIoCounters(GetCurrentProcess(), &io1);
+		GetProcessMemoryInfo(GetCurrentProcess(), &pm1, sizeof(pm1));
+		cost->readOps = io1.ReadOperationCount - io0.ReadOperationCount;
+		cost->pageFaults = pm1.PageFaultCount - pm0.PageFaultCount;
+		cost->bytes = bytes;
+		cost->checksum = sum;
+		return true;
+	}
+
+	// 租借覆盖测试的写入端：第一次写入时让录音端按周期写满一圈以上，试图覆盖正在写入的这块数据；
+	// 每次都检查交给引擎的数据是否与录音内容一致（旧数据为'a'，之后录音端写入的都是'b'）
+	struct TornLeaseWriter {
+		AIKITDLL::CaptureBuffer* buffer;
+		unsigned int oldLen;           // 开始前已写入的旧数据量
+		unsigned int period;           // 录音端每次写入的数据量
+		unsigned int periods;          // 第一次写入引擎期间录音端写入的次数
+		unsigned int dropped;          // 录音端因为租借而丢弃的次数
+		unsigned long long delivered;  // 已交给引擎的字节数
+		unsigned int torn;             // 交给引擎的数据与录音内容不一致的字节数
+	};
+
+	int TornLeaseWrite(const char* data, unsigned int len, void* ctx) {
+		TornLeaseWriter* w = (TornLeaseWriter*)ctx;
+		if (w->delivered == 0) {
+			std::vector<char> fresh(w->period, 'b');
+			for (unsigned int i = 0; i < w->periods; ++i) {
+				if (!w->buffer->Write(fresh.data(), w->period)) {
+					w->dropped++;
+				}
+			}
+		}
+		for (unsigned int i = 0; i < len; ++i) {
+			char expected = w->delivered + i < w->oldLen ? 'a' : 'b';
+			if (data[i] != expected) {
+				w->torn++;
+			}
+		}
+		w->delivered += len;
+		return 0;
+	}
+
+	// G.711参考编码（ITU-T G.711附带的分段量化），用于生成A律/μ律测试文件
+	unsigned char EncodeAlaw(int pcm) {
+		static const int segEnd[8] = { 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF, 0x3FFF, 0x7FFF };
+		int mask;
+		pcm >>= 3;
+		if (pcm >= 0) {
+			mask = 0xD5;
+		}
+		else {
+			mask = 0x55;
+			pcm = -pcm - 1;
+		}
+		int seg = 0;
+		while (seg < 8 && pcm > segEnd[seg]) {
+			++seg;
+		}
+		if (seg >= 8) {
+			return (unsigned char)(0x7F ^ mask);
+		}
+		int a = seg << 4;
+		a |= seg < 2 ? (pcm >> 1) & 0x0F : (pcm >> seg) & 0x0F;
+		return (unsigned char)(a ^ mask);
+	}
+
+	unsigned char EncodeMulaw(int pcm) {
+		static const int segEnd[8] = { 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF };
+		int mask;
+		pcm >>= 2;
+		if (pcm < 0) {
+			pcm = -pcm;
+			mask = 0x7F;
+		}
+		else {
+			mask = 0xFF;
+		}
+		if (pcm > 8159) {
+			pcm = 8159;
+		}
+		pcm += 0x21;
+		int seg = 0;
+		while (seg < 8 && pcm > segEnd[seg]) {
+			++seg;
+		}
+		if (seg >= 8) {
+			return (unsigned char)(0x7F ^ mask);
+		}
+		return (unsigned char)(((seg << 4) | ((pcm >> (seg + 1)) & 0x0F)) ^ mask);
+	}
+
+	void AppendU16(std::string& s, unsigned int v) {
+		s += (char)(v & 0xFF);
+		s += (char)((v >> 8) & 0xFF);
+	}
+
+	void AppendU32(std::string& s, unsigned int v) {
+		AppendU16(s, v & 0xFFFF);
+		AppendU16(s, v >> 16);
+	}
+
+	// WAV测试文件的格式：tag为WAVE格式码，extensible时写成WAVE_FORMAT_EXTENSIBLE，
+	// listChunk时在fmt和data之间插入一个奇数长度的LIST块，unknownSize时data块长度写0（录音中途的文件）
+	struct WavFixture {
+		const char* name;
+		unsigned int tag;
+		unsigned int bits;
+		unsigned int rate;
+		unsigned int channels;
+		bool extensible;
+		bool listChunk;
+		bool unknownSize;
+	};
+
+	// 生成seconds秒、幅度为满刻度一半的1kHz正弦WAV文件，返回文件内容
+	std::string MakeWavFixture(const WavFixture& f, unsigned int seconds) {
+		const double pi = 3.14159265358979323846;
+		unsigned int frames = f.rate * seconds;
+		unsigned int blockAlign = f.channels * f.bits / 8;
+		std::string data;
+		data.reserve((size_t)frames * blockAlign);
+		for (unsigned int i = 0; i < frames; ++i) {
+			double v = 0.5 * sin(2 * pi * 1000.0 * i / f.rate);
+			for (unsigned int c = 0; c < f.channels; ++c) {
+				if (f.tag == 1 && f.bits == 16) {
+					AppendU16(data, (unsigned short)(short)lrint(v * 32767));
+				}
+				else if (f.tag == 1 && f.bits == 24) {
+					int x = (int)lrint(v * 8388607);
+					data += (char)(x & 0xFF);
+					data += (char)((x >> 8) & 0xFF);
+					data += (char)((x >> 16) & 0xFF);
+				}
+				else if (f.tag == 3 && f.bits == 32) {
+					float fv = (float)v;
+					unsigned int u;
+					memcpy(&u, &fv, sizeof(u));
+					AppendU32(data, u);
+				}
+				else if (f.tag == 6) {
+					data += (char)EncodeAlaw((int)lrint(v * 32767));
+				}
+				else if (f.tag == 7) {
+					data += (char)EncodeMulaw((int)lrint(v * 32767));
+				}
+				else {
+					data.append(f.bits / 8 > 0 ? f.bits / 8 : 1, '\0');
+				}
+			}
+		}
+
+		static const unsigned char subformatTail[14] = {
+			0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+		};
+		std::string body = "WAVEfmt ";
+		AppendU32(body, f.extensible ? 40 : 16);
+		AppendU16(body, f.extensible ? 0xFFFE : f.tag);
+		AppendU16(body, f.channels);
+		AppendU32(body, f.rate);
+		AppendU32(body, f.rate * blockAlign);
+		AppendU16(body, blockAlign);
+		AppendU16(body, f.bits);
+		if (f.extensible) {
+			AppendU16(body, 22);
+			AppendU16(body, f.bits);
+			AppendU32(body, f.channels == 2 ? 3 : 4);
+			AppendU16(body, f.tag);
+			body.append((const char*)subformatTail, sizeof(subformatTail));
+		}
+		if (f.listChunk) {
+			body += "LIST";
+			AppendU32(body, 5);
+			body += "INFOx";
+			body += '\0';
+		}
+		body += "data";
+		AppendU32(body, f.unknownSize ? 0 : (unsigned int)data.size());
+		body += data;
+
+		std::string wav = "RIFF";
+		AppendU32(wav, (unsigned int)body.size());
+		return wav + body;
+	}
+
+	bool WriteFixture(const std::string& path, const std::string& content) {
+		FILE* fp = nullptr;
+		if (fopen_s(&fp, path.c_str(), "wb") != 0 || fp == nullptr) {
+			return false;
+		}
+		size_t written = fwrite(content.data(), 1, content.size(), fp);
+		fclose(fp);
+		return written == content.size();
+	}
+
+	std::string FixturePath(const char* name) {
+		char dir[MAX_PATH];
+		GetTempPathA(MAX_PATH, dir);
+		return std::string(dir) + name;
+	}
+
+	// 按frameLen字节一段解码整个文件，返回Open的错误码
+	int DecodeFile(const std::string& path, unsigned int frameLen, std::vector<short>& out) {
+		AIKITDLL::AudioDecoder decoder;
+		int ret = decoder.Open(path.c_str());
+		if (ret != 0) {
+			return ret;
+		}
+		out.clear();
+		unsigned int len = 0;
+		const char* data;
+		while ((data = decoder.Next(frameLen, &len)) != nullptr) {
+			size_t used = out.size();
+			out.resize(used + len / 2);
+			memcpy(out.data() + used, data, len / 2 * 2);
+		}
+		return 0;
+	}
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 用按固定速率产生音频帧的模拟录音线程压测共享采集缓冲区：
+	// 读者每次取数后停顿consumerStallMs模拟引擎或磁盘卡顿，
+	// 验证录音端每次Write都不会被阻塞（单次耗时低于1ms）。返回1表示通过。
+	AIKITDLL_API int TestCaptureConsumerStall(int frameMs, int durationMs, int consumerStallMs)
+	{
+		if (frameMs <= 0 || durationMs <= 0 || consumerStallMs < 0) {
+			AIKITDLL::LogError("TestCaptureConsumerStall: 参数无效");
+			return 0;
+		}
+
+		const unsigned int frameBytes = 16000 * 2 * frameMs / 1000;
+		const int frameCount = durationMs / frameMs;
+		AIKITDLL::CaptureBuffer ring(64 * 1024);
+		AIKITDLL::CaptureConsumer* reader = ring.Subscribe(NULL);
+		if (reader == nullptr) {
+			return 0;
+		}
+		std::atomic<bool> producerDone(false);
+		long long maxPushUs = 0;
+		long long totalPushUs = 0;
+
+		// 读者：模拟一个会卡顿的引擎写入线程
+		std::thread consumer([&]() {
+			std::vector<char> buffer(6400);
+			while (!producerDone.load() || reader->Available() > 0) {
+				if (reader->Read(buffer.data(), (unsigned int)buffer.size()) == 0) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					continue;
+				}
+				if (consumerStallMs > 0) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(consumerStallMs));
+				}
+			}
+		});
+
+		// 生产者：模拟录音线程，按固定节拍送出音频帧
+		std::vector<char> frame(frameBytes);
+		for (unsigned int i = 0; i < frameBytes; ++i) {
+			frame[i] = (char)(i & 0xFF);
+		}
+		long long start = NowUs();
+		for (int i = 0; i < frameCount; ++i) {
+			long long due = start + (long long)i * frameMs * 1000;
+			long long now = NowUs();
+			if (due > now) {
+				std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+			}
+
+			long long t0 = NowUs();
+			ring.Write(frame.data(), frameBytes);
+			long long cost = NowUs() - t0;
+			totalPushUs += cost;
+			if (cost > maxPushUs) {
+				maxPushUs = cost;
+			}
+		}
+		producerDone.store(true);
+		consumer.join();
+
+		CaptureConsumerStats stats;
+		reader->GetStats(&stats);
+		ring.Unsubscribe(reader);
+		AIKITDLL::LogInfo("TestCaptureConsumerStall: 帧长 %d ms, 帧数 %d, 读者卡顿 %d ms", frameMs, frameCount, consumerStallMs);
+		AIKITDLL::LogInfo("TestCaptureConsumerStall: Write 平均 %.2f us, 最大 %lld us", frameCount > 0 ? (double)totalPushUs / frameCount : 0.0, maxPushUs);
+		AIKITDLL::LogInfo("TestCaptureConsumerStall: 积压峰值 %u/%u 字节, 被追上 %llu 次, 丢弃 %llu 字节",
+			stats.highWater, stats.capacity, stats.laps, stats.lostBytes);
+
+		return maxPushUs < 1000 ? 1 : 0;
+	}
+
+	// 流式唤醒长时压测：模拟录音线程以speedup倍速产生audioHours小时的200ms音频帧，
+	// 送数循环与ivw_microphone相同（事件等待 + PumpCapture），用空写入代替引擎。
+	// 每模拟一分钟采样一次进程私有内存，报告内存波动和录音到写入的延迟分布。
+	// 内存增长低于1MB且最大延迟低于50ms时返回1。
+	AIKITDLL_API int BenchIvwStreaming(double audioHours, int speedup)
+	{
+		if (audioHours <= 0 || speedup <= 0) {
+			AIKITDLL::LogError("BenchIvwStreaming: 参数无效");
+			return 0;
+		}
+
+		const unsigned int frameMs = 200;
+		const unsigned int frameBytes = 16000 * 2 * frameMs / 1000;
+		const unsigned int slotCount = 64;
+		const unsigned long long frameCount = (unsigned long long)(audioHours * 3600 * 1000 / frameMs);
+		const unsigned long long framesPerMinute = 60 * 1000 / frameMs;
+
+		AIKITDLL::CaptureBuffer buffer(64 * 1024);
+		HANDLE dataEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		AIKITDLL::CaptureConsumer* consumer = buffer.Subscribe(dataEvent);
+		std::vector<long long> pushTimes(slotCount, 0);
+		std::atomic<bool> producerDone(false);
+
+		StreamBenchWriter writer;
+		writer.pushTimes = pushTimes.data();
+		writer.slotCount = slotCount;
+		writer.frameBytes = frameBytes;
+		writer.consumed = 0;
+
+		// 送数循环，与ivw_microphone一致
+		std::thread pump([&]() {
+			while (!producerDone.load() || consumer->Available() > 0) {
+				WaitForSingleObject(dataEvent, 100);
+				unsigned int written = 0;
+				AIKITDLL::PumpCapture(consumer, 10 * FRAME_LEN, nullptr, StreamBenchWrite, &writer, &written);
+			}
+		});
+
+		std::vector<char> frame(frameBytes, 0);
+		size_t baseMem = 0, minMem = 0, maxMem = 0;
+		long long start = NowUs();
+		long long framePeriodUs = (long long)frameMs * 1000 / speedup;
+		for (unsigned long long i = 0; i < frameCount; ++i) {
+			long long due = start + (long long)i * framePeriodUs;
+			long long now = NowUs();
+			if (due > now) {
+				std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+			}
+
+			pushTimes[i % slotCount] = NowUs();
+			buffer.Write(frame.data(), frameBytes);
+
+			if (i % framesPerMinute == 0) {
+				size_t mem = CurrentPrivateBytes();
+				if (i == framesPerMinute) {
+					// 第一分钟作为预热，之后的内存作为基线
+					baseMem = minMem = maxMem = mem;
+				}
+				else if (i > framesPerMinute) {
+					if (mem < minMem) minMem = mem;
+					if (mem > maxMem) maxMem = mem;
+				}
+			}
+		}
+		producerDone.store(true);
+		SetEvent(dataEvent);
+		pump.join();
+
+		double wallSec = (NowUs() - start) / 1000000.0;
+		CaptureConsumerStats stats;
+		consumer->GetStats(&stats);
+		buffer.Unsubscribe(consumer);
+		CloseHandle(dataEvent);
+		AIKITDLL::LogInfo("BenchIvwStreaming: 模拟音频 %.2f 小时（%d 倍速），耗时 %.1f 秒", audioHours, speedup, wallSec);
+		AIKITDLL::LogInfo("BenchIvwStreaming: 私有内存 基线 %zu KB, 最小 %zu KB, 最大 %zu KB",
+			baseMem / 1024, minMem / 1024, maxMem / 1024);
+		AIKITDLL::LogInfo("BenchIvwStreaming: 送数延迟 平均 %.1f us, P50 <= %lld us, P99 <= %lld us, 最大 %lld us",
+			writer.latency.count ? (double)writer.latency.totalUs / writer.latency.count : 0.0,
+			writer.latency.Percentile(0.5), writer.latency.Percentile(0.99), writer.latency.maxUs);
+		AIKITDLL::LogInfo("BenchIvwStreaming: 写入 %llu 字节, 积压峰值 %u 字节, 被追上 %llu 次",
+			writer.consumed, stats.highWater, stats.laps);
+		// 录音回调写入共享缓冲区是唯一的一次拷贝，送数环节应全部走零拷贝租借
+		AIKITDLL::LogInfo("BenchIvwStreaming: 每秒拷贝 %.0f 字节, 每秒零拷贝送数 %.0f 字节, 为保护租借丢弃录音 %llu 字节",
+			buffer.CopiedBytes() / wallSec, buffer.LeasedBytes() / wallSec, stats.blockedBytes);
+
+		bool memFlat = (maxMem - minMem) < 1024 * 1024;
+		bool latencyBounded = writer.latency.maxUs < 50 * 1000;
+		return (memFlat && latencyBounded) ? 1 : 0;
+	}
+
+	// 录音延迟压测：依次以10/20/50/200ms的录音周期和bufferDepth的队列深度打开当前音频源，
+	// 每种配置录音durationMs，送数循环与ivw_microphone相同，用空写入代替AIKIT_Write。
+	// 报告每种配置下从音频采集到写入的延迟（周期本身的缓冲时间 + 回调到写入的时间），
+	// 以及回调最大间隔和丢失的音频量。返回能持续运行且没有丢数据的最小周期（ms），都不满足时返回0。
+	AIKITDLL_API int BenchCaptureLatency(int durationMs, int bufferDepth)
+	{
+		static const unsigned int periods[] = { 10, 20, 50, 200 };
+		const unsigned int slotCount = 256;
+		int bestPeriod = 0;
+
+		if (durationMs <= 0 || bufferDepth < RECORD_MIN_DEPTH || bufferDepth > RECORD_MAX_DEPTH) {
+			AIKITDLL::LogError("BenchCaptureLatency: 参数无效");
+			return 0;
+		}
+
+		WAVEFORMATEX waveform;
+		waveform.wFormatTag = WAVE_FORMAT_PCM;
+		waveform.nSamplesPerSec = 16000;
+		waveform.wBitsPerSample = 16;
+		waveform.nChannels = 1;
+		waveform.nAvgBytesPerSec = 16000 * 2;
+		waveform.nBlockAlign = 2;
+		waveform.cbSize = 0;
+
+		for (unsigned int period : periods) {
+			AIKITDLL::CaptureBuffer buffer(64 * 1024);
+			HANDLE dataEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+			AIKITDLL::CaptureConsumer* consumer = buffer.Subscribe(dataEvent);
+			std::vector<long long> pushTimes(slotCount, 0);
+			const unsigned int periodBytes = 16 * 2 * period;
+			CaptureBenchContext ctx;
+			memset(&ctx, 0, sizeof(ctx));
+			ctx.buffer = &buffer;
+			ctx.pushTimes = pushTimes.data();
+			ctx.slotCount = slotCount;
+			ctx.frameBytes = periodBytes;
+
+			StreamBenchWriter writer;
+			writer.pushTimes = pushTimes.data();
+			writer.slotCount = slotCount;
+			writer.frameBytes = periodBytes;
+			writer.consumed = 0;
+
+			struct recorder* rec = nullptr;
+			if (create_recorder(&rec, CaptureBenchCallback, &ctx) != 0 || rec == nullptr
+				|| open_recorder_ex(rec, get_default_input_dev(), &waveform, period, bufferDepth) != 0
+				|| start_record(rec) != 0) {
+				AIKITDLL::LogError("BenchCaptureLatency: 周期 %u ms 打开录音失败", period);
+				if (rec) {
+					close_recorder(rec);
+					destroy_recorder(rec);
+				}
+				buffer.Unsubscribe(consumer);
+				CloseHandle(dataEvent);
+				continue;
+			}
+
+			long long start = NowUs();
+			while (NowUs() - start < (long long)durationMs * 1000) {
+				WaitForSingleObject(dataEvent, 100);
+				AIKITDLL::PumpCapture(consumer, periodBytes, nullptr, StreamBenchWrite, &writer, nullptr);
+			}
+			long long elapsedUs = NowUs() - start;
+			stop_record(rec);
+			while (!is_record_stopped(rec)) {
+				Sleep(1);
+			}
+			struct record_stats recStats;
+			get_recorder_stats(rec, &recStats);
+			close_recorder(rec);
+			destroy_recorder(rec);
+
+			// 期望收到的数据量扣除仍在驱动队列中的部分，剩余的缺口即为丢失的音频
+			long long expected = elapsedUs * 32 / 1000 - (long long)periodBytes * bufferDepth;
+			long long lostMs = expected > (long long)ctx.bytes ? (expected - (long long)ctx.bytes) / 32 : 0;
+			CaptureConsumerStats stats;
+			consumer->GetStats(&stats);
+			buffer.Unsubscribe(consumer);
+			CloseHandle(dataEvent);
+			bool sustained = lostMs < (long long)period && stats.laps == 0;
+
+			AIKITDLL::LogInfo("BenchCaptureLatency: 周期 %u ms, 深度 %d: 采集到写入延迟 平均 %.1f ms, P99 <= %.1f ms, 最大 %.1f ms",
+				period, bufferDepth,
+				period + (writer.latency.count ? (double)writer.latency.totalUs / writer.latency.count / 1000.0 : 0.0),
+				period + writer.latency.Percentile(0.99) / 1000.0,
+				period + writer.latency.maxUs / 1000.0);
+			AIKITDLL::LogInfo("BenchCaptureLatency: 周期 %u ms: 回调 %llu 次, 最大间隔 %.1f ms, 丢失约 %lld ms 音频, 送数被追上 %llu 次%s",
+				period, ctx.frames, ctx.maxGapUs / 1000.0, lostMs, stats.laps, sustained ? "" : "（无法持续）");
+			AIKITDLL::LogInfo("BenchCaptureLatency: 周期 %u ms: 录音层检测到丢帧 %u 次共 %llu ms, 溢出 %u 次, 最长停顿 %.1f ms, 队列扩容到 %u",
+				period, recStats.gaps, recStats.lost_bytes / 32, recStats.overruns, recStats.max_stall_us / 1000.0, recStats.depth);
+
+			if (sustained && bestPeriod == 0) {
+				bestPeriod = (int)period;
+			}
+		}
+
+		AIKITDLL::LogInfo("BenchCaptureLatency: 可持续的最小录音周期 %d ms", bestPeriod);
+		return bestPeriod;
+	}
+
+	// 唤醒到命令词识别的切换压测，对比两种方式下切换期间丢失的音频：
+	// 旧方式：关闭唤醒的录音对象再打开识别的录音对象，丢失量为前者最后一块数据到后者第一块数据开始录制之间的时间；
+	// 共享采集：设备一直打开，唤醒读者取消订阅后识别读者立即订阅，丢失量为两个读者读位置之间的差值。
+	// 每种方式切换rounds次，共享采集的平均丢失低于旧方式时返回1。
+	AIKITDLL_API int BenchCaptureHandover(int rounds)
+	{
+		if (rounds <= 0) {
+			AIKITDLL::LogError("BenchCaptureHandover: 参数无效");
+			return 0;
+		}
+
+		unsigned int periodMs = 0;
+		get_record_period(&periodMs, nullptr);
+		const long long periodUs = (long long)periodMs * 1000;
+		HANDLE dataEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		LatencyHistogram reopenGap, reopenOpen, sharedGap;
+
+		// 旧方式：每次切换都关闭并重新打开设备
+		for (int i = 0; i < rounds; ++i) {
+			HandoverRecorder first = { dataEvent, 0 };
+			HandoverRecorder second = { dataEvent, 0 };
+			struct recorder* rec = OpenHandoverRecorder(&first, nullptr);
+			if (!rec) {
+				AIKITDLL::LogError("BenchCaptureHandover: 打开录音设备失败");
+				CloseHandle(dataEvent);
+				return 0;
+			}
+			WaitForSingleObject(dataEvent, 2000);
+			CloseHandoverRecorder(rec);
+
+			long long openUs = 0;
+			rec = OpenHandoverRecorder(&second, &openUs);
+			if (!rec) {
+				AIKITDLL::LogError("BenchCaptureHandover: 重新打开录音设备失败");
+				CloseHandle(dataEvent);
+				return 0;
+			}
+			WaitForSingleObject(dataEvent, 2000);
+			CloseHandoverRecorder(rec);
+
+			long long gap = (second.lastUs - periodUs) - first.lastUs;
+			reopenGap.Add(gap > 0 ? gap : 0);
+			reopenOpen.Add(openUs);
+		}
+
+		// 共享采集：设备保持打开，只更换读者
+		AIKITDLL::CaptureHub& hub = AIKITDLL::CaptureHub::Instance();
+		if (hub.Acquire() != 0) {
+			AIKITDLL::LogError("BenchCaptureHandover: 打开共享录音设备失败");
+			CloseHandle(dataEvent);
+			return 0;
+		}
+		unsigned long long opensBefore = hub.OpenCount();
+		std::vector<char> chunk(6400);
+		for (int i = 0; i < rounds; ++i) {
+			AIKITDLL::CaptureConsumer* first = hub.Subscribe(dataEvent);
+			WaitForSingleObject(dataEvent, 2000);
+			while (first->Read(chunk.data(), (unsigned int)chunk.size()) > 0) {
+			}
+			unsigned long long endPos = first->Position();
+			hub.Unsubscribe(first);
+
+			AIKITDLL::CaptureConsumer* second = hub.Subscribe(dataEvent);
+			unsigned long long startPos = second->Position();
+			hub.Unsubscribe(second);
+
+			// 16k/16bit单声道：32字节为1ms
+			sharedGap.Add((long long)(startPos - endPos) * 1000 / 32);
+		}
+		unsigned long long reopened = hub.OpenCount() - opensBefore;
+		hub.Release();
+		CloseHandle(dataEvent);
+
+		double reopenAvgMs = (double)reopenGap.totalUs / reopenGap.count / 1000.0;
+		double sharedAvgMs = (double)sharedGap.totalUs / sharedGap.count / 1000.0;
+		AIKITDLL::LogInfo("BenchCaptureHandover: 重开设备 %d 次: 丢失音频 平均 %.1f ms, 最大 %.1f ms; 打开设备耗时 平均 %.1f ms",
+			rounds, reopenAvgMs, reopenGap.maxUs / 1000.0, (double)reopenOpen.totalUs / reopenOpen.count / 1000.0);
+		AIKITDLL::LogInfo("BenchCaptureHandover: 共享采集切换 %d 次: 丢失音频 平均 %.1f ms, 最大 %.1f ms, 期间重开设备 %llu 次",
+			rounds, sharedAvgMs, sharedGap.maxUs / 1000.0, reopened);
+
+		return (sharedAvgMs < reopenAvgMs && reopened == 0) ? 1 : 0;
+	}
+
+	// 预录回放测试：wavPath是16k/16bit单声道录音，内容为一条接一条紧跟在唤醒词后说出的命令。
+	// 分别关闭预录和使用prerollMs预录各回放一遍，比较命令词识别率（识别成功次数/唤醒次数）。
+	// 返回1表示开启预录后识别率不低于关闭时且有唤醒发生。
+	AIKITDLL_API int TestPrerollReplay(const char* wavPath, int prerollMs)
+	{
+		if (!wavPath || prerollMs <= 0) {
+			AIKITDLL::LogError("TestPrerollReplay: 参数无效");
+			return 0;
+		}
+
+		FILE* fp = nullptr;
+		if (fopen_s(&fp, wavPath, "rb") != 0 || !fp) {
+			AIKITDLL::LogError("TestPrerollReplay: 打开文件失败: %s", wavPath);
+			return 0;
+		}
+		fseek(fp, 0, SEEK_END);
+		long fileSize = ftell(fp);
+		fclose(fp);
+		// 16k/16bit单声道：32字节为1ms
+		DWORD durationMs = fileSize > 44 ? (DWORD)((fileSize - 44) / 32) : 0;
+		if (durationMs == 0) {
+			AIKITDLL::LogError("TestPrerollReplay: 文件为空: %s", wavPath);
+			return 0;
+		}
+
+		unsigned int savedPreroll = AIKITDLL::CaptureHub::Instance().PrerollMs();
+		int offWakeups = 0, offCommands = 0;
+		int onWakeups = 0, onCommands = 0;
+		bool ok = RunPrerollPass(wavPath, durationMs, 0, &offWakeups, &offCommands)
+			&& RunPrerollPass(wavPath, durationMs, prerollMs, &onWakeups, &onCommands);
+
+		SetCommandPrerollMs((int)savedPreroll);
+		set_audio_source(NULL);  // 恢复平台默认的录音设备
+		if (!ok) {
+			AIKITDLL::LogError("TestPrerollReplay: 启动语音助手失败");
+			return 0;
+		}
+
+		double offRate = offWakeups > 0 ? (double)offCommands / offWakeups : 0.0;
+		double onRate = onWakeups > 0 ? (double)onCommands / onWakeups : 0.0;
+		AIKITDLL::LogInfo("TestPrerollReplay: 关闭预录: 唤醒 %d 次, 识别成功 %d 次, 识别率 %.0f%%",
+			offWakeups, offCommands, offRate * 100);
+		AIKITDLL::LogInfo("TestPrerollReplay: 预录 %d ms: 唤醒 %d 次, 识别成功 %d 次, 识别率 %.0f%%",
+			prerollMs, onWakeups, onCommands, onRate * 100);
+
+		return (onWakeups > 0 && onRate >= offRate) ? 1 : 0;
+	}
+
+	// 录音丢帧检测测试：用合成音频源（实时节奏，积压超过1秒时丢弃积压，和驱动缓冲区耗尽一样）
+	// 以20ms周期录音，回调卡顿一次：
+	// 1) 卡顿150ms：积压能补上，不应报告丢帧；
+	// 2) 卡顿1500ms：积压被丢弃，应报告一次丢帧，丢失量与丢弃的时长相差不超过两个周期。返回1表示通过。
+	AIKITDLL_API int TestCaptureGapDetection()
+	{
+		static const unsigned int stalls[] = { 150, 1500 };
+		struct audio_source_config cfg;
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.type = AUDIO_SOURCE_SYNTH;
+		cfg.speed = 1.0;
+		cfg.tone_hz = 440;
+		cfg.level = 3000;
+
+		WAVEFORMATEX waveform;
+		waveform.wFormatTag = WAVE_FORMAT_PCM;
+		waveform.nSamplesPerSec = 16000;
+		waveform.wBitsPerSample = 16;
+		waveform.nChannels = 1;
+		waveform.nAvgBytesPerSec = 16000 * 2;
+		waveform.nBlockAlign = 2;
+		waveform.cbSize = 0;
+
+		bool passed = true;
+		for (unsigned int stallMs : stalls) {
+			set_audio_source(&cfg);
+			GapTestContext ctx = { 0, 25, stallMs };
+			struct recorder* rec = nullptr;
+			if (create_recorder(&rec, GapTestCallback, &ctx) != 0 || rec == nullptr
+				|| open_recorder_ex(rec, 0, &waveform, 20, 4) != 0 || start_record(rec) != 0) {
+				AIKITDLL::LogError("TestCaptureGapDetection: 打开合成音频源失败");
+				if (rec) {
+					close_recorder(rec);
+					destroy_recorder(rec);
+				}
+				passed = false;
+				break;
+			}
+			Sleep(stallMs + 2000);
+			stop_record(rec);
+			while (!is_record_stopped(rec)) {
+				Sleep(1);
+			}
+			struct record_stats stats;
+			get_recorder_stats(rec, &stats);
+			close_recorder(rec);
+			destroy_recorder(rec);
+
+			// 合成源在积压超过1秒时直接跳到当前时间，丢失的是卡顿时长减去一个周期
+			unsigned long long lostMs = stats.lost_bytes / 32;
+			bool ok = stallMs < 1000
+				? stats.gaps == 0
+				: stats.gaps == 1 && lostMs + 40 >= stallMs && lostMs <= stallMs + 40;
+			AIKITDLL::LogInfo("TestCaptureGapDetection: 卡顿 %u ms: 回调 %llu 次, 丢帧 %u 次共 %llu ms%s",
+				stallMs, stats.periods, stats.gaps, lostMs, ok ? "" : "（不符合预期）");
+			passed = passed && ok;
+		}
+
+		set_audio_source(NULL);  // 恢复平台默认的录音设备
+		return passed ? 1 : 0;
+	}
+
+	// 唤醒重新就绪耗时测试：按语音助手的流程模拟rounds次“唤醒 -> 命令词 -> 回到唤醒监听”，
+	// 分别在关闭和开启常驻引擎模式下测量
+	// 1) 离开唤醒监听的耗时（IvwEngineRelease）；
+	// 2) 命令词结束后重新就绪的耗时（IvwEngineAcquire + 注册回调 + 开始会话 + 第一次写入成功）。
+	// 需要SDK可用。返回1表示常驻模式下的平均重新就绪耗时更短。
+	AIKITDLL_API int BenchIvwRearm(int rounds)
+	{
+		if (rounds <= 0) {
+			rounds = 10;
+		}
+		if (!AIKITDLL::SafeInitSDK()) {
+			AIKITDLL::LogError("BenchIvwRearm: SDK初始化失败");
+			return 0;
+		}
+
+		AIKIT_Callbacks cbs = { AIKITDLL::OnOutput, AIKITDLL::OnEvent, AIKITDLL::OnError };
+		bool savedResident = AIKITDLL::ivwResidentEngine.load();
+		double releaseMs[2] = { 0, 0 };
+		double rearmMs[2] = { 0, 0 };
+		double rearmMaxMs[2] = { 0, 0 };
+		bool ok = true;
+
+		for (int mode = 0; mode < 2 && ok; ++mode) {
+			AIKITDLL::ivwResidentEngine.store(mode == 1);
+			// 第一次加载不计入：两种模式都要在进程启动时完整初始化一次
+			if (AIKITDLL::IvwEngineAcquire() != 0) {
+				AIKITDLL::LogError("BenchIvwRearm: 唤醒引擎初始化失败");
+				ok = false;
+				break;
+			}
+
+			for (int r = 0; r < rounds; ++r) {
+				long long t0 = NowUs();
+				AIKITDLL::IvwEngineRelease();
+				long long t1 = NowUs();
+
+				AIKIT_HANDLE* handle = nullptr;
+				int ret = AIKITDLL::IvwEngineAcquire();
+				if (ret == 0) {
+					ret = AIKIT::AIKIT_RegisterAbilityCallback(IVW_ABILITY, cbs);
+				}
+				if (ret == 0) {
+					ret = StartIvwSession(&handle);
+				}
+				long long t2 = NowUs();
+				if (handle) {
+					AIKIT::AIKIT_End(handle);
+				}
+				if (ret != 0) {
+					AIKITDLL::LogError("BenchIvwRearm: 第 %d 轮重新开始唤醒失败: %d", r + 1, ret);
+					ok = false;
+					break;
+				}
+
+				double rearm = (t2 - t1) / 1000.0;
+				releaseMs[mode] += (t1 - t0) / 1000.0;
+				rearmMs[mode] += rearm;
+				if (rearm > rearmMaxMs[mode]) {
+					rearmMaxMs[mode] = rearm;
+				}
+			}
+		}
+
+		AIKITDLL::ivwResidentEngine.store(savedResident);
+		if (!savedResident) {
+			Ivw70Uninit();
+		}
+		if (!ok) {
+			return 0;
+		}
+
+		for (int mode = 0; mode < 2; ++mode) {
+			AIKITDLL::LogInfo("BenchIvwRearm: %s: 离开唤醒监听平均 %.1f ms, 重新就绪平均 %.1f ms, 最长 %.1f ms",
+				mode == 1 ? "常驻引擎" : "每次重新加载",
+				releaseMs[mode] / rounds, rearmMs[mode] / rounds, rearmMaxMs[mode]);
+		}
+		return rearmMs[1] < rearmMs[0] ? 1 : 0;
+	}
+
+	// 命令词启动耗时测试：rounds次“开始识别 -> 第一次写入成功”（静音数据，不经过采集流），
+	// 分别在每轮前卸载引擎（冷启动）和引擎、语法常驻两种情况下测量，并输出各阶段平均耗时。
+	// 需要SDK可用。返回1表示常驻时的平均首次写入耗时更短。
+	AIKITDLL_API int BenchEsrStartup(int rounds)
+	{
+		if (rounds <= 0) {
+			rounds = 10;
+		}
+		if (!AIKITDLL::SafeInitSDK()) {
+			AIKITDLL::LogError("BenchEsrStartup: SDK初始化失败");
+			return 0;
+		}
+
+		AIKIT_Callbacks cbs = { AIKITDLL::OnOutput, AIKITDLL::OnEvent, AIKITDLL::OnError };
+		EsrPhaseTimes sum[2] = {};
+		long long firstMax[2] = { 0, 0 };
+		bool ok = true;
+
+		for (int mode = 0; mode < 2 && ok; ++mode) {
+			for (int r = 0; r < rounds; ++r) {
+				if (mode == 0 && AIKITDLL::esrEngineLoaded.load()) {
+					CnenEsrUninit();
+				}
+				EsrPhaseTimes times = {};
+				int ret = StartEsrRound(cbs, &times);
+				if (ret != 0) {
+					AIKITDLL::LogError("BenchEsrStartup: 第 %d 轮启动识别失败: %d", r + 1, ret);
+					ok = false;
+					break;
+				}
+				sum[mode].registerUs += times.registerUs;
+				sum[mode].engineUs += times.engineUs;
+				sum[mode].recognizerUs += times.recognizerUs;
+				sum[mode].startUs += times.startUs;
+				sum[mode].readyUs += times.readyUs;
+				sum[mode].firstWriteUs += times.firstWriteUs;
+				sum[mode].engineLoaded += times.engineLoaded;
+				if (times.readyUs + times.firstWriteUs > firstMax[mode]) {
+					firstMax[mode] = times.readyUs + times.firstWriteUs;
+				}
+			}
+		}
+		if (!ok) {
+			return 0;
+		}
+
+		for (int mode = 0; mode < 2; ++mode) {
+			AIKITDLL::LogInfo("BenchEsrStartup: %s: 注册 %.2f ms, 引擎 %.2f ms (加载 %d 次), 识别器 %.2f ms, 开始会话 %.2f ms, "
+				"首次写入 %.2f ms, 合计平均 %.2f ms, 最长 %.2f ms",
+				mode == 1 ? "常驻引擎" : "冷启动",
+				sum[mode].registerUs / 1000.0 / rounds, sum[mode].engineUs / 1000.0 / rounds, sum[mode].engineLoaded,
+				sum[mode].recognizerUs / 1000.0 / rounds, sum[mode].startUs / 1000.0 / rounds,
+				sum[mode].firstWriteUs / 1000.0 / rounds,
+				(sum[mode].readyUs + sum[mode].firstWriteUs) / 1000.0 / rounds, firstMax[mode] / 1000.0);
+		}
+		return sum[1].readyUs + sum[1].firstWriteUs < sum[0].readyUs + sum[0].firstWriteUs ? 1 : 0;
+	}
+
+	// 冷启动耗时测试：卸载引擎并反初始化SDK后，分别用1个线程（依次加载）和2个线程（并行加载）
+	// 启动，测量唤醒引擎就绪（可开始唤醒监听）和全部引擎就绪的耗时，并输出启动时间线。
+	// 需要SDK可用。返回1表示并行加载时全部就绪更快且唤醒就绪不晚于依次加载。
+	AIKITDLL_API int BenchEngineWarmup()
+	{
+		AIKITDLL::EngineWarmup& warmup = AIKITDLL::EngineWarmup::Instance();
+		double ivwReadyMs[2] = { 0, 0 };
+		double allReadyMs[2] = { 0, 0 };
+
+		for (int mode = 0; mode < 2; ++mode) {
+			warmup.Invalidate();
+			Ivw70Uninit();
+			CnenEsrUninit();
+			AIKITDLL::SafeCleanupSDK();
+
+			warmup.SetWorkers(mode == 0 ? 1 : 2);
+			long long t0 = NowUs();
+			if (!warmup.Start()) {
+				AIKITDLL::LogError("BenchEngineWarmup: SDK初始化失败");
+				return 0;
+			}
+			WarmupState ivw = warmup.WaitReady(WARMUP_IVW, 60000);
+			long long t1 = NowUs();
+			WarmupState esr = warmup.WaitReady(WARMUP_ESR, 60000);
+			long long t2 = NowUs();
+			if (ivw != WARMUP_READY || esr != WARMUP_READY) {
+				AIKITDLL::LogError("BenchEngineWarmup: 引擎加载失败 (唤醒=%d, 命令词=%d)", ivw, esr);
+				warmup.Join();
+				return 0;
+			}
+			ivwReadyMs[mode] = (t1 - t0) / 1000.0;
+			allReadyMs[mode] = (t2 - t0) / 1000.0;
+			warmup.Join();
+
+			StartupTimeline timeline;
+			warmup.GetTimeline(&timeline);
+			AIKITDLL::LogInfo("BenchEngineWarmup: %s: SDK %.1f ms, 唤醒引擎 +%.1f/%.1f ms, 命令词引擎 +%.1f/%.1f ms, "
+				"唤醒就绪 %.1f ms, 全部就绪 %.1f ms",
+				mode == 0 ? "依次加载" : "并行加载",
+				timeline.steps[STARTUP_SDK].durationUs / 1000.0,
+				timeline.steps[STARTUP_IVW_ENGINE].beginUs / 1000.0, timeline.steps[STARTUP_IVW_ENGINE].durationUs / 1000.0,
+				timeline.steps[STARTUP_ESR_ENGINE].beginUs / 1000.0, timeline.steps[STARTUP_ESR_ENGINE].durationUs / 1000.0,
+				ivwReadyMs[mode], allReadyMs[mode]);
+		}
+		warmup.SetWorkers(2);
+		// 唤醒就绪时间允许10%的抖动：两种方式下唤醒引擎都是第一个加载
+		return allReadyMs[1] < allReadyMs[0] && ivwReadyMs[1] <= ivwReadyMs[0] * 1.1 ? 1 : 0;
+	}
+
+	// 送数循环内存分配测试：按20ms录音周期回放语料，走与ivw_microphone相同的
+	// 共享缓冲区 -> 静音门限 -> 写入引擎路径，前1秒预热后统计送数线程上的内存分配。
+	// 先不经过门限跑一遍（帧长固定，稳态），再经过门限跑一遍（回放预录音频时帧长会变化，
+	// 允许重新构建的帧分配）。useEngine非0且SDK可用时写入真实的唤醒引擎。
+	// 只统计本模块CRT堆上的分配，SDK自身的分配不在统计范围内。
+	// 需要Debug版本（使用_CrtSetAllocHook），Release版本返回-1；返回1表示稳态送数没有分配。
+	AIKITDLL_API int TestFeedLoopAllocations(int useEngine)
+	{
+#ifndef _DEBUG
+		(void)useEngine;
+		AIKITDLL::LogWarning("TestFeedLoopAllocations: 需要Debug版本才能统计内存分配");
+		return -1;
+#else
+		const unsigned int periodSamples = 320;
+		const size_t warmupSamples = 16000;
+		std::vector<short> pcm;
+		MakeQuietCorpus(pcm, 30);
+
+		bool engine = false;
+		if (useEngine && AIKITDLL::SafeInitSDK() && AIKITDLL::IvwEngineAcquire() == 0) {
+			engine = true;
+		}
+		else if (useEngine) {
+			AIKITDLL::LogWarning("TestFeedLoopAllocations: 唤醒引擎不可用，只构建音频帧");
+		}
+
+		long steadyAllocs[2] = { 0, 0 };
+		AllocFeedWriter writers[2];
+		memset(writers, 0, sizeof(writers));
+		bool ok = true;
+
+		for (int pass = 0; pass < 2 && ok; ++pass) {
+			AllocFeedWriter* w = &writers[pass];
+			AIKITDLL::AudioFrame frame("wav", false);
+			w->frame = &frame;
+			if (engine && AIKIT::AIKIT_Start(IVW_ABILITY, AIKITDLL::IvwSessionParams(900), nullptr, &w->handle) != 0) {
+				AIKITDLL::LogError("TestFeedLoopAllocations: 启动唤醒会话失败");
+				w->handle = nullptr;
+				ok = false;
+				break;
+			}
+
+			struct vad_gate* gate = pass == 1 ? vad_gate_create(16000, VAD_DEFAULT_PREROLL_MS, VAD_DEFAULT_HANGOVER_MS) : nullptr;
+			AIKITDLL::CaptureBuffer buffer(64 * 1024);
+			AIKITDLL::CaptureConsumer* consumer = buffer.Subscribe(NULL);
+			_CRT_ALLOC_HOOK savedHook = nullptr;
+			bool counting = false;
+			for (size_t i = 0; i < pcm.size(); i += periodSamples) {
+				if (!counting && i >= warmupSamples) {
+					g_feedAllocThread = GetCurrentThreadId();
+					g_feedAllocs = 0;
+					w->rebuildAllocs = 0;
+					w->rebuiltFrames = 0;
+					savedHook = _CrtSetAllocHook(FeedAllocHook);
+					counting = true;
+				}
+				size_t n = pcm.size() - i < periodSamples ? pcm.size() - i : periodSamples;
+				buffer.Write((const char*)(pcm.data() + i), (unsigned int)(n * 2));
+				AIKITDLL::PumpCapture(consumer, periodSamples * 2, gate, AllocFeedWrite, w, nullptr);
+			}
+			if (counting) {
+				_CrtSetAllocHook(savedHook);
+				g_feedAllocThread = 0;
+			}
+			steadyAllocs[pass] = g_feedAllocs - w->rebuildAllocs;
+
+			buffer.Unsubscribe(consumer);
+			if (gate) {
+				vad_gate_destroy(gate);
+			}
+			if (w->handle) {
+				AIKIT::AIKIT_End(w->handle);
+			}
+			w->frame = nullptr;
+
+			AIKITDLL::LogInfo("TestFeedLoopAllocations: %s: 写入 %llu 次, 重新构建 %llu 帧（分配 %ld 次）, 其余帧分配 %ld 次",
+				pass == 0 ? "关闭门限" : "开启门限", w->writes, w->rebuiltFrames, w->rebuildAllocs, steadyAllocs[pass]);
+		}
+
+		if (engine) {
+			AIKITDLL::IvwEngineRelease();
+		}
+		if (!ok) {
+			return 0;
+		}
+
+		BuilderCacheStats stats;
+		GetBuilderCacheStats(&stats);
+		AIKITDLL::LogInfo("TestFeedLoopAllocations: 参数集 %u 个（复用 %llu 次）, 数据构建器 %u 个, 复用帧 %llu, 重新构建帧 %llu%s",
+			stats.paramSets, stats.paramHits, stats.createdBuilders, stats.frameReuses, stats.frameRebuilds,
+			engine ? "" : "（未接引擎）");
+
+		// 关闭门限时帧长固定，预热后不应再重新构建
+		return steadyAllocs[0] == 0 && steadyAllocs[1] == 0 && writers[0].rebuiltFrames == 0 ? 1 : 0;
+#endif
+	}
+
+	// 拆除等待测试（不需要SDK）：
+	// 1) 没有回调在执行时立即返回；
+	// 2) 另一线程上的回调执行30ms，等待在回调返回时结束，而不是等到上限；
+	// 3) 在回调内部等待时不等自己；
+	// 4) 唤醒会话在20ms后结束，等待在会话结束时返回。返回1表示通过。
+	AIKITDLL_API int TestTeardownWaits()
+	{
+		AIKITDLL::Teardown& teardown = AIKITDLL::Teardown::Instance();
+		const unsigned int limitMs = 1000;
+		bool ok = true;
+
+		long long t0 = NowUs();
+		bool idle = teardown.WaitCallbacksIdle(limitMs);
+		double idleMs = (NowUs() - t0) / 1000.0;
+		if (!idle || idleMs > 5.0) {
+			AIKITDLL::LogError("TestTeardownWaits: 没有回调时等待了 %.1f ms", idleMs);
+			ok = false;
+		}
+
+		HANDLE entered = CreateEvent(NULL, TRUE, FALSE, NULL);
+		std::thread callback([entered]() {
+			AIKITDLL::CallbackScope scope;
+			SetEvent(entered);
+			Sleep(30);
+		});
+		WaitForSingleObject(entered, INFINITE);
+		t0 = NowUs();
+		bool done = teardown.WaitCallbacksIdle(limitMs);
+		double callbackMs = (NowUs() - t0) / 1000.0;
+		callback.join();
+		CloseHandle(entered);
+		if (!done || callbackMs > 200.0) {
+			AIKITDLL::LogError("TestTeardownWaits: 等待回调返回用了 %.1f ms", callbackMs);
+			ok = false;
+		}
+
+		double nestedMs;
+		{
+			AIKITDLL::CallbackScope scope;
+			t0 = NowUs();
+			done = teardown.WaitCallbacksIdle(limitMs);
+			nestedMs = (NowUs() - t0) / 1000.0;
+		}
+		if (!done || nestedMs > 5.0) {
+			AIKITDLL::LogError("TestTeardownWaits: 回调内等待用了 %.1f ms", nestedMs);
+			ok = false;
+		}
+
+		double sessionMs = -1.0;
+		if (AIKITDLL::g_ivwSessionActive.load()) {
+			AIKITDLL::LogWarning("TestTeardownWaits: 有唤醒会话在运行，跳过会话等待测试");
+		}
+		else {
+			AIKITDLL::g_ivwSessionActive.store(true);
+			std::thread session([]() {
+				Sleep(20);
+				AIKITDLL::EndIvwSession();
+			});
+			t0 = NowUs();
+			done = AIKITDLL::WaitIvwSessionEnded(limitMs);
+			sessionMs = (NowUs() - t0) / 1000.0;
+			session.join();
+			if (!done || sessionMs > 200.0) {
+				AIKITDLL::LogError("TestTeardownWaits: 等待会话结束用了 %.1f ms", sessionMs);
+				ok = false;
+			}
+		}
+
+		TeardownWaitStats stats;
+		GetTeardownWaitStats(TEARDOWN_CALLBACKS, &stats);
+		AIKITDLL::LogInfo("TestTeardownWaits: 无回调 %.1f ms, 回调返回 %.1f ms, 回调内 %.1f ms, 会话结束 %.1f ms; "
+			"回调等待共 %llu 次, 到达上限 %llu 次, 最长 %.1f ms",
+			idleMs, callbackMs, nestedMs, sessionMs, stats.waits, stats.timeouts, stats.maxUs / 1000.0);
+		return ok ? 1 : 0;
+	}
+
+	// 会话定时器测试：sessions个并发会话（默认5000），每个会话按唤醒超时、命令词超时、重试退避的顺序
+	// 反复设置期限，大部分在到期前取消，与实际会话的用法相同。
+	// 1) 时间轮本身（模拟时钟）：每次启动/取消的耗时，到期时间与期限的偏差不超过一个刻度；
+	// 2) 对照：每个阶段创建、设置、关闭一个可等待定时器内核对象的耗时；
+	// 3) 定时器线程（真实时钟）：所有会话各设一个200~1200ms的期限，统计到期回调的延迟和线程唤醒次数。
+	// 返回1表示没有提前、漏掉或在取消后到期的定时器，且真实时钟下的最大延迟小于50ms。
+	AIKITDLL_API int BenchTimerWheel(int sessions)
+	{
+		if (sessions <= 0) {
+			sessions = 5000;
+		}
+		const unsigned int tickUs = TIMER_SERVICE_TICK_US;
+		const unsigned int phaseMs[3] = { 10000, 10000, 2000 };
+		std::vector<BenchSessionTimer> timers((size_t)sessions);
+		unsigned int seed = 7;
+		bool ok = true;
+
+		// 1) 模拟时钟：每个会话走三个阶段，前两个阶段在到期前取消
+		g_benchClockUs = 1000000;
+		struct timer_wheel* wheel = timer_wheel_create(tickUs, g_benchClockUs);
+		if (!wheel) {
+			AIKITDLL::LogError("BenchTimerWheel: 创建时间轮失败");
+			return 0;
+		}
+		long long armUs = 0;
+		long long cancelUs = 0;
+		unsigned long long ops = 0;
+		for (int phase = 0; phase < 3; ++phase) {
+			long long t0 = NowUs();
+			for (int i = 0; i < sessions; ++i) {
+				BenchSessionTimer& s = timers[i];
+				if (phase == 0) {
+					tw_timer_init(&s.timer, BenchTimerFired, &s);
+					s.fired = 0;
+				}
+				seed = seed * 1103515245 + 12345;
+				s.deadlineUs = g_benchClockUs + (unsigned long long)phaseMs[phase] * 1000 / 2 + (seed >> 8) % (phaseMs[phase] * 1000);
+				timer_wheel_arm(wheel, &s.timer, s.deadlineUs);
+			}
+			armUs += NowUs() - t0;
+			ops += sessions;
+			if (phase < 2) {
+				// 会话在期限前结束了这个阶段
+				g_benchClockUs += 100000;
+				timer_wheel_advance(wheel, g_benchClockUs);
+				t0 = NowUs();
+				for (int i = 0; i < sessions; ++i) {
+					timer_wheel_cancel(wheel, &timers[i].timer);
+				}
+				cancelUs += NowUs() - t0;
+			}
+		}
+		// 最后一个阶段全部到期：按下一次需要推进的时间走模拟时钟
+		long long advanceStart = NowUs();
+		for (;;) {
+			long long waitUs = timer_wheel_next_us(wheel, g_benchClockUs);
+			if (waitUs < 0) {
+				break;
+			}
+			g_benchClockUs += waitUs > 0 ? (unsigned long long)waitUs : tickUs;
+			timer_wheel_advance(wheel, g_benchClockUs);
+		}
+		long long advanceUs = NowUs() - advanceStart;
+		struct timer_wheel_stats ws;
+		timer_wheel_get_stats(wheel, &ws);
+		timer_wheel_destroy(wheel);
+
+		unsigned int early = 0;
+		unsigned int late = 0;
+		unsigned int wrongCount = 0;
+		for (int i = 0; i < sessions; ++i) {
+			const BenchSessionTimer& s = timers[i];
+			if (s.fired != 1) {
+				wrongCount++;
+			}
+			else if (s.firedUs < s.deadlineUs) {
+				early++;
+			}
+			else if (s.firedUs - s.deadlineUs >= tickUs) {
+				late++;
+			}
+		}
+		AIKITDLL::LogInfo("BenchTimerWheel: 时间轮 %d 个会话: 启动 %.0f ns/次, 取消 %.0f ns/次, 到期推进共 %.1f ms, "
+			"下移 %llu 次, 逐刻推进 %llu 次",
+			sessions, armUs * 1000.0 / ops, cancelUs * 1000.0 / ((unsigned long long)sessions * 2),
+			advanceUs / 1000.0, ws.cascaded, ws.ticks);
+		if (early || late || wrongCount) {
+			AIKITDLL::LogError("BenchTimerWheel: 提前 %u 个, 晚于一个刻度 %u 个, 未到期或重复到期 %u 个", early, late, wrongCount);
+			ok = false;
+		}
+
+		// 2) 对照：每个阶段一个可等待定时器
+		long long kernelStart = NowUs();
+		for (int phase = 0; phase < 3; ++phase) {
+			for (int i = 0; i < sessions; ++i) {
+				HANDLE timer = CreateWaitableTimer(NULL, TRUE, NULL);
+				if (!timer) {
+					continue;
+				}
+				LARGE_INTEGER due;
+				due.QuadPart = -10000LL * phaseMs[phase];
+				SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE);
+				CancelWaitableTimer(timer);
+				CloseHandle(timer);
+			}
+		}
+		long long kernelUs = NowUs() - kernelStart;
+		AIKITDLL::LogInfo("BenchTimerWheel: 每阶段一个可等待定时器: %.0f ns/阶段", kernelUs * 1000.0 / ops);
+
+		// 3) 定时器线程：真实时钟下的到期延迟
+		AIKITDLL::TimerService& service = AIKITDLL::TimerService::Instance();
+		TimerServiceStats before;
+		service.GetStats(&before);
+		long long start = NowUs();
+		for (int i = 0; i < sessions; ++i) {
+			BenchSessionTimer& s = timers[i];
+			tw_timer_init(&s.timer, BenchServiceFired, &s);
+			s.fired = 0;
+			seed = seed * 1103515245 + 12345;
+			unsigned int delayMs = 200 + (seed >> 8) % 1000;
+			s.deadlineUs = (unsigned long long)NowUs() + (unsigned long long)delayMs * 1000;
+			service.Arm(&s.timer, delayMs);
+		}
+		// 取消十分之一，它们不应再到期
+		for (int i = 0; i < sessions; i += 10) {
+			service.Cancel(&timers[i].timer);
+		}
+		TimerServiceStats after;
+		do {
+			Sleep(50);
+			service.GetStats(&after);
+		} while (after.pending > before.pending && NowUs() - start < 5000000);
+
+		LatencyHistogram latency;
+		unsigned int missing = 0;
+		for (int i = 0; i < sessions; ++i) {
+			const BenchSessionTimer& s = timers[i];
+			if (i % 10 == 0) {
+				if (s.fired) {
+					wrongCount++;
+				}
+				continue;
+			}
+			if (s.fired != 1) {
+				missing++;
+				continue;
+			}
+			long long lateUs = (long long)s.firedUs - (long long)s.deadlineUs;
+			latency.Add(lateUs > 0 ? lateUs : 0);
+		}
+		// 超时退出时仍在等待的定时器，在timers释放前取消
+		for (int i = 0; i < sessions; ++i) {
+			service.Cancel(&timers[i].timer);
+		}
+		AIKITDLL::LogInfo("BenchTimerWheel: 定时器线程: %llu 个到期, 延迟平均 %.2f ms, P99 <= %.2f ms, 最大 %.2f ms, 线程唤醒 %llu 次",
+			latency.count, latency.count ? (double)latency.totalUs / latency.count / 1000.0 : 0.0,
+			latency.Percentile(0.99) / 1000.0, latency.maxUs / 1000.0,
+			after.wakeups - before.wakeups);
+		if (missing || wrongCount) {
+			AIKITDLL::LogError("BenchTimerWheel: 未到期 %u 个, 取消后仍到期 %u 个", missing, wrongCount);
+			ok = false;
+		}
+		if (latency.maxUs >= 50000) {
+			ok = false;
+		}
+		return ok ? 1 : 0;
+	}
+
+	// 停止延迟测试：停止请求在每种等待和会话中都要在50ms内生效。
+	// 1) 不需要SDK：唤醒事件等待、唤醒会话结束等待和退避用的事件等待，在等待中途取消，测量取消到返回的时间；
+	// 2) useEngine非0时用合成音频源运行完整的语音助手，分别在唤醒监听和命令词监听的会话中途停止，
+	//    检查从停止到控制线程离开主循环的时间（会话中止），总耗时含引擎卸载和SDK反初始化，只输出不检查。
+	// 返回1表示所有测得的中止时间都小于50ms。
+	AIKITDLL_API int TestStopLatency(int useEngine)
+	{
+		const double limitMs = 50.0;
+		AIKITDLL::CancelToken token;
+		bool ok = true;
+
+		double wakeupMs = -1.0;
+		double sessionMs = -1.0;
+		if (AIKITDLL::g_ivwSessionActive.load()) {
+			AIKITDLL::LogWarning("TestStopLatency: 有唤醒会话在运行，跳过唤醒等待测试");
+		}
+		else {
+			ResetWakeupStatus();
+			wakeupMs = MeasureCancel(token, 20, [&token]() { AIKITDLL::WaitForWakeup(10000, &token); });
+			AIKITDLL::g_ivwSessionActive.store(true);
+			sessionMs = MeasureCancel(token, 20, [&token]() { AIKITDLL::WaitIvwSessionEnded(10000, &token); });
+			AIKITDLL::EndIvwSession();
+			if (wakeupMs < 0 || wakeupMs > limitMs || sessionMs < 0 || sessionMs > limitMs) {
+				AIKITDLL::LogError("TestStopLatency: 取消唤醒等待用了 %.1f ms, 取消会话等待用了 %.1f ms", wakeupMs, sessionMs);
+				ok = false;
+			}
+		}
+		HANDLE backoff = CreateEvent(NULL, FALSE, FALSE, NULL);
+		double backoffMs = MeasureCancel(token, 20, [&token, backoff]() {
+			HANDLE events[2] = { token.Event(), backoff };
+			WaitForMultipleObjects(2, events, FALSE, 5000);
+		});
+		CloseHandle(backoff);
+		if (backoffMs < 0 || backoffMs > limitMs) {
+			AIKITDLL::LogError("TestStopLatency: 取消退避等待用了 %.1f ms", backoffMs);
+			ok = false;
+		}
+		AIKITDLL::LogInfo("TestStopLatency: 取消唤醒等待 %.2f ms, 会话结束等待 %.2f ms, 退避 %.2f ms",
+			wakeupMs, sessionMs, backoffMs);
+
+		if (useEngine) {
+			const VOICE_ASSISTANT_STATE states[2] = { STATE_WAKEUP_LISTENING, STATE_COMMAND_LISTENING };
+			if (SetVoiceAudioSource(AUDIO_SOURCE_SYNTH, nullptr, 1.0, 1) != 0) {
+				AIKITDLL::LogError("TestStopLatency: 设置合成音频源失败");
+				return 0;
+			}
+			for (int i = 0; i < 2; ++i) {
+				VoiceStopTimes times = {};
+				if (!StopInState(states[i], &times)) {
+					AIKITDLL::LogError("TestStopLatency: 没能在状态 %d 中停止语音助手", (int)states[i]);
+					ok = false;
+					continue;
+				}
+				AIKITDLL::LogInfo("TestStopLatency: 状态 %d 中停止: 中止会话 %.1f ms, 总计 %.1f ms",
+					times.state, times.abortUs / 1000.0, times.totalUs / 1000.0);
+				if (times.abortUs / 1000.0 > limitMs) {
+					AIKITDLL::LogError("TestStopLatency: 状态 %d 中止会话用了 %.1f ms", times.state, times.abortUs / 1000.0);
+					ok = false;
+				}
+			}
+		}
+		return ok ? 1 : 0;
+	}
+
+	// AIKIT会话测试：
+	// 1) 用不存在的能力ID启动，两类错误都设为重试2次，检查启动调用3次、恢复2次、失败后没有残留会话，
+	//    之后的End直接返回；测试完恢复默认重试策略；
+	// 2) useEngine非0且唤醒引擎可用时开始真实的唤醒会话，写入1秒静音后连续End两次、
+	//    以及只靠析构结束一次，检查每个会话只调用一次AIKIT_End，并输出各调用的耗时分布。
+	// 返回1表示全部通过。
+	AIKITDLL_API int TestAikitSession(int useEngine)
+	{
+		AikitCallStats start = {};
+		AikitCallStats end = {};
+		bool ok = true;
+
+		ResetAikitCallStats();
+		SetAikitRetryPolicy(AIKIT_ERROR_SESSION, 2, 0);
+		SetAikitRetryPolicy(AIKIT_ERROR_OTHER, 2, 0);
+		int recovered = 0;
+		int ret;
+		{
+			AIKITDLL::AikitSession session("aikit_session_test");
+			ret = session.Start(nullptr, CountRecover, &recovered);
+			if (ret == 0 || session.Active() || session.End() != 0) {
+				ok = false;
+			}
+		}
+		SetAikitRetryPolicy(AIKIT_ERROR_SESSION, 1, 0);
+		SetAikitRetryPolicy(AIKIT_ERROR_OTHER, 0, 0);
+		GetAikitCallStats(AIKIT_CALL_START, &start);
+		GetAikitCallStats(AIKIT_CALL_END, &end);
+		if (start.calls != 3 || start.retries != 2 || recovered != 2) {
+			ok = false;
+		}
+		AIKITDLL::LogInfo("TestAikitSession: 无效能力启动返回 %d（类别 %d），启动 %llu 次，重试 %llu 次，恢复 %d 次，结束 %llu 次",
+			ret, (int)AIKITDLL::ClassifyAikitError(ret), start.calls, start.retries, recovered, end.calls);
+
+		if (useEngine) {
+			if (!AIKITDLL::SafeInitSDK() || AIKITDLL::IvwEngineAcquire() != 0) {
+				AIKITDLL::LogError("TestAikitSession: 唤醒引擎不可用");
+				return 0;
+			}
+			static const char silence[FRAME_LEN] = { 0 };
+			AIKIT_BizParam* params = AIKITDLL::IvwSessionParams(900);
+			AIKITDLL::AudioFrame frame("wav", false);
+			ResetAikitCallStats();
+			{
+				AIKITDLL::AikitSession session(IVW_ABILITY);
+				if (session.Start(params) != 0) {
+					AIKITDLL::LogError("TestAikitSession: 开始唤醒会话失败");
+					return 0;
+				}
+				for (int i = 0; i < 100; ++i) {
+					session.Write(frame.Build(silence, FRAME_LEN));
+				}
+				session.End();
+				session.End();
+			}
+			{
+				AIKITDLL::AikitSession session(IVW_ABILITY);
+				if (session.Start(params) != 0) {
+					ok = false;
+				}
+			}
+			AikitCallStats write = {};
+			GetAikitCallStats(AIKIT_CALL_START, &start);
+			GetAikitCallStats(AIKIT_CALL_WRITE, &write);
+			GetAikitCallStats(AIKIT_CALL_END, &end);
+			if (start.calls != 2 || end.calls != 2 || write.calls != 100) {
+				ok = false;
+			}
+			AIKITDLL::LogInfo("TestAikitSession: 启动 %llu 次 平均 %.2f ms p99 %.2f ms; 写入 %llu 次 中位 %.3f ms p99 %.3f ms 最长 %.3f ms; 结束 %llu 次",
+				start.calls, start.calls ? start.totalUs / 1000.0 / start.calls : 0.0, start.p99Us / 1000.0,
+				write.calls, write.p50Us / 1000.0, write.p99Us / 1000.0, write.maxUs / 1000.0, end.calls);
+		}
+		return ok ? 1 : 0;
+	}
+
+	// 预开命令词会话测试：命令词引擎常驻、共享录音设备保持打开，rounds次“开始命令词识别 -> 可以送数”，
+	// 分别按原流程新建识别器（冷交接）、接过唤醒期间已经就绪的预开会话，以及监听一开始就唤醒
+	// （预开还没完成，开始识别要等它）三种情况测量交接耗时；
+	// 同时报告预开会话的资源占用（私有内存增量、预开耗时）。需要SDK和录音设备可用。
+	// 返回1表示预开就绪时每轮都用上了预开会话、没有等待预开，且平均交接耗时更短。
+	AIKITDLL_API int BenchEsrStandby(int rounds)
+	{
+		if (rounds <= 0) {
+			rounds = 10;
+		}
+		if (!AIKITDLL::SafeInitSDK()) {
+			AIKITDLL::LogError("BenchEsrStandby: SDK初始化失败");
+			return 0;
+		}
+		if (AIKITDLL::EsrEngineAcquire(nullptr) != 0) {
+			AIKITDLL::LogError("BenchEsrStandby: 命令词引擎不可用");
+			return 0;
+		}
+		AIKITDLL::CaptureHub& hub = AIKITDLL::CaptureHub::Instance();
+		if (hub.Acquire() != 0) {
+			AIKITDLL::LogError("BenchEsrStandby: 打开共享录音设备失败");
+			AIKITDLL::EsrEngineRelease();
+			return 0;
+		}
+
+		AIKITDLL::EsrStandby& standby = AIKITDLL::EsrStandby::Instance();
+		bool wasEnabled = standby.Enabled();
+		AIKIT_Callbacks cbs = { AIKITDLL::OnOutput, AIKITDLL::OnEvent, AIKITDLL::OnError };
+		LatencyHistogram handover[3];
+		long long memDelta = 0;
+		EsrStandbyStats before[3] = {};
+		EsrStandbyStats after[3] = {};
+		bool ok = true;
+
+		// 0: 冷交接；1: 预开就绪后唤醒；2: 预开开始后立即唤醒
+		for (int mode = 0; mode < 3 && ok; ++mode) {
+			standby.Configure(mode != 0, 0);
+			standby.GetStats(&before[mode]);
+			for (int r = 0; r < rounds; ++r) {
+				if (mode == 1) {
+					// 模拟唤醒监听期间：预开会话就绪后再“唤醒”
+					size_t privBefore = CurrentPrivateBytes();
+					standby.Arm(cbs);
+					bool ready = WaitUntil([&standby]() {
+						EsrStandbyStats st;
+						standby.GetStats(&st);
+						return st.active != 0;
+					}, 10000);
+					if (!ready) {
+						AIKITDLL::LogError("BenchEsrStandby: 第 %d 轮预开会话未就绪", r + 1);
+						ok = false;
+						break;
+					}
+					memDelta += (long long)CurrentPrivateBytes() - (long long)privBefore;
+				}
+				else if (mode == 2) {
+					standby.Arm(cbs);
+				}
+				long long us = 0;
+				struct EsrRecognizer* esr = StartMicCommand(&us);
+				if (esr == nullptr) {
+					AIKITDLL::LogError("BenchEsrStandby: 第 %d 轮开始识别失败", r + 1);
+					ok = false;
+					break;
+				}
+				handover[mode].Add(us);
+				EsrStopListening(esr);
+				EsrUninit(esr);
+				delete esr;
+			}
+			standby.GetStats(&after[mode]);
+		}
+		standby.Discard();
+		standby.Configure(wasEnabled, 0);
+		hub.Release();
+		AIKITDLL::EsrEngineRelease();
+		if (!ok) {
+			return 0;
+		}
+
+		unsigned long long taken = after[1].taken - before[1].taken;
+		unsigned long long waited = after[1].waited - before[1].waited;
+		unsigned long long prepared = after[1].prepared - before[1].prepared;
+		double coldMs = (double)handover[0].totalUs / handover[0].count / 1000.0;
+		double warmMs = (double)handover[1].totalUs / handover[1].count / 1000.0;
+		double earlyMs = (double)handover[2].totalUs / handover[2].count / 1000.0;
+		AIKITDLL::LogInfo("BenchEsrStandby: 冷交接 %d 次: 平均 %.2f ms, 最长 %.2f ms; 预开交接 %d 次 (使用预开 %llu 次): 平均 %.2f ms, 最长 %.2f ms; 每次省下 %.2f ms",
+			rounds, coldMs, handover[0].maxUs / 1000.0, rounds, taken, warmMs, handover[1].maxUs / 1000.0, coldMs - warmMs);
+		AIKITDLL::LogInfo("BenchEsrStandby: 监听开始即唤醒 %d 次: 平均 %.2f ms, 最长 %.2f ms (使用预开 %llu 次, 等待预开 %llu 次, 冷启动 %llu 次)",
+			rounds, earlyMs, handover[2].maxUs / 1000.0, after[2].taken - before[2].taken,
+			after[2].waited - before[2].waited, after[2].missed - before[2].missed);
+		AIKITDLL::LogInfo("BenchEsrStandby: 预开会话资源: 预开 %llu 次, 平均耗时 %.2f ms, 私有内存增量平均 %.1f KB; "
+			"另占 1 个送数线程、1 个采集读者和 1 个引擎会话",
+			prepared, after[1].avgPrepareUs / 1000.0, memDelta / 1024.0 / rounds);
+
+		return (taken == (unsigned long long)rounds && waited == 0 && warmMs < coldMs) ? 1 : 0;
+	}
+
+	// 文件识别送数节奏测试：pcmPath是16k/16bit单声道音频，分别按speed倍速和快速模式各识别一遍，
+	// 输出每遍的实时率。需要SDK和命令词引擎可用。
+	// 返回1表示倍速模式的实时率与1/speed相差不超过10%，且快速模式更快。
+	AIKITDLL_API int BenchEsrFilePacing(const char* pcmPath, double speed)
+	{
+		if (pcmPath == nullptr || speed <= 0) {
+			AIKITDLL::LogError("BenchEsrFilePacing: 参数无效");
+			return 0;
+		}
+		if (!AIKITDLL::SafeInitSDK() || AIKITDLL::EsrEngineAcquire(nullptr) != 0) {
+			AIKITDLL::LogError("BenchEsrFilePacing: 命令词引擎不可用");
+			return 0;
+		}
+
+		static const int modes[2] = { ESR_PACING_SPEED, ESR_PACING_FAST };
+		EsrFileStats stats[2] = {};
+		bool ok = true;
+		for (int i = 0; i < 2 && ok; ++i) {
+			SetEsrFilePacing(modes[i], speed, 0);
+			long readLen = 0;
+			int ret = AIKITDLL::EsrFileSession(ESR_ABILITY, pcmPath, 1, &readLen, nullptr, &stats[i]);
+			if (ret != 0 && ret != ESR_HAS_RESULT) {
+				AIKITDLL::LogError("BenchEsrFilePacing: 识别失败: %d", ret);
+				ok = false;
+			}
+		}
+		SetEsrFilePacing(ESR_PACING_SPEED, ESR_FILE_DEFAULT_SPEED, 0);
+		AIKITDLL::EsrEngineRelease();
+		if (!ok) {
+			return 0;
+		}
+
+		AIKITDLL::LogInfo("BenchEsrFilePacing: 音频 %.1f 秒; %.1f 倍速: 用时 %.2f 秒, 实时率 %.3f; 快速: 每次写入 %u 字节, 用时 %.2f 秒, 实时率 %.3f",
+			stats[0].audioUs / 1000000.0, speed, stats[0].wallUs / 1000000.0, stats[0].rtf,
+			stats[1].frameBytes, stats[1].wallUs / 1000000.0, stats[1].rtf);
+
+		double expected = 1.0 / speed;
+		bool paced = stats[0].rtf > expected * 0.9 && stats[0].rtf < expected * 1.1;
+		return (paced && stats[1].wallUs < stats[0].wallUs) ? 1 : 0;
+	}
+
+	// 批量识别吞吐测试：对manifestPath中的文件分别用1/2/4/8/16个线程批量识别（结果写到esr_batch_bench.jsonl），
+	// 输出每种线程数的吞吐（文件/秒、实时倍数）和相对单线程的加速比。需要SDK和命令词引擎可用。
+	// 返回1表示每一轮都没有失败的文件，且2个线程的吞吐高于1个线程。
+	AIKITDLL_API int BenchEsrBatch(const char* manifestPath)
+	{
+		static const int workerCounts[] = { 1, 2, 4, 8, 16 };
+		const int runs = sizeof(workerCounts) / sizeof(workerCounts[0]);
+		EsrBatchStats stats[runs] = {};
+
+		if (manifestPath == nullptr) {
+			AIKITDLL::LogError("BenchEsrBatch: 参数无效");
+			return 0;
+		}
+		if (!AIKITDLL::SafeInitSDK()) {
+			AIKITDLL::LogError("BenchEsrBatch: SDK初始化失败");
+			return 0;
+		}
+
+		bool ok = true;
+		for (int i = 0; i < runs && ok; ++i) {
+			int failed = RunEsrBatch(manifestPath, "esr_batch_bench.jsonl", workerCounts[i], 1, &stats[i]);
+			if (failed != 0 || stats[i].files == 0) {
+				AIKITDLL::LogError("BenchEsrBatch: %d 个线程时批量识别失败: %d", workerCounts[i], failed);
+				ok = false;
+			}
+		}
+		if (!ok) {
+			return 0;
+		}
+
+		for (int i = 0; i < runs; ++i) {
+			AIKITDLL::LogInfo("BenchEsrBatch: %2d 个线程(实际 %u): %llu 个文件用时 %.2f 秒, %.1f 文件/秒, %.1f 倍实时, 加速比 %.2f",
+				workerCounts[i], stats[i].workers, stats[i].files, stats[i].wallUs / 1000000.0,
+				stats[i].filesPerSec, stats[i].audioPerSec,
+				stats[0].filesPerSec > 0 ? stats[i].filesPerSec / stats[0].filesPerSec : 0.0);
+		}
+		return stats[1].filesPerSec > stats[0].filesPerSec ? 1 : 0;
+	}
+
+	// 音频文件读取开销测试：对path（建议放在网络共享上、几百MB以上）按frameLen字节一帧读取passes遍，
+	// 比较原来的fread逐帧读取、内存映射和流方式读取每GB的读I/O操作数、缺页数和耗时。
+	// 第一遍之前文件可能不在缓存里，各方式依次交替读取以减小缓存的影响。
+	// 返回1表示三种方式读出的数据一致，且内存映射的读I/O操作数少于fread。
+	AIKITDLL_API int BenchAudioFileInput(const char* path, int frameLen, int passes)
+	{
+		static const char* names[3] = { "fread逐帧", "内存映射", "流方式" };
+		if (path == nullptr || frameLen <= 0 || frameLen > (int)AUDIO_FILE_STREAM_BYTES) {
+			AIKITDLL::LogError("BenchAudioFileInput: 参数无效");
+			return 0;
+		}
+		if (passes <= 0) {
+			passes = 3;
+		}
+
+		FileReadCost total[3] = {};
+		unsigned long long checksum[3] = { 0, 0, 0 };
+		for (int p = 0; p < passes; ++p) {
+			for (int mode = 0; mode < 3; ++mode) {
+				FileReadCost cost = {};
+				if (!ReadFileOnce(path, mode, (unsigned int)frameLen, &cost)) {
+					AIKITDLL::LogError("BenchAudioFileInput: 读取失败: %s", path);
+					return 0;
+				}
+				total[mode].wallUs += cost.wallUs;
+				total[mode].readOps += cost.readOps;
+				total[mode].pageFaults += cost.pageFaults;
+				total[mode].bytes += cost.bytes;
+				checksum[mode] = cost.checksum;
+			}
+		}
+
+		bool same = checksum[0] == checksum[1] && checksum[0] == checksum[2] &&
+			total[0].bytes == total[1].bytes && total[0].bytes == total[2].bytes;
+		for (int mode = 0; mode < 3; ++mode) {
+			double gb = total[mode].bytes / (1024.0 * 1024.0 * 1024.0);
+			AIKITDLL::LogInfo("BenchAudioFileInput: %s (%d 字节/帧): 每GB 读I/O %.0f 次, 缺页 %.0f 次, 耗时 %.2f 秒",
+				names[mode], frameLen, gb > 0 ? total[mode].readOps / gb : 0.0, gb > 0 ? total[mode].pageFaults / gb : 0.0,
+				gb > 0 ? total[mode].wallUs / 1000000.0 / gb : 0.0);
+		}
+		if (!same) {
+			AIKITDLL::LogError("BenchAudioFileInput: 各方式读出的数据不一致");
+		}
+		return (same && total[1].readOps < total[0].readOps) ? 1 : 0;
+	}
+
+	// 音频文件解码一致性测试：在临时目录生成1kHz正弦（半满刻度）的各种WAV文件，用AudioDecoder按帧解码，
+	// 1) 每个文件都输出16k单声道，长度与时长一致（误差不超过1个采样）；
+	// 2) PCM和float的信噪比高于60dB，A律/μ律高于28dB（8bit压扩本身的量化噪声把信噪比限制在30~35dB）；
+	// 3) 没有文件头的文件按16k PCM原样输出；
+	// 4) 头部截断、ADPCM、8bit PCM、RIFF但不是WAVE的文件返回E_AUDIO_FORMAT。返回1表示通过。
+	AIKITDLL_API int TestAudioDecoder()
+	{
+		static const WavFixture fixtures[] = {
+			{ "PCM16 16k 单声道", 1, 16, 16000, 1, false, false, false },
+			{ "PCM16 16k 立体声", 1, 16, 16000, 2, false, true, false },
+			{ "PCM16 8k 单声道", 1, 16, 8000, 1, false, false, false },
+			{ "PCM16 48k 立体声", 1, 16, 48000, 2, false, true, false },
+			{ "PCM16 22.05k 长度未知", 1, 16, 22050, 1, false, false, true },
+			{ "PCM24 44.1k 立体声", 1, 24, 44100, 2, false, false, false },
+			{ "float32 16k 单声道", 3, 32, 16000, 1, false, false, false },
+			{ "float32 48k 立体声 EXTENSIBLE", 3, 32, 48000, 2, true, false, false },
+			{ "A律 8k 单声道", 6, 8, 8000, 1, false, false, false },
+			{ "μ律 8k 单声道", 7, 8, 8000, 1, false, true, false },
+		};
+		const unsigned int seconds = 2;
+		const unsigned int expected = 16000 * seconds;
+		const std::string path = FixturePath("aikit_decoder_fixture.wav");
+		std::vector<short> out;
+		bool pass = true;
+
+		for (const WavFixture& f : fixtures) {
+			if (!WriteFixture(path, MakeWavFixture(f, seconds))) {
+				AIKITDLL::LogError("TestAudioDecoder: 写测试文件失败: %s", path.c_str());
+				return 0;
+			}
+			int ret = DecodeFile(path, FRAME_LEN_ESR, out);
+			// 跳过开头和结尾的滤波器过渡段
+			double snr = out.size() > 4000 ? ToneSnr(out.data() + 2000, (unsigned int)out.size() - 4000, 1000.0, 16000.0, nullptr) : 0.0;
+			double need = (f.tag == 6 || f.tag == 7) ? 28.0 : 60.0;
+			bool ok = ret == 0 && (out.size() + 1 >= expected && out.size() <= expected + 1) && snr > need;
+			AIKITDLL::LogInfo("TestAudioDecoder: %s: 返回 %d, 输出 %zu/%u 采样, 信噪比 %.1f dB %s",
+				f.name, ret, out.size(), expected, snr, ok ? "通过" : "失败");
+			pass = pass && ok;
+		}
+
+		// 没有文件头的16k PCM
+		std::vector<short> tone;
+		MakeTone(tone, expected, 1, 1000.0, 16000.0, 16000.0);
+		bool rawOk = WriteFixture(path, std::string((const char*)tone.data(), tone.size() * sizeof(short)))
+			&& DecodeFile(path, FRAME_LEN_ESR, out) == 0 && out == tone;
+		AIKITDLL::LogInfo("TestAudioDecoder: 无文件头PCM: %s", rawOk ? "通过" : "失败");
+		pass = pass && rawOk;
+
+		// 不支持或损坏的文件
+		static const WavFixture unsupported[] = {
+			{ "ADPCM", 2, 4, 8000, 1, false, false, false },
+			{ "PCM8", 1, 8, 8000, 1, false, false, false },
+			{ "9声道", 1, 16, 16000, 9, false, false, false },
+		};
+		for (const WavFixture& f : unsupported) {
+			int ret = WriteFixture(path, MakeWavFixture(f, 1)) ? DecodeFile(path, FRAME_LEN_ESR, out) : 0;
+			AIKITDLL::LogInfo("TestAudioDecoder: %s: 返回 %d %s", f.name, ret, ret == E_AUDIO_FORMAT ? "通过" : "失败");
+			pass = pass && ret == E_AUDIO_FORMAT;
+		}
+		std::string truncated = MakeWavFixture(fixtures[0], 1).substr(0, 30);
+		std::string notWave = MakeWavFixture(fixtures[0], 1);
+		memcpy(&notWave[8], "AVI ", 4);
+		int truncRet = WriteFixture(path, truncated) ? DecodeFile(path, FRAME_LEN_ESR, out) : 0;
+		int notWaveRet = WriteFixture(path, notWave) ? DecodeFile(path, FRAME_LEN_ESR, out) : 0;
+		AIKITDLL::LogInfo("TestAudioDecoder: 截断的头部返回 %d, RIFF/AVI返回 %d", truncRet, notWaveRet);
+		pass = pass && truncRet == E_AUDIO_FORMAT && notWaveRet == E_AUDIO_FORMAT;
+
+		// float数据中的NaN按静音处理：把16k单声道float文件开头的20个样本改成NaN（覆盖两组8样本的SIMD转换），
+		// 重采样器输出滞后于输入，开头20个输出样本只由这些样本和静音的滤波器历史得出，应当全为0
+		std::string nanWav = MakeWavFixture(fixtures[6], 1);
+		size_t dataPos = nanWav.find("data") + 8;
+		const unsigned char nanBytes[4] = { 0x00, 0x00, 0xC0, 0x7F };
+		for (int i = 0; i < 20; ++i) {
+			memcpy(&nanWav[dataPos + i * 4], nanBytes, sizeof(nanBytes));
+		}
+		bool nanOk = WriteFixture(path, nanWav) && DecodeFile(path, FRAME_LEN_ESR, out) == 0 && out.size() >= 20;
+		for (size_t i = 0; nanOk && i < 20; ++i) {
+			nanOk = out[i] == 0;
+		}
+		AIKITDLL::LogInfo("TestAudioDecoder: float NaN样本: %s", nanOk ? "通过" : "失败");
+		pass = pass && nanOk;
+
+		DeleteFileA(path.c_str());
+		return pass ? 1 : 0;
+	}
+
+	// 音频文件解码吞吐测试：生成seconds秒的48k立体声float32 WAV，按ESR快速模式的块长解码passes遍，
+	// 报告每秒解码的输入数据量和实时倍数。返回1表示解码速度超过实时的100倍。
+	AIKITDLL_API int BenchAudioDecoder(int seconds)
+	{
+		if (seconds <= 0) {
+			seconds = 60;
+		}
+		const int passes = 3;
+		const WavFixture f = { "float32 48k 立体声", 3, 32, 48000, 2, false, false, false };
+		const std::string path = FixturePath("aikit_decoder_bench.wav");
+		if (!WriteFixture(path, MakeWavFixture(f, (unsigned int)seconds))) {
+			AIKITDLL::LogError("BenchAudioDecoder: 写测试文件失败: %s", path.c_str());
+			return 0;
+		}
+
+		long long bestUs = 0;
+		unsigned long long outBytes = 0;
+		long long inBytes = 0;
+		for (int p = 0; p < passes; ++p) {
+			AIKITDLL::AudioDecoder decoder;
+			if (decoder.Open(path.c_str()) != 0) {
+				DeleteFileA(path.c_str());
+				return 0;
+			}
+			inBytes = decoder.Format().dataBytes;
+			unsigned int len = 0;
+			volatile unsigned char sink = 0;
+			long long t0 = NowUs();
+			const char* data;
+			// 快速模式下每次写入的块长（ESR_FEED_CHUNK）
+			while ((data = decoder.Next(6400, &len)) != nullptr) {
+				sink ^= (unsigned char)data[len - 1];
+			}
+			long long us = NowUs() - t0;
+			outBytes = decoder.Position();
+			if (p == 0 || us < bestUs) {
+				bestUs = us;
+			}
+		}
+		DeleteFileA(path.c_str());
+
+		double sec = bestUs > 0 ? bestUs / 1000000.0 : 0;
+		double mbps = sec > 0 ? inBytes / (1024.0 * 1024.0) / sec : 0;
+		double realtime = sec > 0 ? seconds / sec : 0;
+		AIKITDLL::LogInfo("BenchAudioDecoder: %s %d 秒: 输入 %lld 字节, 输出 %llu 字节, 用时 %.3f 秒, %.1f MB/s, %.0f 倍实时 (%s)",
+			f.name, seconds, inBytes, outBytes, sec, mbps, realtime,
+			resampler_simd_name(resampler_detect_simd()));
+		return realtime > 100.0 ? 1 : 0;
+	}
+
+	// 唤醒阈值扫描：用manifestPath中的标注样本（格式见RunIvwEval）按几个阈值各评测一遍，4个线程，
+	// 报告写到ivw_eval_<阈值>.json，输出每个阈值的误拒率、每小时误唤醒次数、平均延迟和实时率。需要SDK和唤醒引擎可用。
+	// 返回1表示每一遍都没有失败的文件，且阈值升高时误拒率不降、误唤醒不升。
+	AIKITDLL_API int BenchIvwThresholdSweep(const char* manifestPath)
+	{
+		static const int thresholds[] = { 500, 700, 900, 1100, 1300 };
+		const int runs = sizeof(thresholds) / sizeof(thresholds[0]);
+		IvwEvalStats stats[runs] = {};
+
+		if (manifestPath == nullptr) {
+			AIKITDLL::LogError("BenchIvwThresholdSweep: 参数无效");
+			return 0;
+		}
+		if (!AIKITDLL::SafeInitSDK()) {
+			AIKITDLL::LogError("BenchIvwThresholdSweep: SDK初始化失败");
+			return 0;
+		}
+
+		bool ok = true;
+		for (int i = 0; i < runs; ++i) {
+			char report[64];
+			sprintf_s(report, sizeof(report), "ivw_eval_%d.json", thresholds[i]);
+			int failed = RunIvwEval(manifestPath, report, 4, thresholds[i], &stats[i]);
+			if (failed != 0) {
+				AIKITDLL::LogError("BenchIvwThresholdSweep: 阈值 %d 返回 %d", thresholds[i], failed);
+				ok = false;
+			}
+		}
+
+		AIKITDLL::LogInfo("BenchIvwThresholdSweep: 阈值 | 误拒率 | 误唤醒/小时 | 平均延迟(ms) | 单路实时率");
+		for (int i = 0; i < runs; ++i) {
+			AIKITDLL::LogInfo("BenchIvwThresholdSweep: %5d | %6.2f%% | %8.2f | %8.0f | %.4f",
+				thresholds[i], stats[i].frr * 100, stats[i].farPerHour, stats[i].latencyAvgMs, stats[i].rtf);
+			if (i > 0 && (stats[i].frr < stats[i - 1].frr || stats[i].farPerHour > stats[i - 1].farPerHour)) {
+				ok = false;
+			}
+		}
+		return ok ? 1 : 0;
+	}
+
+	// 评测占用唤醒会话测试：先卸载唤醒引擎，再用manifestPath中的样本（格式见RunIvwEval）评测一遍。
+	// 评测期间在g_ivwMutex下反复检查：评测在运行且引擎已加载时，唤醒会话必须一直处于占用状态，
+	// 否则ivw_microphone、ivw_file会在评测线程写入时开始新会话。需要SDK和唤醒引擎可用。
+	// 返回1表示评测成功、观察到了加载好的引擎，且期间会话一直被占用
+	AIKITDLL_API int TestIvwEvalSessionClaim(const char* manifestPath)
+	{
+		if (manifestPath == nullptr) {
+			AIKITDLL::LogError("TestIvwEvalSessionClaim: 参数无效");
+			return 0;
+		}
+		if (!AIKITDLL::SafeInitSDK()) {
+			AIKITDLL::LogError("TestIvwEvalSessionClaim: SDK初始化失败");
+			return 0;
+		}
+		if (AIKITDLL::ivwEngineLoaded.load()) {
+			Ivw70Uninit();
+		}
+		if (AIKITDLL::ivwEngineLoaded.load() || AIKITDLL::g_ivwSessionActive.load()) {
+			AIKITDLL::LogError("TestIvwEvalSessionClaim: 唤醒引擎未能卸载或有唤醒会话在运行");
+			return 0;
+		}
+
+		std::atomic<bool> done(false);
+		unsigned int claimed = 0;
+		unsigned int lost = 0;
+		std::thread watcher([&]() {
+			while (!done.load()) {
+				{
+					// 先读会话再读评测标记：评测结束时先清标记再结束会话，不会误报
+					std::lock_guard<std::mutex> lock(AIKITDLL::g_ivwMutex);
+					bool session = AIKITDLL::g_ivwSessionActive.load();
+					bool loaded = AIKITDLL::ivwEngineLoaded.load();
+					if (loaded && AIKITDLL::IvwEvalActive()) {
+						if (session) {
+							claimed++;
+						}
+						else {
+							lost++;
+						}
+					}
+				}
+				Sleep(1);
+			}
+		});
+		IvwEvalStats stats = {};
+		int failed = RunIvwEval(manifestPath, "ivw_eval_claim.json", 4, 900, &stats);
+		done.store(true);
+		watcher.join();
+		bool ended = !AIKITDLL::g_ivwSessionActive.load();
+
+		AIKITDLL::LogInfo("TestIvwEvalSessionClaim: 评测返回 %d, 引擎加载后采样 %u 次, 会话未占用 %u 次, 结束后会话%s",
+			failed, claimed + lost, lost, ended ? "已释放" : "仍被占用");
+		return (failed == 0 && claimed > 0 && lost == 0 && ended) ? 1 : 0;
+	}
+
+	// 租借覆盖测试（不需要SDK和设备）：PumpCapture写入第一块时录音端按周期写入超过一圈，
+	// 后面几个周期会覆盖正在写入引擎的这块数据。返回1表示这些周期被录音端丢弃并记入blockedBytes，
+	// 交给引擎的每个字节都与录音内容一致，读者没有丢失数据。
+	AIKITDLL_API int TestCaptureTornLease()
+	{
+		const unsigned int capacity = 4096;
+		const unsigned int chunk = 512;
+		AIKITDLL::CaptureBuffer buffer(capacity);
+		AIKITDLL::CaptureConsumer* consumer = buffer.Subscribe(NULL);
+		if (consumer == nullptr) {
+			return 0;
+		}
+		std::vector<char> old(2 * chunk, 'a');
+		buffer.Write(old.data(), (unsigned int)old.size());
+
+		TornLeaseWriter writer;
+		writer.buffer = &buffer;
+		writer.oldLen = (unsigned int)old.size();
+		writer.period = chunk;
+		writer.periods = capacity / chunk;
+		writer.dropped = 0;
+		writer.delivered = 0;
+		writer.torn = 0;
+		unsigned int written = 0;
+		int ret = AIKITDLL::PumpCapture(consumer, chunk, nullptr, TornLeaseWrite, &writer, &written);
+
+		CaptureConsumerStats stats;
+		consumer->GetStats(&stats);
+		buffer.Unsubscribe(consumer);
+		AIKITDLL::LogInfo("TestCaptureTornLease: 写入 %u 字节, 内容不符 %u 字节, 录音端丢弃 %u 次（%llu 字节）, 丢失 %llu 字节, 读位置 %llu",
+			written, writer.torn, writer.dropped, stats.blockedBytes, stats.lostBytes, stats.position);
+
+		// 旧数据占了两个周期，录音端写满一圈之后的两个周期会覆盖第一块，被丢弃；其余数据全部完整读出
+		unsigned int kept = writer.periods - 2;
+		return (ret == 0 && writer.torn == 0 && writer.dropped == 2 && stats.blockedBytes == 2 * chunk &&
+			stats.lostBytes == 0 && written == old.size() + kept * chunk && stats.position == written) ? 1 : 0;
+	}
+
+	// 采集格式转换精度测试：对常见设备格式输入1kHz正弦，
+	// 1) 各SIMD版本与标量版本的输出相差不超过1个采样值；
+	// 2) 与理想重采样（解析正弦）的信噪比高于60dB，输出长度与时长一致；
+	// 3) 48k输入中9kHz以上的信号（会混叠到16k输出的频带内）衰减超过60dB。返回1表示通过。
+	AIKITDLL_API int TestResampler()
+	{
+		static const struct { unsigned int rate; unsigned int channels; } formats[] = {
+			{ 48000, 2 }, { 48000, 1 }, { 44100, 2 }, { 44100, 1 }, { 32000, 1 }, { 22050, 1 }, { 8000, 1 },
+		};
+		const double toneHz = 1000.0;
+		const double amplitude = 10000.0;
+		const unsigned int seconds = 2;
+		enum resampler_simd best = resampler_detect_simd();
+		bool pass = true;
+
+		for (const auto& fmt : formats) {
+			std::vector<short> in;
+			MakeTone(in, fmt.rate * seconds, fmt.channels, toneHz, fmt.rate, amplitude);
+
+			std::vector<short> reference;
+			struct resampler* rs = resampler_create(fmt.rate, fmt.channels, 16000, fmt.rate / 50);
+			resampler_set_simd(rs, RESAMPLER_SIMD_SCALAR);
+			ResampleStream(rs, in, fmt.channels, fmt.rate, reference);
+			resampler_destroy(rs);
+
+			int maxDiff = 0;
+			for (int simd = RESAMPLER_SIMD_SSE2; simd <= (int)best; ++simd) {
+				std::vector<short> out;
+				rs = resampler_create(fmt.rate, fmt.channels, 16000, fmt.rate / 50);
+				resampler_set_simd(rs, (enum resampler_simd)simd);
+				ResampleStream(rs, in, fmt.channels, fmt.rate, out);
+				resampler_destroy(rs);
+				if (out.size() != reference.size()) {
+					maxDiff = 65536;
+					break;
+				}
+				for (size_t i = 0; i < out.size(); ++i) {
+					int d = abs(out[i] - reference[i]);
+					if (d > maxDiff) maxDiff = d;
+				}
+			}
+
+			// 跳过开头的滤波器延迟
+			double fitAmp = 0;
+			unsigned int skip = 1600;
+			double snr = ToneSnr(reference.data() + skip, (unsigned int)reference.size() - skip, toneHz, 16000, &fitAmp);
+			bool lengthOk = reference.size() + 2 >= 16000 * seconds && reference.size() <= 16000 * seconds + 2;
+			bool ok = maxDiff <= 1 && snr > 60.0 && fabs(fitAmp - amplitude) < amplitude * 0.01 && lengthOk;
+			AIKITDLL::LogInfo("TestResampler: %u Hz %u 声道 -> 16k: 输出 %zu 采样, SNR %.1f dB, 幅度 %.0f, SIMD与标量最大差 %d %s",
+				fmt.rate, fmt.channels, reference.size(), snr, fitAmp, maxDiff, ok ? "" : "失败");
+			pass = pass && ok;
+		}
+
+		// 混叠抑制：48k输入中高于输出奈奎斯特频率的信号
+		for (double aliasHz = 9000.0; aliasHz <= 20000.0; aliasHz += 5500.0) {
+			std::vector<short> in, out;
+			MakeTone(in, 48000 * seconds, 1, aliasHz, 48000, amplitude);
+			struct resampler* rs = resampler_create(48000, 1, 16000, 960);
+			ResampleStream(rs, in, 1, 48000, out);
+			resampler_destroy(rs);
+
+			double energy = 0;
+			for (size_t i = 1600; i < out.size(); ++i) {
+				energy += (double)out[i] * out[i];
+			}
+			double rms = sqrt(energy / (out.size() - 1600));
+			double attenuation = rms > 0 ? 20 * log10(rms / (amplitude / sqrt(2.0))) : -200.0;
+			bool ok = attenuation < -60.0;
+			AIKITDLL::LogInfo("TestResampler: 48k输入 %.0f Hz 混叠衰减 %.1f dB %s", aliasHz, attenuation, ok ? "" : "失败");
+			pass = pass && ok;
+		}
+
+		AIKITDLL::LogInfo("TestResampler: 当前CPU使用 %s 内核, 结果: %s", resampler_simd_name(best), pass ? "通过" : "失败");
+		return pass ? 1 : 0;
+	}
+
+	// 采集格式转换吞吐量：把seconds秒48k立体声按20ms周期转换为16k单声道，
+	// 分别报告标量/SSE2/AVX2内核占用单个CPU核心的比例。当前CPU最优内核低于1%时返回1。
+	AIKITDLL_API int BenchResampler(int seconds)
+	{
+		if (seconds <= 0) {
+			AIKITDLL::LogError("BenchResampler: 参数无效");
+			return 0;
+		}
+
+		std::vector<short> in((size_t)48000 * 2 * seconds);
+		unsigned int seed = 1;
+		for (size_t i = 0; i < in.size(); ++i) {
+			seed = seed * 1103515245 + 12345;
+			in[i] = (short)((seed >> 16) % 20000 - 10000);
+		}
+
+		enum resampler_simd best = resampler_detect_simd();
+		double bestLoad = 100.0;
+		for (int simd = RESAMPLER_SIMD_SCALAR; simd <= (int)best; ++simd) {
+			struct resampler* rs = resampler_create(48000, 2, 16000, 960);
+			resampler_set_simd(rs, (enum resampler_simd)simd);
+			std::vector<short> out;
+			long long start = NowUs();
+			ResampleStream(rs, in, 2, 48000, out);
+			long long elapsedUs = NowUs() - start;
+			resampler_destroy(rs);
+
+			double load = elapsedUs / (seconds * 10000.0);  // 占音频时长的百分比
+			AIKITDLL::LogInfo("BenchResampler: %s: %d 秒48k立体声耗时 %.1f ms，占用单核 %.3f%%",
+				resampler_simd_name((enum resampler_simd)simd), seconds, elapsedUs / 1000.0, load);
+			if (simd == (int)best) {
+				bestLoad = load;
+			}
+		}
+		return bestLoad < 1.0 ? 1 : 0;
+	}
+
+	// 静音门限收益测试：把一段大部分时间安静的16k单声道录音（wavPath为NULL时合成10分钟、
+	// 语音约占5%的语料）分别在关闭和开启门限时按录音周期回放一遍，报告引擎写入次数和CPU时间。
+	// useEngine非0且SDK已初始化时写入真实的唤醒引擎，否则只统计写入，CPU时间仅含门限本身的开销。
+	// 返回1表示开启门限后写入减少且语音段都送入了引擎。
+	AIKITDLL_API int BenchVadGate(const char* wavPath, int useEngine)
+	{
+		std::vector<short> pcm;
+		if (wavPath) {
+			if (!LoadPcm16k(wavPath, pcm)) {
+				AIKITDLL::LogError("BenchVadGate: 读取录音失败: %s", wavPath);
+				return 0;
+			}
+		}
+		else {
+			MakeQuietCorpus(pcm, 600);
+		}
+
+		GateBenchWriter writers[2];
+		long long cpuUs[2] = { 0, 0 };
+		struct vad_gate_stats gateStats;
+		memset(writers, 0, sizeof(writers));
+		memset(&gateStats, 0, sizeof(gateStats));
+
+		for (int pass = 0; pass < 2; ++pass) {
+			GateBenchWriter* w = &writers[pass];
+			if (useEngine && AIKITDLL::isInitialized) {
+				if (AIKIT::AIKIT_Start(IVW_ABILITY, AIKITDLL::IvwSessionParams(900), nullptr, &w->handle) != 0) {
+					AIKITDLL::LogWarning("BenchVadGate: 启动唤醒引擎失败，只统计写入");
+					w->handle = nullptr;
+				}
+				else {
+					w->frame = new AIKITDLL::AudioFrame("wav", false);
+				}
+			}
+
+			struct vad_gate* gate = pass == 1 ? vad_gate_create(16000, VAD_DEFAULT_PREROLL_MS, VAD_DEFAULT_HANGOVER_MS) : nullptr;
+			RunGatePass(pcm, gate, w, &cpuUs[pass]);
+			if (gate) {
+				vad_gate_get_stats(gate, &gateStats);
+				vad_gate_destroy(gate);
+			}
+
+			if (w->handle) AIKIT::AIKIT_End(w->handle);
+			if (w->frame) delete w->frame;
+		}
+
+		bool engine = writers[0].handle != nullptr;
+		double seconds = pcm.size() / 16000.0;
+		double writeCut = writers[0].writes ? 100.0 * (1.0 - (double)writers[1].writes / writers[0].writes) : 0.0;
+		double cpuCut = cpuUs[0] > 0 ? 100.0 * (1.0 - (double)cpuUs[1] / cpuUs[0]) : 0.0;
+		AIKITDLL::LogInfo("BenchVadGate: 语料 %.1f 秒，语音帧 %.1f%%，门限开启 %u 次",
+			seconds, gateStats.frames ? 100.0 * gateStats.speech_frames / gateStats.frames : 0.0, gateStats.opens);
+		AIKITDLL::LogInfo("BenchVadGate: 关闭门限: 写入 %llu 次 / %llu 字节, CPU %.1f ms",
+			writers[0].writes, writers[0].bytes, cpuUs[0] / 1000.0);
+		AIKITDLL::LogInfo("BenchVadGate: 开启门限: 写入 %llu 次 / %llu 字节, CPU %.1f ms",
+			writers[1].writes, writers[1].bytes, cpuUs[1] / 1000.0);
+		AIKITDLL::LogInfo("BenchVadGate: 引擎写入减少 %.1f%%, CPU%s减少 %.1f%%",
+			writeCut, engine ? "" : "（未接引擎）", cpuCut);
+
+		return (writers[1].writes < writers[0].writes && gateStats.opens > 0) ? 1 : 0;
+	}
+
+#ifdef __cplusplus
+}
+#endif
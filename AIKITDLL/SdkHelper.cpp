@@ -1,5 +1,12 @@
 #include "pch.h"
 #include "Common.h"
+#include "IvwWrapper.h"
+#include "CnenEsrWrapper.h"
+#include "VoiceStateManager.h"
+#include "EngineWarmup.h"
+#include "EsrStandby.h"
+#include "TimerService.h"
+#include "Teardown.h"
 #include <mutex>
 
 namespace AIKITDLL {
@@ -31,12 +38,38 @@ namespace AIKITDLL {
     }
 
     // 安全地清理SDK
-    void SafeCleanupSDK() {
+    bool SafeCleanupSDK() {
         std::lock_guard<std::mutex> lock(sdkMutex);
         
         if (sdkInitialized.load()) {
+            // 反初始化会释放识别会话正在使用的引擎，调用方应先用EsrEngineUnload等会话结束
+            if (EsrEngineUnload(0) != 0) {
+                LogError("SafeCleanupSDK: 仍有识别会话在使用ESR引擎，不反初始化SDK");
+                return false;
+            }
             AIKIT::AIKIT_UnInit();
             sdkInitialized.store(false);
+            // 反初始化SDK会释放所有引擎，常驻的唤醒/命令词引擎需要重新加载
+            ivwEngineLoaded.store(false);
+            esrEngineLoaded.store(false);
         }
+        return true;
     }
 }
+
+// 导出函数实现
+void CleanupSDK()
+{
+    // 先停止使用引擎的线程，再卸载引擎、反初始化SDK，最后停止定时器线程
+    VoiceStateManager::GetInstance()->StopVoiceAssistant();
+    AIKITDLL::EngineWarmup::Instance().Invalidate();
+    AIKITDLL::EsrStandby::Instance().Shutdown();
+    if (AIKITDLL::ivwEngineLoaded.load()) {
+        Ivw70Uninit();
+    }
+    if (AIKITDLL::EsrEngineUnload(TEARDOWN_SESSION_TIMEOUT_MS) != 0 || !AIKITDLL::SafeCleanupSDK()) {
+        AIKITDLL::LogError("CleanupSDK: 仍有识别会话在使用ESR引擎，SDK未反初始化");
+    }
+    AIKITDLL::TimerService::Instance().Shutdown();
+    AIKITDLL::LogInfo("CleanupSDK: SDK资源和后台线程已清理");
+}
@@ -7,6 +7,6 @@ namespace AIKITDLL {
     // 安全地初始化SDK
     bool SafeInitSDK();
     
-    // 安全地清理SDK
-    void SafeCleanupSDK();
+    // 安全地清理SDK：先卸载命令词引擎，还有识别会话持有引擎引用时不清理并返回false
+    bool SafeCleanupSDK();
 }
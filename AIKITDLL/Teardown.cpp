@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "Teardown.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <chrono>
+#include <cstring>
+
+static const char* const g_waitNames[] = {
+	"SDK回调返回", "唤醒会话结束", "重试退避", "识别会话归还引用"
+};
+static_assert(sizeof(g_waitNames) / sizeof(g_waitNames[0]) == TEARDOWN_WAIT_COUNT, "每个等待点都要有名称");
+
+// 当前线程所在的回调层数：回调里触发的拆除不等待自己
+static thread_local int t_callbackDepth = 0;
+
+namespace AIKITDLL {
+
+	Teardown& Teardown::Instance() {
+		static Teardown instance;
+		return instance;
+	}
+
+	Teardown::Teardown() : m_activeCallbacks(0) {
+		memset(m_stats, 0, sizeof(m_stats));
+	}
+
+	void Teardown::EnterCallback() {
+		t_callbackDepth++;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_activeCallbacks++;
+	}
+
+	void Teardown::LeaveCallback() {
+		t_callbackDepth--;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeCallbacks--;
+		}
+		m_idle.notify_all();
+	}
+
+	bool Teardown::WaitCallbacksIdle(unsigned int timeoutMs) {
+		unsigned long long begin = audio_source_now_us();
+		int own = t_callbackDepth;
+		bool done;
+		int pending;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			done = m_idle.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+				[this, own]() { return m_activeCallbacks <= own; });
+			pending = m_activeCallbacks - own;
+		}
+		Record(TEARDOWN_CALLBACKS, begin, done);
+		if (!done) {
+			LogWarning("Teardown: 等待 %u ms 后仍有 %d 个SDK回调未返回，继续拆除", timeoutMs, pending);
+		}
+		return done;
+	}
+
+	void Teardown::Record(TeardownWait wait, unsigned long long beginUs, bool completed) {
+		long long us = (long long)(audio_source_now_us() - beginUs);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			TeardownWaitStats& s = m_stats[wait];
+			s.waits++;
+			if (!completed) {
+				s.timeouts++;
+			}
+			s.totalUs += us;
+			s.lastUs = us;
+			if (us > s.maxUs) {
+				s.maxUs = us;
+			}
+		}
+		LogDebug("Teardown: %s 等待 %.1f ms%s", g_waitNames[wait], us / 1000.0, completed ? "" : "（到达上限）");
+	}
+
+	void Teardown::GetStats(TeardownWait wait, TeardownWaitStats* stats) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		*stats = m_stats[wait];
+	}
+
+	void Teardown::ResetStats() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		memset(m_stats, 0, sizeof(m_stats));
+	}
+}
+
+int GetTeardownWaitStats(int wait, TeardownWaitStats* stats)
+{
+	if (!stats || wait < 0 || wait >= TEARDOWN_WAIT_COUNT) {
+		return -1;
+	}
+	AIKITDLL::Teardown::Instance().GetStats((TeardownWait)wait, stats);
+	return 0;
+}
+
+void ResetTeardownWaitStats()
+{
+	AIKITDLL::Teardown::Instance().ResetStats();
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+
+// 拆除和恢复过程中的等待点
+enum TeardownWait {
+	TEARDOWN_CALLBACKS = 0,   // 等待正在执行的SDK回调返回
+	TEARDOWN_IVW_SESSION,     // 等待上一个唤醒会话结束
+	TEARDOWN_RETRY_BACKOFF,   // 失败后重试前的退避，停止时立即结束
+	TEARDOWN_ESR_REFS,        // 卸载命令词引擎前等待识别会话归还引用
+	TEARDOWN_WAIT_COUNT
+};
+
+// 单个等待点的统计
+struct TeardownWaitStats {
+	unsigned long long waits;     // 等待次数
+	unsigned long long timeouts;  // 等到上限才结束的次数（退避等待中为正常结束）
+	long long totalUs;            // 累计等待时长（微秒）
+	long long maxUs;              // 最长一次（微秒）
+	long long lastUs;             // 最近一次（微秒）
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取等待点wait（TeardownWait）的统计，成功返回0
+	AIKITDLL_API int GetTeardownWaitStats(int wait, TeardownWaitStats* stats);
+
+	// 清零所有等待点的统计
+	AIKITDLL_API void ResetTeardownWaitStats();
+
+#ifdef __cplusplus
+}
+#endif
+
+// 等待上限（毫秒）：正常情况下完成信号会立即到达，上限只用来防止卡死。
+// 回调等待的上限与原来固定等待的100ms相同，最坏情况下不比原来慢
+#define TEARDOWN_CALLBACK_TIMEOUT_MS 100
+#define TEARDOWN_SESSION_TIMEOUT_MS 1000
+
+namespace AIKITDLL {
+	// 拆除过程的完成信号：记录正在执行的SDK回调，卸载引擎或SDK之后只等到回调全部返回，
+	// 不再固定睡眠；同时统计每个等待点实际等了多久。线程安全。
+	class Teardown {
+	public:
+		static Teardown& Instance();
+
+		void EnterCallback();
+		void LeaveCallback();
+
+		// 等待其他线程上的SDK回调全部返回，当前线程自己所在的回调不计入。
+		// 不能在回调可能需要的锁内调用，否则只能等到上限。按时完成返回true
+		bool WaitCallbacksIdle(unsigned int timeoutMs);
+
+		// 记录一次等待，beginUs为audio_source_now_us()的起始时间，completed为false表示等到了上限
+		void Record(TeardownWait wait, unsigned long long beginUs, bool completed);
+
+		void GetStats(TeardownWait wait, TeardownWaitStats* stats);
+		void ResetStats();
+
+	private:
+		Teardown();
+		Teardown(const Teardown&) = delete;
+		Teardown& operator=(const Teardown&) = delete;
+
+		std::mutex m_mutex;
+		std::condition_variable m_idle;
+		int m_activeCallbacks;
+		TeardownWaitStats m_stats[TEARDOWN_WAIT_COUNT];
+	};
+
+	// SDK回调的作用域，放在回调函数的开头
+	class CallbackScope {
+	public:
+		CallbackScope() { Teardown::Instance().EnterCallback(); }
+		~CallbackScope() { Teardown::Instance().LeaveCallback(); }
+
+		CallbackScope(const CallbackScope&) = delete;
+		CallbackScope& operator=(const CallbackScope&) = delete;
+	};
+}
@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "TimerService.h"
+#include "Common.h"
+#include "audiosrc.h"
+#include <chrono>
+#include <cstring>
+
+namespace AIKITDLL {
+
+	TimerService& TimerService::Instance() {
+		static TimerService instance;
+		return instance;
+	}
+
+	TimerService::TimerService()
+		: m_wheel(nullptr), m_nextWakeUs(0), m_quit(false), m_wakeups(0), m_maxLateUs(0) {
+		m_wheel = timer_wheel_create(TIMER_SERVICE_TICK_US, audio_source_now_us());
+		if (!m_wheel) {
+			LogError("TimerService: 创建时间轮失败");
+		}
+	}
+
+	TimerService::~TimerService() {
+		// 静态对象在DLL卸载时持有加载器锁析构，线程退出也要这把锁，这里等待线程会死锁。
+		// 线程应已由Shutdown停止；仍在运行时放手，时间轮也留给它
+		if (m_thread.joinable()) {
+			m_thread.detach();
+			return;
+		}
+		timer_wheel_destroy(m_wheel);
+	}
+
+	void TimerService::Shutdown() {
+		std::thread worker;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+			worker.swap(m_thread);
+		}
+		m_cond.notify_all();
+		if (worker.joinable()) {
+			worker.join();
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = false;
+		m_nextWakeUs = 0;
+	}
+
+	void TimerService::Arm(struct tw_timer* t, unsigned int delayMs) {
+		unsigned long long deadline = audio_source_now_us() + (unsigned long long)delayMs * 1000;
+		bool wake;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_wheel) {
+				return;
+			}
+			if (!m_thread.joinable() && !m_quit) {
+				m_thread = std::thread(&TimerService::ThreadProc, this);
+			}
+			timer_wheel_arm(m_wheel, t, deadline);
+			// 只有比线程计划醒来更早的期限才需要叫醒它
+			wake = m_nextWakeUs == 0 || deadline < m_nextWakeUs;
+		}
+		if (wake) {
+			m_cond.notify_one();
+		}
+	}
+
+	bool TimerService::Cancel(struct tw_timer* t) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_wheel) {
+			return false;
+		}
+		return timer_wheel_cancel(m_wheel, t) != 0;
+	}
+
+	void TimerService::ThreadProc() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_quit) {
+			unsigned long long now = audio_source_now_us();
+			timer_wheel_advance(m_wheel, now);
+			long long waitUs = timer_wheel_next_us(m_wheel, now);
+			if (waitUs < 0) {
+				m_nextWakeUs = 0;
+				m_cond.wait(lock);
+			}
+			else {
+				m_nextWakeUs = now + (unsigned long long)waitUs;
+				m_cond.wait_for(lock, std::chrono::microseconds(waitUs));
+			}
+			m_wakeups++;
+		}
+	}
+
+	void TimerService::GetStats(TimerServiceStats* stats) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		struct timer_wheel_stats ws;
+		memset(&ws, 0, sizeof(ws));
+		if (m_wheel) {
+			timer_wheel_get_stats(m_wheel, &ws);
+		}
+		stats->pending = ws.pending;
+		stats->armed = ws.armed;
+		stats->cancelled = ws.cancelled;
+		stats->fired = ws.fired;
+		stats->wakeups = m_wakeups;
+		stats->maxLateUs = m_maxLateUs;
+	}
+
+	Deadline::Deadline() : m_deadlineUs(0), m_event(NULL), m_expired(false) {
+		tw_timer_init(&m_timer, &Deadline::OnExpire, this);
+	}
+
+	Deadline::~Deadline() {
+		Cancel();
+	}
+
+	void Deadline::Start(unsigned int delayMs, HANDLE event) {
+		TimerService& service = TimerService::Instance();
+		service.Cancel(&m_timer);
+		m_event = event;
+		m_expired.store(false, std::memory_order_release);
+		m_deadlineUs = audio_source_now_us() + (unsigned long long)delayMs * 1000;
+		service.Arm(&m_timer, delayMs);
+	}
+
+	bool Deadline::Cancel() {
+		return TimerService::Instance().Cancel(&m_timer);
+	}
+
+	// 在定时器线程上、持有TimerService的锁时执行
+	void Deadline::OnExpire(struct tw_timer* t, void* arg) {
+		Deadline* d = (Deadline*)arg;
+		long long late = (long long)(audio_source_now_us() - d->m_deadlineUs);
+		TimerService& service = TimerService::Instance();
+		if (late > service.m_maxLateUs) {
+			service.m_maxLateUs = late;
+		}
+		d->m_expired.store(true, std::memory_order_release);
+		if (d->m_event) {
+			SetEvent(d->m_event);
+		}
+	}
+}
+
+int GetTimerServiceStats(TimerServiceStats* stats)
+{
+	if (!stats) {
+		return -1;
+	}
+	AIKITDLL::TimerService::Instance().GetStats(stats);
+	return 0;
+}
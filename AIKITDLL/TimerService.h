@@ -0,0 +1,107 @@
+#pragma once
+#include "timer_wheel.h"
+#include <Windows.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// 定时器线程的统计
+struct TimerServiceStats {
+	unsigned int pending;          // 当前等待中的定时器
+	unsigned long long armed;      // 启动次数
+	unsigned long long cancelled;  // 到期前取消的次数
+	unsigned long long fired;      // 到期次数
+	unsigned long long wakeups;    // 定时器线程被唤醒的次数
+	long long maxLateUs;           // 到期回调比期限晚的最大值（微秒）
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// 导出定义
+#ifdef _WIN32
+#if defined(AIKITDLL_EXPORTS) || defined(_USRDLL)
+#define AIKITDLL_API __declspec(dllexport)
+#else
+#define AIKITDLL_API __declspec(dllimport)
+#endif
+#else
+#define AIKITDLL_API
+#endif
+
+	// 获取会话定时器线程的统计，成功返回0
+	AIKITDLL_API int GetTimerServiceStats(TimerServiceStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+// 定时器精度（微秒）：会话期限都在百毫秒以上，10ms足够，也让空闲时的唤醒更少
+#define TIMER_SERVICE_TICK_US 10000
+
+namespace AIKITDLL {
+	// 进程内所有会话期限共用的定时器：一个分层时间轮加一个线程，
+	// 启动和取消都是O(1)，不为每个阶段创建内核对象。第一次使用时启动线程，由Shutdown停止。
+	// 回调在定时器线程上、持有内部锁时执行，只能做置位、SetEvent之类的短操作，
+	// 不能再调用Arm/Cancel；因此Cancel返回后回调不会再执行。
+	class TimerService {
+	public:
+		static TimerService& Instance();
+
+		// 启动（或重新启动）定时器t，delayMs毫秒后在定时器线程上调用t的回调
+		void Arm(struct tw_timer* t, unsigned int delayMs);
+		// 取消定时器，到期前取消返回true
+		bool Cancel(struct tw_timer* t);
+
+		void GetStats(TimerServiceStats* stats);
+
+		// 停止定时器线程（CleanupSDK调用）。之后的Arm会重新启动线程
+		void Shutdown();
+
+	private:
+		TimerService();
+		~TimerService();
+		TimerService(const TimerService&) = delete;
+		TimerService& operator=(const TimerService&) = delete;
+
+		void ThreadProc();
+		static void OnDeadline(struct tw_timer* t, void* arg);
+
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::thread m_thread;
+		struct timer_wheel* m_wheel;
+		unsigned long long m_nextWakeUs;   // 线程计划醒来的时间，0表示无限等待
+		bool m_quit;
+		unsigned long long m_wakeups;
+		long long m_maxLateUs;
+
+		friend class Deadline;
+	};
+
+	// 一个会话期限：到期时置位并触发event（可为NULL）。析构时自动取消。
+	// 同一个Deadline可以反复Start，不是线程安全的，每个会话一个
+	class Deadline {
+	public:
+		Deadline();
+		~Deadline();
+
+		Deadline(const Deadline&) = delete;
+		Deadline& operator=(const Deadline&) = delete;
+
+		void Start(unsigned int delayMs, HANDLE event);
+		// 取消，到期前取消返回true
+		bool Cancel();
+		bool Expired() const { return m_expired.load(std::memory_order_acquire); }
+
+	private:
+		static void OnExpire(struct tw_timer* t, void* arg);
+
+		struct tw_timer m_timer;
+		unsigned long long m_deadlineUs;
+		HANDLE m_event;
+		std::atomic<bool> m_expired;
+	};
+}
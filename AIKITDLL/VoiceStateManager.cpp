@@ -3,6 +3,13 @@
 #include "IvwWrapper.h"
 #include "CnenEsrWrapper.h"
 #include "SdkHelper.h"
+#include "audiosrc.h"
+#include "CaptureHub.h"
+#include "EngineWarmup.h"
+#include "EsrStandby.h"
+#include "IvwEval.h"
+#include "Teardown.h"
+#include "TimerService.h"
 #include <chrono>
 
 // 静态实例初始化
@@ -10,16 +17,32 @@ VoiceStateManager* VoiceStateManager::s_instance = nullptr;
 
 // 设置最大等待时间（毫秒）
 const int MAX_COMMAND_WAIT_TIME = 10000; // 10秒
+// 等待后台引擎加载的最长时间（毫秒），超时后回到主循环重新检查
+const unsigned int MAX_WARMUP_WAIT_TIME = 30000;
+
+// 唤醒会话开始送数时由ivw_microphone调用：此刻起助手可以被唤醒。arg是本次监听的AIKIT_Callbacks
+static void OnWakeListening(void* arg) {
+    AIKITDLL::EngineWarmup::Instance().MarkWakeListening();
+    // 启用预开时在等待唤醒期间准备好命令词会话，唤醒后直接接过来
+    AIKITDLL::EsrStandby::Instance().Arm(*static_cast<const AIKIT_Callbacks*>(arg));
+}
 
 // 构造函数
 VoiceStateManager::VoiceStateManager()
     : m_currentState(STATE_IDLE),
     m_isRunning(false),
+    m_controlActive(false),
     m_sdkInitialized(false),
     m_wakeupInitialized(false),
-    m_consecutiveFailures(0) {
+    m_consecutiveFailures(0),
+    m_wakeupCount(0),
+    m_commandCount(0),
+    m_loopExitUs(0),
+    m_stopTimes(),
+    m_hasStopTimes(false) {
     // 创建状态变化事件对象
     m_stateChangeEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    m_backoffEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 }
 
 // 析构函数
@@ -32,6 +55,10 @@ VoiceStateManager::~VoiceStateManager() {
 		CloseHandle(m_stateChangeEvent);
 		m_stateChangeEvent = NULL;
 	}
+	if (m_backoffEvent) {
+		CloseHandle(m_backoffEvent);
+		m_backoffEvent = NULL;
+	}
 }
 
 // 静态互斥锁的定义
@@ -76,6 +103,8 @@ bool VoiceStateManager::StartVoiceAssistant() {
         m_wakeupInitialized.store(false, std::memory_order_release);
         m_currentState.store(STATE_IDLE, std::memory_order_release);
         m_consecutiveFailures.store(0, std::memory_order_release);
+        m_wakeupCount.store(0, std::memory_order_release);
+        m_commandCount.store(0, std::memory_order_release);
 
         // 重置事件
         if (m_stateChangeEvent) {
@@ -87,6 +116,23 @@ bool VoiceStateManager::StartVoiceAssistant() {
                 return false;
             }
         }
+        m_cancel.Reset();
+        if (!m_backoffEvent) {
+            m_backoffEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+            if (!m_backoffEvent) {
+                AIKITDLL::LogError("创建事件对象失败\n");
+                return false;
+            }
+        }
+
+        // 唤醒词评测和语音助手都会初始化、卸载唤醒引擎，不能同时运行。
+        // 先标记再检查，评测一侧按相反的顺序，两边不会同时错过对方
+        m_controlActive.store(true);
+        if (AIKITDLL::IvwEvalActive()) {
+            m_controlActive.store(false);
+            AIKITDLL::LogWarning("唤醒词评测正在运行，语音助手无法启动\n");
+            return false;
+        }
 
         // 设置运行标志
         m_isRunning.store(true, std::memory_order_release);
@@ -97,6 +143,7 @@ bool VoiceStateManager::StartVoiceAssistant() {
         } catch (const std::exception& e) {
             AIKITDLL::LogError("启动控制线程失败: %s\n", e.what());
             m_isRunning.store(false, std::memory_order_release);
+            m_controlActive.store(false);
             return false;
         }
     }
@@ -110,14 +157,31 @@ bool VoiceStateManager::StartVoiceAssistant() {
 
 // 停止语音助手循环
 void VoiceStateManager::StopVoiceAssistant() {
+	unsigned long long begin = audio_source_now_us();
+	VOICE_ASSISTANT_STATE state = m_currentState.load();
+	bool running = m_controlThread.joinable();
+
 	// 设置停止标志
 	m_isRunning.store(false);
 
+	// 取消正在进行的唤醒、命令词会话和等待，它们在一帧之内返回
+	m_cancel.Cancel();
+	StopIvwMicrophone();
+
 	// 触发事件，让控制线程可以检查停止标志
 	SetEvent(m_stateChangeEvent);
 	// 等待线程完成
-	if (m_controlThread.joinable()) {
+	if (running) {
 		m_controlThread.join();
+
+		unsigned long long exitUs = m_loopExitUs.load();
+		std::lock_guard<std::mutex> lock(m_stopTimesMutex);
+		m_stopTimes.abortUs = exitUs > begin ? (long long)(exitUs - begin) : 0;
+		m_stopTimes.totalUs = (long long)(audio_source_now_us() - begin);
+		m_stopTimes.state = (int)state;
+		m_hasStopTimes = true;
+		AIKITDLL::LogInfo("语音助手停止耗时: 中止会话 %.1f ms, 总计 %.1f ms（停止时状态: %s）\n",
+			m_stopTimes.abortUs / 1000.0, m_stopTimes.totalUs / 1000.0, GetStateName(state));
 	}
 
 	// 重置状态
@@ -159,8 +223,8 @@ void VoiceStateManager::TransitionToState(VOICE_ASSISTANT_STATE newState) {
     switch (oldState) {
     case STATE_WAKEUP_LISTENING:
         if (m_wakeupInitialized) {
-            AIKITDLL::LogDebug("离开唤醒监听状态，清理唤醒资源\n");
-            Ivw70Uninit();
+            AIKITDLL::LogDebug("离开唤醒监听状态，释放唤醒引擎\n");
+            AIKITDLL::IvwEngineRelease();
             m_wakeupInitialized = false;
         }
         break;
@@ -264,8 +328,8 @@ void VoiceStateManager::HandleEvent(AIKIT_EVENT_TYPE eventType, const char* resu
 	case EVENT_WAKEUP_SUCCESS:
 		// 唤醒成功，转到命令词识别状态前先确保清理当前资源
 		if (m_wakeupInitialized) {
-            AIKITDLL::LogDebug("准备进入命令词识别状态，清理唤醒资源\n");
-            Ivw70Uninit();
+            AIKITDLL::LogDebug("准备进入命令词识别状态，释放唤醒引擎\n");
+            AIKITDLL::IvwEngineRelease();
             m_wakeupInitialized = false;
         }
 		
@@ -273,6 +337,7 @@ void VoiceStateManager::HandleEvent(AIKIT_EVENT_TYPE eventType, const char* resu
 		AIKITDLL::wakeupFlag = 1;
 		AIKITDLL::wakeupDetected = true;
 		AIKITDLL::lastEventType = EVENT_WAKEUP_SUCCESS;
+		m_wakeupCount++;
 		
 		// 状态转换
 		TransitionToState(STATE_COMMAND_LISTENING);
@@ -292,6 +357,9 @@ void VoiceStateManager::HandleEvent(AIKIT_EVENT_TYPE eventType, const char* resu
 	case EVENT_ESR_SUCCESS:
 	case EVENT_ESR_FAILED:
 	case EVENT_ESR_TIMEOUT:
+		if (eventType == EVENT_ESR_SUCCESS) {
+			m_commandCount++;
+		}
 		// 命令词识别完成（无论成功失败），回到唤醒监听状态
 		TransitionToState(STATE_WAKEUP_LISTENING);
 		break;
@@ -330,9 +398,9 @@ void VoiceStateManager::ResetState() {
         }
     }
 
-    // 重置计数并延迟一段时间确保资源释放
+    // 重置计数，等正在执行的SDK回调返回后再重新进入唤醒监听
     m_consecutiveFailures.store(0, std::memory_order_release);
-    Sleep(100);
+    AIKITDLL::Teardown::Instance().WaitCallbacksIdle(TEARDOWN_CALLBACK_TIMEOUT_MS);
 
     // 重新设置状态
     TransitionToState(STATE_WAKEUP_LISTENING);
@@ -346,20 +414,27 @@ void VoiceStateManager::ControlThreadProc() {
     AIKIT_Callbacks cbs = { AIKITDLL::OnOutput, AIKITDLL::OnEvent, AIKITDLL::OnError };    // 确保清理之前的状态
     ResetSDKState();
     
-    // 等待一小段时间确保之前的资源完全释放
-    Sleep(100);
+    // 确保之前的SDK回调都已返回
+    AIKITDLL::Teardown::Instance().WaitCallbacksIdle(TEARDOWN_CALLBACK_TIMEOUT_MS);
     
-    // 尝试初始化SDK
-    m_sdkInitialized = AIKITDLL::SafeInitSDK();
+    // 初始化SDK，唤醒和命令词引擎在后台并行加载，唤醒引擎就绪即可开始监听
+    m_sdkInitialized = AIKITDLL::EngineWarmup::Instance().Start();
     if (!m_sdkInitialized) {
         AIKITDLL::LogError("SDK初始化失败，语音助手无法启动\n");
         m_isRunning.store(false);
+        m_controlActive.store(false);
         return;
     }
     
     // 初始化成功后重置失败计数
     m_consecutiveFailures.store(0);
 
+    // 整个运行期间持有共享录音设备，唤醒与命令词识别切换时只换读者，不重开设备
+    bool holdsCapture = (AIKITDLL::CaptureHub::Instance().Acquire() == 0);
+    if (!holdsCapture) {
+        AIKITDLL::LogWarning("打开共享录音设备失败，将在唤醒或识别时重试\n");
+    }
+
     while (m_isRunning.load()) {
         try {
             // 获取当前状态
@@ -392,19 +467,25 @@ void VoiceStateManager::ControlThreadProc() {
                         if (m_consecutiveFailures.load() >= 3) {
                             AIKITDLL::LogError("连续多次初始化失败，需要重置系统\n");
                             TransitionToState(STATE_IDLE);
-                            Sleep(5000); // 延长等待时间，避免频繁重试
+                            Backoff(5000); // 延长等待时间，避免频繁重试
                         } else {
-                            Sleep(2000);
+                            Backoff(2000);
                         }
                         continue;
                     }
                     AIKITDLL::LogDebug("SDK重新初始化成功\n");
                 }
 
-                // 初始化唤醒功能（如果需要）
+                // 唤醒引擎还在后台加载时等它结束，避免重复初始化
+                if (AIKITDLL::EngineWarmup::Instance().WaitReady(WARMUP_IVW, MAX_WARMUP_WAIT_TIME, &m_cancel) == WARMUP_RUNNING) {
+                    AIKITDLL::LogWarning("唤醒引擎仍在后台加载，继续等待...\n");
+                    continue;
+                }
+
+                // 初始化唤醒功能（如果需要），常驻模式下引擎已加载时直接返回
                 if (!m_wakeupInitialized) {
                     AIKITDLL::LogDebug("初始化唤醒功能...\n");
-                    int ret = Ivw70Init();
+                    int ret = AIKITDLL::IvwEngineAcquire();
                     if (ret != 0) {
                         AIKITDLL::LogError("唤醒功能初始化失败，错误码：%d\n", ret);
                         m_consecutiveFailures++;
@@ -412,9 +493,9 @@ void VoiceStateManager::ControlThreadProc() {
                             AIKITDLL::LogError("连续多次初始化失败，重置系统...\n");
                             ResetSDKState();
                             TransitionToState(STATE_IDLE);
-                            Sleep(5000);
+                            Backoff(5000);
                         } else {
-                            Sleep(2000);
+                            Backoff(2000);
                         }
                         continue;
                     }
@@ -426,12 +507,16 @@ void VoiceStateManager::ControlThreadProc() {
                     AIKITDLL::LogError("唤醒或SDK未正确初始化，无法启动麦克风唤醒\n");
                     ResetSDKState();
                     TransitionToState(STATE_IDLE);
-                    Sleep(2000);
+                    Backoff(2000);
                     continue;
                 }
 
                 AIKITDLL::LogDebug("启动麦克风唤醒监听...\n");
-                int ret = Ivw70Microphone(cbs);
+                int ret = AIKITDLL::IvwMicrophoneSession(cbs, &m_cancel, OnWakeListening, &cbs);
+                if (m_cancel.IsCancelled()) {
+                    // 停止请求中止了监听，直接回到循环条件退出
+                    continue;
+                }
                 if (ret != 0) {
                     AIKITDLL::LogError("启动麦克风唤醒失败，错误码：%d\n", ret);
                     
@@ -442,23 +527,27 @@ void VoiceStateManager::ControlThreadProc() {
                     if (m_consecutiveFailures.load() >= 3) {
                         AIKITDLL::LogError("连续多次启动失败，重置系统...\n");
                         TransitionToState(STATE_IDLE);
-                        Sleep(5000);
+                        Backoff(5000);
                     } else {
                         // 短暂等待后重试
-                        Sleep(2000);
+                        Backoff(2000);
                     }
                     continue;
                 }
 
-                AIKITDLL::LogDebug("唤醒监听已启动，等待唤醒事件...\n");
+                AIKITDLL::LogDebug("唤醒监听已返回，等待唤醒事件处理...\n");
                 
                 // 等待状态变化或停止信号
                 WaitForSingleObject(m_stateChangeEvent, INFINITE);
                 ResetEvent(m_stateChangeEvent);
+                if (m_cancel.IsCancelled()) {
+                    // 引擎由退出前的ResetSDKState统一卸载
+                    continue;
+                }
 
-                // 清理唤醒资源
+                // 结束本次唤醒监听，常驻模式下引擎保持加载
                 if (m_wakeupInitialized) {
-                    Ivw70Uninit();
+                    AIKITDLL::IvwEngineRelease();
                     m_wakeupInitialized = false;
                 }
 
@@ -473,40 +562,39 @@ void VoiceStateManager::ControlThreadProc() {
                         AIKITDLL::LogError("SDK重新初始化失败，尝试恢复...\n");
                         // 回到空闲状态，避免循环
                         TransitionToState(STATE_IDLE);
-                        Sleep(2000);
+                        Backoff(2000);
                         continue;
                     }
                 }
 
+                // 命令词引擎通常已在唤醒期间加载完成
+                if (AIKITDLL::EngineWarmup::Instance().WaitReady(WARMUP_ESR, MAX_WARMUP_WAIT_TIME, &m_cancel) == WARMUP_RUNNING) {
+                    AIKITDLL::LogWarning("命令词引擎仍在后台加载，继续等待...\n");
+                    continue;
+                }
+
                 AIKITDLL::LogDebug("开始命令词识别...\n");
 
                 // 重置ESR状态
                 ResetEsrStatus();
 
-                // 启动命令词识别 - 函数没有返回值，无法直接检查成功或失败
-                EsrMicrophone(cbs);
-
-                // 设置命令词识别超时事件
-                HANDLE timeoutEvent = CreateWaitableTimer(NULL, TRUE, NULL);
-                if (timeoutEvent == NULL) {
-                    AIKITDLL::LogError("创建定时器失败，错误码：%d\n", GetLastError());
-                    TransitionToState(STATE_WAKEUP_LISTENING);
+                // 启动命令词识别 - 结果通过回调事件改变状态，返回值只用来判断是否被取消
+                AIKITDLL::EsrMicrophoneSession(cbs, &m_cancel);
+                if (m_cancel.IsCancelled()) {
                     continue;
                 }
 
-                LARGE_INTEGER dueTime;
-                dueTime.QuadPart = -10000LL * MAX_COMMAND_WAIT_TIME; // 100纳秒为单位
-                SetWaitableTimer(timeoutEvent, &dueTime, 0, NULL, NULL, FALSE);
+                // 命令词识别期限由会话定时器管理，到期时触发状态变化事件
+                AIKITDLL::Deadline commandDeadline;
+                commandDeadline.Start(MAX_COMMAND_WAIT_TIME, m_stateChangeEvent);
 
                 // 等待状态变化、超时或停止信号
-                HANDLE events[2] = { m_stateChangeEvent, timeoutEvent };
-                DWORD waitResult = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+                DWORD waitResult = WaitForSingleObject(m_stateChangeEvent, INFINITE);
+                commandDeadline.Cancel();
 
-                // 清理定时器
-                CloseHandle(timeoutEvent);
-
-                // 处理超时情况
-                if (waitResult == WAIT_OBJECT_0 + 1) {
+                // 处理超时情况：期限已到且状态还没有被识别结果改变
+                if (waitResult == WAIT_OBJECT_0 && commandDeadline.Expired() &&
+                    m_currentState.load() == STATE_COMMAND_LISTENING && m_isRunning.load()) {
                     AIKITDLL::LogWarning("命令词识别超时\n");
                     // 触发超时事件
                     HandleEvent(EVENT_ESR_TIMEOUT, "超时");
@@ -525,8 +613,10 @@ void VoiceStateManager::ControlThreadProc() {
                 // 处理命令词，此处暂不实现具体逻辑
                 AIKITDLL::LogDebug("处理识别到的命令词...\n");
 
-                // 模拟处理命令的过程
-                Sleep(500);
+                // 模拟处理命令的过程，停止时立即结束
+                if (WaitForSingleObject(m_cancel.Event(), 500) == WAIT_OBJECT_0) {
+                    continue;
+                }
 
                 // 处理完命令后回到唤醒监听状态
                 TransitionToState(STATE_WAKEUP_LISTENING);
@@ -538,24 +628,32 @@ void VoiceStateManager::ControlThreadProc() {
             // 发生异常时进行资源清理和重置
             ResetSDKState();
             TransitionToState(STATE_IDLE);
-            Sleep(5000);
+            Backoff(5000);
         }
     }
 
-    // 线程退出前清理资源
+    // 线程退出前清理资源；先记下离开主循环的时刻，停止耗时据此区分中止和拆除
+    m_loopExitUs.store(audio_source_now_us());
     ResetSDKState();
+    if (holdsCapture) {
+        AIKITDLL::CaptureHub::Instance().Release();
+    }
     AIKITDLL::LogDebug("语音助手控制线程退出\n");
+    m_controlActive.store(false);
 }
 
 // 重置SDK状态和资源
 void VoiceStateManager::ResetSDKState() {
+    // 预开的命令词会话持有引擎引用，卸载引擎之前先结束它
+    AIKITDLL::EsrStandby::Instance().Discard();
+
     // 避免重入,先检查状态
     if (!m_sdkInitialized.load(std::memory_order_acquire) && 
         !m_wakeupInitialized.load(std::memory_order_acquire)) {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(m_stateMutex);
+    std::unique_lock<std::mutex> lock(m_stateMutex);
     
     // 获取当前状态用于日志
     VOICE_ASSISTANT_STATE currentState = m_currentState.load(std::memory_order_acquire);
@@ -564,29 +662,41 @@ void VoiceStateManager::ResetSDKState() {
     AIKITDLL::LogDebug("开始重置SDK状态和资源...\n");
     
     try {
-        // 清理唤醒资源
-        if (m_wakeupInitialized) {
+        // 先等后台引擎加载结束，再卸载引擎
+        AIKITDLL::EngineWarmup::Instance().Invalidate();
+
+        // 清理唤醒资源，常驻的引擎也一并卸载
+        if (m_wakeupInitialized || AIKITDLL::ivwEngineLoaded.load()) {
             AIKITDLL::LogDebug("清理唤醒资源...\n");
             Ivw70Uninit();
             m_wakeupInitialized = false;
         }
         
-        // 清理ESR资源
+        // 清理ESR资源，常驻的引擎和语法也一并卸载。
+        // 正在结束的识别会话归还引用时，回调可能还要获取状态锁，等待期间先释放锁
         AIKITDLL::LogDebug("清理ESR资源...\n");
         ResetEsrStatus();
+        lock.unlock();
+        bool esrReleased = (AIKITDLL::EsrEngineUnload(TEARDOWN_SESSION_TIMEOUT_MS) == 0);
+        lock.lock();
         
-        // 清理SDK
+        // 清理SDK；还有识别会话在用引擎时不能反初始化，留到下一次重置
         if (m_sdkInitialized) {
             AIKITDLL::LogDebug("清理SDK资源...\n");
-            AIKITDLL::SafeCleanupSDK();
-            m_sdkInitialized = false;
+            if (esrReleased && AIKITDLL::SafeCleanupSDK()) {
+                m_sdkInitialized = false;
+            }
+            else {
+                AIKITDLL::LogError("仍有识别会话在使用ESR引擎，暂不清理SDK\n");
+            }
         }
         
         // 重置错误计数
         m_consecutiveFailures.store(0);
         
-        // 强制等待一小段时间，确保资源完全释放
-        Sleep(100);
+        // 等待正在执行的SDK回调返回；回调会进入HandleEvent获取状态锁，先释放锁
+        lock.unlock();
+        AIKITDLL::Teardown::Instance().WaitCallbacksIdle(TEARDOWN_CALLBACK_TIMEOUT_MS);
         
         AIKITDLL::LogDebug("SDK状态和资源重置完成\n");
     }
@@ -599,6 +709,36 @@ void VoiceStateManager::ResetSDKState() {
     }
 }
 
+// 失败后重试前的退避，到期由会话定时器触发，停止时立即返回
+bool VoiceStateManager::Backoff(DWORD ms) {
+    unsigned long long begin = audio_source_now_us();
+    AIKITDLL::Deadline deadline;
+    // 清掉上一次退避被打断后才到期留下的信号
+    ResetEvent(m_backoffEvent);
+    deadline.Start(ms, m_backoffEvent);
+    HANDLE events[2] = { m_cancel.Event(), m_backoffEvent };
+    DWORD ret = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+    deadline.Cancel();
+    AIKITDLL::Teardown::Instance().Record(TEARDOWN_RETRY_BACKOFF, begin, ret == WAIT_OBJECT_0);
+    return ret != WAIT_OBJECT_0;
+}
+
+// 获取本次运行以来的唤醒次数和命令词识别成功次数
+void VoiceStateManager::GetEventCounts(int* wakeups, int* commands) {
+    if (wakeups) *wakeups = m_wakeupCount.load();
+    if (commands) *commands = m_commandCount.load();
+}
+
+// 获取最近一次停止的耗时
+bool VoiceStateManager::GetStopTimes(VoiceStopTimes* times) {
+    std::lock_guard<std::mutex> lock(m_stopTimesMutex);
+    if (!m_hasStopTimes) {
+        return false;
+    }
+    *times = m_stopTimes;
+    return true;
+}
+
 // 导出函数实现
 
 int StartVoiceAssistantLoop() {
@@ -632,3 +772,56 @@ int GetVoiceAssistantState() {
 const char* GetLastCommandResult() {
 	return AIKITDLL::lastResult.c_str();
 }
+
+int SetVoiceAudioSource(int type, const char* path, double speed, int loop) {
+	struct audio_source_config cfg = {};
+	cfg.type = type;
+	cfg.path = path;
+	cfg.speed = speed;
+	cfg.loop = loop;
+	if (type == AUDIO_SOURCE_SYNTH) {
+		// 合成源默认产生1kHz中等音量的音调
+		cfg.tone_hz = 1000;
+		cfg.level = 8000;
+	}
+
+	int ret = set_audio_source(&cfg);
+	if (ret != 0) {
+		AIKITDLL::LogError("设置音频源失败，类型: %d, 错误码: %d\n", type, ret);
+		return ret;
+	}
+	AIKITDLL::LogInfo("音频源已切换，类型: %d, 路径: %s, 倍速: %.2f\n", type, path ? path : "", speed);
+	return 0;
+}
+
+int SetVoiceCapturePeriod(int periodMs, int bufferDepth) {
+	if (periodMs <= 0 || bufferDepth <= 0
+		|| set_record_period((unsigned int)periodMs, (unsigned int)bufferDepth) != 0) {
+		AIKITDLL::LogError("设置录音周期失败，周期: %d ms, 深度: %d\n", periodMs, bufferDepth);
+		return -1;
+	}
+	AIKITDLL::LogInfo("录音周期已设置为 %d ms，队列深度 %d\n", periodMs, bufferDepth);
+	return 0;
+}
+
+int SetCommandPrerollMs(int prerollMs) {
+	if (prerollMs < 0) {
+		AIKITDLL::LogError("设置预录长度失败，长度: %d ms\n", prerollMs);
+		return -1;
+	}
+	AIKITDLL::CaptureHub::Instance().SetPrerollMs((unsigned int)prerollMs);
+	AIKITDLL::LogInfo("命令词识别预录长度已设置为 %u ms\n", AIKITDLL::CaptureHub::Instance().PrerollMs());
+	return 0;
+}
+
+void SetVoiceVadGate(int enabled) {
+	AIKITDLL::CaptureHub::Instance().SetVadEnabled(enabled != 0);
+	AIKITDLL::LogInfo("静音门限已%s\n", enabled ? "开启" : "关闭");
+}
+
+int GetVoiceStopTimes(VoiceStopTimes* times) {
+	if (!times) {
+		return -1;
+	}
+	return VoiceStateManager::GetInstance()->GetStopTimes(times) ? 0 : -1;
+}
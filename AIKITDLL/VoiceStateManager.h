@@ -2,6 +2,7 @@
 
 #include "pch.h"
 #include "Common.h"
+#include "CancelToken.h"
 #include <Windows.h>
 #include <string>
 #include <atomic>
@@ -16,6 +17,13 @@ enum VOICE_ASSISTANT_STATE {
     STATE_PROCESSING = 3        // 命令处理中
 };
 
+// 最近一次停止语音助手的耗时（微秒）
+struct VoiceStopTimes {
+    long long abortUs;   // 发出停止到控制线程离开主循环，即正在进行的会话或等待被中止的时间
+    long long totalUs;   // 发出停止到StopVoiceAssistant返回，含卸载引擎和反初始化SDK
+    int state;           // 停止时所处的状态（VOICE_ASSISTANT_STATE）
+};
+
 // 语音助手状态管理类
 class VoiceStateManager {
 private:
@@ -37,9 +45,24 @@ private:
     // 控制运行标志
     std::atomic<bool> m_isRunning;
     
+    // 控制线程从启动到清理完资源退出期间为true，停止请求发出后仍可能在拆除SDK
+    std::atomic<bool> m_controlActive;
+    
     // 状态转换事件句柄
     HANDLE m_stateChangeEvent;
     
+    // 取消令牌：停止时中止正在进行的唤醒、命令词会话和所有等待，启动时重置
+    AIKITDLL::CancelToken m_cancel;
+    
+    // 最近一次停止的计时，控制线程离开主循环的时刻由线程自己记录
+    std::atomic<unsigned long long> m_loopExitUs;
+    std::mutex m_stopTimesMutex;
+    VoiceStopTimes m_stopTimes;
+    bool m_hasStopTimes;
+    
+    // 退避到期事件（自动重置），由会话定时器触发
+    HANDLE m_backoffEvent;
+    
     // SDK初始化状态
     std::atomic<bool> m_sdkInitialized;
     
@@ -49,6 +72,10 @@ private:
     // 连续失败计数
     std::atomic<int> m_consecutiveFailures;
     
+    // 本次运行以来的唤醒次数和命令词识别成功次数
+    std::atomic<int> m_wakeupCount;
+    std::atomic<int> m_commandCount;
+    
     // 内部状态转换函数
     void TransitionToState(VOICE_ASSISTANT_STATE newState);
     
@@ -58,6 +85,9 @@ private:
     // 重置SDK状态和资源
     void ResetSDKState();
     
+    // 失败后重试前的退避，最多等待ms毫秒；收到停止请求时提前返回false
+    bool Backoff(DWORD ms);
+    
     // 确保单例模式
     static VoiceStateManager* s_instance;
     
@@ -80,11 +110,20 @@ public:
     // 获取当前状态
     VOICE_ASSISTANT_STATE GetCurrentState();
     
+    // 语音助手是否在运行或还在退出清理中，此时SDK和唤醒引擎归它管理
+    bool IsActive() const { return m_controlActive.load(); }
+    
     // 处理事件回调
     void HandleEvent(AIKIT_EVENT_TYPE eventType, const char* result);
     
     // 重置状态（用于错误恢复）
     void ResetState();
+    
+    // 获取本次运行以来的唤醒次数和命令词识别成功次数
+    void GetEventCounts(int* wakeups, int* commands);
+    
+    // 获取最近一次停止的耗时，还没有停止过时返回false
+    bool GetStopTimes(VoiceStopTimes* times);
 };
 
 // 导出函数声明
@@ -93,4 +132,18 @@ extern "C" {
     AIKITDLL_API int StopVoiceAssistantLoop();
     AIKITDLL_API int GetVoiceAssistantState();
     AIKITDLL_API const char* GetLastCommandResult();
+    // 选择唤醒与命令识别使用的音频源（见audiosrc.h），需在StartVoiceAssistantLoop前调用
+    // type: 0 waveIn, 1 ALSA, 2 文件回放, 3 合成信号; path: 文件路径或ALSA设备名
+    // speed: 文件/合成源的播放倍速，0为不限速; loop: 文件播完后是否从头循环
+    AIKITDLL_API int SetVoiceAudioSource(int type, const char* path, double speed, int loop);
+    // 设置录音周期（10~200ms，10的整数倍）和驱动队列深度（2~32），下次打开录音设备时生效
+    // 周期越短唤醒响应越快，但对送数线程的及时性要求越高
+    AIKITDLL_API int SetVoiceCapturePeriod(int periodMs, int bufferDepth);
+    // 设置命令词识别的预录长度（0~3000ms）：唤醒后从唤醒词结束处回放最多这么长的音频，
+    // 紧跟唤醒词说出的命令不会被截掉开头；0表示只识别进入命令词状态之后的音频
+    AIKITDLL_API int SetCommandPrerollMs(int prerollMs);
+    // 开关引擎前的静音门限（默认开启）：安静时不向唤醒和命令词引擎写入静音，下次开始监听时生效
+    AIKITDLL_API void SetVoiceVadGate(int enabled);
+    // 获取最近一次StopVoiceAssistantLoop的耗时，成功返回0，还没有停止过时返回-1
+    AIKITDLL_API int GetVoiceStopTimes(VoiceStopTimes* times);
 }
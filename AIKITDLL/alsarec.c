@@ -0,0 +1,202 @@
+/*
+@file
+@brief ALSA capture source, the linux counterpart of the waveIn source
+
+	A reader thread blocks in snd_pcm_readi() and hands each period to
+	rec->on_data_ind. Overruns (-EPIPE) are counted and recovered with
+	snd_pcm_prepare().
+	Link with -lasound.
+*/
+
+#ifndef _WIN32
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <alsa/asoundlib.h>
+#include "winrec.h"
+#include "audiosrc.h"
+
+struct alsa_source {
+	struct recorder *rec;
+	snd_pcm_t *pcm;
+	void *thread;
+	volatile int running;
+	volatile int exited;
+	char *buf;
+	snd_pcm_uframes_t period_frames;
+	unsigned int block_align;
+};
+
+/* how long the stream has been in overrun, from the xrun trigger timestamp */
+static unsigned long long alsa_xrun_us(snd_pcm_t *pcm)
+{
+	snd_pcm_status_t *status;
+	snd_timestamp_t now, trigger;
+
+	snd_pcm_status_alloca(&status);
+	if(snd_pcm_status(pcm, status) < 0 || snd_pcm_status_get_state(status) != SND_PCM_STATE_XRUN)
+		return 0;
+	snd_pcm_status_get_tstamp(status, &now);
+	snd_pcm_status_get_trigger_tstamp(status, &trigger);
+	if(now.tv_sec < trigger.tv_sec)
+		return 0;
+	return (unsigned long long)(now.tv_sec - trigger.tv_sec) * 1000000 + now.tv_usec - trigger.tv_usec;
+}
+
+static void alsa_thread_proc(void *para)
+{
+	struct alsa_source *src = (struct alsa_source *)para;
+	snd_pcm_sframes_t n;
+
+	while(src->running) {
+		n = snd_pcm_readi(src->pcm, src->buf, src->period_frames);
+		if(n == -EPIPE) {
+			/* counted only: the ring buffer size is fixed once hw_params are set */
+			record_account_overrun(src->rec, alsa_xrun_us(src->pcm), audio_source_now_us());
+			snd_pcm_prepare(src->pcm);
+			continue;
+		}
+		if(n == -ESTRPIPE) {
+			snd_pcm_prepare(src->pcm);
+			continue;
+		}
+		if(n < 0) {
+			if(snd_pcm_recover(src->pcm, (int)n, 1) < 0)
+				break;
+			continue;
+		}
+		if(n > 0)
+			record_account_period(src->rec, (unsigned long)n * src->block_align, audio_source_now_us());
+		if(n > 0 && src->running && src->rec->on_data_ind)
+			src->rec->on_data_ind(src->buf, (unsigned long)n * src->block_align, src->rec->user_cb_para);
+	}
+	src->exited = 1;
+}
+
+static unsigned int alsa_dev_num(void)
+{
+	snd_pcm_t *pcm;
+	if(snd_pcm_open(&pcm, "default", SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK) < 0)
+		return 0;
+	snd_pcm_close(pcm);
+	return 1;
+}
+
+static int alsa_default_dev(void)
+{
+	return 0;
+}
+
+static int alsa_open(struct recorder *rec, unsigned int dev, WAVEFORMATEX *fmt)
+{
+	const struct audio_source_config *cfg = audio_source_current();
+	const char *name = (cfg->path && cfg->path[0]) ? cfg->path : "default";
+	struct alsa_source *src;
+	unsigned int rate;
+	int err;
+
+	(void)dev;
+	if(fmt == NULL || fmt->wFormatTag != WAVE_FORMAT_PCM || fmt->wBitsPerSample != 16)
+		return -RECORD_ERR_INVAL;
+
+	src = (struct alsa_source *)malloc(sizeof(struct alsa_source));
+	if(!src)
+		return -RECORD_ERR_MEMFAIL;
+	memset(src, 0, sizeof(struct alsa_source));
+	src->rec = rec;
+	src->block_align = fmt->nChannels * 2;
+	src->period_frames = rec->period_bytes / src->block_align;
+
+	err = snd_pcm_open(&src->pcm, name, SND_PCM_STREAM_CAPTURE, 0);
+	if(err < 0) {
+		printf("snd_pcm_open %s failed: %s\n", name, snd_strerror(err));
+		free(src);
+		return -RECORD_ERR_GENERAL;
+	}
+
+	rate = fmt->nSamplesPerSec;
+	err = snd_pcm_set_params(src->pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+			fmt->nChannels, rate, 1, rec->period_ms * rec->depth * 1000);
+	if(err < 0) {
+		printf("snd_pcm_set_params failed: %s\n", snd_strerror(err));
+		snd_pcm_close(src->pcm);
+		free(src);
+		return -RECORD_ERR_GENERAL;
+	}
+
+	src->buf = (char *)malloc(src->period_frames * src->block_align);
+	if(!src->buf) {
+		snd_pcm_close(src->pcm);
+		free(src);
+		return -RECORD_ERR_MEMFAIL;
+	}
+
+	rec->source_data = src;
+	return 0;
+}
+
+static void alsa_close(struct recorder *rec)
+{
+	struct alsa_source *src = (struct alsa_source *)rec->source_data;
+	if(!src)
+		return;
+	src->running = 0;
+	if(src->thread) {
+		/* wake up a reader blocked in snd_pcm_readi */
+		snd_pcm_drop(src->pcm);
+		audio_source_thread_join(src->thread);
+	}
+	snd_pcm_close(src->pcm);
+	free(src->buf);
+	free(src);
+	rec->source_data = NULL;
+}
+
+static int alsa_start(struct recorder *rec)
+{
+	struct alsa_source *src = (struct alsa_source *)rec->source_data;
+	int ret;
+
+	if(src->thread) {
+		audio_source_thread_join(src->thread);
+		src->thread = NULL;
+	}
+	snd_pcm_prepare(src->pcm);
+	src->running = 1;
+	src->exited = 0;
+	ret = audio_source_thread_start(&src->thread, alsa_thread_proc, src);
+	if(ret != 0) {
+		src->running = 0;
+		src->exited = 1;
+	}
+	return ret;
+}
+
+static int alsa_stop(struct recorder *rec)
+{
+	struct alsa_source *src = (struct alsa_source *)rec->source_data;
+	src->running = 0;
+	snd_pcm_drop(src->pcm);
+	return 0;
+}
+
+static int alsa_is_stopped(struct recorder *rec)
+{
+	struct alsa_source *src = (struct alsa_source *)rec->source_data;
+	return src == NULL || src->thread == NULL || src->exited;
+}
+
+const struct audio_source_ops alsa_source_ops = {
+	"alsa",
+	alsa_dev_num,
+	alsa_default_dev,
+	alsa_open,
+	alsa_close,
+	alsa_start,
+	alsa_stop,
+	alsa_is_stopped
+};
+
+#endif /* _WIN32 */
@@ -0,0 +1,125 @@
+/*
+ * @file
+ * @brief pluggable audio sources behind the winrec recorder interface
+ *
+ * The recorder API in winrec.h (create_recorder, open_recorder, start_record,
+ * stop_record, close_recorder, destroy_recorder) stays the same for every
+ * source. A source is selected process-wide with set_audio_source() and is
+ * picked up by every recorder created afterwards:
+ *	AUDIO_SOURCE_WAVEIN	- windows waveIn device (default on windows)
+ *	AUDIO_SOURCE_ALSA	- ALSA capture device (default on linux)
+ *	AUDIO_SOURCE_FILE	- raw PCM / WAV file replayed at real-time or scaled pace
+ *	AUDIO_SOURCE_SYNTH	- synthetic generator (tone / bursts / silence)
+ *
+ * File and synthetic sources behave like a microphone that keeps running:
+ * their stream position follows the wall clock while paced, so audio that
+ * arrives while no recorder is open is lost, exactly like a real device.
+ */
+
+#ifndef __IFLY_AUDIOSRC_H__
+#define __IFLY_AUDIOSRC_H__
+
+#include "winrec.h"
+
+/* source types */
+enum audio_source_type {
+	AUDIO_SOURCE_WAVEIN = 0,
+	AUDIO_SOURCE_ALSA,
+	AUDIO_SOURCE_FILE,
+	AUDIO_SOURCE_SYNTH,
+	AUDIO_SOURCE_COUNT
+};
+
+/* process-wide source selection */
+struct audio_source_config {
+	int type;				/* enum audio_source_type */
+	const char *path;		/* FILE: audio file; ALSA: pcm name, NULL means "default" */
+	double speed;			/* FILE/SYNTH: 1.0 real time, 4.0 four times faster, 0 as fast as possible */
+	int loop;				/* FILE: restart from the beginning at the end of file */
+	unsigned int tone_hz;	/* SYNTH: sine frequency, 0 generates silence */
+	unsigned int level;		/* SYNTH: peak amplitude, 0..32767 */
+	unsigned int burst_on_ms;	/* SYNTH: tone on period, 0 means always on */
+	unsigned int burst_off_ms;	/* SYNTH: silence between bursts */
+};
+
+/* Do not change the sequence */
+enum {
+	RECORD_STATE_CREATED,	/* Init		*/
+	RECORD_STATE_READY,		/* Opened	*/
+	RECORD_STATE_STOPPING,	/* During Stop	*/
+	RECORD_STATE_RECORDING,	/* Started	*/
+};
+
+/* backend operations, called by the generic recorder layer with the state already checked */
+struct audio_source_ops {
+	const char *name;
+	unsigned int (*dev_num)(void);
+	int  (*default_dev)(void);
+	int  (*open)(struct recorder *rec, unsigned int dev, WAVEFORMATEX *fmt);
+	void (*close)(struct recorder *rec);
+	int  (*start)(struct recorder *rec);
+	int  (*stop)(struct recorder *rec);
+	int  (*is_stopped)(struct recorder *rec);
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* C++ */
+
+/**
+ * @fn
+ * @brief	Select the audio source used by recorders created from now on.
+ * @return	int			- Return 0 in success, otherwise return error code.
+ * @param	cfg			- [in] source config, NULL restores the platform default.
+ */
+int set_audio_source(const struct audio_source_config *cfg);
+
+/**
+ * @fn
+ * @brief	Get the current audio source config.
+ * @param	cfg			- [out] current config.
+ */
+void get_audio_source(struct audio_source_config *cfg);
+
+/**
+ * @fn
+ * @brief	Get the name of the source a recorder is bound to.
+ */
+const char * get_recorder_source_name(struct recorder *rec);
+
+/* -------------------------------------
+ * for backends only
+ --------------------------------------*/
+extern const struct audio_source_ops wavein_source_ops;
+extern const struct audio_source_ops alsa_source_ops;
+extern const struct audio_source_ops file_source_ops;
+extern const struct audio_source_ops synth_source_ops;
+
+/* the config copy the backends read from */
+const struct audio_source_config * audio_source_current(void);
+
+/* bumped by every set_audio_source(), lets simulated sources restart their clock */
+unsigned int audio_source_generation(void);
+
+/* health accounting, see struct record_stats.
+ * record_account_period is called for every period before on_data_ind;
+ * record_account_overrun when the driver ran out of buffers, it returns how
+ * many buffers the source should add to its queue (0 to keep the depth) */
+void record_account_period(struct recorder *rec, unsigned long len, unsigned long long now_us);
+unsigned int record_account_overrun(struct recorder *rec, unsigned long long stall_us, unsigned long long now_us);
+
+/* monotonic clock in microseconds */
+unsigned long long audio_source_now_us(void);
+
+/* sleep, in microseconds */
+void audio_source_sleep_us(unsigned long long us);
+
+/* worker thread for file/synth/alsa sources */
+int audio_source_thread_start(void **thread_out, void (*proc)(void *), void *para);
+void audio_source_thread_join(void *thread);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* C++ */
+
+#endif
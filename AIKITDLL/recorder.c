@@ -0,0 +1,499 @@
+/*
+@file
+@brief recorder interface shared by all audio sources
+
+	create_recorder binds a recorder to the audio source selected by
+	set_audio_source(); all the other calls are dispatched to that source.
+*/
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS	/* portable C: fopen/strcpy instead of the _s variants */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "winrec.h"
+#include "audiosrc.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+#define SOURCE_PATH_MAX 1024
+#define GAP_MIN_US		5000	/* lag jumps smaller than this are jitter */
+#define CLOCK_DRIFT_SHIFT	3	/* lag creeping up below the gap threshold is followed at 1/8 per window */
+
+static struct audio_source_config cur_cfg = {
+#ifdef _WIN32
+	AUDIO_SOURCE_WAVEIN,
+#else
+	AUDIO_SOURCE_ALSA,
+#endif
+	NULL, 1.0, 0, 0, 0, 0, 0
+};
+static char cur_path[SOURCE_PATH_MAX];
+static unsigned int cur_generation;
+static unsigned int cur_period_ms = RECORD_DEFAULT_PERIOD_MS;
+static unsigned int cur_depth = RECORD_DEFAULT_DEPTH;
+
+static int check_period(unsigned int period_ms, unsigned int depth)
+{
+	if(period_ms < RECORD_MIN_PERIOD_MS || period_ms > RECORD_MAX_PERIOD_MS || period_ms % 10 != 0)
+		return -RECORD_ERR_INVAL;
+	if(depth < RECORD_MIN_DEPTH || depth > RECORD_MAX_DEPTH)
+		return -RECORD_ERR_INVAL;
+	return 0;
+}
+
+static const struct audio_source_ops * source_ops_of(int type)
+{
+	switch(type) {
+#ifdef _WIN32
+	case AUDIO_SOURCE_WAVEIN:
+		return &wavein_source_ops;
+#else
+	case AUDIO_SOURCE_ALSA:
+		return &alsa_source_ops;
+#endif
+	case AUDIO_SOURCE_FILE:
+		return &file_source_ops;
+	case AUDIO_SOURCE_SYNTH:
+		return &synth_source_ops;
+	default:
+		return NULL;
+	}
+}
+
+/* -------------------------------------
+ * helpers for the sources
+ --------------------------------------*/
+const struct audio_source_config * audio_source_current(void)
+{
+	return &cur_cfg;
+}
+
+unsigned int audio_source_generation(void)
+{
+	return cur_generation;
+}
+
+unsigned long long audio_source_now_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (unsigned long long)(counter.QuadPart / freq.QuadPart * 1000000
+		+ counter.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void audio_source_sleep_us(unsigned long long us)
+{
+#ifdef _WIN32
+	/* Sleep() has 1ms granularity; round up so pacing never runs ahead */
+	Sleep((DWORD)((us + 999) / 1000));
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t)(us / 1000000);
+	ts.tv_nsec = (long)(us % 1000000) * 1000;
+	while(nanosleep(&ts, &ts) != 0 && errno == EINTR)
+		;
+#endif
+}
+
+/* -------------------------------------
+ * health accounting
+ *
+ * Gaps: every period the delivered byte count is turned into stream time and
+ * compared with the clock; the difference is the delivery lag. A callback
+ * that runs late only raises the lag until the queue is drained, lost audio
+ * raises it for good. So the smallest lag over a window of depth + 1 periods
+ * is compared with the usual lag; a step of more than half a period that
+ * is still there, no longer falling, one window later is a gap of that
+ * length. Slow clock drift is followed without counting.
+ --------------------------------------*/
+static void restart_clock(struct recorder *rec)
+{
+	rec->clock_start_us = audio_source_now_us();
+	rec->clock_bytes = 0;
+	rec->clock_valid = 0;
+	rec->clock_pending = 0;
+	rec->overrun_streak = 0;
+}
+
+void record_account_period(struct recorder *rec, unsigned long len, unsigned long long now_us)
+{
+	long long lag, threshold, step;
+
+	if(len == 0)
+		return;
+	rec->stats.periods++;
+	rec->stats.bytes += len;
+	if(rec->bytes_per_sec == 0)
+		return;
+
+	rec->clock_bytes += len;
+	lag = (long long)(now_us - rec->clock_start_us)
+		- (long long)(rec->clock_bytes * 1000000 / rec->bytes_per_sec);
+	if(!rec->clock_valid) {
+		rec->clock_valid = 1;
+		rec->clock_base_us = lag;
+		rec->window_min_us = lag;
+		rec->window_left = rec->depth + 1;
+		return;
+	}
+
+	if(lag < rec->window_min_us)
+		rec->window_min_us = lag;
+	if(--rec->window_left > 0)
+		return;
+
+	threshold = (long long)rec->period_ms * 1000 / 2;
+	if(threshold < GAP_MIN_US)
+		threshold = GAP_MIN_US;
+	step = rec->window_min_us - rec->clock_base_us;
+	if(step < 0) {
+		/* delivered earlier than before: start-up latency settling or an unpaced source */
+		rec->clock_base_us = rec->window_min_us;
+		rec->clock_pending = 0;
+	} else if(step <= threshold) {
+		rec->clock_base_us += step >> CLOCK_DRIFT_SHIFT;
+		rec->clock_pending = 0;
+	} else if(rec->clock_pending && rec->window_prev_us - rec->window_min_us <= threshold) {
+		rec->stats.gaps++;
+		rec->stats.lost_bytes += (unsigned long long)step * rec->bytes_per_sec / 1000000
+			/ rec->block_align * rec->block_align;
+		rec->clock_base_us = rec->window_min_us;
+		rec->clock_pending = 0;
+	} else {
+		/* raised, but may still be a backlog draining */
+		rec->clock_pending = 1;
+	}
+	rec->window_prev_us = rec->window_min_us;
+	rec->window_min_us = lag;
+	rec->window_left = rec->depth + 1;
+}
+
+unsigned int record_account_overrun(struct recorder *rec, unsigned long long stall_us, unsigned long long now_us)
+{
+	unsigned int add;
+
+	rec->stats.overruns++;
+	rec->stats.stall_us += stall_us;
+	if(stall_us > rec->stats.max_stall_us)
+		rec->stats.max_stall_us = stall_us;
+
+	if(rec->overrun_streak == 0 || now_us - rec->overrun_first_us > RECORD_GROW_WINDOW_MS * 1000ULL) {
+		rec->overrun_streak = 0;
+		rec->overrun_first_us = now_us;
+	}
+	if(++rec->overrun_streak < RECORD_GROW_OVERRUNS)
+		return 0;
+	rec->overrun_streak = 0;
+
+	if(rec->depth >= RECORD_MAX_DEPTH)
+		return 0;
+	add = rec->depth / 2;
+	if(add == 0)
+		add = 1;
+	if(add > RECORD_MAX_DEPTH - rec->depth)
+		add = RECORD_MAX_DEPTH - rec->depth;
+	return add;
+}
+
+struct thread_start {
+	void (*proc)(void *);
+	void *para;
+};
+
+#ifdef _WIN32
+static unsigned int __stdcall thread_entry(void *p)
+#else
+static void * thread_entry(void *p)
+#endif
+{
+	struct thread_start start = *(struct thread_start *)p;
+	free(p);
+	start.proc(start.para);
+	return 0;
+}
+
+int audio_source_thread_start(void **thread_out, void (*proc)(void *), void *para)
+{
+	struct thread_start *start;
+
+	start = (struct thread_start *)malloc(sizeof(struct thread_start));
+	if(!start)
+		return -RECORD_ERR_MEMFAIL;
+	start->proc = proc;
+	start->para = para;
+
+#ifdef _WIN32
+	{
+		unsigned int tid;
+		HANDLE hdl = (HANDLE)_beginthreadex(NULL, 0, thread_entry, start, 0, &tid);
+		if(hdl == 0) {
+			free(start);
+			return -RECORD_ERR_GENERAL;
+		}
+		*thread_out = hdl;
+	}
+#else
+	{
+		pthread_t *tid = (pthread_t *)malloc(sizeof(pthread_t));
+		if(!tid) {
+			free(start);
+			return -RECORD_ERR_MEMFAIL;
+		}
+		if(pthread_create(tid, NULL, thread_entry, start) != 0) {
+			free(tid);
+			free(start);
+			return -RECORD_ERR_GENERAL;
+		}
+		*thread_out = tid;
+	}
+#endif
+	return 0;
+}
+
+void audio_source_thread_join(void *thread)
+{
+	if(thread == NULL)
+		return;
+#ifdef _WIN32
+	WaitForSingleObject((HANDLE)thread, INFINITE);
+	CloseHandle((HANDLE)thread);
+#else
+	pthread_join(*(pthread_t *)thread, NULL);
+	free(thread);
+#endif
+}
+
+/* -------------------------------------
+ * Interfaces
+ --------------------------------------*/
+int set_audio_source(const struct audio_source_config *cfg)
+{
+	struct audio_source_config def = {
+#ifdef _WIN32
+		AUDIO_SOURCE_WAVEIN,
+#else
+		AUDIO_SOURCE_ALSA,
+#endif
+		NULL, 1.0, 0, 0, 0, 0, 0
+	};
+
+	if(cfg == NULL)
+		cfg = &def;
+	if(source_ops_of(cfg->type) == NULL)
+		return -RECORD_ERR_INVAL;
+	if(cfg->type == AUDIO_SOURCE_FILE && (cfg->path == NULL || cfg->path[0] == '\0'))
+		return -RECORD_ERR_INVAL;
+	if(cfg->speed < 0)
+		return -RECORD_ERR_INVAL;
+	if(cfg->path && strlen(cfg->path) >= SOURCE_PATH_MAX)
+		return -RECORD_ERR_INVAL;
+
+	cur_cfg = *cfg;
+	if(cfg->path) {
+		strcpy(cur_path, cfg->path);
+		cur_cfg.path = cur_path;
+	} else {
+		cur_path[0] = '\0';
+		cur_cfg.path = NULL;
+	}
+	cur_generation++;
+	return 0;
+}
+
+void get_audio_source(struct audio_source_config *cfg)
+{
+	if(cfg)
+		*cfg = cur_cfg;
+}
+
+const char * get_recorder_source_name(struct recorder *rec)
+{
+	if(rec == NULL || rec->ops == NULL)
+		return "none";
+	return rec->ops->name;
+}
+
+int set_record_period(unsigned int period_ms, unsigned int depth)
+{
+	if(check_period(period_ms, depth) != 0)
+		return -RECORD_ERR_INVAL;
+	cur_period_ms = period_ms;
+	cur_depth = depth;
+	return 0;
+}
+
+void get_record_period(unsigned int *period_ms, unsigned int *depth)
+{
+	if(period_ms)
+		*period_ms = cur_period_ms;
+	if(depth)
+		*depth = cur_depth;
+}
+
+int get_recorder_stats(struct recorder *rec, struct record_stats *stats)
+{
+	if(rec == NULL || stats == NULL)
+		return -RECORD_ERR_INVAL;
+	*stats = rec->stats;
+	stats->depth = rec->state >= RECORD_STATE_READY ? rec->depth : 0;
+	return 0;
+}
+
+unsigned int get_recorder_period_bytes(struct recorder *rec)
+{
+	if(rec == NULL || rec->state < RECORD_STATE_READY)
+		return 0;
+	return rec->period_bytes;
+}
+
+int get_default_input_dev()
+{
+	const struct audio_source_ops *ops = source_ops_of(cur_cfg.type);
+	return ops ? ops->default_dev() : 0;
+}
+
+unsigned int get_input_dev_num()
+{
+	const struct audio_source_ops *ops = source_ops_of(cur_cfg.type);
+	return ops ? ops->dev_num() : 0;
+}
+
+/* callback will be run on a new thread */
+int create_recorder(struct recorder ** out_rec,
+				void (*on_data_ind)(char *data, unsigned long len, void *user_cb_para),
+				void* user_cb_para)
+{
+	struct recorder * myrec;
+	const struct audio_source_ops *ops;
+
+	ops = source_ops_of(cur_cfg.type);
+	if(ops == NULL)
+		return -RECORD_ERR_NOT_READY;
+
+	myrec = (struct recorder *)malloc(sizeof(struct recorder));
+	if(!myrec)
+		return -RECORD_ERR_MEMFAIL;
+
+	memset(myrec, 0, sizeof(struct recorder));
+	myrec->on_data_ind = on_data_ind;
+	myrec->user_cb_para = user_cb_para;
+	myrec->state = RECORD_STATE_CREATED;
+	myrec->ops = ops;
+
+	*out_rec = myrec;
+	return 0;
+}
+
+void destroy_recorder(struct recorder *rec)
+{
+	if(!rec)
+		return;
+
+	free(rec);
+}
+
+int open_recorder(struct recorder * rec, unsigned int dev, WAVEFORMATEX * fmt)
+{
+	return open_recorder_ex(rec, dev, fmt, cur_period_ms, cur_depth);
+}
+
+int open_recorder_ex(struct recorder * rec, unsigned int dev, WAVEFORMATEX * fmt,
+				unsigned int period_ms, unsigned int depth)
+{
+	int ret = 0;
+	if(!rec )
+		return -RECORD_ERR_INVAL;
+	if(rec->state >= RECORD_STATE_READY)
+		return 0;
+	if(check_period(period_ms, depth) != 0)
+		return -RECORD_ERR_INVAL;
+
+	rec->period_ms = period_ms;
+	rec->depth = depth;
+	if(fmt) {
+		rec->period_bytes = fmt->nBlockAlign * (fmt->nSamplesPerSec * period_ms / 1000);
+		rec->block_align = fmt->nBlockAlign;
+		rec->bytes_per_sec = fmt->nBlockAlign * fmt->nSamplesPerSec;
+	} else {
+		rec->period_bytes = 16 * 2 * period_ms;	/* 16khz, 16bit, mono */
+		rec->block_align = 2;
+		rec->bytes_per_sec = 16000 * 2;
+	}
+
+	ret = rec->ops->open(rec, dev, fmt);
+	if(ret == 0)
+		rec->state = RECORD_STATE_READY;
+	return ret;
+
+}
+
+void close_recorder(struct recorder *rec)
+{
+	if(rec == NULL || rec->state < RECORD_STATE_READY)
+		return;
+	if(rec->state == RECORD_STATE_RECORDING)
+		stop_record(rec);
+
+	rec->ops->close(rec);
+
+	rec->state = RECORD_STATE_CREATED;
+}
+
+int start_record(struct recorder * rec)
+{
+	int ret;
+	if(rec == NULL)
+		return -RECORD_ERR_INVAL;
+	if( rec->state < RECORD_STATE_READY)
+		return -RECORD_ERR_NOT_READY;
+	if( rec->state == RECORD_STATE_RECORDING)
+		return 0;
+
+	/* set before starting: sources may deliver data before start returns */
+	restart_clock(rec);
+	rec->state = RECORD_STATE_RECORDING;
+	ret = rec->ops->start(rec);
+	if(ret != 0)
+		rec->state = RECORD_STATE_READY;
+	return ret;
+}
+
+int stop_record(struct recorder * rec)
+{
+	int ret;
+	if(rec == NULL)
+		return -RECORD_ERR_INVAL;
+	if( rec->state < RECORD_STATE_RECORDING)
+		return 0;
+
+	rec->state = RECORD_STATE_STOPPING;
+	ret = rec->ops->stop(rec);
+	if(ret == 0) {
+		rec->state = RECORD_STATE_READY;
+	}
+	return ret;
+}
+
+int is_record_stopped(struct recorder *rec)
+{
+	if(rec->state == RECORD_STATE_RECORDING)
+		return 0;
+
+	return rec->ops->is_stopped(rec);
+}
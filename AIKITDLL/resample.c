@@ -0,0 +1,401 @@
+/*
+@file
+@brief capture-side format conversion: channel downmix + polyphase resampler
+
+	Output sample n sits at n*M in the upsampled (rate * L) domain. With
+	base = n*M / L and phase = n*M % L it is the dot product of the phase's
+	coefficients with the last taps input samples ending at base. When
+	decimating, taps grows with M/L so the transition band stays the same
+	width at the output rate.
+	Coefficients are stored reversed per phase so that the dot product runs
+	over contiguous memory in both arrays.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "resample.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RS_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RS_TARGET_AVX2
+#else
+#define RS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define RS_KAISER_BETA	8.0	/* about 80dB stop band */
+#define RS_CUTOFF	0.85	/* filter cutoff relative to the lower Nyquist, stop band ends near Nyquist */
+#define RS_TAP_ALIGN	16	/* taps are a multiple of the widest kernel step */
+
+typedef float (*rs_dot_fn)(const float *a, const float *b, unsigned int n);
+
+struct resampler {
+	unsigned int in_rate;
+	unsigned int out_rate;
+	unsigned int channels;
+	unsigned int L;			/* interpolation factor */
+	unsigned int M;			/* decimation factor */
+	unsigned int max_in_frames;
+	unsigned int taps;		/* filter taps per phase */
+
+	float *coefs;			/* L phases x taps, reversed */
+	float *buf;			/* history + pending mono input */
+	unsigned int buf_len;
+	unsigned int buf_cap;
+	unsigned long long pos;		/* next output position in the upsampled domain, relative to buf[0] */
+
+	enum resampler_simd simd;
+	rs_dot_fn dot;
+};
+
+/* -------------------------------------
+ * Kernels
+ --------------------------------------*/
+static float dot_scalar(const float *a, const float *b, unsigned int n)
+{
+	float acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+	unsigned int i;
+
+	for(i = 0; i < n; i += 4) {
+		acc0 += a[i] * b[i];
+		acc1 += a[i + 1] * b[i + 1];
+		acc2 += a[i + 2] * b[i + 2];
+		acc3 += a[i + 3] * b[i + 3];
+	}
+	return (acc0 + acc1) + (acc2 + acc3);
+}
+
+#ifdef RS_X86
+static float dot_sse2(const float *a, const float *b, unsigned int n)
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	__m128 sum;
+	unsigned int i;
+
+	for(i = 0; i < n; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	sum = _mm_add_ps(acc0, acc1);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+RS_TARGET_AVX2
+static float dot_avx2(const float *a, const float *b, unsigned int n)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	__m128 sum;
+	unsigned int i;
+
+	for(i = 0; i < n; i += 16) {
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+	}
+	acc0 = _mm256_add_ps(acc0, acc1);
+	sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+/* stereo -> mono, 4 frames per step: (l + r) / 2 */
+static unsigned int downmix_stereo_sse2(const short *in, unsigned int frames, float *out)
+{
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128 half = _mm_set1_ps(0.5f);
+	unsigned int i;
+
+	for(i = 0; i + 4 <= frames; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i * 2));
+		__m128i lr = _mm_madd_epi16(v, ones);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lr), half));
+	}
+	return i;
+}
+#endif
+
+enum resampler_simd resampler_detect_simd(void)
+{
+#ifdef RS_X86
+#ifdef _MSC_VER
+	int info[4];
+	int has_avx2 = 0;
+
+	__cpuid(info, 0);
+	if(info[0] >= 7) {
+		int osxsave, avx;
+		__cpuid(info, 1);
+		osxsave = (info[2] >> 27) & 1;
+		avx = (info[2] >> 28) & 1;
+		__cpuidex(info, 7, 0);
+		/* the OS must save the YMM registers too */
+		if(osxsave && avx && ((info[1] >> 5) & 1) && (_xgetbv(0) & 0x6) == 0x6)
+			has_avx2 = 1;
+	}
+	if(has_avx2)
+		return RESAMPLER_SIMD_AVX2;
+	return RESAMPLER_SIMD_SSE2;
+#else
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		return RESAMPLER_SIMD_AVX2;
+	if(__builtin_cpu_supports("sse2"))
+		return RESAMPLER_SIMD_SSE2;
+	return RESAMPLER_SIMD_SCALAR;
+#endif
+#else
+	return RESAMPLER_SIMD_SCALAR;
+#endif
+}
+
+const char *resampler_simd_name(enum resampler_simd simd)
+{
+	switch(simd) {
+	case RESAMPLER_SIMD_AVX2:
+		return "avx2";
+	case RESAMPLER_SIMD_SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+enum resampler_simd resampler_set_simd(struct resampler *rs, enum resampler_simd simd)
+{
+	enum resampler_simd best = resampler_detect_simd();
+
+	if(simd > best)
+		simd = best;
+	rs->simd = simd;
+	switch(simd) {
+#ifdef RS_X86
+	case RESAMPLER_SIMD_AVX2:
+		rs->dot = dot_avx2;
+		break;
+	case RESAMPLER_SIMD_SSE2:
+		rs->dot = dot_sse2;
+		break;
+#endif
+	default:
+		rs->simd = RESAMPLER_SIMD_SCALAR;
+		rs->dot = dot_scalar;
+		break;
+	}
+	return rs->simd;
+}
+
+/* -------------------------------------
+ * Filter design
+ --------------------------------------*/
+static unsigned int gcd(unsigned int a, unsigned int b)
+{
+	while(b) {
+		unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* zeroth order modified Bessel function of the first kind */
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for(k = 1; k < 50; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if(term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+static void design_filter(struct resampler *rs)
+{
+	unsigned int len = rs->L * rs->taps;
+	/* cutoff in cycles per upsampled sample */
+	double nyquist = (rs->in_rate < rs->out_rate ? rs->in_rate : rs->out_rate) / 2.0;
+	double fc = RS_CUTOFF * nyquist / ((double)rs->in_rate * rs->L);
+	double center = (len - 1) / 2.0;
+	double i0_beta = bessel_i0(RS_KAISER_BETA);
+	unsigned int i, p, k;
+
+	for(i = 0; i < len; i++) {
+		double x = i - center;
+		double sinc = x == 0 ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+		double r = x / (center + 1.0);
+		double w = bessel_i0(RS_KAISER_BETA * sqrt(1.0 - r * r)) / i0_beta;
+		double h = sinc * w * rs->L;	/* interpolation gain */
+
+		/* h[k*L + p] is tap k of phase p, stored reversed */
+		p = i % rs->L;
+		k = i / rs->L;
+		rs->coefs[p * rs->taps + (rs->taps - 1 - k)] = (float)h;
+	}
+
+	/* unity DC gain for every phase so a constant input gives no ripple */
+	for(p = 0; p < rs->L; p++) {
+		float *c = rs->coefs + p * rs->taps;
+		double sum = 0;
+		for(k = 0; k < rs->taps; k++)
+			sum += c[k];
+		if(sum != 0) {
+			for(k = 0; k < rs->taps; k++)
+				c[k] = (float)(c[k] / sum);
+		}
+	}
+}
+
+/* -------------------------------------
+ * Interfaces
+ --------------------------------------*/
+struct resampler *resampler_create(unsigned int in_rate, unsigned int channels,
+		unsigned int out_rate, unsigned int max_in_frames)
+{
+	struct resampler *rs;
+	unsigned int g;
+
+	if(in_rate == 0 || out_rate == 0 || channels == 0 || channels > 8 || max_in_frames == 0)
+		return NULL;
+
+	rs = (struct resampler *)calloc(1, sizeof(*rs));
+	if(rs == NULL)
+		return NULL;
+
+	g = gcd(in_rate, out_rate);
+	rs->in_rate = in_rate;
+	rs->out_rate = out_rate;
+	rs->channels = channels;
+	rs->L = out_rate / g;
+	rs->M = in_rate / g;
+	rs->max_in_frames = max_in_frames;
+	rs->taps = RESAMPLER_BASE_TAPS;
+	if(rs->M > rs->L)
+		rs->taps = RESAMPLER_BASE_TAPS * ((rs->M + rs->L - 1) / rs->L);
+	rs->taps = (rs->taps + RS_TAP_ALIGN - 1) / RS_TAP_ALIGN * RS_TAP_ALIGN;
+
+	rs->coefs = (float *)malloc(sizeof(float) * rs->L * rs->taps);
+	rs->buf_cap = rs->taps + max_in_frames;
+	rs->buf = (float *)malloc(sizeof(float) * rs->buf_cap);
+	if(rs->coefs == NULL || rs->buf == NULL) {
+		resampler_destroy(rs);
+		return NULL;
+	}
+
+	design_filter(rs);
+	resampler_set_simd(rs, resampler_detect_simd());
+	resampler_reset(rs);
+	return rs;
+}
+
+void resampler_destroy(struct resampler *rs)
+{
+	if(rs == NULL)
+		return;
+	free(rs->coefs);
+	free(rs->buf);
+	free(rs);
+}
+
+void resampler_reset(struct resampler *rs)
+{
+	/* start from silence: taps-1 zero samples of history */
+	memset(rs->buf, 0, sizeof(float) * (rs->taps - 1));
+	rs->buf_len = rs->taps - 1;
+	rs->pos = (unsigned long long)(rs->taps - 1) * rs->L;
+}
+
+unsigned int resampler_max_output(const struct resampler *rs, unsigned int frames)
+{
+	return (unsigned int)(((unsigned long long)frames * rs->L) / rs->M) + 2;
+}
+
+static void downmix(const struct resampler *rs, const short *in, unsigned int frames, float *out)
+{
+	unsigned int i = 0, c;
+
+	if(rs->channels == 1) {
+		for(i = 0; i < frames; i++)
+			out[i] = in[i];
+		return;
+	}
+#ifdef RS_X86
+	if(rs->channels == 2 && rs->simd != RESAMPLER_SIMD_SCALAR)
+		i = downmix_stereo_sse2(in, frames, out);
+#endif
+	for(; i < frames; i++) {
+		int sum = 0;
+		for(c = 0; c < rs->channels; c++)
+			sum += in[i * rs->channels + c];
+		out[i] = (float)sum / rs->channels;
+	}
+}
+
+static short to_s16(float v)
+{
+	if(v >= 32767.0f)
+		return 32767;
+	if(v <= -32768.0f)
+		return -32768;
+	return (short)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+unsigned int resampler_process(struct resampler *rs, const short *in, unsigned int frames,
+		short *out, unsigned int out_cap)
+{
+	unsigned int produced = 0;
+	unsigned int drop;
+
+	if(rs == NULL || in == NULL || out == NULL)
+		return 0;
+
+	while(frames > 0) {
+		unsigned int room = rs->buf_cap - rs->buf_len;
+		unsigned int n = frames < room ? frames : room;
+
+		if(n == 0)
+			break;	/* out is full and input is backing up, drop the rest */
+
+		downmix(rs, in, n, rs->buf + rs->buf_len);
+		rs->buf_len += n;
+		in += (size_t)n * rs->channels;
+		frames -= n;
+
+		/* every output whose newest input sample has arrived */
+		while(produced < out_cap) {
+			unsigned long long base = rs->pos / rs->L;
+			unsigned int phase = (unsigned int)(rs->pos % rs->L);
+			if(base >= rs->buf_len)
+				break;
+			out[produced++] = to_s16(rs->dot(rs->coefs + phase * rs->taps,
+				rs->buf + base - (rs->taps - 1), rs->taps));
+			rs->pos += rs->M;
+		}
+
+		/* keep taps-1 samples of history before the next output */
+		drop = (unsigned int)(rs->pos / rs->L) - (rs->taps - 1);
+		if(drop > rs->buf_len)
+			drop = rs->buf_len;
+		if(drop > 0) {
+			memmove(rs->buf, rs->buf + drop, sizeof(float) * (rs->buf_len - drop));
+			rs->buf_len -= drop;
+			rs->pos -= (unsigned long long)drop * rs->L;
+		}
+	}
+	return produced;
+}
@@ -0,0 +1,59 @@
+/*
+@file
+@brief capture-side format conversion: channel downmix + polyphase resampler
+
+	Converts interleaved 16bit PCM of any rate / channel count into the
+	16bit mono stream the engines expect. The rate change is done by a
+	rational polyphase FIR (L/M, Kaiser windowed sinc); the inner dot product
+	has AVX2 and SSE2 versions picked at runtime, with a scalar fallback.
+
+	A resampler keeps its filter history between calls, so a stream can be
+	fed period by period. It is not thread safe; use one per stream.
+*/
+
+#ifndef __AIKIT_RESAMPLE_H__
+#define __AIKIT_RESAMPLE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* instruction set used by the filter kernel */
+enum resampler_simd {
+	RESAMPLER_SIMD_SCALAR = 0,
+	RESAMPLER_SIMD_SSE2,
+	RESAMPLER_SIMD_AVX2
+};
+
+#define RESAMPLER_BASE_TAPS	64	/* filter taps per phase, times ceil(M/L) when decimating */
+
+struct resampler;
+
+/* max_in_frames: input block size, normally one capture period; longer input is
+ * processed block by block. returns NULL on bad parameters or out of memory */
+struct resampler *resampler_create(unsigned int in_rate, unsigned int channels,
+		unsigned int out_rate, unsigned int max_in_frames);
+void resampler_destroy(struct resampler *rs);
+
+/* drop the filter history, e.g. when the device is reopened */
+void resampler_reset(struct resampler *rs);
+
+/* upper bound of output samples produced from frames input frames */
+unsigned int resampler_max_output(const struct resampler *rs, unsigned int frames);
+
+/* in: frames of interleaved 16bit samples; out: 16bit mono.
+ * returns the number of samples written to out (never more than out_cap) */
+unsigned int resampler_process(struct resampler *rs, const short *in, unsigned int frames,
+		short *out, unsigned int out_cap);
+
+/* best kernel this CPU supports */
+enum resampler_simd resampler_detect_simd(void);
+/* force a kernel (clamped to what the CPU supports), returns the one in use */
+enum resampler_simd resampler_set_simd(struct resampler *rs, enum resampler_simd simd);
+const char *resampler_simd_name(enum resampler_simd simd);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,414 @@
+/*
+@file
+@brief simulated capture sources: PCM/WAV file replay and synthetic generator
+
+	Both sources run a worker thread that delivers one period of audio at a
+	time through rec->on_data_ind, like the waveIn callback thread does.
+	While paced (speed > 0) the stream position follows a device clock that
+	starts when the source is selected, so closing and reopening a recorder
+	skips the audio "spoken" in between, the same as a real microphone.
+*/
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS	/* portable C: fopen/strcpy instead of the _s variants */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "winrec.h"
+#include "audiosrc.h"
+
+#define SIM_RESYNC_MS	1000	/* drop the backlog when the thread falls this far behind */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct sim_source {
+	struct recorder *rec;
+	void *thread;
+	volatile int running;	/* thread keeps delivering while set */
+	volatile int exited;	/* thread has left its loop */
+
+	char *buf;
+	unsigned int period_bytes;
+	unsigned int block_align;
+	unsigned int bytes_per_sec;
+	unsigned int channels;
+	unsigned int sample_rate;
+	double speed;
+
+	unsigned long long pos;		/* stream position in bytes */
+
+	/* file */
+	FILE *fp;
+	unsigned long long data_offset;
+	unsigned long long data_len;
+	int loop;
+
+	/* synth */
+	unsigned int tone_hz;
+	unsigned int level;
+	unsigned int burst_on_ms;
+	unsigned int burst_off_ms;
+
+	/* fills at most len bytes at pos, returns 0 at end of stream */
+	unsigned int (*fill)(struct sim_source *src, char *buf, unsigned int len);
+};
+
+/* device clock shared by the simulated sources, restarted by set_audio_source() */
+static unsigned int clock_generation = (unsigned int)-1;
+static unsigned long long clock_epoch_us;
+
+static unsigned long long device_clock_pos(struct sim_source *src)
+{
+	unsigned long long now = audio_source_now_us();
+	double bytes;
+
+	if(clock_generation != audio_source_generation()) {
+		clock_generation = audio_source_generation();
+		clock_epoch_us = now;
+	}
+	bytes = (double)(now - clock_epoch_us) * src->bytes_per_sec * src->speed / 1000000.0;
+	return (unsigned long long)bytes / src->block_align * src->block_align;
+}
+
+static void sim_thread_proc(void *para)
+{
+	struct sim_source *src = (struct sim_source *)para;
+	unsigned long long next_due = audio_source_now_us();
+	unsigned long long now;
+	unsigned int len;
+
+	while(src->running) {
+		len = src->fill(src, src->buf, src->period_bytes);
+		if(len == 0) {
+			/* end of a non-looping file: the device goes quiet */
+			audio_source_sleep_us(src->rec->period_ms * 1000);
+			continue;
+		}
+		src->pos += len;
+		record_account_period(src->rec, len, audio_source_now_us());
+		if(src->running && src->rec->on_data_ind)
+			src->rec->on_data_ind(src->buf, len, src->rec->user_cb_para);
+
+		if(src->speed <= 0)
+			continue;
+		next_due += (unsigned long long)((double)len * 1000000.0 / (src->bytes_per_sec * src->speed));
+		now = audio_source_now_us();
+		if(next_due > now)
+			audio_source_sleep_us(next_due - now);
+		else if(now - next_due > SIM_RESYNC_MS * 1000)
+			next_due = now;
+	}
+	src->exited = 1;
+}
+
+static int check_format(WAVEFORMATEX *fmt)
+{
+	if(fmt == NULL || fmt->wFormatTag != WAVE_FORMAT_PCM || fmt->wBitsPerSample != 16
+		|| fmt->nChannels == 0 || fmt->nSamplesPerSec == 0)
+		return -RECORD_ERR_INVAL;
+	return 0;
+}
+
+static struct sim_source * sim_source_new(struct recorder *rec, WAVEFORMATEX *fmt)
+{
+	const struct audio_source_config *cfg = audio_source_current();
+	struct sim_source *src;
+
+	src = (struct sim_source *)malloc(sizeof(struct sim_source));
+	if(!src)
+		return NULL;
+	memset(src, 0, sizeof(struct sim_source));
+
+	src->rec = rec;
+	src->channels = fmt->nChannels;
+	src->sample_rate = fmt->nSamplesPerSec;
+	src->block_align = fmt->nChannels * 2;
+	src->bytes_per_sec = src->sample_rate * src->block_align;
+	src->period_bytes = rec->period_bytes;
+	src->speed = cfg->speed;
+	src->loop = cfg->loop;
+	src->tone_hz = cfg->tone_hz;
+	src->level = cfg->level > 32767 ? 32767 : cfg->level;
+	src->burst_on_ms = cfg->burst_on_ms;
+	src->burst_off_ms = cfg->burst_off_ms;
+
+	src->buf = (char *)malloc(src->period_bytes);
+	if(!src->buf) {
+		free(src);
+		return NULL;
+	}
+	return src;
+}
+
+static void sim_source_free(struct sim_source *src)
+{
+	if(!src)
+		return;
+	if(src->fp)
+		fclose(src->fp);
+	if(src->buf)
+		free(src->buf);
+	free(src);
+}
+
+static int sim_start(struct recorder *rec)
+{
+	struct sim_source *src = (struct sim_source *)rec->source_data;
+	int ret;
+
+	/* join a thread left over from a previous start/stop */
+	if(src->thread) {
+		audio_source_thread_join(src->thread);
+		src->thread = NULL;
+	}
+	if(src->speed > 0) {
+		unsigned long long pos = device_clock_pos(src);
+		if(pos > src->pos)
+			src->pos = pos;
+	}
+
+	src->running = 1;
+	src->exited = 0;
+	ret = audio_source_thread_start(&src->thread, sim_thread_proc, src);
+	if(ret != 0) {
+		src->running = 0;
+		src->exited = 1;
+	}
+	return ret;
+}
+
+static int sim_stop(struct recorder *rec)
+{
+	struct sim_source *src = (struct sim_source *)rec->source_data;
+	src->running = 0;
+	return 0;
+}
+
+static void sim_close(struct recorder *rec)
+{
+	struct sim_source *src = (struct sim_source *)rec->source_data;
+	if(!src)
+		return;
+	src->running = 0;
+	if(src->thread) {
+		audio_source_thread_join(src->thread);
+		src->thread = NULL;
+	}
+	sim_source_free(src);
+	rec->source_data = NULL;
+}
+
+static int sim_is_stopped(struct recorder *rec)
+{
+	struct sim_source *src = (struct sim_source *)rec->source_data;
+	return src == NULL || src->thread == NULL || src->exited;
+}
+
+static unsigned int sim_dev_num(void)
+{
+	return 1;
+}
+
+static int sim_default_dev(void)
+{
+	return 0;
+}
+
+/* -------------------------------------
+ * file source
+ --------------------------------------*/
+static unsigned int read_le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned int read_le16(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/* find the "data" chunk of a WAV file; raw PCM files are used as they are */
+static int locate_pcm_data(struct sim_source *src, WAVEFORMATEX *fmt)
+{
+	unsigned char hdr[12];
+	unsigned char chunk[8];
+	unsigned char fmtbuf[16];
+	unsigned long long file_len;
+	unsigned long long off;
+	unsigned int size;
+
+	fseek(src->fp, 0, SEEK_END);
+	file_len = (unsigned long long)ftell(src->fp);
+	fseek(src->fp, 0, SEEK_SET);
+
+	if(fread(hdr, 1, sizeof(hdr), src->fp) != sizeof(hdr)
+		|| memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) {
+		src->data_offset = 0;
+		src->data_len = file_len;
+		return 0;
+	}
+
+	off = 12;
+	while(off + 8 <= file_len) {
+		fseek(src->fp, (long)off, SEEK_SET);
+		if(fread(chunk, 1, sizeof(chunk), src->fp) != sizeof(chunk))
+			break;
+		size = read_le32(chunk + 4);
+		if(memcmp(chunk, "fmt ", 4) == 0 && size >= sizeof(fmtbuf)) {
+			if(fread(fmtbuf, 1, sizeof(fmtbuf), src->fp) != sizeof(fmtbuf))
+				break;
+			/* the file is replayed as is, it must match the requested format */
+			if(read_le16(fmtbuf) != WAVE_FORMAT_PCM
+				|| read_le16(fmtbuf + 2) != fmt->nChannels
+				|| read_le32(fmtbuf + 4) != fmt->nSamplesPerSec
+				|| read_le16(fmtbuf + 14) != fmt->wBitsPerSample)
+				return -RECORD_ERR_INVAL;
+		} else if(memcmp(chunk, "data", 4) == 0) {
+			src->data_offset = off + 8;
+			src->data_len = size;
+			if(src->data_offset + src->data_len > file_len)
+				src->data_len = file_len - src->data_offset;
+			return 0;
+		}
+		off += 8 + size + (size & 1);
+	}
+	return -RECORD_ERR_INVAL;
+}
+
+static unsigned int file_fill(struct sim_source *src, char *buf, unsigned int len)
+{
+	unsigned long long pos = src->pos;
+	unsigned int done = 0;
+	unsigned int n;
+
+	if(src->data_len < src->block_align)
+		return 0;
+
+	while(done < len) {
+		if(pos >= src->data_len) {
+			if(!src->loop)
+				break;
+			pos %= src->data_len;
+		}
+		n = len - done;
+		if(n > src->data_len - pos)
+			n = (unsigned int)(src->data_len - pos);
+		fseek(src->fp, (long)(src->data_offset + pos), SEEK_SET);
+		n = (unsigned int)fread(buf + done, 1, n, src->fp);
+		if(n == 0)
+			break;
+		done += n;
+		pos += n;
+	}
+	return done / src->block_align * src->block_align;
+}
+
+static int file_open(struct recorder *rec, unsigned int dev, WAVEFORMATEX *fmt)
+{
+	const struct audio_source_config *cfg = audio_source_current();
+	struct sim_source *src;
+	int ret;
+
+	(void)dev;
+	ret = check_format(fmt);
+	if(ret != 0)
+		return ret;
+	if(cfg->path == NULL)
+		return -RECORD_ERR_INVAL;
+
+	src = sim_source_new(rec, fmt);
+	if(!src)
+		return -RECORD_ERR_MEMFAIL;
+
+	src->fp = fopen(cfg->path, "rb");
+	if(!src->fp) {
+		sim_source_free(src);
+		return -RECORD_ERR_INVAL;
+	}
+	ret = locate_pcm_data(src, fmt);
+	if(ret != 0) {
+		sim_source_free(src);
+		return ret;
+	}
+
+	src->fill = file_fill;
+	rec->source_data = src;
+	return 0;
+}
+
+/* -------------------------------------
+ * synthetic source
+ --------------------------------------*/
+static unsigned int synth_fill(struct sim_source *src, char *buf, unsigned int len)
+{
+	short *out = (short *)buf;
+	unsigned long long frame = src->pos / src->block_align;
+	unsigned int frames = len / src->block_align;
+	unsigned long long cycle_frames = 0;
+	unsigned long long on_frames = 0;
+	unsigned int i, c;
+	short v;
+
+	if(src->burst_on_ms > 0) {
+		on_frames = (unsigned long long)src->sample_rate * src->burst_on_ms / 1000;
+		cycle_frames = on_frames + (unsigned long long)src->sample_rate * src->burst_off_ms / 1000;
+	}
+
+	for(i = 0; i < frames; i++, frame++) {
+		v = 0;
+		if(src->tone_hz > 0 && (cycle_frames == 0 || frame % cycle_frames < on_frames)) {
+			/* phase from the absolute sample index keeps the tone continuous across periods */
+			double t = (double)(frame % src->sample_rate) / src->sample_rate;
+			v = (short)(src->level * sin(2 * M_PI * src->tone_hz * t));
+		}
+		for(c = 0; c < src->channels; c++)
+			*out++ = v;
+	}
+	return frames * src->block_align;
+}
+
+static int synth_open(struct recorder *rec, unsigned int dev, WAVEFORMATEX *fmt)
+{
+	struct sim_source *src;
+	int ret;
+
+	(void)dev;
+	ret = check_format(fmt);
+	if(ret != 0)
+		return ret;
+
+	src = sim_source_new(rec, fmt);
+	if(!src)
+		return -RECORD_ERR_MEMFAIL;
+
+	src->fill = synth_fill;
+	rec->source_data = src;
+	return 0;
+}
+
+const struct audio_source_ops file_source_ops = {
+	"file",
+	sim_dev_num,
+	sim_default_dev,
+	file_open,
+	sim_close,
+	sim_start,
+	sim_stop,
+	sim_is_stopped
+};
+
+const struct audio_source_ops synth_source_ops = {
+	"synth",
+	sim_dev_num,
+	sim_default_dev,
+	synth_open,
+	sim_close,
+	sim_start,
+	sim_stop,
+	sim_is_stopped
+};
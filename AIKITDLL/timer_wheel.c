@@ -0,0 +1,236 @@
+/*
+@file
+@brief hierarchical timer wheel for session deadlines
+
+	Same layout as the classic kernel wheel: a timer lives in level 0 slot
+	(expires & 63) when due within 64 ticks, otherwise in the level whose
+	span covers it, indexed by the matching bits of its expiry. Each time
+	the level 0 index wraps, the next slot of level 1 is redistributed,
+	and so on upwards. tw->now is the next tick still to be processed.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "timer_wheel.h"
+
+#define TW_BITS		6
+#define TW_SIZE		(1 << TW_BITS)
+#define TW_MASK		(TW_SIZE - 1)
+#define TW_LEVELS	4
+#define TW_MAX_DELTA	((1ULL << (TW_BITS * TW_LEVELS)) - 1)
+
+struct timer_wheel {
+	unsigned int tick_us;
+	unsigned long long now;		/* next tick to process */
+	struct tw_link slots[TW_LEVELS][TW_SIZE];
+	struct timer_wheel_stats stats;
+};
+
+static void list_init(struct tw_link *head)
+{
+	head->next = head;
+	head->prev = head;
+}
+
+static int list_empty(const struct tw_link *head)
+{
+	return head->next == head;
+}
+
+static void list_add_tail(struct tw_link *head, struct tw_link *node)
+{
+	node->prev = head->prev;
+	node->next = head;
+	head->prev->next = node;
+	head->prev = node;
+}
+
+static void list_del(struct tw_link *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->next = NULL;
+	node->prev = NULL;
+}
+
+/* move all of src to the empty dst, leaving src empty */
+static void list_splice_init(struct tw_link *src, struct tw_link *dst)
+{
+	if(list_empty(src)) {
+		list_init(dst);
+		return;
+	}
+	dst->next = src->next;
+	dst->prev = src->prev;
+	dst->next->prev = dst;
+	dst->prev->next = dst;
+	list_init(src);
+}
+
+/* place t by its expiry relative to tw->now */
+static void place(struct timer_wheel *tw, struct tw_timer *t)
+{
+	unsigned long long expires = t->expires;
+	unsigned long long delta;
+	int level;
+
+	if(expires < tw->now) {
+		/* already due: the slot processed next */
+		list_add_tail(&tw->slots[0][tw->now & TW_MASK], &t->link);
+		return;
+	}
+	delta = expires - tw->now;
+	if(delta > TW_MAX_DELTA) {
+		expires = tw->now + TW_MAX_DELTA;
+		t->expires = expires;
+		delta = TW_MAX_DELTA;
+	}
+	for(level = 0; level < TW_LEVELS - 1; ++level) {
+		if(delta < (1ULL << (TW_BITS * (level + 1))))
+			break;
+	}
+	list_add_tail(&tw->slots[level][(expires >> (TW_BITS * level)) & TW_MASK], &t->link);
+}
+
+/* redistribute one slot of a higher level, returns the slot index */
+static unsigned int cascade(struct timer_wheel *tw, int level)
+{
+	unsigned int index = (unsigned int)((tw->now >> (TW_BITS * level)) & TW_MASK);
+	struct tw_link work;
+	struct tw_link *node;
+
+	list_splice_init(&tw->slots[level][index], &work);
+	while(!list_empty(&work)) {
+		node = work.next;
+		list_del(node);
+		place(tw, (struct tw_timer *)node);
+		tw->stats.cascaded++;
+	}
+	return index;
+}
+
+struct timer_wheel *timer_wheel_create(unsigned int tick_us, unsigned long long now_us)
+{
+	struct timer_wheel *tw;
+	int level, i;
+
+	if(tick_us == 0)
+		return NULL;
+	tw = (struct timer_wheel *)calloc(1, sizeof(*tw));
+	if(!tw)
+		return NULL;
+	tw->tick_us = tick_us;
+	tw->now = now_us / tick_us;
+	for(level = 0; level < TW_LEVELS; ++level) {
+		for(i = 0; i < TW_SIZE; ++i)
+			list_init(&tw->slots[level][i]);
+	}
+	return tw;
+}
+
+void timer_wheel_destroy(struct timer_wheel *tw)
+{
+	free(tw);
+}
+
+void tw_timer_init(struct tw_timer *t, tw_callback fn, void *arg)
+{
+	t->link.next = NULL;
+	t->link.prev = NULL;
+	t->expires = 0;
+	t->fn = fn;
+	t->arg = arg;
+}
+
+int tw_timer_pending(const struct tw_timer *t)
+{
+	return t->link.next != NULL;
+}
+
+void timer_wheel_arm(struct timer_wheel *tw, struct tw_timer *t, unsigned long long deadline_us)
+{
+	if(tw_timer_pending(t)) {
+		list_del(&t->link);
+		tw->stats.pending--;
+	}
+	/* round up: never fire before the deadline */
+	t->expires = (deadline_us + tw->tick_us - 1) / tw->tick_us;
+	place(tw, t);
+	tw->stats.pending++;
+	tw->stats.armed++;
+}
+
+int timer_wheel_cancel(struct timer_wheel *tw, struct tw_timer *t)
+{
+	if(!tw_timer_pending(t))
+		return 0;
+	list_del(&t->link);
+	tw->stats.pending--;
+	tw->stats.cancelled++;
+	return 1;
+}
+
+unsigned int timer_wheel_advance(struct timer_wheel *tw, unsigned long long now_us)
+{
+	unsigned long long target = now_us / tw->tick_us;
+	unsigned int fired = 0;
+	struct tw_link work;
+	struct tw_link *node;
+	struct tw_timer *t;
+	unsigned int index;
+	int level;
+
+	while(tw->now <= target) {
+		if(tw->stats.pending == 0) {
+			/* nothing to cascade or fire: jump straight to the target */
+			tw->now = target + 1;
+			break;
+		}
+		index = (unsigned int)(tw->now & TW_MASK);
+		if(index == 0) {
+			for(level = 1; level < TW_LEVELS; ++level) {
+				if(cascade(tw, level) != 0)
+					break;
+			}
+		}
+		tw->now++;
+		tw->stats.ticks++;
+
+		list_splice_init(&tw->slots[0][index], &work);
+		while(!list_empty(&work)) {
+			/* one at a time: the callback may cancel timers still on the work list */
+			node = work.next;
+			list_del(node);
+			tw->stats.pending--;
+			tw->stats.fired++;
+			fired++;
+			t = (struct tw_timer *)node;
+			if(t->fn)
+				t->fn(t, t->arg);
+		}
+	}
+	return fired;
+}
+
+long long timer_wheel_next_us(const struct timer_wheel *tw, unsigned long long now_us)
+{
+	unsigned long long tick;
+	unsigned long long due_us;
+	unsigned int i;
+
+	if(tw->stats.pending == 0)
+		return -1;
+	/* the rest of the current level 0 round, then the next cascade */
+	tick = tw->now;
+	for(i = (unsigned int)(tw->now & TW_MASK); i < TW_SIZE; ++i, ++tick) {
+		if(!list_empty(&tw->slots[0][i]))
+			break;
+	}
+	due_us = tick * tw->tick_us;
+	return due_us > now_us ? (long long)(due_us - now_us) : 0;
+}
+
+void timer_wheel_get_stats(const struct timer_wheel *tw, struct timer_wheel_stats *stats)
+{
+	*stats = tw->stats;
+}
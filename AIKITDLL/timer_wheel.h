@@ -0,0 +1,80 @@
+/*
+@file
+@brief hierarchical timer wheel for session deadlines
+
+	Four levels of 64 slots. Level 0 holds timers due within 64 ticks,
+	each further level covers 64 times the span of the one below, so with
+	a 10ms tick the wheel reaches about 46 hours (later deadlines are
+	clamped). Arming and cancelling are O(1) list operations; a timer only
+	moves when its level 1..3 slot is cascaded down as time reaches it.
+
+	The wheel does no locking and reads no clock: the owner passes the
+	time in and serialises all calls. Callbacks run inside
+	timer_wheel_advance() and may arm or cancel any timer, themselves
+	included.
+*/
+
+#ifndef __AIKIT_TIMER_WHEEL_H__
+#define __AIKIT_TIMER_WHEEL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct timer_wheel;
+struct tw_timer;
+
+typedef void (*tw_callback)(struct tw_timer *t, void *arg);
+
+struct tw_link {
+	struct tw_link *next;
+	struct tw_link *prev;
+};
+
+/* embedded by the caller, must stay valid while pending */
+struct tw_timer {
+	struct tw_link link;		/* slot list, next == NULL while not pending */
+	unsigned long long expires;	/* tick */
+	tw_callback fn;
+	void *arg;
+};
+
+struct timer_wheel_stats {
+	unsigned int pending;
+	unsigned long long armed;
+	unsigned long long cancelled;	/* cancelled while pending */
+	unsigned long long fired;
+	unsigned long long cascaded;	/* timers moved down a level */
+	unsigned long long ticks;	/* ticks processed one by one */
+};
+
+/* tick_us is the resolution; now_us is the caller's clock at creation.
+ * returns NULL on bad parameters or out of memory */
+struct timer_wheel *timer_wheel_create(unsigned int tick_us, unsigned long long now_us);
+/* pending timers are forgotten, never called */
+void timer_wheel_destroy(struct timer_wheel *tw);
+
+void tw_timer_init(struct tw_timer *t, tw_callback fn, void *arg);
+int tw_timer_pending(const struct tw_timer *t);
+
+/* (re)arm t to fire at the first tick at or after deadline_us.
+ * a deadline already passed fires on the next advance */
+void timer_wheel_arm(struct timer_wheel *tw, struct tw_timer *t, unsigned long long deadline_us);
+/* returns 1 if t was pending, 0 if it had already fired or was never armed */
+int timer_wheel_cancel(struct timer_wheel *tw, struct tw_timer *t);
+
+/* run every timer due at or before now_us, returns how many fired */
+unsigned int timer_wheel_advance(struct timer_wheel *tw, unsigned long long now_us);
+
+/* microseconds from now_us until the wheel next needs advancing:
+ * -1 with nothing pending, 0 if already due. may be early (a cascade
+ * that turns out to bring nothing due), never late */
+long long timer_wheel_next_us(const struct timer_wheel *tw, unsigned long long now_us);
+
+void timer_wheel_get_stats(const struct timer_wheel *tw, struct timer_wheel_stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
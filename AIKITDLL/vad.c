@@ -0,0 +1,238 @@
+/*
+@file
+@brief energy + zero-crossing voice activity gate in front of the engines
+
+	Per frame features are the sum of squares and the number of sign changes.
+	Both are computed eight samples at a time with SSE2 on x86 and by a
+	scalar loop elsewhere. Frames split across calls are carried in a small
+	buffer so every decision is made on a whole 10ms frame.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "vad.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VAD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define VAD_FRAME_MS		10
+#define VAD_MAX_FRAME		480	/* 48khz x 10ms */
+#define VAD_SPEECH_RATIO	8.0	/* speech: energy above noise floor x this (~9dB) */
+#define VAD_LOUD_RATIO		64.0	/* this far above the floor counts as speech whatever the ZCR */
+#define VAD_MIN_ENERGY		(60.0 * 60.0)	/* mean square below this is silence for sure */
+#define VAD_MAX_ZCR		0.45	/* zero crossings per sample above this look like hiss */
+#define VAD_FLOOR_RISE		0.002	/* noise floor follows rising energy slowly */
+#define VAD_FLOOR_RISE_SPEECH	0.0005	/* and slower still during speech, so a steady loud noise is learned in a few seconds */
+#define VAD_FLOOR_FALL		0.2	/* and falling energy quickly */
+
+struct vad_gate {
+	unsigned int frame_len;		/* samples per frame */
+	unsigned int preroll;		/* samples */
+	unsigned int hangover;		/* frames, 0 latches */
+
+	short frame[VAD_MAX_FRAME];	/* frame split across calls */
+	unsigned int frame_fill;
+	short prev;			/* last sample before the current frame */
+
+	double noise;			/* mean square noise floor, 0 before the first frame */
+	int open;
+	unsigned int hang_left;		/* frames left before closing */
+	unsigned long long withheld_run;	/* samples withheld since the gate closed */
+
+	struct vad_gate_stats stats;
+};
+
+/* sum of squares and sign changes of n samples, prev is the sample before x[0] */
+static void frame_features(const short *x, unsigned int n, short prev,
+		unsigned long long *energy, unsigned int *crossings)
+{
+	unsigned long long e = 0;
+	unsigned int zc = 0;
+	unsigned int i = 0;
+
+	if(n == 0) {
+		*energy = 0;
+		*crossings = 0;
+		return;
+	}
+	zc = ((prev ^ x[0]) < 0);
+
+#ifdef VAD_SSE2
+	{
+		__m128i acc = _mm_setzero_si128();	/* two 64bit lanes */
+		__m128i cnt = _mm_setzero_si128();	/* eight 16bit lanes */
+		const __m128i zero = _mm_setzero_si128();
+		unsigned int k;
+
+		/* crossings between x[i+k] and x[i+k+1], so stop one short of the end */
+		for(; i + 8 < n; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(x + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(x + i + 1));
+			/* a*a pairwise sums fit in an unsigned 32bit lane */
+			__m128i sq = _mm_madd_epi16(a, a);
+			acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+			acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+			/* sign of a^b is set on a crossing, srai turns it into -1 */
+			cnt = _mm_sub_epi16(cnt, _mm_srai_epi16(_mm_xor_si128(a, b), 15));
+		}
+		{
+			unsigned long long lanes[2];
+			unsigned short counts[8];
+			_mm_storeu_si128((__m128i *)lanes, acc);
+			_mm_storeu_si128((__m128i *)counts, cnt);
+			e = lanes[0] + lanes[1];
+			for(k = 0; k < 8; k++)
+				zc += counts[k];
+		}
+	}
+#endif
+	for(; i < n; i++) {
+		e += (unsigned long long)((int)x[i] * (int)x[i]);
+		if(i + 1 < n)
+			zc += ((x[i] ^ x[i + 1]) < 0);
+	}
+	*energy = e;
+	*crossings = zc;
+}
+
+/* updates the noise floor and returns whether the frame is speech */
+static int classify_frame(struct vad_gate *gate, const short *x)
+{
+	unsigned long long sum;
+	unsigned int crossings;
+	double energy, zcr;
+	int speech;
+
+	frame_features(x, gate->frame_len, gate->prev, &sum, &crossings);
+	gate->prev = x[gate->frame_len - 1];
+
+	energy = (double)sum / gate->frame_len;
+	zcr = (double)crossings / gate->frame_len;
+	if(gate->noise <= 0)
+		gate->noise = energy > VAD_MIN_ENERGY ? energy : VAD_MIN_ENERGY;
+
+	speech = energy > VAD_MIN_ENERGY
+		&& ((energy > gate->noise * VAD_SPEECH_RATIO && zcr < VAD_MAX_ZCR)
+			|| energy > gate->noise * VAD_LOUD_RATIO);
+
+	if(energy < gate->noise)
+		gate->noise += (energy - gate->noise) * VAD_FLOOR_FALL;
+	else
+		gate->noise += (energy - gate->noise) * (speech ? VAD_FLOOR_RISE_SPEECH : VAD_FLOOR_RISE);
+	if(gate->noise < VAD_MIN_ENERGY / VAD_SPEECH_RATIO)
+		gate->noise = VAD_MIN_ENERGY / VAD_SPEECH_RATIO;
+
+	gate->stats.frames++;
+	if(speech)
+		gate->stats.speech_frames++;
+	return speech;
+}
+
+/* advances the open / hangover state by one frame */
+static void update_state(struct vad_gate *gate, int speech, int *opened)
+{
+	if(speech) {
+		if(!gate->open) {
+			gate->open = 1;
+			gate->stats.opens++;
+			*opened = 1;
+		}
+		gate->hang_left = gate->hangover;
+	} else if(gate->open && gate->hangover > 0) {
+		if(gate->hang_left > 0)
+			gate->hang_left--;
+		if(gate->hang_left == 0)
+			gate->open = 0;
+	}
+}
+
+struct vad_gate *vad_gate_create(unsigned int sample_rate, unsigned int preroll_ms, unsigned int hangover_ms)
+{
+	struct vad_gate *gate;
+	unsigned int frame_len = sample_rate * VAD_FRAME_MS / 1000;
+
+	if(frame_len == 0 || frame_len > VAD_MAX_FRAME)
+		return NULL;
+
+	gate = (struct vad_gate *)calloc(1, sizeof(*gate));
+	if(gate == NULL)
+		return NULL;
+	gate->frame_len = frame_len;
+	gate->preroll = sample_rate / 1000 * preroll_ms;
+	gate->hangover = (hangover_ms + VAD_FRAME_MS - 1) / VAD_FRAME_MS;
+	return gate;
+}
+
+void vad_gate_destroy(struct vad_gate *gate)
+{
+	free(gate);
+}
+
+void vad_gate_reset(struct vad_gate *gate)
+{
+	gate->frame_fill = 0;
+	gate->open = 0;
+	gate->hang_left = 0;
+	gate->withheld_run = 0;
+}
+
+int vad_gate_process(struct vad_gate *gate, const short *pcm, unsigned int samples, unsigned int *replay)
+{
+	int was_open = gate->open;
+	int any_open = gate->open;
+	int opened = 0;
+	unsigned int i = 0;
+
+	if(replay)
+		*replay = 0;
+	if(pcm == NULL || samples == 0)
+		return gate->open;
+
+	/* finish a frame left over from the previous call */
+	if(gate->frame_fill > 0) {
+		unsigned int n = gate->frame_len - gate->frame_fill;
+		if(n > samples)
+			n = samples;
+		memcpy(gate->frame + gate->frame_fill, pcm, n * sizeof(short));
+		gate->frame_fill += n;
+		i = n;
+		if(gate->frame_fill == gate->frame_len) {
+			update_state(gate, classify_frame(gate, gate->frame), &opened);
+			any_open |= gate->open;
+			gate->frame_fill = 0;
+		}
+	}
+
+	for(; i + gate->frame_len <= samples; i += gate->frame_len) {
+		update_state(gate, classify_frame(gate, pcm + i), &opened);
+		any_open |= gate->open;
+	}
+
+	if(i < samples) {
+		gate->frame_fill = samples - i;
+		memcpy(gate->frame, pcm + i, gate->frame_fill * sizeof(short));
+	}
+
+	gate->stats.samples += samples;
+	if(!any_open) {
+		gate->withheld_run += samples;
+		gate->stats.withheld += samples;
+		return 0;
+	}
+
+	if(opened && !was_open && replay) {
+		unsigned long long n = gate->withheld_run < gate->preroll ? gate->withheld_run : gate->preroll;
+		*replay = (unsigned int)n;
+		gate->stats.replayed += n;
+	}
+	gate->withheld_run = 0;
+	gate->stats.passed += samples;
+	return 1;
+}
+
+void vad_gate_get_stats(const struct vad_gate *gate, struct vad_gate_stats *stats)
+{
+	*stats = gate->stats;
+}
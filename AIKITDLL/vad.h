@@ -0,0 +1,55 @@
+/*
+@file
+@brief energy + zero-crossing voice activity gate in front of the engines
+
+	Audio is classified in 10ms frames. A frame counts as speech when its
+	energy is well above an adaptive noise floor and its zero-crossing rate
+	looks like voice rather than hiss (very loud frames pass regardless).
+	The gate stays open for hangover_ms after the last speech frame, and
+	when it opens it asks the caller to replay up to preroll_ms of the audio
+	it withheld, so speech onsets reach the engine intact.
+*/
+
+#ifndef __AIKIT_VAD_H__
+#define __AIKIT_VAD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VAD_DEFAULT_PREROLL_MS		300
+#define VAD_DEFAULT_HANGOVER_MS		500
+
+struct vad_gate;
+
+struct vad_gate_stats {
+	unsigned long long samples;	/* classified */
+	unsigned long long passed;	/* returned as open */
+	unsigned long long withheld;	/* returned as closed */
+	unsigned long long replayed;	/* withheld earlier, then replayed as pre-roll */
+	unsigned long long frames;
+	unsigned long long speech_frames;
+	unsigned int opens;		/* closed -> open transitions */
+};
+
+/* hangover_ms == 0 latches the gate open after the first speech frame
+ * until vad_gate_reset(). returns NULL on bad parameters or out of memory */
+struct vad_gate *vad_gate_create(unsigned int sample_rate, unsigned int preroll_ms, unsigned int hangover_ms);
+void vad_gate_destroy(struct vad_gate *gate);
+
+/* closes the gate and forgets the withheld audio, keeps the noise floor and stats */
+void vad_gate_reset(struct vad_gate *gate);
+
+/* classify samples of 16bit mono audio following the previous call.
+ * returns 1 if they should go to the engine, 0 to withhold them.
+ * when the gate opens in this call, *replay gets the number of samples
+ * withheld just before pcm that should be sent first (0 otherwise) */
+int vad_gate_process(struct vad_gate *gate, const short *pcm, unsigned int samples, unsigned int *replay);
+
+void vad_gate_get_stats(const struct vad_gate *gate, struct vad_gate_stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -13,6 +13,7 @@
 #include <process.h>
 #include <errno.h>
 #include "winrec.h"
+#include "audiosrc.h"
 
 #pragma comment(lib, "winmm.lib") 
 
@@ -25,21 +26,12 @@
 #endif
 
 
-/* Do not change the sequence */
-enum {
-	RECORD_STATE_CREATED,	/* Init		*/
-	RECORD_STATE_READY,		/* Opened	*/
-	RECORD_STATE_STOPPING,	/* During Stop	*/
-	RECORD_STATE_RECORDING,	/* Started	*/
-};
-
 #define SAMPLE_RATE  16000
 #define SAMPLE_BIT_SIZE 16
-#define FRAME_CNT   10
-#define BUF_COUNT   4
 
 
 static void free_rec_buffer(HWAVEIN wi, WAVEHDR *first_header, unsigned headercount);
+static unsigned int grow_rec_buffer(struct recorder *rec, HWAVEIN wi, unsigned int count);
 static void data_proc(struct recorder *rec, MSG *msg);
 static unsigned int  __stdcall record_thread_proc ( void * para);
 
@@ -155,10 +147,11 @@ static int prepare_rec_buffer(HWAVEIN wi, WAVEHDR ** bufheader_out, unsigned int
 	if(headercount < 2 || bufheader_out == NULL)
 		return -RECORD_ERR_INVAL;
 	
-	header = (WAVEHDR *)malloc(sizeof(WAVEHDR) * headercount);
+	/* room for the deepest queue, so headers never move while the driver owns them */
+	header = (WAVEHDR *)malloc(sizeof(WAVEHDR) * RECORD_MAX_DEPTH);
 	if(!header)
 		return - RECORD_ERR_MEMFAIL;
-	memset(header, 0, sizeof(WAVEHDR) * headercount);
+	memset(header, 0, sizeof(WAVEHDR) * RECORD_MAX_DEPTH);
 
 	for(i = 0; i < headercount; ++i) {
 		(header+i)->lpData = (LPSTR)malloc(bufsize);
@@ -205,6 +198,36 @@ static void free_rec_buffer(HWAVEIN wi, WAVEHDR *first_header, unsigned headerco
 	free(first_header);
 }
 
+/* called on the callback thread while recording: prepare more buffers and queue them */
+static unsigned int grow_rec_buffer(struct recorder *rec, HWAVEIN wi, unsigned int count)
+{
+	WAVEHDR *header;
+	unsigned int added = 0;
+
+	while(added < count && rec->bufcount < RECORD_MAX_DEPTH) {
+		header = (WAVEHDR *)rec->bufheader + rec->bufcount;
+		header->lpData = (LPSTR)malloc(rec->period_bytes);
+		if(header->lpData == NULL)
+			break;
+		header->dwBufferLength = rec->period_bytes;
+		header->dwFlags = 0;
+		header->dwUser = rec->bufcount + 1;
+		if(waveInPrepareHeader(wi, header, sizeof(WAVEHDR)) != MMSYSERR_NOERROR) {
+			free(header->lpData);
+			header->lpData = NULL;
+			break;
+		}
+		/* counted once prepared, so close frees it even if the add fails */
+		rec->bufcount++;
+		rec->depth = rec->bufcount;
+		if(waveInAddBuffer(wi, header, sizeof(WAVEHDR)) != MMSYSERR_NOERROR)
+			break;
+		rec->queued++;
+		added++;
+	}
+	return added;
+}
+
 static void close_rec_device(HWAVEIN wi)
 {
 	if(wi != NULL) {
@@ -294,6 +317,8 @@ static void data_proc(struct recorder *rec, MSG *msg)
 {
 	HWAVEIN whdl;
 	WAVEHDR *buf;
+	unsigned long long now;
+	int overrun;
 
 	whdl = (HWAVEIN)msg->wParam;
 	buf = (WAVEHDR *)msg->lParam;
@@ -307,12 +332,27 @@ static void data_proc(struct recorder *rec, MSG *msg)
 		return;
 	}
 
+	/* the last queued buffer came back: the driver has had nowhere to
+	   write since this message was posted, until the buffer is re-added */
+	if(rec->queued > 0)
+		rec->queued--;
+	overrun = (rec->queued == 0 && rec->state == RECORD_STATE_RECORDING);
+	now = audio_source_now_us();
+	record_account_period(rec, buf->dwBytesRecorded, now);
+
 	rec->on_data_ind(buf->lpData, buf->dwBytesRecorded, rec->user_cb_para);
 
 	switch(rec->state)	{
 	case RECORD_STATE_RECORDING:
 		// after copied, put it into the queue of driver again.
-		waveInAddBuffer(whdl, buf, sizeof(WAVEHDR));
+		if(waveInAddBuffer(whdl, buf, sizeof(WAVEHDR)) == MMSYSERR_NOERROR)
+			rec->queued++;
+		if(overrun) {
+			unsigned long long stall_us = (unsigned long long)(DWORD)(GetTickCount() - (DWORD)msg->time) * 1000;
+			unsigned int add = record_account_overrun(rec, stall_us, now);
+			if(add > 0 && grow_rec_buffer(rec, whdl, add) > 0)
+				rec->stats.grows++;
+		}
 		break;
 	case RECORD_STATE_STOPPING:
 	default:
@@ -351,7 +391,7 @@ static int open_recorder_internal(struct recorder * rec, unsigned int dev, WAVEF
 	unsigned int buf_size;
 	int ret = 0;
 
-	rec->bufcount = BUF_COUNT;
+	rec->bufcount = rec->depth;
 	rec->wavein_hdl = NULL;
 	rec->rec_thread_hdl = NULL;
 	ret = create_callback_thread((void *)rec, &rec->rec_thread_hdl);
@@ -363,10 +403,8 @@ static int open_recorder_internal(struct recorder * rec, unsigned int dev, WAVEF
 		goto fail;
 	}
 
-	if(fmt)
-		buf_size =  fmt->nBlockAlign *(fmt->nSamplesPerSec/50) * FRAME_CNT; // 200ms
-	else
-		buf_size = FRAME_CNT * 20 * 16 * 2;  // 16khz, 16bit, 200ms;
+	/* one period per buffer, sized by the recorder layer */
+	buf_size = rec->period_bytes;
 	
 	ret = prepare_rec_buffer((HWAVEIN)rec->wavein_hdl,  (WAVEHDR **)&rec->bufheader, rec->bufcount , buf_size);
 	if(ret != 0 ) {
@@ -413,108 +451,37 @@ static void close_recorder_internal(struct recorder *rec)
 }
 
 /* -------------------------------------
- * Interfaces 
+ * waveIn source, driven by the recorder layer in recorder.c
  --------------------------------------*/ 
-int get_default_input_dev()
-{
-	return WAVE_MAPPER;
-}
-
-unsigned int get_input_dev_num()
+static unsigned int wavein_dev_num(void)
 {
 	return waveInGetNumDevs();
 }
 
-/* callback will be run on a new thread */
-int create_recorder(struct recorder ** out_rec, 
-				void (*on_data_ind)(char *data, unsigned long len, void *user_cb_para), 
-				void* user_cb_para)
-{
-	struct recorder * myrec;
-	myrec = (struct recorder *)malloc(sizeof(struct recorder));
-	if(!myrec)
-		return -RECORD_ERR_MEMFAIL;
-
-	memset(myrec, 0, sizeof(struct recorder));
-	myrec->on_data_ind = on_data_ind;
-	myrec->user_cb_para = user_cb_para;
-	myrec->state = RECORD_STATE_CREATED;
-
-	*out_rec = myrec;
-	return 0;
-}
-
-void destroy_recorder(struct recorder *rec)
-{
-	if(!rec)
-		return;
-
-	free(rec);
-}
-
-int open_recorder(struct recorder * rec, unsigned int dev, WAVEFORMATEX * fmt)
+static int wavein_default_dev(void)
 {
-	int ret = 0;
-	if(!rec )
-		return -RECORD_ERR_INVAL;
-	if(rec->state >= RECORD_STATE_READY)
-		return 0;
-
-	ret = open_recorder_internal(rec, dev, fmt);
-	if(ret == 0)
-		rec->state = RECORD_STATE_READY;
-	return 0;
-
-}
-
-void close_recorder(struct recorder *rec)
-{
-	if(rec == NULL || rec->state < RECORD_STATE_READY)
-		return;
-	if(rec->state == RECORD_STATE_RECORDING)
-		stop_record(rec);
-
-	close_recorder_internal(rec);
-
-	rec->state = RECORD_STATE_CREATED;	
+	return WAVE_MAPPER;
 }
 
-int start_record(struct recorder * rec)
+static int wavein_start(struct recorder *rec)
 {
-	int ret;
-	if(rec == NULL)
-		return -RECORD_ERR_INVAL;
-	if( rec->state < RECORD_STATE_READY)
-		return -RECORD_ERR_NOT_READY;
-	if( rec->state == RECORD_STATE_RECORDING)
-		return 0;
-
-	ret = start_record_internal((HWAVEIN)rec->wavein_hdl, (WAVEHDR*)rec->bufheader, rec->bufcount);
-	if(ret == 0)
-		rec->state = RECORD_STATE_RECORDING;
-	return ret;
+	/* set before the buffers go in: callbacks start as soon as waveInStart returns */
+	rec->queued = rec->bufcount;
+	return start_record_internal((HWAVEIN)rec->wavein_hdl, (WAVEHDR*)rec->bufheader, rec->bufcount);
 }
 
-int stop_record(struct recorder * rec)
+static int wavein_stop(struct recorder *rec)
 {
-	int ret;
-	if(rec == NULL)
-		return -RECORD_ERR_INVAL;
-	if( rec->state < RECORD_STATE_RECORDING)
-		return 0;
-
-	rec->state = RECORD_STATE_STOPPING;
-	ret = stop_record_internal((HWAVEIN)rec->wavein_hdl);
-	if(ret == 0) {		
-		rec->state = RECORD_STATE_READY;
-	}
-	return ret;
+	return stop_record_internal((HWAVEIN)rec->wavein_hdl);
 }
 
-int is_record_stopped(struct recorder *rec)
-{
-	if(rec->state == RECORD_STATE_RECORDING)
-		return 0;
-
-	return is_stopped_internal(rec);
-}
+const struct audio_source_ops wavein_source_ops = {
+	"wavein",
+	wavein_dev_num,
+	wavein_default_dev,
+	open_recorder_internal,
+	close_recorder_internal,
+	wavein_start,
+	wavein_stop,
+	is_stopped_internal
+};
@@ -2,7 +2,8 @@
  * @file
  * @brief a record interface in windows
  *
- * it encapsluate the windows API waveInxxx;
+ * it encapsluate the windows API waveInxxx; other capture sources (ALSA,
+ * file replay, synthetic) plug in behind the same interface, see audiosrc.h.
  * Common steps:
  *	create_recorder,
  *	open_recorder, 
@@ -18,6 +19,22 @@
 #ifndef __IFLY_WINREC_H__
 #define __IFLY_WINREC_H__
 
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#else
+/* same layout as the windows definition */
+typedef struct {
+	unsigned short wFormatTag;
+	unsigned short nChannels;
+	unsigned int nSamplesPerSec;
+	unsigned int nAvgBytesPerSec;
+	unsigned short nBlockAlign;
+	unsigned short wBitsPerSample;
+	unsigned short cbSize;
+} WAVEFORMATEX;
+#define WAVE_FORMAT_PCM 1
+#endif
 
 /* error code */
 enum {
@@ -28,6 +45,33 @@ enum {
 	RECORD_ERR_NOT_READY
 };
 
+/* capture period and queue depth, see open_recorder_ex */
+#define RECORD_DEFAULT_PERIOD_MS	200
+#define RECORD_DEFAULT_DEPTH		4
+#define RECORD_MIN_PERIOD_MS		10
+#define RECORD_MAX_PERIOD_MS		200
+#define RECORD_MIN_DEPTH			2
+#define RECORD_MAX_DEPTH			32
+
+/* queue growth: this many overruns within the window add half the depth again */
+#define RECORD_GROW_OVERRUNS		3
+#define RECORD_GROW_WINDOW_MS		10000
+
+/* capture health counters, see get_recorder_stats */
+struct record_stats {
+	unsigned long long periods;		/* buffers delivered to on_data_ind */
+	unsigned long long bytes;		/* bytes delivered */
+	unsigned int gaps;				/* discontinuities found by comparing samples delivered with the clock */
+	unsigned long long lost_bytes;	/* audio missing in those gaps, in the device format */
+	unsigned int overruns;			/* times the driver ran out of queued buffers */
+	unsigned long long stall_us;	/* total time the driver had no buffer to fill */
+	unsigned long long max_stall_us;
+	unsigned int grows;				/* times the queue was deepened after repeated overruns */
+	unsigned int depth;				/* current queue depth */
+};
+
+struct audio_source_ops;
+
 /* recorder object. */
 struct recorder {
 	void (*on_data_ind)(char *data, unsigned long len, void *user_para);
@@ -38,6 +82,30 @@ struct recorder {
 	void * rec_thread_hdl;
 	void * bufheader;
 	unsigned int bufcount;
+
+	unsigned int period_ms;		/* audio per callback */
+	unsigned int period_bytes;
+	unsigned int depth;			/* periods queued in the driver */
+
+	const struct audio_source_ops * ops;	/* capture source, see audiosrc.h */
+	void * source_data;						/* private data of non-waveIn sources */
+
+	unsigned int bytes_per_sec;		/* of the opened format */
+	unsigned int block_align;
+	struct record_stats stats;		/* kept for the recorder's lifetime */
+
+	/* capture clock, restarted by start_record, see record_account_period */
+	unsigned long long clock_start_us;
+	unsigned long long clock_bytes;		/* delivered since start */
+	int clock_valid;
+	long long clock_base_us;			/* usual delivery lag behind the clock */
+	long long window_min_us;			/* smallest lag in the current window */
+	long long window_prev_us;			/* and in the previous one */
+	int clock_pending;					/* lag raised, waiting to see if it stays */
+	unsigned int window_left;			/* periods left in the window */
+	unsigned long long overrun_first_us;	/* first overrun of the current streak */
+	unsigned int overrun_streak;
+	volatile unsigned int queued;		/* waveIn buffers in the driver */
 };
 
 #ifdef __cplusplus
@@ -48,7 +116,7 @@ extern "C" {
  * @fn
  * @brief	Get the default input device ID
  *
- * @return	returns WAVE_MAPPER in windows.
+ * @return	returns WAVE_MAPPER for waveIn, 0 for other sources.
  */
 int get_default_input_dev();
 
@@ -61,7 +129,7 @@ unsigned int get_input_dev_num();
 
 /**
  * @fn 
- * @brief	Create a recorder object.
+ * @brief	Create a recorder object bound to the current audio source.
  * @return	int			- Return 0 in success, otherwise return error code.
  * @param	out_rec		- [out] recorder object holder
  * @param	on_data_ind	- [in]	callback. called when data coming.
@@ -91,6 +159,53 @@ void destroy_recorder(struct recorder *rec);
  */
 int open_recorder(struct recorder * rec, unsigned int dev, WAVEFORMATEX * fmt);
 
+/**
+ * @fn
+ * @brief	open the device with an explicit period and queue depth.
+ *			Small periods lower the capture latency, a deeper queue
+ *			tolerates a slower callback consumer.
+ * @return	int			- Return 0 in success, otherwise return error code.
+ * @param	rec			- [in] recorder object
+ * @param	dev			- [in] device id, from 0.
+ * @param	fmt			- [in] record format.
+ * @param	period_ms	- [in] audio per callback, RECORD_MIN_PERIOD_MS..RECORD_MAX_PERIOD_MS,
+ *							multiple of 10.
+ * @param	depth		- [in] number of periods queued, RECORD_MIN_DEPTH..RECORD_MAX_DEPTH.
+ */
+int open_recorder_ex(struct recorder * rec, unsigned int dev, WAVEFORMATEX * fmt,
+				unsigned int period_ms, unsigned int depth);
+
+/**
+ * @fn
+ * @brief	Set the period and depth open_recorder uses from now on.
+ * @return	int			- Return 0 in success, otherwise return error code.
+ */
+int set_record_period(unsigned int period_ms, unsigned int depth);
+
+/**
+ * @fn
+ * @brief	Get the period and depth open_recorder uses.
+ */
+void get_record_period(unsigned int *period_ms, unsigned int *depth);
+
+/**
+ * @fn
+ * @brief	Bytes delivered per callback by an opened recorder.
+ * @return	the period size, 0 if the recorder is not opened.
+ */
+unsigned int get_recorder_period_bytes(struct recorder *rec);
+
+/**
+ * @fn
+ * @brief	Read the capture health counters of a recorder. Callable from any
+ *			thread while recording; counters are updated by the capture thread
+ *			without locking, so a snapshot may mix two consecutive periods.
+ * @return	int			- Return 0 in success, otherwise return error code.
+ * @param	rec			- [in] recorder object
+ * @param	stats		- [out] counters
+ */
+int get_recorder_stats(struct recorder *rec, struct record_stats *stats);
+
 /**
  * @fn
  * @brief	close the device.
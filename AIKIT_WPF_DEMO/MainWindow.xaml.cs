@@ -103,6 +103,9 @@ namespace AikitWpfDemo
 
                 // 清理弹窗资源
                 _popupManager.Cleanup();
+
+                // 停止DLL的后台线程并反初始化SDK
+                NativeMethods.CleanupSDK();
             }
             catch
             {